@@ -19,9 +19,18 @@
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "esp_tls_crypto.h"
+#include "esp_tls.h"
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+#include "mbedtls/ssl.h"
+#include "mbedtls/platform_util.h"
+#endif
 #include "esp_system.h"
+#include "esp_random.h"
+#include "esp_heap_caps.h"
 #include <errno.h>
 #include <arpa/inet.h>
+#include <sys/uio.h>
+#include <sys/select.h>
 
 static const char *TAG = "websocket_client";
 
@@ -43,6 +52,12 @@ static const char *TAG = "websocket_client";
 #define WEBSOCKET_TX_LOCK_TIMEOUT_MS    (CONFIG_ESP_WS_CLIENT_TX_LOCK_TIMEOUT_MS)
 #endif
 
+#if defined(CONFIG_ESP_WS_CLIENT_BUFFER_POOL_SPIRAM)
+#define WEBSOCKET_BUFFER_POOL_CAPS      (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#else
+#define WEBSOCKET_BUFFER_POOL_CAPS      (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#endif
+
 #define ESP_WS_CLIENT_MEM_CHECK(TAG, a, action) if (!(a)) {                                         \
         ESP_LOGE(TAG,"%s(%d): %s", __FUNCTION__, __LINE__, "Memory exhausted");                     \
         action;                                                                                     \
@@ -106,6 +121,7 @@ typedef struct {
     const char                  *cert_common_name;
     esp_err_t (*crt_bundle_attach)(void *conf);
     esp_transport_handle_t      ext_transport;
+    bool                        tls_session_reuse;
 } websocket_config_storage_t;
 
 typedef enum {
@@ -149,6 +165,17 @@ struct esp_websocket_client {
     int                         payload_offset;
     esp_transport_keep_alive_t  keep_alive_cfg;
     struct ifreq                *if_name;
+    esp_websocket_buffer_stats_t buf_stats;
+    uint64_t                    buf_used_tick_ms;
+    esp_websocket_data_cb_t     data_cb;
+    void                        *data_cb_ctx;
+    bool                        rx_direct_msg;  /*!< the message being received is delivered to data_cb */
+    uint8_t                     *iov_bounce;    /*!< ws:// scatter-gather send: masked payload chunk (WS_IOV_BOUNCE_SIZE) */
+    esp_websocket_tls_stats_t   tls_stats;
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    esp_tls_client_session_t    *tls_session;   /*!< last negotiated session, offered on the next connect */
+    unsigned char               tls_master[48]; /*!< master secret of tls_session, equal again after a resumed handshake */
+#endif
 };
 
 static uint64_t _tick_get_ms(void)
@@ -156,42 +183,92 @@ static uint64_t _tick_get_ms(void)
     return esp_timer_get_time() / 1000;
 }
 
-static esp_err_t esp_websocket_new_buf(esp_websocket_client_handle_t client, bool is_tx)
+static void esp_websocket_buf_count_alloc(esp_websocket_client_handle_t client, int size)
 {
+    client->buf_stats.allocs++;
+    client->buf_stats.bytes_held += size;
+    if (client->buf_stats.bytes_held > client->buf_stats.bytes_peak) {
+        client->buf_stats.bytes_peak = client->buf_stats.bytes_held;
+    }
+}
+
 #ifdef CONFIG_ESP_WS_CLIENT_ENABLE_DYNAMIC_BUFFER
-    if (is_tx) {
-        if (client->tx_buffer) {
-            free(client->tx_buffer);
-        }
+static char *esp_websocket_alloc_buf(esp_websocket_client_handle_t client)
+{
+#ifdef CONFIG_ESP_WS_CLIENT_BUFFER_POOL
+    // pooled buffers are kept across calls, every reader/writer fills what it uses, no need to zero
+    char *buf = heap_caps_malloc(client->buffer_size, WEBSOCKET_BUFFER_POOL_CAPS);
+#else
+    char *buf = calloc(1, client->buffer_size);
+#endif
+    if (buf) {
+        esp_websocket_buf_count_alloc(client, client->buffer_size);
+    }
+    return buf;
+}
 
-        client->tx_buffer = calloc(1, client->buffer_size);
-        ESP_WS_CLIENT_MEM_CHECK(TAG, client->tx_buffer, return ESP_ERR_NO_MEM);
-    } else {
-        if (client->rx_buffer) {
-            free(client->rx_buffer);
-        }
+static void esp_websocket_release_buf(esp_websocket_client_handle_t client, char **buf)
+{
+    if (*buf) {
+        free(*buf);
+        *buf = NULL;
+        client->buf_stats.frees++;
+        client->buf_stats.bytes_held -= client->buffer_size;
+    }
+}
+#endif
 
-        client->rx_buffer = calloc(1, client->buffer_size);
-        ESP_WS_CLIENT_MEM_CHECK(TAG, client->rx_buffer, return ESP_ERR_NO_MEM);
+static esp_err_t esp_websocket_new_buf(esp_websocket_client_handle_t client, bool is_tx)
+{
+#ifdef CONFIG_ESP_WS_CLIENT_ENABLE_DYNAMIC_BUFFER
+    char **buf = is_tx ? &client->tx_buffer : &client->rx_buffer;
+#ifdef CONFIG_ESP_WS_CLIENT_BUFFER_POOL
+    client->buf_used_tick_ms = _tick_get_ms();
+    if (*buf) {
+        client->buf_stats.reuses++;
+        return ESP_OK;
     }
+#else
+    esp_websocket_release_buf(client, buf);
+#endif
+    *buf = esp_websocket_alloc_buf(client);
+    ESP_WS_CLIENT_MEM_CHECK(TAG, *buf, return ESP_ERR_NO_MEM);
 #endif
     return ESP_OK;
 }
 
 static void esp_websocket_free_buf(esp_websocket_client_handle_t client, bool is_tx)
 {
-#ifdef CONFIG_ESP_WS_CLIENT_ENABLE_DYNAMIC_BUFFER
-    if (is_tx) {
-        if (client->tx_buffer) {
-            free(client->tx_buffer);
-            client->tx_buffer = NULL;
-        }
-    } else {
-        if (client->rx_buffer) {
-            free(client->rx_buffer);
-            client->rx_buffer = NULL;
-        }
+#if defined(CONFIG_ESP_WS_CLIENT_ENABLE_DYNAMIC_BUFFER) && !defined(CONFIG_ESP_WS_CLIENT_BUFFER_POOL)
+    esp_websocket_release_buf(client, is_tx ? &client->tx_buffer : &client->rx_buffer);
+#endif
+}
+
+/*
+ * Return pooled buffers to the heap when the connection is down or has been idle.
+ * Only called from the client task (the sole user of rx_buffer) with client->lock held;
+ * tx_buffer is released only if the tx lock is free right now, otherwise on a later iteration.
+ */
+static void esp_websocket_pool_trim(esp_websocket_client_handle_t client)
+{
+#ifdef CONFIG_ESP_WS_CLIENT_BUFFER_POOL
+    if (client->rx_buffer == NULL && client->tx_buffer == NULL) {
+        return;
     }
+    bool idle = CONFIG_ESP_WS_CLIENT_BUFFER_POOL_IDLE_MS > 0 &&
+                _tick_get_ms() - client->buf_used_tick_ms > CONFIG_ESP_WS_CLIENT_BUFFER_POOL_IDLE_MS;
+    if (client->state == WEBSOCKET_STATE_CONNECTED && !idle) {
+        return;
+    }
+    esp_websocket_release_buf(client, &client->rx_buffer);
+#ifdef CONFIG_ESP_WS_CLIENT_SEPARATE_TX_LOCK
+    if (xSemaphoreTakeRecursive(client->tx_lock, 0) == pdPASS) {
+        esp_websocket_release_buf(client, &client->tx_buffer);
+        xSemaphoreGiveRecursive(client->tx_lock);
+    }
+#else
+    esp_websocket_release_buf(client, &client->tx_buffer);
+#endif
 #endif
 }
 
@@ -454,6 +531,13 @@ static void destroy_and_free_resources(esp_websocket_client_handle_t client)
     free(client->tx_buffer);
     free(client->rx_buffer);
     free(client->errormsg_buffer);
+    free(client->iov_bounce);
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    if (client->tls_session) {
+        esp_tls_free_client_session(client->tls_session);
+    }
+    mbedtls_platform_zeroize(client->tls_master, sizeof(client->tls_master));
+#endif
     if (client->status_bits) {
         vEventGroupDelete(client->status_bits);
     }
@@ -493,6 +577,261 @@ static esp_err_t set_websocket_transport_optional_settings(esp_websocket_client_
     return ESP_ERR_INVALID_ARG;
 }
 
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+/*
+ * wss:// parent transport on top of esp-tls that resumes TLS sessions.
+ *
+ * transport_ssl keeps its esp_tls_cfg_t private, so there is no way to hand it a saved session.
+ * This transport builds the esp-tls configuration from the client config itself, offers the session
+ * cached in the client on connect and replaces it with the newly negotiated one afterwards. The session
+ * lives in the client, so it survives the transport list being rebuilt by esp_websocket_client_start().
+ */
+typedef struct {
+    esp_websocket_client_handle_t client;
+    esp_tls_t                     *tls;
+} ws_tls_transport_t;
+
+static int ws_tls_poll(esp_transport_handle_t t, int timeout_ms, bool write)
+{
+    ws_tls_transport_t *ctx = esp_transport_get_context_data(t);
+    int sock = -1;
+    if (ctx->tls == NULL || esp_tls_get_conn_sockfd(ctx->tls, &sock) != ESP_OK || sock < 0) {
+        return -1;
+    }
+    /* records already decrypted by mbedTLS are not visible on the socket */
+    if (!write && esp_tls_get_bytes_avail(ctx->tls) > 0) {
+        return 1;
+    }
+    fd_set set, errset;
+    FD_ZERO(&set);
+    FD_ZERO(&errset);
+    FD_SET(sock, &set);
+    FD_SET(sock, &errset);
+    struct timeval tv = {
+        .tv_sec = timeout_ms / 1000,
+        .tv_usec = (timeout_ms % 1000) * 1000,
+    };
+    int ret = select(sock + 1, write ? NULL : &set, write ? &set : NULL, &errset, timeout_ms < 0 ? NULL : &tv);
+    if (ret > 0 && FD_ISSET(sock, &errset)) {
+        int sock_errno = 0;
+        socklen_t len = sizeof(sock_errno);
+        getsockopt(sock, SOL_SOCKET, SO_ERROR, &sock_errno, &len);
+        ESP_LOGE(TAG, "poll_%s select error %d, errno = %s", write ? "write" : "read", sock_errno, strerror(sock_errno));
+        return -1;
+    }
+    return ret;
+}
+
+static int ws_tls_poll_read(esp_transport_handle_t t, int timeout_ms)
+{
+    return ws_tls_poll(t, timeout_ms, false);
+}
+
+static int ws_tls_poll_write(esp_transport_handle_t t, int timeout_ms)
+{
+    return ws_tls_poll(t, timeout_ms, true);
+}
+
+static void ws_tls_drop_session(esp_websocket_client_handle_t client)
+{
+    if (client->tls_session) {
+        esp_tls_free_client_session(client->tls_session);
+        client->tls_session = NULL;
+    }
+    mbedtls_platform_zeroize(client->tls_master, sizeof(client->tls_master));
+}
+
+/*
+ * Whether the server accepted the offered session. mbedTLS has no public query for this once the handshake
+ * is over; an abbreviated TLS 1.2 handshake reuses the master secret of the offered session, a full one
+ * derives a new one. TLS 1.3 derives fresh secrets either way and is reported as a full handshake.
+ */
+static bool ws_tls_session_resumed(esp_websocket_client_handle_t client, esp_tls_t *tls, bool offered)
+{
+    mbedtls_ssl_context *ssl = esp_tls_get_ssl_context(tls);
+    if (!offered || ssl == NULL || ssl->MBEDTLS_PRIVATE(session) == NULL ||
+            mbedtls_ssl_get_version_number(ssl) != MBEDTLS_SSL_VERSION_TLS1_2) {
+        return false;
+    }
+    return memcmp(ssl->MBEDTLS_PRIVATE(session)->MBEDTLS_PRIVATE(master), client->tls_master, sizeof(client->tls_master)) == 0;
+}
+
+static void ws_tls_save_master(esp_websocket_client_handle_t client, esp_tls_t *tls)
+{
+    mbedtls_ssl_context *ssl = esp_tls_get_ssl_context(tls);
+    if (ssl && ssl->MBEDTLS_PRIVATE(session) && mbedtls_ssl_get_version_number(ssl) == MBEDTLS_SSL_VERSION_TLS1_2) {
+        memcpy(client->tls_master, ssl->MBEDTLS_PRIVATE(session)->MBEDTLS_PRIVATE(master), sizeof(client->tls_master));
+    } else {
+        mbedtls_platform_zeroize(client->tls_master, sizeof(client->tls_master));
+    }
+}
+
+static int ws_tls_connect(esp_transport_handle_t t, const char *host, int port, int timeout_ms)
+{
+    ws_tls_transport_t *ctx = esp_transport_get_context_data(t);
+    esp_websocket_client_handle_t client = ctx->client;
+    websocket_config_storage_t *config = client->config;
+
+    esp_tls_cfg_t cfg = {
+        .timeout_ms = timeout_ms,
+        .use_global_ca_store = config->use_global_ca_store,
+        .skip_common_name = config->skip_cert_common_name_check,
+        .common_name = config->cert_common_name,
+        .crt_bundle_attach = config->crt_bundle_attach,
+        .if_name = client->if_name,
+        .client_session = client->tls_session,
+    };
+    /* PEM buffers are passed including the terminating NULL, as transport_ssl does */
+    if (!config->use_global_ca_store && config->cert) {
+        cfg.cacert_buf = (const unsigned char *)config->cert;
+        cfg.cacert_bytes = config->cert_len ? config->cert_len : strlen(config->cert) + 1;
+    }
+    if (config->client_cert) {
+        cfg.clientcert_buf = (const unsigned char *)config->client_cert;
+        cfg.clientcert_bytes = config->client_cert_len ? config->client_cert_len : strlen(config->client_cert) + 1;
+    }
+    if (config->client_key) {
+        cfg.clientkey_buf = (const unsigned char *)config->client_key;
+        cfg.clientkey_bytes = config->client_key_len ? config->client_key_len : strlen(config->client_key) + 1;
+#if CONFIG_ESP_TLS_USE_DS_PERIPHERAL
+    } else if (config->client_ds_data) {
+        cfg.ds_data = config->client_ds_data;
+#endif
+    }
+    if (client->keep_alive_cfg.keep_alive_enable) {
+        cfg.keep_alive_cfg = (tls_keep_alive_cfg_t *)&client->keep_alive_cfg;
+    }
+
+    ctx->tls = esp_tls_init();
+    if (ctx->tls == NULL) {
+        return -1;
+    }
+    bool offered = client->tls_session != NULL;
+    uint64_t start_ms = _tick_get_ms();
+    if (esp_tls_conn_new_sync(host, strlen(host), port, &cfg, ctx->tls) <= 0) {
+        ESP_LOGE(TAG, "Failed to open a new TLS connection%s", offered ? " (offering cached session)" : "");
+        esp_tls_error_handle_t error_handle = NULL;
+        bool handshake_failed = esp_tls_get_error_handle(ctx->tls, &error_handle) == ESP_OK && error_handle &&
+                                error_handle->last_error == ESP_ERR_MBEDTLS_SSL_HANDSHAKE_FAILED;
+        esp_tls_conn_destroy(ctx->tls);
+        ctx->tls = NULL;
+        client->tls_stats.failures++;
+        /* a handshake error may come from a session the server no longer knows (restart, ticket key rotation),
+         * don't offer it again; DNS/TCP failures (e.g. a Wi-Fi blip) keep it for the next attempt */
+        if (handshake_failed) {
+            ws_tls_drop_session(client);
+        }
+        return -1;
+    }
+    uint32_t elapsed = (uint32_t)(_tick_get_ms() - start_ms);
+    bool resume = ws_tls_session_resumed(client, ctx->tls, offered);
+
+    esp_websocket_tls_stats_t *st = &client->tls_stats;
+    if (offered) {
+        st->offered++;
+    }
+    uint32_t *avg = resume ? &st->resumed_avg_ms : &st->full_avg_ms;
+    uint32_t n = resume ? ++st->resumed : st->handshakes + 1 - st->resumed;
+    *avg = (uint32_t)(((uint64_t)*avg * (n - 1) + elapsed) / n);
+    st->handshakes++;
+    st->last_ms = elapsed;
+    st->last_resumed = resume;
+    if (elapsed > st->max_ms) {
+        st->max_ms = elapsed;
+    }
+    ESP_LOGD(TAG, "TLS handshake %" PRIu32 " ms (%s%s)", elapsed, resume ? "resumed" : "full",
+             (offered && !resume) ? ", cached session rejected" : "");
+
+    esp_tls_client_session_t *session = esp_tls_get_client_session(ctx->tls);
+    if (session) {
+        if (client->tls_session) {
+            esp_tls_free_client_session(client->tls_session);
+        }
+        client->tls_session = session;
+        ws_tls_save_master(client, ctx->tls);
+    }
+    return 0;
+}
+
+static int ws_tls_read(esp_transport_handle_t t, char *buffer, int len, int timeout_ms)
+{
+    ws_tls_transport_t *ctx = esp_transport_get_context_data(t);
+    int poll = ws_tls_poll_read(t, timeout_ms);
+    if (poll == -1) {
+        return ERR_TCP_TRANSPORT_CONNECTION_FAILED;
+    }
+    if (poll == 0) {
+        return ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+    }
+    int ret = esp_tls_conn_read(ctx->tls, (unsigned char *)buffer, len);
+    if (ret == ESP_TLS_ERR_SSL_WANT_READ || ret == ESP_TLS_ERR_SSL_TIMEOUT) {
+        return ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+    }
+    if (ret == 0) {
+        return ERR_TCP_TRANSPORT_CONNECTION_CLOSED_BY_FIN;
+    }
+    return ret;
+}
+
+static int ws_tls_write(esp_transport_handle_t t, const char *buffer, int len, int timeout_ms)
+{
+    ws_tls_transport_t *ctx = esp_transport_get_context_data(t);
+    int poll = ws_tls_poll_write(t, timeout_ms);
+    if (poll <= 0) {
+        ESP_LOGW(TAG, "Poll timeout or error, errno=%s, fd=%d, timeout_ms=%d", strerror(errno), esp_transport_get_socket(t), timeout_ms);
+        return poll;
+    }
+    int ret = esp_tls_conn_write(ctx->tls, (const unsigned char *)buffer, len);
+    if (ret == ESP_TLS_ERR_SSL_WANT_WRITE) {
+        return 0;
+    }
+    return ret;
+}
+
+static int ws_tls_close(esp_transport_handle_t t)
+{
+    ws_tls_transport_t *ctx = esp_transport_get_context_data(t);
+    if (ctx->tls) {
+        esp_tls_conn_destroy(ctx->tls);
+        ctx->tls = NULL;
+    }
+    return 0;
+}
+
+static int ws_tls_destroy(esp_transport_handle_t t)
+{
+    ws_tls_close(t);
+    free(esp_transport_get_context_data(t));
+    return 0;
+}
+
+static int ws_tls_get_socket(esp_transport_handle_t t)
+{
+    ws_tls_transport_t *ctx = esp_transport_get_context_data(t);
+    int sock = -1;
+    if (ctx->tls) {
+        esp_tls_get_conn_sockfd(ctx->tls, &sock);
+    }
+    return sock;
+}
+
+static esp_transport_handle_t ws_tls_transport_init(esp_websocket_client_handle_t client)
+{
+    esp_transport_handle_t t = esp_transport_init();
+    ws_tls_transport_t *ctx = calloc(1, sizeof(ws_tls_transport_t));
+    if (t == NULL || ctx == NULL) {
+        esp_transport_destroy(t);
+        free(ctx);
+        return NULL;
+    }
+    ctx->client = client;
+    esp_transport_set_context_data(t, ctx);
+    esp_transport_set_func(t, ws_tls_connect, ws_tls_read, ws_tls_write, ws_tls_close, ws_tls_poll_read, ws_tls_poll_write, ws_tls_destroy);
+    esp_transport_set_get_socket_func(t, ws_tls_get_socket);
+    return t;
+}
+#endif // CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+
 static esp_err_t esp_websocket_client_create_transport(esp_websocket_client_handle_t client)
 {
     if (!client->config->scheme) {
@@ -527,61 +866,74 @@ static esp_err_t esp_websocket_client_create_transport(esp_websocket_client_hand
         esp_transport_list_add(client->transport_list, ws, WS_OVER_TCP_SCHEME);
         ESP_WS_CLIENT_ERR_OK_CHECK(TAG, set_websocket_transport_optional_settings(client, WS_OVER_TCP_SCHEME), return ESP_FAIL;)
     } else if (strcasecmp(client->config->scheme, WS_OVER_TLS_SCHEME) == 0) {
-        esp_transport_handle_t ssl = esp_transport_ssl_init();
-        ESP_WS_CLIENT_MEM_CHECK(TAG, ssl, return ESP_ERR_NO_MEM);
-
-        esp_transport_set_default_port(ssl, WEBSOCKET_SSL_DEFAULT_PORT);
-        esp_transport_list_add(client->transport_list, ssl, "_ssl"); // need to save to transport list, for cleanup
-        if (client->keep_alive_cfg.keep_alive_enable) {
-            esp_transport_ssl_set_keep_alive(ssl, &client->keep_alive_cfg);
-        }
-        if (client->if_name) {
-            esp_transport_ssl_set_interface_name(ssl, client->if_name);
+        esp_transport_handle_t ssl = NULL;
+        if (client->config->tls_session_reuse) {
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+            ssl = ws_tls_transport_init(client);
+            ESP_WS_CLIENT_MEM_CHECK(TAG, ssl, return ESP_ERR_NO_MEM);
+            esp_transport_set_default_port(ssl, WEBSOCKET_SSL_DEFAULT_PORT);
+            esp_transport_list_add(client->transport_list, ssl, "_ssl"); // need to save to transport list, for cleanup
+#else
+            ESP_LOGW(TAG, "tls_session_reuse requires CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS, every connect does a full handshake");
+#endif
         }
-
-        if (client->config->use_global_ca_store == true) {
-            esp_transport_ssl_enable_global_ca_store(ssl);
-        } else if (client->config->cert) {
-            if (!client->config->cert_len) {
-                esp_transport_ssl_set_cert_data(ssl, client->config->cert, strlen(client->config->cert));
-            } else {
-                esp_transport_ssl_set_cert_data_der(ssl, client->config->cert, client->config->cert_len);
+        if (ssl == NULL) {
+            ssl = esp_transport_ssl_init();
+            ESP_WS_CLIENT_MEM_CHECK(TAG, ssl, return ESP_ERR_NO_MEM);
+
+            esp_transport_set_default_port(ssl, WEBSOCKET_SSL_DEFAULT_PORT);
+            esp_transport_list_add(client->transport_list, ssl, "_ssl"); // need to save to transport list, for cleanup
+            if (client->keep_alive_cfg.keep_alive_enable) {
+                esp_transport_ssl_set_keep_alive(ssl, &client->keep_alive_cfg);
             }
-        }
-        if (client->config->client_cert) {
-            if (!client->config->client_cert_len) {
-                esp_transport_ssl_set_client_cert_data(ssl, client->config->client_cert, strlen(client->config->client_cert));
-            } else {
-                esp_transport_ssl_set_client_cert_data_der(ssl, client->config->client_cert, client->config->client_cert_len);
+            if (client->if_name) {
+                esp_transport_ssl_set_interface_name(ssl, client->if_name);
             }
-        }
-        if (client->config->client_key) {
-            if (!client->config->client_key_len) {
-                esp_transport_ssl_set_client_key_data(ssl, client->config->client_key, strlen(client->config->client_key));
-            } else {
-                esp_transport_ssl_set_client_key_data_der(ssl, client->config->client_key, client->config->client_key_len);
+
+            if (client->config->use_global_ca_store == true) {
+                esp_transport_ssl_enable_global_ca_store(ssl);
+            } else if (client->config->cert) {
+                if (!client->config->cert_len) {
+                    esp_transport_ssl_set_cert_data(ssl, client->config->cert, strlen(client->config->cert));
+                } else {
+                    esp_transport_ssl_set_cert_data_der(ssl, client->config->cert, client->config->cert_len);
+                }
             }
+            if (client->config->client_cert) {
+                if (!client->config->client_cert_len) {
+                    esp_transport_ssl_set_client_cert_data(ssl, client->config->client_cert, strlen(client->config->client_cert));
+                } else {
+                    esp_transport_ssl_set_client_cert_data_der(ssl, client->config->client_cert, client->config->client_cert_len);
+                }
+            }
+            if (client->config->client_key) {
+                if (!client->config->client_key_len) {
+                    esp_transport_ssl_set_client_key_data(ssl, client->config->client_key, strlen(client->config->client_key));
+                } else {
+                    esp_transport_ssl_set_client_key_data_der(ssl, client->config->client_key, client->config->client_key_len);
+                }
 #if CONFIG_ESP_TLS_USE_DS_PERIPHERAL
-        } else if (client->config->client_ds_data) {
-            esp_transport_ssl_set_ds_data(ssl, client->config->client_ds_data);
+            } else if (client->config->client_ds_data) {
+                esp_transport_ssl_set_ds_data(ssl, client->config->client_ds_data);
 #endif
-        }
-        if (client->config->crt_bundle_attach) {
+            }
+            if (client->config->crt_bundle_attach) {
 #ifdef CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
-            esp_transport_ssl_crt_bundle_attach(ssl, client->config->crt_bundle_attach);
+                esp_transport_ssl_crt_bundle_attach(ssl, client->config->crt_bundle_attach);
 #else //CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
-            ESP_LOGE(TAG, "crt_bundle_attach configured but not enabled in menuconfig: Please enable MBEDTLS_CERTIFICATE_BUNDLE option");
+                ESP_LOGE(TAG, "crt_bundle_attach configured but not enabled in menuconfig: Please enable MBEDTLS_CERTIFICATE_BUNDLE option");
 #endif
-        }
-        if (client->config->skip_cert_common_name_check) {
-            esp_transport_ssl_skip_common_name_check(ssl);
-        }
-        if (client->config->cert_common_name) {
+            }
+            if (client->config->skip_cert_common_name_check) {
+                esp_transport_ssl_skip_common_name_check(ssl);
+            }
+            if (client->config->cert_common_name) {
 #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
-            esp_transport_ssl_set_common_name(ssl, client->config->cert_common_name);
+                esp_transport_ssl_set_common_name(ssl, client->config->cert_common_name);
 #else
-            ESP_LOGE(TAG, "cert_common_name requires ESP-IDF 5.1.0 or later");
+                ESP_LOGE(TAG, "cert_common_name requires ESP-IDF 5.1.0 or later");
 #endif
+            }
         }
 
         esp_transport_handle_t wss = esp_transport_ws_init(ssl);
@@ -753,6 +1105,7 @@ esp_websocket_client_handle_t esp_websocket_client_init(const esp_websocket_clie
     client->config->cert_common_name = config->cert_common_name;
     client->config->crt_bundle_attach = config->crt_bundle_attach;
     client->config->ext_transport = config->ext_transport;
+    client->config->tls_session_reuse = config->tls_session_reuse;
 
     if (config->uri) {
         if (esp_websocket_client_set_uri(client, config->uri) != ESP_OK) {
@@ -792,6 +1145,8 @@ esp_websocket_client_handle_t esp_websocket_client_init(const esp_websocket_clie
     ESP_WS_CLIENT_MEM_CHECK(TAG, client->tx_buffer, {
         goto _websocket_init_fail;
     });
+    esp_websocket_buf_count_alloc(client, buffer_size);
+    esp_websocket_buf_count_alloc(client, buffer_size);
 #endif
     client->status_bits = xEventGroupCreate();
     ESP_WS_CLIENT_MEM_CHECK(TAG, client->status_bits, {
@@ -984,7 +1339,17 @@ static esp_err_t esp_websocket_client_recv(esp_websocket_client_handle_t client)
             return ESP_OK;
         }
 
-        esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_DATA, client->rx_buffer, rlen);
+        // binary messages bypass the event loop when a data sink is registered
+        if (client->last_opcode == WS_TRANSPORT_OPCODES_BINARY || client->last_opcode == WS_TRANSPORT_OPCODES_TEXT) {
+            client->rx_direct_msg = client->last_opcode == WS_TRANSPORT_OPCODES_BINARY;
+        }
+        esp_websocket_data_cb_t data_cb = client->data_cb;
+        if (data_cb && client->rx_direct_msg &&
+                (client->last_opcode == WS_TRANSPORT_OPCODES_BINARY || client->last_opcode == WS_TRANSPORT_OPCODES_CONT)) {
+            data_cb(client->rx_buffer, rlen, client->payload_offset, client->payload_len, client->last_fin, client->data_cb_ctx);
+        } else {
+            esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_DATA, client->rx_buffer, rlen);
+        }
 
         client->payload_offset += rlen;
     } while (client->payload_offset < client->payload_len);
@@ -1146,6 +1511,7 @@ static void esp_websocket_client_task(void *pv)
             ESP_LOGD(TAG, "Client run iteration in a default state: %d", client->state);
             break;
         }
+        esp_websocket_pool_trim(client);
         xSemaphoreGiveRecursive(client->lock);
         if (WEBSOCKET_STATE_CONNECTED == client->state) {
             read_select = esp_transport_poll_read(client->transport, 1000); //Poll every 1000ms
@@ -1204,6 +1570,7 @@ static void esp_websocket_client_task(void *pv)
     esp_transport_close(client->transport);
     xEventGroupSetBits(client->status_bits, STOPPED_BIT);
     client->state = WEBSOCKET_STATE_UNKNOW;
+    esp_websocket_pool_trim(client);
     if (client->selected_for_destroying == true) {
         destroy_and_free_resources(client);
     }
@@ -1327,6 +1694,313 @@ int esp_websocket_client_send_text_partial(esp_websocket_client_handle_t client,
     return esp_websocket_client_send_with_exact_opcode(client, WS_TRANSPORT_OPCODES_TEXT, (const uint8_t *)data, len, timeout);
 }
 
+#define WS_FRAME_HEADER_MAX     (14)    /* 2 + 8 bytes extended length + 4 bytes mask key */
+#define WS_MASK_BIT             (0x80)
+#define WS_IOV_BOUNCE_SIZE      (1460)  /* ws:// payload is masked into this many bytes at a time (one TCP MSS) */
+
+/* XOR `len` bytes with the frame mask, starting at payload offset `offset`.
+ * Aligned words are masked 16 bytes per iteration with a rotated 32-bit key. */
+static void ws_mask_inplace(uint8_t *buf, size_t len, const uint8_t mask[4], size_t offset)
+{
+    while (len > 0 && ((uintptr_t)buf & 3)) {
+        *buf++ ^= mask[offset++ & 3];
+        len--;
+    }
+    uint32_t key;
+    uint8_t *k = (uint8_t *)&key;
+    for (int i = 0; i < 4; i++) {
+        k[i] = mask[(offset + i) & 3];
+    }
+    uint32_t *w = (uint32_t *)buf;
+    size_t words = len >> 2;
+    while (words >= 4) {
+        w[0] ^= key;
+        w[1] ^= key;
+        w[2] ^= key;
+        w[3] ^= key;
+        w += 4;
+        words -= 4;
+    }
+    while (words--) {
+        *w++ ^= key;
+    }
+    buf = (uint8_t *)w;
+    for (size_t i = 0; i < (len & 3); i++) {
+        buf[i] ^= k[i];
+    }
+}
+
+static int ws_build_header(uint8_t *hdr, ws_transport_opcodes_t opcode, size_t len, uint8_t mask[4])
+{
+    int n = 0;
+    hdr[n++] = (uint8_t)opcode;
+    if (len < 126) {
+        hdr[n++] = WS_MASK_BIT | (uint8_t)len;
+    } else if (len <= 0xFFFF) {
+        hdr[n++] = WS_MASK_BIT | 126;
+        hdr[n++] = (uint8_t)(len >> 8);
+        hdr[n++] = (uint8_t)len;
+    } else {
+        hdr[n++] = WS_MASK_BIT | 127;
+        for (int i = 7; i >= 0; i--) {
+            hdr[n++] = (i >= (int)sizeof(size_t)) ? 0 : (uint8_t)((uint64_t)len >> (8 * i));
+        }
+    }
+    uint32_t key = esp_random();
+    memcpy(mask, &key, 4);
+    memcpy(hdr + n, mask, 4);
+    return n + 4;
+}
+
+static int ws_transport_write_all(esp_transport_handle_t t, const char *buf, int len, int timeout_ms)
+{
+    int written = 0;
+    while (written < len) {
+        int wlen = esp_transport_write(t, buf + written, len - written, timeout_ms);
+        if (wlen <= 0) {
+            return wlen < 0 ? wlen : -1;
+        }
+        written += wlen;
+    }
+    return written;
+}
+
+/* writev() the whole vector to the TCP socket, looping over partial writes */
+static int ws_writev_all(esp_transport_handle_t tcp, int sock, struct iovec *v, int cnt, int timeout_ms)
+{
+    while (cnt > 0) {
+        int poll = esp_transport_poll_write(tcp, timeout_ms);
+        if (poll <= 0) {
+            return -1;
+        }
+        ssize_t wlen = writev(sock, v, cnt);
+        if (wlen < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                continue;
+            }
+            return -1;
+        }
+        while (cnt > 0 && (size_t)wlen >= v->iov_len) {
+            wlen -= v->iov_len;
+            v++;
+            cnt--;
+        }
+        if (cnt > 0) {
+            v->iov_base = (uint8_t *)v->iov_base + wlen;
+            v->iov_len -= wlen;
+        }
+    }
+    return 0;
+}
+
+/* ws:// : the caller's segments are read-only, so the payload is masked into a small per-client bounce
+ * buffer and written together with the header by writev(), one bounce buffer at a time */
+static int ws_send_iov_tcp(esp_websocket_client_handle_t client, esp_transport_handle_t tcp, const uint8_t *hdr, int hdr_len,
+                           const esp_websocket_iovec_t *iov, int iovcnt, const uint8_t mask[4], int timeout_ms)
+{
+    int sock = esp_transport_get_socket(tcp);
+    if (sock < 0) {
+        return -1;
+    }
+    if (client->iov_bounce == NULL) {
+        client->iov_bounce = malloc(WS_IOV_BOUNCE_SIZE);
+        ESP_WS_CLIENT_MEM_CHECK(TAG, client->iov_bounce, return -1);
+    }
+    uint8_t *bounce = client->iov_bounce;
+    struct iovec vec[2] = {
+        { .iov_base = (void *)hdr, .iov_len = hdr_len },
+    };
+    size_t offset = 0;
+    int i = 0;
+    const uint8_t *src = iovcnt ? (const uint8_t *)iov[0].data : NULL;
+    size_t remain = iovcnt ? iov[0].len : 0;
+    do {
+        size_t fill = 0;
+        while (fill < WS_IOV_BOUNCE_SIZE && i < iovcnt) {
+            if (remain == 0) {
+                if (++i < iovcnt) {
+                    src = (const uint8_t *)iov[i].data;
+                    remain = iov[i].len;
+                }
+                continue;
+            }
+            size_t n = WS_IOV_BOUNCE_SIZE - fill;
+            if (n > remain) {
+                n = remain;
+            }
+            memcpy(bounce + fill, src, n);
+            ws_mask_inplace(bounce + fill, n, mask, offset);
+            fill += n;
+            src += n;
+            remain -= n;
+            offset += n;
+        }
+        int cnt = 0;
+        struct iovec *v = vec;
+        if (vec[0].iov_len > 0) {
+            cnt++;
+        } else {
+            v++;
+        }
+        if (fill > 0) {
+            vec[1].iov_base = bounce;
+            vec[1].iov_len = fill;
+            cnt++;
+        }
+        if (ws_writev_all(tcp, sock, v, cnt, timeout_ms) < 0) {
+            return -1;
+        }
+        vec[0].iov_len = 0;     /* header goes out with the first chunk only */
+    } while (i < iovcnt);
+    return 0;
+}
+
+/* wss:// : header + masked payload staged through the tx buffer, one frame regardless of buffer_size */
+static int ws_send_iov_staged(esp_websocket_client_handle_t client, esp_transport_handle_t parent, const uint8_t *hdr, int hdr_len,
+                              const esp_websocket_iovec_t *iov, int iovcnt, const uint8_t mask[4], int timeout_ms)
+{
+    if (esp_websocket_new_buf(client, true) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to setup tx buffer");
+        return -1;
+    }
+    uint8_t *buf = (uint8_t *)client->tx_buffer;
+    int fill = hdr_len;
+    size_t offset = 0;
+    int ret = 0;
+    memcpy(buf, hdr, hdr_len);
+    for (int i = 0; i < iovcnt && ret >= 0; i++) {
+        const uint8_t *src = (const uint8_t *)iov[i].data;
+        size_t remain = iov[i].len;
+        while (remain > 0) {
+            size_t n = client->buffer_size - fill;
+            if (n > remain) {
+                n = remain;
+            }
+            memcpy(buf + fill, src, n);
+            ws_mask_inplace(buf + fill, n, mask, offset);
+            fill += n;
+            src += n;
+            remain -= n;
+            offset += n;
+            if (fill == client->buffer_size) {
+                if ((ret = ws_transport_write_all(parent, (char *)buf, fill, timeout_ms)) < 0) {
+                    break;
+                }
+                fill = 0;
+            }
+        }
+    }
+    if (ret >= 0 && fill > 0) {
+        ret = ws_transport_write_all(parent, (char *)buf, fill, timeout_ms);
+    }
+    esp_websocket_free_buf(client, true);
+    return ret < 0 ? -1 : 0;
+}
+
+int esp_websocket_client_send_iov_with_opcode(esp_websocket_client_handle_t client, ws_transport_opcodes_t opcode,
+                                              const esp_websocket_iovec_t *iov, int iovcnt, TickType_t timeout)
+{
+    int ret = -1;
+    size_t total = 0;
+
+    if (client == NULL || iovcnt < 0 || iovcnt > ESP_WEBSOCKET_IOV_MAX || (iov == NULL && iovcnt > 0)) {
+        ESP_LOGE(TAG, "Invalid arguments");
+        return -1;
+    }
+    for (int i = 0; i < iovcnt; i++) {
+        if (iov[i].data == NULL && iov[i].len > 0) {
+            ESP_LOGE(TAG, "Invalid arguments");
+            return -1;
+        }
+        total += iov[i].len;
+    }
+    if (total > INT32_MAX) {
+        ESP_LOGE(TAG, "Payload too large");
+        return -1;
+    }
+
+    if (!esp_websocket_client_is_connected(client)) {
+        ESP_LOGE(TAG, "Websocket client is not connected");
+        return -1;
+    }
+
+    if (client->transport == NULL) {
+        ESP_LOGE(TAG, "Invalid transport");
+        return -1;
+    }
+
+    /* The raw transport below the websocket layer; an external transport has none we know of,
+     * so send the segments as a fragmented message through the regular path instead */
+    esp_transport_handle_t tcp = esp_transport_list_get_transport(client->transport_list, "_tcp");
+    esp_transport_handle_t ssl = esp_transport_list_get_transport(client->transport_list, "_ssl");
+    if (client->config->ext_transport || (tcp == NULL && ssl == NULL)) {
+        int sent = 0;
+        for (int i = 0; i < iovcnt || (iovcnt == 0 && i == 0); i++) {
+            ws_transport_opcodes_t op = (i == 0) ? opcode : WS_TRANSPORT_OPCODES_CONT;
+            if (i >= iovcnt - 1) {
+                op |= WS_TRANSPORT_OPCODES_FIN;
+            }
+            int wlen = esp_websocket_client_send_with_exact_opcode(client, op, iovcnt ? iov[i].data : NULL,
+                                                                   iovcnt ? iov[i].len : 0, timeout);
+            if (wlen < 0) {
+                return wlen;
+            }
+            sent += wlen;
+        }
+        return sent;
+    }
+
+#ifdef CONFIG_ESP_WS_CLIENT_SEPARATE_TX_LOCK
+    if (xSemaphoreTakeRecursive(client->tx_lock, timeout) != pdPASS) {
+        ESP_LOGE(TAG, "Could not lock ws-client within %" PRIu32 " timeout", timeout);
+        return -1;
+    }
+#else
+    if (xSemaphoreTakeRecursive(client->lock, timeout) != pdPASS) {
+        ESP_LOGE(TAG, "Could not lock ws-client within %" PRIu32 " timeout", timeout);
+        return -1;
+    }
+#endif
+
+    uint8_t hdr[WS_FRAME_HEADER_MAX];
+    uint8_t mask[4];
+    int hdr_len = ws_build_header(hdr, opcode | WS_TRANSPORT_OPCODES_FIN, total, mask);
+    int timeout_ms = (timeout == portMAX_DELAY) ? -1 : timeout * portTICK_PERIOD_MS;
+    int wret;
+    if (tcp) {
+        wret = ws_send_iov_tcp(client, tcp, hdr, hdr_len, iov, iovcnt, mask, timeout_ms);
+    } else {
+        wret = ws_send_iov_staged(client, ssl, hdr, hdr_len, iov, iovcnt, mask, timeout_ms);
+    }
+
+    if (wret < 0) {
+        ret = -1;
+        esp_tls_error_handle_t error_handle = esp_transport_get_error_handle(client->transport);
+        if (error_handle) {
+            esp_websocket_client_error(client, "esp_transport_write() returned %d, transport_error=%s, tls_error_code=%i, tls_flags=%i, errno=%d",
+                                       ret, esp_err_to_name(error_handle->last_error), error_handle->esp_tls_error_code,
+                                       error_handle->esp_tls_flags, errno);
+        } else {
+            esp_websocket_client_error(client, "esp_transport_write() returned %d, errno=%d", ret, errno);
+        }
+        esp_websocket_client_abort_connection(client, WEBSOCKET_ERROR_TYPE_TCP_TRANSPORT);
+    } else {
+        ret = (int)total;
+    }
+
+#ifdef CONFIG_ESP_WS_CLIENT_SEPARATE_TX_LOCK
+    xSemaphoreGiveRecursive(client->tx_lock);
+#else
+    xSemaphoreGiveRecursive(client->lock);
+#endif
+    return ret;
+}
+
+int esp_websocket_client_send_bin_iov(esp_websocket_client_handle_t client, const esp_websocket_iovec_t *iov, int iovcnt, TickType_t timeout)
+{
+    return esp_websocket_client_send_iov_with_opcode(client, WS_TRANSPORT_OPCODES_BINARY, iov, iovcnt, timeout);
+}
+
 int esp_websocket_client_send_cont_msg(esp_websocket_client_handle_t client, const char *data, int len, TickType_t timeout)
 {
     return esp_websocket_client_send_with_exact_opcode(client, WS_TRANSPORT_OPCODES_CONT, (const uint8_t *)data, len, timeout);
@@ -1352,6 +2026,42 @@ int esp_websocket_client_send_with_opcode(esp_websocket_client_handle_t client,
     return esp_websocket_client_send_with_exact_opcode(client, opcode | WS_TRANSPORT_OPCODES_FIN, data, len, timeout);
 }
 
+esp_err_t esp_websocket_client_set_data_callback(esp_websocket_client_handle_t client, esp_websocket_data_cb_t cb, void *user_ctx)
+{
+    if (client == NULL) {
+        ESP_LOGW(TAG, "Client was not initialized");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // the client task reads data_cb once per chunk (outside of client->lock), so the context is set first
+    client->data_cb_ctx = user_ctx;
+    client->data_cb = cb;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_websocket_client_get_buffer_stats(esp_websocket_client_handle_t client, esp_websocket_buffer_stats_t *stats)
+{
+    if (client == NULL || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *stats = client->buf_stats;
+    return ESP_OK;
+}
+
+esp_err_t esp_websocket_client_get_tls_stats(esp_websocket_client_handle_t client, esp_websocket_tls_stats_t *stats)
+{
+    if (client == NULL || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    *stats = client->tls_stats;
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
 bool esp_websocket_client_is_connected(esp_websocket_client_handle_t client)
 {
     if (client == NULL) {
@@ -136,6 +136,7 @@ typedef struct {
     size_t                      ping_interval_sec;          /*!< Websocket ping interval, defaults to 10 seconds if not set */
     struct ifreq                *if_name;                   /*!< The name of interface for data to go through. Use the default interface without setting */
     esp_transport_handle_t      ext_transport;              /*!< External WebSocket tcp_transport handle to the client; or if null, the client will create its own transport handle. */
+    bool                        tls_session_reuse;          /*!< wss:// only: cache the TLS session after each handshake and offer it on the next connect of this handle (session ID / session ticket resumption). Requires CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS, ignored otherwise */
 } esp_websocket_client_config_t;
 
 /**
@@ -359,6 +360,129 @@ int esp_websocket_client_send_fin(esp_websocket_client_handle_t client, TickType
  */
 int esp_websocket_client_send_with_opcode(esp_websocket_client_handle_t client, ws_transport_opcodes_t opcode, const uint8_t *data, int len, TickType_t timeout);
 
+/**
+ * @brief rx/tx buffer heap usage counters
+ */
+typedef struct {
+    uint32_t allocs;        /*!< Heap allocations of rx/tx buffers */
+    uint32_t frees;         /*!< Heap frees of rx/tx buffers */
+    uint32_t reuses;        /*!< Buffer requests served by the pool without touching the heap */
+    uint32_t bytes_held;    /*!< Bytes currently held by rx/tx buffers */
+    uint32_t bytes_peak;    /*!< Peak of bytes_held */
+} esp_websocket_buffer_stats_t;
+
+/**
+ * @brief      Get rx/tx buffer heap usage counters
+ *
+ * @param[in]  client  The client
+ * @param[out] stats   Counters since esp_websocket_client_init()
+ *
+ * @return     esp_err_t
+ */
+esp_err_t esp_websocket_client_get_buffer_stats(esp_websocket_client_handle_t client, esp_websocket_buffer_stats_t *stats);
+
+/**
+ * @brief TLS handshake timing (wss:// with `tls_session_reuse`)
+ *
+ * Times cover DNS lookup, TCP connect and the TLS handshake, i.e. everything before the HTTP upgrade.
+ * A handshake counts as "resumed" only when the server accepted the offered session (abbreviated TLS 1.2
+ * handshake); a rejected session falls back to a full handshake and is counted as one. TLS 1.3 connections
+ * are always reported as full handshakes.
+ */
+typedef struct {
+    uint32_t handshakes;        /*!< Successful handshakes */
+    uint32_t failures;          /*!< Failed connects (the cached session is dropped only on a TLS handshake error) */
+    uint32_t offered;           /*!< Successful handshakes that offered a cached session */
+    uint32_t resumed;           /*!< Successful handshakes where the server accepted the cached session */
+    uint32_t last_ms;           /*!< Duration of the last successful handshake */
+    uint32_t full_avg_ms;       /*!< Average duration of full handshakes */
+    uint32_t resumed_avg_ms;    /*!< Average duration of resumed handshakes */
+    uint32_t max_ms;            /*!< Longest successful handshake */
+    bool     last_resumed;      /*!< The last handshake resumed a cached session */
+} esp_websocket_tls_stats_t;
+
+/**
+ * @brief      Get TLS handshake timing
+ *
+ * @param[in]  client  The client
+ * @param[out] stats   Counters since esp_websocket_client_init(), kept across stop/start
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_INVALID_ARG
+ *     - ESP_ERR_NOT_SUPPORTED if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS is disabled
+ */
+esp_err_t esp_websocket_client_get_tls_stats(esp_websocket_client_handle_t client, esp_websocket_tls_stats_t *stats);
+
+/**
+ * @brief Direct data sink for binary messages
+ *
+ * Called from the client task for every chunk read from the transport, without going through the esp_event loop.
+ *
+ * @param data           Chunk data (valid only during the call)
+ * @param len            Chunk length
+ * @param payload_offset Offset of this chunk in the frame payload
+ * @param payload_len    Total payload length of the frame
+ * @param fin            FIN flag of the frame
+ * @param user_ctx       Context passed to esp_websocket_client_set_data_callback()
+ */
+typedef void (*esp_websocket_data_cb_t)(const char *data, int len, int payload_offset, int payload_len, bool fin, void *user_ctx);
+
+/**
+ * @brief      Deliver binary messages straight to a data sink instead of posting WEBSOCKET_EVENT_DATA
+ *
+ * Binary frames (and continuation frames of a binary message) are handed to `cb` from the client task
+ * as soon as each chunk is read; text and control frames are still dispatched as WEBSOCKET_EVENT_DATA.
+ * The sink runs in the client task and must not block or call the close/stop/destroy APIs.
+ *
+ * @param[in]  client    The client
+ * @param[in]  cb        The sink, NULL to go back to WEBSOCKET_EVENT_DATA for binary messages
+ * @param[in]  user_ctx  Context passed to the sink
+ *
+ * @return     esp_err_t
+ */
+esp_err_t esp_websocket_client_set_data_callback(esp_websocket_client_handle_t client, esp_websocket_data_cb_t cb, void *user_ctx);
+
+/**
+ * @brief Payload segment for the scatter-gather send API
+ */
+typedef struct {
+    const void *data;   /*!< Segment data (read only, may be in flash) */
+    size_t      len;    /*!< Segment length in bytes */
+} esp_websocket_iovec_t;
+
+#define ESP_WEBSOCKET_IOV_MAX   (8)     /*!< Maximum number of segments per frame */
+
+/**
+ * @brief      Write one WebSocket frame whose payload is gathered from caller-owned segments
+ *
+ * The segments are not gathered into the client's tx buffer first, and the frame is never split at `buffer_size`:
+ *  - ws://  the payload is masked into a small per-client bounce buffer (one TCP MSS) and written together
+ *           with the frame header by writev() on the TCP socket, no tx buffer is allocated
+ *  - wss:// header and payload are masked into the tx buffer chunk by chunk (one copy, TLS encrypts
+ *           from its own buffer anyway), still as a single frame
+ *
+ * @param[in]  client  The client
+ * @param[in]  opcode  The opcode (FIN is always set)
+ * @param[in]  iov     Payload segments
+ * @param[in]  iovcnt  Number of segments (0 ~ ESP_WEBSOCKET_IOV_MAX)
+ * @param[in]  timeout Write data timeout in RTOS ticks
+ *
+ *  Notes:
+ *  - The segments are only read, never modified; they must stay valid until this function returns
+ *
+ * @return
+ *     - Number of payload bytes sent
+ *     - (-1) if any errors
+ */
+int esp_websocket_client_send_iov_with_opcode(esp_websocket_client_handle_t client, ws_transport_opcodes_t opcode,
+                                              const esp_websocket_iovec_t *iov, int iovcnt, TickType_t timeout);
+
+/**
+ * @brief      Write a binary frame gathered from caller-owned segments (see esp_websocket_client_send_iov_with_opcode)
+ */
+int esp_websocket_client_send_bin_iov(esp_websocket_client_handle_t client, const esp_websocket_iovec_t *iov, int iovcnt, TickType_t timeout);
+
 /**
  * @brief      Close the WebSocket connection in a clean way
  *
@@ -0,0 +1,430 @@
+/*
+ * SPDX-FileCopyrightText: 2021-2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ *
+ * This test code is in the Public Domain (or CC0 licensed, at your option.)
+ *
+ * Unless required by applicable law or agreed to in writing, this
+ * software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <esp_websocket_client.h>
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_tls_crypto.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "lwip/sockets.h"
+#include "unity.h"
+#include "test_utils.h"
+
+#include "unity_fixture.h"
+#include "memory_checks.h"
+
+TEST_GROUP(websocket);
+
+TEST_SETUP(websocket)
+{
+#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 1, 0)
+    /* IDF v5.0 runs some lazy inits within printf()
+     * This test sets the leak threshold to 0, so we need to call printf()
+     * before recording the heap size in test_utils_record_free_mem()
+     */
+    printf("TEST_SETUP: websocket\n");
+#endif
+    test_utils_record_free_mem();
+    TEST_ESP_OK(test_utils_set_leak_level(0, ESP_LEAK_TYPE_CRITICAL, ESP_COMP_LEAK_GENERAL));
+}
+
+TEST_TEAR_DOWN(websocket)
+{
+    test_utils_finish_and_evaluate_leaks(0, 0);
+}
+
+
+TEST(websocket, websocket_init_deinit)
+{
+    const esp_websocket_client_config_t websocket_cfg = {
+        // no connection takes place, but the uri has to be valid for init() to succeed
+        .uri = "ws://echo.websocket.org",
+    };
+    esp_websocket_client_handle_t client = esp_websocket_client_init(&websocket_cfg);
+    TEST_ASSERT_NOT_EQUAL(NULL, client);
+    esp_websocket_client_destroy(client);
+}
+
+TEST(websocket, websocket_init_invalid_url)
+{
+    const esp_websocket_client_config_t websocket_cfg = {
+        .uri = "INVALID",
+    };
+    esp_websocket_client_handle_t client = esp_websocket_client_init(&websocket_cfg);
+    TEST_ASSERT_NULL(client);
+}
+
+TEST(websocket, websocket_set_invalid_url)
+{
+    const esp_websocket_client_config_t websocket_cfg = {};
+    esp_websocket_client_handle_t client = esp_websocket_client_init(&websocket_cfg);
+    TEST_ASSERT_NOT_EQUAL(NULL, client);
+    TEST_ASSERT_NOT_EQUAL(ESP_OK, esp_websocket_client_set_uri(client, "INVALID"));
+    esp_websocket_client_destroy(client);
+}
+
+TEST_GROUP_RUNNER(websocket)
+{
+    RUN_TEST_CASE(websocket, websocket_init_deinit)
+    RUN_TEST_CASE(websocket, websocket_init_invalid_url)
+    RUN_TEST_CASE(websocket, websocket_set_invalid_url)
+}
+
+/*
+ * Scatter-gather send (esp_websocket_client_send_bin_iov) against a minimal websocket server on the
+ * loopback interface: the server completes the upgrade handshake, unmasks every binary frame and
+ * reports its length (or -1 if the frame was fragmented) so the test can compare the payload.
+ */
+#define IOV_TEST_PORT           8090
+#define IOV_TEST_BUFFER_SIZE    256     /* smaller than the payloads below, which must still arrive as one frame */
+#define IOV_TEST_MAX_PAYLOAD    4096
+#define IOV_TEST_LEAK_BYTES     1024    /* lwIP keeps closed TCP pcbs in TIME_WAIT for a while */
+#define IOV_TEST_TIMEOUT_MS     5000
+#define WS_GUID                 "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+typedef struct {
+    int               listen_sock;
+    QueueHandle_t     frames;
+    SemaphoreHandle_t done;
+    uint8_t           rx[IOV_TEST_MAX_PAYLOAD];
+    uint8_t           payload[IOV_TEST_MAX_PAYLOAD];
+} iov_test_server_t;
+
+static int recv_all(int sock, void *buf, size_t len)
+{
+    size_t got = 0;
+    while (got < len) {
+        int n = recv(sock, (uint8_t *)buf + got, len - got, 0);
+        if (n <= 0) {
+            return -1;
+        }
+        got += n;
+    }
+    return 0;
+}
+
+static bool iov_test_server_handshake(int sock)
+{
+    char req[512];
+    int len = 0;
+    req[0] = '\0';
+    while (strstr(req, "\r\n\r\n") == NULL) {
+        int n = recv(sock, req + len, sizeof(req) - 1 - len, 0);
+        if (n <= 0) {
+            return false;
+        }
+        len += n;
+        req[len] = '\0';
+    }
+    const char *key = strstr(req, "Sec-WebSocket-Key: ");
+    if (key == NULL) {
+        return false;
+    }
+    key += strlen("Sec-WebSocket-Key: ");
+    const char *end = strstr(key, "\r\n");
+
+    char concat[96];
+    unsigned char sha1[20];
+    unsigned char accept[32];
+    size_t accept_len = 0;
+    int concat_len = snprintf(concat, sizeof(concat), "%.*s" WS_GUID, (int)(end - key), key);
+    esp_crypto_sha1((const unsigned char *)concat, concat_len, sha1);
+    esp_crypto_base64_encode(accept, sizeof(accept), &accept_len, sha1, sizeof(sha1));
+
+    char resp[192];
+    int resp_len = snprintf(resp, sizeof(resp), "HTTP/1.1 101 Switching Protocols\r\n"
+                            "Upgrade: websocket\r\n"
+                            "Connection: Upgrade\r\n"
+                            "Sec-WebSocket-Accept: %.*s\r\n\r\n", (int)accept_len, accept);
+    return send(sock, resp, resp_len, 0) == resp_len;
+}
+
+/* Reads one client frame into srv->rx and unmasks it, returns the payload length or -1 */
+static int iov_test_server_read_frame(iov_test_server_t *srv, int sock, uint8_t *opcode, bool *fin)
+{
+    uint8_t hdr[2];
+    if (recv_all(sock, hdr, sizeof(hdr)) < 0) {
+        return -1;
+    }
+    *fin = (hdr[0] & 0x80) != 0;
+    *opcode = hdr[0] & 0x0F;
+    uint64_t len = hdr[1] & 0x7F;
+    if (len >= 126) {
+        uint8_t ext[8];
+        int ext_len = (len == 126) ? 2 : 8;
+        if (recv_all(sock, ext, ext_len) < 0) {
+            return -1;
+        }
+        len = 0;
+        for (int i = 0; i < ext_len; i++) {
+            len = (len << 8) | ext[i];
+        }
+    }
+    uint8_t mask[4] = { 0 };
+    if ((hdr[1] & 0x80) && recv_all(sock, mask, sizeof(mask)) < 0) {
+        return -1;
+    }
+    if (len > sizeof(srv->rx) || recv_all(sock, srv->rx, len) < 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < len; i++) {
+        srv->rx[i] ^= mask[i & 3];
+    }
+    return (int)len;
+}
+
+static void iov_test_server_task(void *arg)
+{
+    iov_test_server_t *srv = arg;
+    int sock = accept(srv->listen_sock, NULL, NULL);
+    if (sock >= 0 && iov_test_server_handshake(sock)) {
+        uint8_t opcode;
+        bool fin;
+        int len;
+        while ((len = iov_test_server_read_frame(srv, sock, &opcode, &fin)) >= 0) {
+            if (opcode != WS_TRANSPORT_OPCODES_BINARY && opcode != WS_TRANSPORT_OPCODES_CONT) {
+                continue;   /* PING etc. */
+            }
+            memcpy(srv->payload, srv->rx, len);
+            int report = fin ? len : -1;
+            xQueueSend(srv->frames, &report, portMAX_DELAY);
+        }
+    }
+    if (sock >= 0) {
+        close(sock);
+    }
+    xSemaphoreGive(srv->done);
+    vTaskDelete(NULL);
+}
+
+static esp_websocket_client_handle_t iov_test_connect(iov_test_server_t **out_srv)
+{
+    iov_test_server_t *srv = calloc(1, sizeof(iov_test_server_t));
+    TEST_ASSERT_NOT_NULL(srv);
+    srv->frames = xQueueCreate(4, sizeof(int));
+    srv->done = xSemaphoreCreateBinary();
+    TEST_ASSERT_NOT_NULL(srv->frames);
+    TEST_ASSERT_NOT_NULL(srv->done);
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(IOV_TEST_PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    int opt = 1;
+    srv->listen_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, srv->listen_sock);
+    setsockopt(srv->listen_sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    TEST_ASSERT_EQUAL(0, bind(srv->listen_sock, (struct sockaddr *)&addr, sizeof(addr)));
+    TEST_ASSERT_EQUAL(0, listen(srv->listen_sock, 1));
+    TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(iov_test_server_task, "iov_test_srv", 4096, srv, 5, NULL));
+
+    char uri[32];
+    snprintf(uri, sizeof(uri), "ws://127.0.0.1:%d", IOV_TEST_PORT);
+    const esp_websocket_client_config_t websocket_cfg = {
+        .uri = uri,
+        .buffer_size = IOV_TEST_BUFFER_SIZE,
+        .disable_auto_reconnect = true,
+    };
+    esp_websocket_client_handle_t client = esp_websocket_client_init(&websocket_cfg);
+    TEST_ASSERT_NOT_NULL(client);
+    TEST_ESP_OK(esp_websocket_client_start(client));
+    for (int waited = 0; !esp_websocket_client_is_connected(client); waited += 10) {
+        TEST_ASSERT_LESS_THAN(IOV_TEST_TIMEOUT_MS, waited);
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    *out_srv = srv;
+    return client;
+}
+
+static void iov_test_disconnect(esp_websocket_client_handle_t client, iov_test_server_t *srv)
+{
+    esp_websocket_client_stop(client);
+    esp_websocket_client_destroy(client);
+    TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(srv->done, pdMS_TO_TICKS(IOV_TEST_TIMEOUT_MS)));
+    close(srv->listen_sock);
+    vQueueDelete(srv->frames);
+    vSemaphoreDelete(srv->done);
+    free(srv);
+    vTaskDelay(pdMS_TO_TICKS(100));     /* let the idle task free the server task */
+}
+
+/* Sends the segments as one frame and checks what the server received and that the segments are untouched */
+static void iov_test_send_and_check(esp_websocket_client_handle_t client, iov_test_server_t *srv,
+                                    const esp_websocket_iovec_t *iov, int iovcnt)
+{
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        total += iov[i].len;
+    }
+    uint8_t *expected = malloc(total + 1);
+    TEST_ASSERT_NOT_NULL(expected);
+    size_t off = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        if (iov[i].len) {
+            memcpy(expected + off, iov[i].data, iov[i].len);
+            off += iov[i].len;
+        }
+    }
+
+    TEST_ASSERT_EQUAL_INT((int)total, esp_websocket_client_send_bin_iov(client, iov, iovcnt, pdMS_TO_TICKS(IOV_TEST_TIMEOUT_MS)));
+    int received = 0;
+    TEST_ASSERT_EQUAL(pdTRUE, xQueueReceive(srv->frames, &received, pdMS_TO_TICKS(IOV_TEST_TIMEOUT_MS)));
+    TEST_ASSERT_EQUAL_INT((int)total, received);
+    off = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        if (iov[i].len) {
+            TEST_ASSERT_EQUAL_MEMORY(expected + off, srv->payload + off, iov[i].len);
+            TEST_ASSERT_EQUAL_MEMORY(expected + off, iov[i].data, iov[i].len);
+            off += iov[i].len;
+        }
+    }
+    free(expected);
+}
+
+static void iov_test_fill(uint8_t *buf, size_t len, uint8_t seed)
+{
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = (uint8_t)(seed + i * 7);
+    }
+}
+
+TEST_GROUP(websocket_iov);
+
+TEST_SETUP(websocket_iov)
+{
+    test_utils_record_free_mem();
+    TEST_ESP_OK(test_utils_set_leak_level(IOV_TEST_LEAK_BYTES, ESP_LEAK_TYPE_CRITICAL, ESP_COMP_LEAK_GENERAL));
+}
+
+TEST_TEAR_DOWN(websocket_iov)
+{
+    test_utils_finish_and_evaluate_leaks(IOV_TEST_LEAK_BYTES, IOV_TEST_LEAK_BYTES);
+}
+
+TEST(websocket_iov, send_iov_multiple_segments)
+{
+    static const uint8_t header[8] = { 'h', 'e', 'a', 'd', 'e', 'r', 0x00, 0xff };
+    uint8_t *body = malloc(300);
+    uint8_t tail[3] = { 0xa5, 0x5a, 0x01 };
+    TEST_ASSERT_NOT_NULL(body);
+    iov_test_fill(body, 300, 1);
+    const esp_websocket_iovec_t iov[] = {
+        { .data = header, .len = sizeof(header) },
+        { .data = body, .len = 300 },
+        { .data = tail, .len = sizeof(tail) },
+    };
+    iov_test_server_t *srv;
+    esp_websocket_client_handle_t client = iov_test_connect(&srv);
+    iov_test_send_and_check(client, srv, iov, sizeof(iov) / sizeof(iov[0]));
+    iov_test_disconnect(client, srv);
+    free(body);
+}
+
+TEST(websocket_iov, send_iov_larger_than_buffer_size)
+{
+    /* larger than buffer_size and than the ws:// masking bounce buffer, sent as one unfragmented frame */
+    uint8_t *a = malloc(3000);
+    uint8_t *b = malloc(1001);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_NOT_NULL(b);
+    iov_test_fill(a, 3000, 3);
+    iov_test_fill(b, 1001, 5);
+    const esp_websocket_iovec_t iov[] = {
+        { .data = a, .len = 3000 },
+        { .data = b, .len = 1001 },
+    };
+    iov_test_server_t *srv;
+    esp_websocket_client_handle_t client = iov_test_connect(&srv);
+    iov_test_send_and_check(client, srv, iov, 1);
+    iov_test_send_and_check(client, srv, iov, 2);
+    iov_test_disconnect(client, srv);
+    free(a);
+    free(b);
+}
+
+TEST(websocket_iov, send_iov_zero_length_segment)
+{
+    uint8_t a[10];
+    uint8_t b[10];
+    iov_test_fill(a, sizeof(a), 7);
+    iov_test_fill(b, sizeof(b), 9);
+    const esp_websocket_iovec_t iov[] = {
+        { .data = a, .len = sizeof(a) },
+        { .data = a, .len = 0 },
+        { .data = NULL, .len = 0 },
+        { .data = b, .len = sizeof(b) },
+    };
+    const esp_websocket_iovec_t empty[] = {
+        { .data = NULL, .len = 0 },
+    };
+    iov_test_server_t *srv;
+    esp_websocket_client_handle_t client = iov_test_connect(&srv);
+    iov_test_send_and_check(client, srv, iov, sizeof(iov) / sizeof(iov[0]));
+    iov_test_send_and_check(client, srv, empty, 1);
+    iov_test_send_and_check(client, srv, NULL, 0);
+    iov_test_disconnect(client, srv);
+}
+
+TEST(websocket_iov, send_iov_keeps_caller_data)
+{
+    /* const data lives in flash: any write through the segment pointer would fault */
+    static const char prompt[] = "segments are read only and may live in flash";
+    uint8_t *ram = malloc(2000);
+    uint8_t *copy = malloc(2000);
+    TEST_ASSERT_NOT_NULL(ram);
+    TEST_ASSERT_NOT_NULL(copy);
+    iov_test_fill(ram, 2000, 11);
+    memcpy(copy, ram, 2000);
+    const esp_websocket_iovec_t iov[] = {
+        { .data = prompt, .len = sizeof(prompt) },
+        { .data = ram, .len = 2000 },
+    };
+    iov_test_server_t *srv;
+    esp_websocket_client_handle_t client = iov_test_connect(&srv);
+    for (int i = 0; i < 3; i++) {
+        iov_test_send_and_check(client, srv, iov, sizeof(iov) / sizeof(iov[0]));
+    }
+    iov_test_disconnect(client, srv);
+    TEST_ASSERT_EQUAL_MEMORY(copy, ram, 2000);
+    TEST_ASSERT_EQUAL_STRING("segments are read only and may live in flash", prompt);
+    free(ram);
+    free(copy);
+}
+
+TEST_GROUP_RUNNER(websocket_iov)
+{
+    RUN_TEST_CASE(websocket_iov, send_iov_multiple_segments)
+    RUN_TEST_CASE(websocket_iov, send_iov_larger_than_buffer_size)
+    RUN_TEST_CASE(websocket_iov, send_iov_zero_length_segment)
+    RUN_TEST_CASE(websocket_iov, send_iov_keeps_caller_data)
+}
+
+static void run_all_tests(void)
+{
+    RUN_TEST_GROUP(websocket);
+    RUN_TEST_GROUP(websocket_iov);
+}
+
+void app_main(void)
+{
+    /* bring up lwIP (loopback) once, outside of the per-test leak accounting */
+    ESP_ERROR_CHECK(esp_netif_init());
+    const char *argv[] = { "test", "-v" };
+    UnityMain(sizeof(argv) / sizeof(argv[0]), argv, run_all_tests);
+}
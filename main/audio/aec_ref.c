@@ -0,0 +1,351 @@
+#include "aec_ref.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include <string.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "inmp441_i2s.h"
+#include "max98357_i2s.h"
+
+static const char *TAG = "AEC_REF";
+
+// 参考环形缓冲区：8192个采样（16kHz下512ms），中断中写入，必须在内部RAM
+#define AEC_REF_RING_SAMPLES    8192
+#define AEC_REF_RING_MASK       (AEC_REF_RING_SAMPLES - 1)
+// 计算出的位置与连续推进的位置相差超过2ms时重新同步（麦克风丢帧、任务被长时间阻塞等）
+#define AEC_REF_RESYNC_MS       2
+// 参考数据还没输出时最长等待时间（两个扬声器DMA缓冲区）
+#define AEC_REF_WAIT_MS         70
+// 校准结果减去的余量，保证参考信号略微超前于回声（AEC只能消除参考之后的回声）
+#define AEC_REF_LEAD_SAMPLES    16
+
+// 校准参数
+#define CAL_FRAME_SAMPLES       512     // 每次读取的麦克风采样数
+#define CAL_RECORD_MS           800     // 录音时长
+#define CAL_CHIRP_START_FRAME   2       // 第几帧之后开始播放扫频
+#define CAL_CHIRP_MS            100     // 扫频长度
+#define CAL_CHIRP_F0            300.0f  // 扫频起始频率
+#define CAL_CHIRP_F1            4000.0f // 扫频结束频率
+#define CAL_CHIRP_AMPLITUDE     8000.0f // 扫频幅度（约-12dBFS）
+#define CAL_MAX_LAG_MS          250     // 最大搜索延迟
+#define CAL_MIN_CORRELATION     0.15f   // 归一化相关峰阈值
+
+static int16_t *s_ring = NULL;
+static int s_sample_rate = 16000;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t s_write_count = 0;       // 已写入（已输出）的采样总数
+static int64_t s_write_ts = 0;          // 最近一次写入的时间（最后一个采样输出完成的时间）
+static SemaphoreHandle_t s_write_sem = NULL;
+static volatile bool s_waiting = false;
+
+// 读取端（只有一个读取任务）
+static int64_t s_read_pos = 0;
+static bool s_synced = false;
+static volatile int s_delay = 0;
+static aec_ref_stats_t s_stats;
+
+/**
+ * @brief 初始化参考信号环形缓冲区
+ */
+esp_err_t aec_ref_init(int sample_rate)
+{
+    if (s_ring != NULL) {
+        return ESP_OK;
+    }
+    s_ring = (int16_t *)heap_caps_calloc(AEC_REF_RING_SAMPLES, sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    s_write_sem = xSemaphoreCreateBinary();
+    if (s_ring == NULL || s_write_sem == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate reference ring");
+        aec_ref_deinit();
+        return ESP_ERR_NO_MEM;
+    }
+    s_sample_rate = sample_rate;
+    s_write_count = 0;
+    s_write_ts = esp_timer_get_time();
+    s_synced = false;
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_stats.delay_samples = s_delay;
+    return ESP_OK;
+}
+
+/**
+ * @brief 释放参考信号环形缓冲区
+ */
+void aec_ref_deinit(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    int16_t *ring = s_ring;
+    s_ring = NULL;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (ring) {
+        heap_caps_free(ring);
+    }
+    if (s_write_sem) {
+        vSemaphoreDelete(s_write_sem);
+        s_write_sem = NULL;
+    }
+}
+
+/**
+ * @brief 扬声器DMA发送完成：把实际输出的数据写入环形缓冲区
+ */
+bool IRAM_ATTR aec_ref_on_sent(const void *data, size_t size, void *ctx)
+{
+    BaseType_t need_yield = pdFALSE;
+    int samples = size / sizeof(int16_t);
+
+    portENTER_CRITICAL_ISR(&s_lock);
+    if (s_ring == NULL || samples > AEC_REF_RING_SAMPLES) {
+        portEXIT_CRITICAL_ISR(&s_lock);
+        return false;
+    }
+    int pos = (int)(s_write_count & AEC_REF_RING_MASK);
+    int first = AEC_REF_RING_SAMPLES - pos;
+    if (first > samples) {
+        first = samples;
+    }
+    memcpy(&s_ring[pos], data, first * sizeof(int16_t));
+    if (samples > first) {
+        memcpy(&s_ring[0], (const int16_t *)data + first, (samples - first) * sizeof(int16_t));
+    }
+    s_write_count += samples;
+    s_write_ts = esp_timer_get_time();
+    portEXIT_CRITICAL_ISR(&s_lock);
+
+    if (s_waiting) {
+        xSemaphoreGiveFromISR(s_write_sem, &need_yield);
+    }
+    return need_yield == pdTRUE;
+}
+
+/**
+ * @brief 取出与一段麦克风数据对齐的参考信号
+ */
+esp_err_t aec_ref_fetch(int16_t *out, int samples, int64_t capture_end_us)
+{
+    if (s_ring == NULL || out == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    int64_t write_count = s_write_count;
+    int64_t write_ts = s_write_ts;
+    portEXIT_CRITICAL(&s_lock);
+
+    // 1.按时间戳换算出这段麦克风数据对应的参考位置；同一时钟源下偏移固定，正常情况下只在首次读取时使用
+    int64_t expected = write_count + (capture_end_us - write_ts) * s_sample_rate / 1000000 - samples - s_delay;
+    int64_t resync_limit = (int64_t)s_sample_rate * AEC_REF_RESYNC_MS / 1000;
+    if (!s_synced || llabs(expected - s_read_pos) > resync_limit) {
+        if (s_synced) {
+            s_stats.resyncs++;
+        }
+        s_read_pos = expected;
+        s_synced = true;
+    }
+
+    // 2.参考数据要等扬声器DMA发送完才会写入，必要时等待下一次发送完成
+    int64_t need_end = s_read_pos + samples;
+    if (need_end > write_count) {
+        s_stats.waits++;
+        s_waiting = true;
+        while (need_end > write_count) {
+            if (xSemaphoreTake(s_write_sem, pdMS_TO_TICKS(AEC_REF_WAIT_MS)) != pdTRUE) {
+                break;
+            }
+            portENTER_CRITICAL(&s_lock);
+            write_count = s_write_count;
+            portEXIT_CRITICAL(&s_lock);
+        }
+        s_waiting = false;
+    }
+
+    // 3.拷贝，没有输出过或者已经被覆盖的位置补静音
+    bool missing = false;
+    for (int i = 0; i < samples; i++) {
+        int64_t idx = s_read_pos + i;
+        if (idx < 0 || idx >= write_count || write_count - idx > AEC_REF_RING_SAMPLES - CAL_FRAME_SAMPLES) {
+            out[i] = 0;
+            missing = true;
+        } else {
+            out[i] = s_ring[idx & AEC_REF_RING_MASK];
+        }
+    }
+    s_read_pos += samples;
+
+    if (missing) {
+        s_stats.missing++;
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+void aec_ref_set_delay(int delay_samples)
+{
+    s_delay = delay_samples < 0 ? 0 : delay_samples;
+    s_stats.delay_samples = s_delay;
+    s_synced = false;
+}
+
+int aec_ref_get_delay(void)
+{
+    return s_delay;
+}
+
+/**
+ * @brief 生成Hann窗的线性扫频信号
+ */
+static void aec_ref_gen_chirp(int16_t *chirp, int len)
+{
+    float duration = (float)len / s_sample_rate;
+    float k = (CAL_CHIRP_F1 - CAL_CHIRP_F0) / duration;
+    for (int i = 0; i < len; i++) {
+        float t = (float)i / s_sample_rate;
+        float phase = 2.0f * (float)M_PI * (CAL_CHIRP_F0 * t + 0.5f * k * t * t);
+        float win = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / (len - 1));
+        chirp[i] = (int16_t)(CAL_CHIRP_AMPLITUDE * win * sinf(phase));
+    }
+}
+
+/**
+ * @brief 播放扫频信号并测量扬声器到麦克风的延迟
+ */
+esp_err_t aec_ref_calibrate(int mic_num, int *delay_samples)
+{
+    if (s_ring == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (mic_num < 1) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const int frames = CAL_RECORD_MS * s_sample_rate / 1000 / CAL_FRAME_SAMPLES;
+    const int total = frames * CAL_FRAME_SAMPLES;
+    const int chirp_len = CAL_CHIRP_MS * s_sample_rate / 1000;
+    esp_err_t ret = ESP_OK;
+
+    // 1.分配录音缓冲区（只在启动时用一次，放PSRAM）
+    int16_t *mic_rec = (int16_t *)heap_caps_malloc(total * sizeof(int16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    int16_t *ref_rec = (int16_t *)heap_caps_malloc(total * sizeof(int16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    int16_t *chirp = (int16_t *)heap_caps_malloc(chirp_len * sizeof(int16_t), MALLOC_CAP_8BIT);
+    // 多麦时驱动输出交错的 [L, R, L, R, ...]，按帧读入后只取第一个麦克风（左声道）参与互相关
+    int16_t *frame_buf = NULL;
+    if (mic_num > 1) {
+        frame_buf = (int16_t *)heap_caps_malloc(CAL_FRAME_SAMPLES * mic_num * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (!mic_rec || !ref_rec || !chirp || (mic_num > 1 && !frame_buf)) {
+        ret = ESP_ERR_NO_MEM;
+        goto exit;
+    }
+    aec_ref_gen_chirp(chirp, chirp_len);
+
+    // 2.以0延迟同时录制麦克风和参考信号，录制过程中播放扫频
+    int old_delay = s_delay;
+    aec_ref_set_delay(0);
+    for (int f = 0; f < frames; f++) {
+        size_t bytes_read = 0;
+        int16_t *mic = mic_rec + f * CAL_FRAME_SAMPLES;
+        const size_t frame_bytes = CAL_FRAME_SAMPLES * mic_num * sizeof(int16_t);
+        ret = inmp441_i2s_read(frame_buf ? frame_buf : mic, frame_bytes, &bytes_read, pdMS_TO_TICKS(200));
+        if (ret != ESP_OK || bytes_read != frame_bytes) {
+            ESP_LOGE(TAG, "Calibration: failed to read microphone");
+            aec_ref_set_delay(old_delay);
+            ret = (ret == ESP_OK) ? ESP_FAIL : ret;
+            goto exit;
+        }
+        if (frame_buf) {
+            for (int i = 0; i < CAL_FRAME_SAMPLES; i++) {
+                mic[i] = frame_buf[i * mic_num];
+            }
+        }
+        aec_ref_fetch(ref_rec + f * CAL_FRAME_SAMPLES, CAL_FRAME_SAMPLES, inmp441_i2s_get_read_timestamp());
+        if (f == CAL_CHIRP_START_FRAME) {
+            max98357_i2s_write(chirp, chirp_len * sizeof(int16_t), NULL, pdMS_TO_TICKS(200));
+        }
+    }
+
+    // 3.在参考信号中找到扫频开始的位置
+    int onset = -1;
+    for (int i = 0; i < total; i++) {
+        if (abs(ref_rec[i]) > (int)(CAL_CHIRP_AMPLITUDE / 4)) {
+            onset = i;
+            break;
+        }
+    }
+    int start = onset - chirp_len / 4;
+    if (start < 0) {
+        start = 0;
+    }
+    int max_lag = CAL_MAX_LAG_MS * s_sample_rate / 1000;
+    if (start + chirp_len + max_lag > total) {
+        max_lag = total - start - chirp_len;
+    }
+    if (onset < 0 || max_lag <= 0) {
+        ESP_LOGW(TAG, "Calibration: chirp not found in reference (onset=%d)", onset);
+        aec_ref_set_delay(old_delay);
+        ret = ESP_ERR_NOT_FOUND;
+        goto exit;
+    }
+
+    // 4.互相关：参考信号的扫频段与麦克风在各个延迟下的相关值，取绝对值最大的位置（扬声器可能反相）
+    int64_t best = 0;
+    int best_lag = 0;
+    for (int lag = 0; lag <= max_lag; lag++) {
+        int64_t acc = 0;
+        const int16_t *r = ref_rec + start;
+        const int16_t *m = mic_rec + start + lag;
+        for (int i = 0; i < chirp_len; i++) {
+            acc += (int32_t)r[i] * m[i];
+        }
+        if (llabs(acc) > llabs(best)) {
+            best = acc;
+            best_lag = lag;
+        }
+    }
+
+    // 5.归一化相关系数，太小说明麦克风没有听到扫频
+    int64_t e_ref = 0, e_mic = 0;
+    for (int i = 0; i < chirp_len; i++) {
+        e_ref += (int32_t)ref_rec[start + i] * ref_rec[start + i];
+        e_mic += (int32_t)mic_rec[start + best_lag + i] * mic_rec[start + best_lag + i];
+    }
+    float corr = (e_ref > 0 && e_mic > 0) ? fabsf((float)best) / sqrtf((float)e_ref * (float)e_mic) : 0.0f;
+    if (corr < CAL_MIN_CORRELATION) {
+        ESP_LOGW(TAG, "Calibration: correlation too weak (%.3f at %d samples), keep delay %d", corr, best_lag, old_delay);
+        aec_ref_set_delay(old_delay);
+        ret = ESP_ERR_NOT_FOUND;
+        goto exit;
+    }
+
+    int delay = best_lag - AEC_REF_LEAD_SAMPLES;
+    aec_ref_set_delay(delay);
+    ESP_LOGI(TAG, "Calibration done: echo lag %d samples (%.2f ms), correlation %.3f, reference delay %d samples",
+             best_lag, best_lag * 1000.0f / s_sample_rate, corr, aec_ref_get_delay());
+    if (delay_samples) {
+        *delay_samples = aec_ref_get_delay();
+    }
+
+exit:
+    heap_caps_free(mic_rec);
+    heap_caps_free(ref_rec);
+    heap_caps_free(chirp);
+    heap_caps_free(frame_buf);
+    return ret;
+}
+
+/**
+ * @brief 获取统计信息
+ */
+esp_err_t aec_ref_get_stats(aec_ref_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *stats = s_stats;
+    return ESP_OK;
+}
@@ -0,0 +1,290 @@
+#include "audio_bus.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "AUDIO_BUS";
+
+// BLOCK 策略下发布者最长等待时间，超时后仍然丢帧，防止订阅者卡死拖住发布者
+#define AUDIO_BUS_BLOCK_TIMEOUT_MS  100
+
+struct audio_bus_sub {
+    bool                    used;
+    const char             *name;
+    QueueHandle_t           que;        // 存放 audio_frame_t* 的队列
+    audio_bus_overflow_t    policy;
+    uint32_t                delivered;
+    uint32_t                dropped;
+};
+
+// 帧池
+static audio_frame_t *s_frames = NULL;      // 帧描述符数组
+static int16_t *s_frame_mem = NULL;         // 所有帧共用的一整块PCM内存
+static QueueHandle_t s_free_que = NULL;     // 空闲帧队列
+static size_t s_frame_bytes = 0;
+static int s_pool_size = 0;
+
+// 订阅者
+static struct audio_bus_sub s_subs[AUDIO_BUS_MAX_SUBSCRIBERS];
+static SemaphoreHandle_t s_sub_lock = NULL;
+static uint32_t s_seq = 0;
+
+/**
+ * @brief 初始化音频帧总线
+ */
+esp_err_t audio_bus_init(size_t frame_bytes, int pool_size)
+{
+    if (frame_bytes == 0 || pool_size <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_frames != NULL) {
+        // 帧池按首次初始化的帧长分配，帧长不同时复用会导致发布者越界写入
+        if (frame_bytes != s_frame_bytes || pool_size != s_pool_size) {
+            ESP_LOGE(TAG, "Audio bus already initialized with %d x %d bytes, requested %d x %d bytes",
+                     s_pool_size, (int)s_frame_bytes, pool_size, (int)frame_bytes);
+            return ESP_ERR_INVALID_STATE;
+        }
+        ESP_LOGW(TAG, "Audio bus already initialized");
+        return ESP_OK;
+    }
+
+    // 1.帧池放在内部RAM，订阅者直接读取，不再拷贝
+    s_frames = (audio_frame_t *)calloc(pool_size, sizeof(audio_frame_t));
+    s_frame_mem = (int16_t *)heap_caps_malloc(frame_bytes * pool_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    s_free_que = xQueueCreate(pool_size, sizeof(audio_frame_t *));
+    s_sub_lock = xSemaphoreCreateMutex();
+    if (!s_frames || !s_frame_mem || !s_free_que || !s_sub_lock) {
+        ESP_LOGE(TAG, "Failed to allocate audio bus (%d x %d bytes)", pool_size, (int)frame_bytes);
+        audio_bus_deinit();
+        return ESP_ERR_NO_MEM;
+    }
+
+    // 2.所有帧放入空闲队列
+    s_frame_bytes = frame_bytes;
+    s_pool_size = pool_size;
+    for (int i = 0; i < pool_size; i++) {
+        audio_frame_t *frame = &s_frames[i];
+        frame->data = (int16_t *)((uint8_t *)s_frame_mem + i * frame_bytes);
+        frame->refcount = 0;
+        xQueueSend(s_free_que, &frame, 0);
+    }
+    memset(s_subs, 0, sizeof(s_subs));
+    s_seq = 0;
+
+    ESP_LOGI(TAG, "Audio bus initialized: %d frames x %d bytes", pool_size, (int)frame_bytes);
+    return ESP_OK;
+}
+
+/**
+ * @brief 释放音频帧总线
+ */
+void audio_bus_deinit(void)
+{
+    for (int i = 0; i < AUDIO_BUS_MAX_SUBSCRIBERS; i++) {
+        if (s_subs[i].used) {
+            audio_bus_unsubscribe(&s_subs[i]);
+        }
+    }
+    if (s_free_que) {
+        vQueueDelete(s_free_que);
+        s_free_que = NULL;
+    }
+    if (s_sub_lock) {
+        vSemaphoreDelete(s_sub_lock);
+        s_sub_lock = NULL;
+    }
+    if (s_frame_mem) {
+        heap_caps_free(s_frame_mem);
+        s_frame_mem = NULL;
+    }
+    if (s_frames) {
+        free(s_frames);
+        s_frames = NULL;
+    }
+    s_frame_bytes = 0;
+    s_pool_size = 0;
+}
+
+/**
+ * @brief 从帧池中获取一帧
+ */
+audio_frame_t *audio_bus_frame_alloc(TickType_t ticks_to_wait)
+{
+    audio_frame_t *frame = NULL;
+    if (s_free_que == NULL || xQueueReceive(s_free_que, &frame, ticks_to_wait) != pdTRUE) {
+        return NULL;
+    }
+    frame->refcount = 1;
+    frame->len = 0;
+    frame->flags = 0;
+    frame->timestamp_us = 0;
+    return frame;
+}
+
+void audio_frame_retain(audio_frame_t *frame)
+{
+    __atomic_fetch_add(&frame->refcount, 1, __ATOMIC_RELAXED);
+}
+
+void audio_frame_release(audio_frame_t *frame)
+{
+    if (frame == NULL) {
+        return;
+    }
+    // 最后一个引用释放 -> 回到帧池
+    if (__atomic_sub_fetch(&frame->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+        xQueueSend(s_free_que, &frame, 0);
+    }
+}
+
+/**
+ * @brief 按订阅者的溢出策略把帧放入其队列
+ */
+static void audio_bus_deliver(struct audio_bus_sub *sub, audio_frame_t *frame)
+{
+    audio_frame_retain(frame);
+
+    TickType_t wait = (sub->policy == AUDIO_BUS_BLOCK) ? pdMS_TO_TICKS(AUDIO_BUS_BLOCK_TIMEOUT_MS) : 0;
+    if (xQueueSend(sub->que, &frame, wait) == pdTRUE) {
+        sub->delivered++;
+        return;
+    }
+
+    if (sub->policy == AUDIO_BUS_DROP_OLDEST) {
+        // 丢掉最旧的一帧再放入新帧
+        audio_frame_t *oldest = NULL;
+        if (xQueueReceive(sub->que, &oldest, 0) == pdTRUE) {
+            audio_frame_release(oldest);
+            sub->dropped++;
+        }
+        if (xQueueSend(sub->que, &frame, 0) == pdTRUE) {
+            sub->delivered++;
+            return;
+        }
+    }
+
+    // DROP_NEWEST / BLOCK超时 / 竞争失败：丢弃当前帧
+    sub->dropped++;
+    audio_frame_release(frame);
+}
+
+/**
+ * @brief 发布一帧给所有订阅者
+ */
+esp_err_t audio_bus_publish(audio_frame_t *frame)
+{
+    if (frame == NULL || s_sub_lock == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    frame->seq = s_seq++;
+
+    xSemaphoreTake(s_sub_lock, portMAX_DELAY);
+    for (int i = 0; i < AUDIO_BUS_MAX_SUBSCRIBERS; i++) {
+        if (s_subs[i].used) {
+            audio_bus_deliver(&s_subs[i], frame);
+        }
+    }
+    xSemaphoreGive(s_sub_lock);
+
+    // 释放发布者自己的引用（没有订阅者时帧直接回到帧池）
+    audio_frame_release(frame);
+    return ESP_OK;
+}
+
+/**
+ * @brief 注册订阅者
+ */
+audio_bus_sub_handle_t audio_bus_subscribe(const char *name, int depth, audio_bus_overflow_t policy)
+{
+    if (s_sub_lock == NULL || depth <= 0) {
+        ESP_LOGE(TAG, "Audio bus is not initialized or invalid depth");
+        return NULL;
+    }
+
+    struct audio_bus_sub *sub = NULL;
+    xSemaphoreTake(s_sub_lock, portMAX_DELAY);
+    for (int i = 0; i < AUDIO_BUS_MAX_SUBSCRIBERS; i++) {
+        if (!s_subs[i].used) {
+            sub = &s_subs[i];
+            break;
+        }
+    }
+    if (sub) {
+        sub->que = xQueueCreate(depth, sizeof(audio_frame_t *));
+        if (sub->que) {
+            sub->used = true;
+            sub->name = name;
+            sub->policy = policy;
+            sub->delivered = 0;
+            sub->dropped = 0;
+        } else {
+            sub = NULL;
+        }
+    }
+    xSemaphoreGive(s_sub_lock);
+
+    if (sub == NULL) {
+        ESP_LOGE(TAG, "Failed to subscribe '%s'", name ? name : "?");
+        return NULL;
+    }
+    ESP_LOGI(TAG, "Subscriber '%s' added (depth=%d, policy=%d)", name ? name : "?", depth, policy);
+    return sub;
+}
+
+/**
+ * @brief 注销订阅者
+ */
+esp_err_t audio_bus_unsubscribe(audio_bus_sub_handle_t sub)
+{
+    if (sub == NULL || !sub->used) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(s_sub_lock, portMAX_DELAY);
+    sub->used = false;
+    xSemaphoreGive(s_sub_lock);
+
+    // 释放队列中尚未消费的帧
+    audio_frame_t *frame = NULL;
+    while (xQueueReceive(sub->que, &frame, 0) == pdTRUE) {
+        audio_frame_release(frame);
+    }
+    vQueueDelete(sub->que);
+    sub->que = NULL;
+
+    ESP_LOGI(TAG, "Subscriber '%s' removed (delivered=%lu, dropped=%lu)",
+             sub->name ? sub->name : "?", (unsigned long)sub->delivered, (unsigned long)sub->dropped);
+    return ESP_OK;
+}
+
+/**
+ * @brief 从订阅者队列中取出一帧
+ */
+audio_frame_t *audio_bus_receive(audio_bus_sub_handle_t sub, TickType_t ticks_to_wait)
+{
+    audio_frame_t *frame = NULL;
+    if (sub == NULL || sub->que == NULL) {
+        return NULL;
+    }
+    if (xQueueReceive(sub->que, &frame, ticks_to_wait) != pdTRUE) {
+        return NULL;
+    }
+    return frame;
+}
+
+/**
+ * @brief 获取订阅者统计信息
+ */
+esp_err_t audio_bus_get_stats(audio_bus_sub_handle_t sub, audio_bus_stats_t *stats)
+{
+    if (sub == NULL || stats == NULL || !sub->used) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    stats->delivered = sub->delivered;
+    stats->dropped = sub->dropped;
+    stats->queued = uxQueueMessagesWaiting(sub->que);
+    return ESP_OK;
+}
@@ -0,0 +1,356 @@
+#include "audio_codec.h"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include "sdkconfig.h"
+#include <string.h>
+#include <math.h>
+
+static const char *TAG = "AUDIO_CODEC";
+
+// IMA-ADPCM 步长表和索引调整表（放在DRAM中，避免编码循环里取flash常量）
+static DRAM_ATTR const int16_t s_step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+    19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+    5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+static DRAM_ATTR const int8_t s_index_table[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+
+#define IMA_MAX_INDEX   88
+
+/**
+ * @brief IMA-ADPCM 标量参考实现（按标准算法逐位判断）
+ */
+void audio_codec_ima_encode_ansi(audio_codec_state_t *st, const int16_t *pcm, int samples, uint8_t *out)
+{
+    int pred = st->predictor;
+    int index = st->step_index;
+
+    for (int i = 0; i < samples; i++) {
+        int step = s_step_table[index];
+        int diff = pcm[i] - pred;
+        int code = 0;
+        if (diff < 0) {
+            code = 8;
+            diff = -diff;
+        }
+        int vpdiff = step >> 3;
+        if (diff >= step) {
+            code |= 4;
+            diff -= step;
+            vpdiff += step;
+        }
+        step >>= 1;
+        if (diff >= step) {
+            code |= 2;
+            diff -= step;
+            vpdiff += step;
+        }
+        step >>= 1;
+        if (diff >= step) {
+            code |= 1;
+            vpdiff += step;
+        }
+        pred += (code & 8) ? -vpdiff : vpdiff;
+        if (pred > 32767) {
+            pred = 32767;
+        } else if (pred < -32768) {
+            pred = -32768;
+        }
+        index += s_index_table[code & 7];
+        if (index < 0) {
+            index = 0;
+        } else if (index > IMA_MAX_INDEX) {
+            index = IMA_MAX_INDEX;
+        }
+
+        // 低半字节在前
+        if (i & 1) {
+            out[i >> 1] |= (uint8_t)(code << 4);
+        } else {
+            out[i >> 1] = (uint8_t)code;
+        }
+    }
+
+    st->predictor = pred;
+    st->step_index = index;
+}
+
+/**
+ * @brief 编码一个采样（无分支版本：比较结果转成掩码，Xtensa 上编译为 min/max 和条件移动）
+ */
+static inline __attribute__((always_inline)) int ima_encode_sample(int sample, int *pred, int *index)
+{
+    int step = s_step_table[*index];
+    int diff = sample - *pred;
+    int neg = diff >> 31;                   // 负数时为 -1
+    diff = (diff ^ neg) - neg;
+
+    int m = -(diff >= step);
+    int code = 4 & m;
+    int vpdiff = (step >> 3) + (step & m);
+    diff -= step & m;
+    step >>= 1;
+    m = -(diff >= step);
+    code |= 2 & m;
+    vpdiff += step & m;
+    diff -= step & m;
+    step >>= 1;
+    m = -(diff >= step);
+    code |= 1 & m;
+    vpdiff += step & m;
+
+    int p = *pred + ((vpdiff ^ neg) - neg);
+    p = p > 32767 ? 32767 : p;
+    p = p < -32768 ? -32768 : p;
+    *pred = p;
+
+    int idx = *index + s_index_table[code];
+    idx = idx < 0 ? 0 : idx;
+    idx = idx > IMA_MAX_INDEX ? IMA_MAX_INDEX : idx;
+    *index = idx;
+
+    return code | (neg & 8);
+}
+
+/**
+ * @brief IMA-ADPCM 优化实现：一次编码两个采样输出一个字节，状态保存在寄存器中
+ *
+ * 工程默认按 -Og 编译，这个热点函数单独按 -O2 编译。输出与参考实现逐位一致。
+ */
+static void __attribute__((optimize("O2"))) ima_encode_fast(audio_codec_state_t *st, const int16_t *pcm, int samples, uint8_t *out)
+{
+    int pred = st->predictor;
+    int index = st->step_index;
+
+    int pairs = samples >> 1;
+    for (int i = 0; i < pairs; i++) {
+        int lo = ima_encode_sample(pcm[0], &pred, &index);
+        int hi = ima_encode_sample(pcm[1], &pred, &index);
+        *out++ = (uint8_t)(lo | (hi << 4));
+        pcm += 2;
+    }
+    if (samples & 1) {
+        *out = (uint8_t)ima_encode_sample(pcm[0], &pred, &index);
+    }
+
+    st->predictor = pred;
+    st->step_index = index;
+}
+
+/**
+ * @brief IMA-ADPCM 解码参考实现
+ */
+int audio_codec_ima_decode(const uint8_t *in, size_t len, int samples, int16_t *pcm)
+{
+    if (len < AUDIO_CODEC_ADPCM_HEADER_BYTES) {
+        return 0;
+    }
+    int pred = (int16_t)(in[0] | (in[1] << 8));
+    int index = in[2] > IMA_MAX_INDEX ? IMA_MAX_INDEX : in[2];
+    // 奇数采样的帧最后半个字节是填充，只解码实际的采样数
+    int max_samples = (int)(len - AUDIO_CODEC_ADPCM_HEADER_BYTES) * 2;
+    if (samples <= 0 || samples > max_samples) {
+        samples = max_samples;
+    }
+    const uint8_t *data = in + AUDIO_CODEC_ADPCM_HEADER_BYTES;
+
+    for (int i = 0; i < samples; i++) {
+        int code = (i & 1) ? (data[i >> 1] >> 4) : (data[i >> 1] & 0x0F);
+        int step = s_step_table[index];
+        int vpdiff = step >> 3;
+        if (code & 4) {
+            vpdiff += step;
+        }
+        if (code & 2) {
+            vpdiff += step >> 1;
+        }
+        if (code & 1) {
+            vpdiff += step >> 2;
+        }
+        pred += (code & 8) ? -vpdiff : vpdiff;
+        if (pred > 32767) {
+            pred = 32767;
+        } else if (pred < -32768) {
+            pred = -32768;
+        }
+        index += s_index_table[code & 7];
+        if (index < 0) {
+            index = 0;
+        } else if (index > IMA_MAX_INDEX) {
+            index = IMA_MAX_INDEX;
+        }
+        pcm[i] = (int16_t)pred;
+    }
+    return samples;
+}
+
+// PCM16 --------------------------------------------------------------------------------------
+static size_t pcm16_max_encoded_size(int samples)
+{
+    return samples * sizeof(int16_t);
+}
+
+static size_t pcm16_encode(audio_codec_state_t *st, const int16_t *pcm, int samples, uint8_t *out)
+{
+    memcpy(out, pcm, samples * sizeof(int16_t));
+    return samples * sizeof(int16_t);
+}
+
+// IMA-ADPCM ----------------------------------------------------------------------------------
+static size_t ima_max_encoded_size(int samples)
+{
+    return AUDIO_CODEC_ADPCM_HEADER_BYTES + (samples + 1) / 2;
+}
+
+static size_t ima_encode(audio_codec_state_t *st, const int16_t *pcm, int samples, uint8_t *out)
+{
+    // 帧头：编码这一帧之前的状态，服务器每帧都可以从帧头重新开始解码
+    out[0] = (uint8_t)(st->predictor & 0xFF);
+    out[1] = (uint8_t)((st->predictor >> 8) & 0xFF);
+    out[2] = (uint8_t)st->step_index;
+    out[3] = 0;
+    ima_encode_fast(st, pcm, samples, out + AUDIO_CODEC_ADPCM_HEADER_BYTES);
+    return ima_max_encoded_size(samples);
+}
+
+static const audio_codec_iface_t s_codecs[AUDIO_CODEC_MAX] = {
+    [AUDIO_CODEC_PCM16] = {
+        .type = AUDIO_CODEC_PCM16,
+        .name = "pcm16",
+        .max_encoded_size = pcm16_max_encoded_size,
+        .encode = pcm16_encode,
+    },
+    [AUDIO_CODEC_IMA_ADPCM] = {
+        .type = AUDIO_CODEC_IMA_ADPCM,
+        .name = "ima_adpcm",
+        .max_encoded_size = ima_max_encoded_size,
+        .encode = ima_encode,
+    },
+};
+
+const audio_codec_iface_t *audio_codec_get(audio_codec_type_t type)
+{
+    if (type < 0 || type >= AUDIO_CODEC_MAX) {
+        return NULL;
+    }
+    return &s_codecs[type];
+}
+
+const audio_codec_iface_t *audio_codec_find(const char *name)
+{
+    if (name == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < AUDIO_CODEC_MAX; i++) {
+        if (strcmp(s_codecs[i].name, name) == 0) {
+            return &s_codecs[i];
+        }
+    }
+    return NULL;
+}
+
+void audio_codec_reset(audio_codec_state_t *st)
+{
+    st->predictor = 0;
+    st->step_index = 0;
+}
+
+/**
+ * @brief 编码基准测试
+ */
+esp_err_t audio_codec_benchmark(int samples, int rounds)
+{
+    samples &= ~0x1;
+    if (samples <= 0 || rounds <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const audio_codec_iface_t *ima = audio_codec_get(AUDIO_CODEC_IMA_ADPCM);
+    const audio_codec_iface_t *pcm = audio_codec_get(AUDIO_CODEC_PCM16);
+    int16_t *src = (int16_t *)heap_caps_malloc(samples * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    int16_t *dec = (int16_t *)heap_caps_malloc(samples * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    uint8_t *out_ansi = (uint8_t *)heap_caps_malloc(ima->max_encoded_size(samples), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    uint8_t *out_fast = (uint8_t *)heap_caps_malloc(pcm->max_encoded_size(samples), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!src || !dec || !out_ansi || !out_fast) {
+        heap_caps_free(src);
+        heap_caps_free(dec);
+        heap_caps_free(out_ansi);
+        heap_caps_free(out_fast);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // 1.构造测试信号：几个谐波叠加，幅度包络起伏，接近语音的频谱和动态范围
+    for (int i = 0; i < samples; i++) {
+        float t = i / 16000.0f;
+        float env = 0.2f + 0.8f * fabsf(sinf(2.0f * (float)M_PI * 3.0f * t));
+        float v = 0.5f * sinf(2.0f * (float)M_PI * 220.0f * t) + 0.25f * sinf(2.0f * (float)M_PI * 660.0f * t) +
+                  0.12f * sinf(2.0f * (float)M_PI * 1870.0f * t) + 0.06f * sinf(2.0f * (float)M_PI * 3300.0f * t);
+        src[i] = (int16_t)(env * v * 20000.0f);
+    }
+
+    // 2.标量参考实现
+    audio_codec_state_t st;
+    uint32_t start = esp_cpu_get_cycle_count();
+    for (int r = 0; r < rounds; r++) {
+        audio_codec_reset(&st);
+        audio_codec_ima_encode_ansi(&st, src, samples, out_ansi + AUDIO_CODEC_ADPCM_HEADER_BYTES);
+    }
+    uint32_t ansi_cycles = (esp_cpu_get_cycle_count() - start) / rounds;
+
+    // 3.优化实现（含帧头），与参考实现逐位比较
+    size_t ima_bytes = 0;
+    start = esp_cpu_get_cycle_count();
+    for (int r = 0; r < rounds; r++) {
+        audio_codec_reset(&st);
+        ima_bytes = ima->encode(&st, src, samples, out_fast);
+    }
+    uint32_t fast_cycles = (esp_cpu_get_cycle_count() - start) / rounds;
+    esp_err_t ret = ESP_OK;
+    if (memcmp(out_ansi + AUDIO_CODEC_ADPCM_HEADER_BYTES, out_fast + AUDIO_CODEC_ADPCM_HEADER_BYTES,
+               ima_bytes - AUDIO_CODEC_ADPCM_HEADER_BYTES) != 0) {
+        ESP_LOGE(TAG, "Optimized IMA-ADPCM output differs from ansi reference");
+        ret = ESP_FAIL;
+    }
+
+    // 4.解码信噪比：接着上一帧的状态再编码一帧（步长已经收敛，与连续上行时一致）
+    ima->encode(&st, src, samples, out_fast);
+    audio_codec_ima_decode(out_fast, ima_bytes, samples, dec);
+    double e_sig = 0, e_err = 0;
+    for (int i = 0; i < samples; i++) {
+        double d = (double)src[i] - dec[i];
+        e_sig += (double)src[i] * src[i];
+        e_err += d * d;
+    }
+    float snr = e_err > 0 ? 10.0f * log10f((float)(e_sig / e_err)) : 99.0f;
+
+    // 5.PCM16 透传作为对照
+    start = esp_cpu_get_cycle_count();
+    size_t pcm_bytes = 0;
+    for (int r = 0; r < rounds; r++) {
+        pcm_bytes = pcm->encode(&st, src, samples, out_fast);
+    }
+    uint32_t pcm_cycles = (esp_cpu_get_cycle_count() - start) / rounds;
+
+    float frame_ms = samples * 1000.0f / 16000.0f;
+    float cycles_per_ms = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ * 1000.0f;
+    ESP_LOGI(TAG, "%d samples/frame (%.0f ms @ 16kHz):", samples, frame_ms);
+    ESP_LOGI(TAG, "  pcm16:     %lu cycles, %d bytes/frame, %.1f kbit/s",
+             (unsigned long)pcm_cycles, (int)pcm_bytes, pcm_bytes * 8 / frame_ms);
+    ESP_LOGI(TAG, "  ima_adpcm: ansi %lu cycles, optimized %lu cycles (%.3f%% CPU, x%.2f), %d bytes/frame, %.1f kbit/s, SNR %.1f dB",
+             (unsigned long)ansi_cycles, (unsigned long)fast_cycles, 100.0f * fast_cycles / (cycles_per_ms * frame_ms),
+             fast_cycles ? (float)ansi_cycles / fast_cycles : 0.0f, (int)ima_bytes, ima_bytes * 8 / frame_ms, snr);
+
+    heap_caps_free(src);
+    heap_caps_free(dec);
+    heap_caps_free(out_ansi);
+    heap_caps_free(out_fast);
+    return ret;
+}
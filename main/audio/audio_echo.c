@@ -2,6 +2,15 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "dsps_tone_gen.h"
+#include "dsps_corr.h"
+#include "dsps_wind_hann.h"
 
 #include "inmp441_i2s.h"
 #include "max98357_i2s.h"
@@ -19,6 +28,22 @@ static const char *TAG = "AUDIO_ECHO";
 // 用于在录音和播放之间传递数据的缓冲区大小
 #define ECHO_BUFFER_SIZE     (2048)
 
+// 往返延迟基准测试：麦克风按 sr.c 的方式采集（32位、DMA回调），测试音为Hann窗多音短脉冲
+#define BENCH_MIC_BITS       (I2S_DATA_BIT_WIDTH_32BIT)
+#define BENCH_MIC_GAIN_SHIFT (1)
+#define BENCH_BURST_MS       (10)        // 测试音长度
+#define BENCH_BURST_AMPL     (8000.0f)   // 测试音幅度（约-12dBFS）
+#define BENCH_SETTLE_MS      (300)       // 每次测量前先写静音，让DMA缓冲回到稳态
+#define BENCH_WINDOW_MS      (400)       // 写入测试音后录音的时长（最大可测延迟）
+#define BENCH_MIN_CORR       (0.15f)     // 归一化相关峰阈值
+#define BENCH_NOISE_FLOOR    (30.0f)     // 参与检测的最小RMS，静音段的相关值没有意义
+
+// 多音叠加比单音的自相关峰更尖，不容易错到相邻周期上
+static const float s_burst_freqs[] = {700.0f, 1300.0f, 2300.0f, 3100.0f};
+// 基准测试的配置组合
+static const i2s_latency_profile_t s_bench_profiles[] = {I2S_LATENCY_LOW, I2S_LATENCY_BALANCED, I2S_LATENCY_ROBUST};
+static const int s_bench_chunks[] = {256, 512, 1024};
+
 /**
  * @brief 实时回声任务
  * @param arg 未使用
@@ -97,3 +122,261 @@ void audio_echo_task_start(void)
     xTaskCreate(echo_task, "echo_task", ECHO_TASK_STACK_SIZE, NULL, ECHO_TASK_PRIORITY, NULL);
     ESP_LOGI(TAG, "Audio echo task started.");
 }
+
+/**
+ * @brief 生成测试音：几个单音（dsps_tone_gen）叠加后加Hann窗
+ */
+static esp_err_t echo_gen_burst(float *burst, int len)
+{
+    float *tmp = (float *)malloc(len * sizeof(float));
+    if (tmp == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    const int tones = sizeof(s_burst_freqs) / sizeof(s_burst_freqs[0]);
+    memset(burst, 0, len * sizeof(float));
+    for (int t = 0; t < tones; t++) {
+        dsps_tone_gen_f32(tmp, len, BENCH_BURST_AMPL / tones, s_burst_freqs[t] / ECHO_SAMPLE_RATE, 0);
+        for (int i = 0; i < len; i++) {
+            burst[i] += tmp[i];
+        }
+    }
+    dsps_wind_hann_f32(tmp, len);
+    for (int i = 0; i < len; i++) {
+        burst[i] *= tmp[i];
+    }
+    free(tmp);
+    return ESP_OK;
+}
+
+/**
+ * @brief 在录音中找测试音的起点（归一化互相关峰）
+ *
+ * @return 起点位置，没有找到返回 -1
+ */
+static int echo_find_burst(const float *rec, int rec_len, const float *burst, int burst_len, float *corr)
+{
+    if (dsps_corr_f32(rec, rec_len, burst, burst_len, corr) != ESP_OK) {
+        return -1;
+    }
+
+    float e_burst = 0;
+    for (int i = 0; i < burst_len; i++) {
+        e_burst += burst[i] * burst[i];
+    }
+    const float e_floor = BENCH_NOISE_FLOOR * BENCH_NOISE_FLOOR * burst_len;
+
+    // 滑动窗口能量，归一化相关值 = corr^2 / (E_burst * E_rec)，取平方避免扬声器反相时漏检
+    float e_rec = 0;
+    for (int i = 0; i < burst_len; i++) {
+        e_rec += rec[i] * rec[i];
+    }
+    float best = 0;
+    int best_pos = -1;
+    for (int n = 0; n <= rec_len - burst_len; n++) {
+        if (n > 0) {
+            e_rec += rec[n + burst_len - 1] * rec[n + burst_len - 1] - rec[n - 1] * rec[n - 1];
+        }
+        if (e_rec > e_floor) {
+            float score = corr[n] * corr[n] / (e_burst * e_rec);
+            if (score > best) {
+                best = score;
+                best_pos = n;
+            }
+        }
+    }
+    return (sqrtf(best) >= BENCH_MIN_CORR) ? best_pos : -1;
+}
+
+static int echo_cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief 测量一种DMA配置下的声学往返延迟
+ */
+esp_err_t audio_echo_measure_latency(i2s_latency_profile_t profile, int chunk_samples, int trials,
+                                     audio_echo_latency_t *result)
+{
+    const int burst_len = ECHO_SAMPLE_RATE * BENCH_BURST_MS / 1000;
+    if (result == NULL || trials <= 0 || chunk_samples < burst_len || chunk_samples % 8) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(result, 0, sizeof(*result));
+    result->trials = trials;
+
+    const int win_frames = (ECHO_SAMPLE_RATE * BENCH_WINDOW_MS / 1000 + chunk_samples - 1) / chunk_samples;
+    const int win_len = win_frames * chunk_samples;
+    const int settle_frames = (ECHO_SAMPLE_RATE * BENCH_SETTLE_MS / 1000 + chunk_samples - 1) / chunk_samples;
+    const size_t chunk_bytes = chunk_samples * sizeof(int16_t);
+    esp_err_t ret = ESP_OK;
+
+    // 1.分配缓冲区：收发块放内部RAM（16字节对齐走 aes3 转换），录音和相关结果放PSRAM
+    int16_t *mic = (int16_t *)heap_caps_aligned_alloc(16, chunk_bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    int16_t *silence = (int16_t *)heap_caps_calloc(1, chunk_bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    int16_t *burst_pcm = (int16_t *)heap_caps_calloc(1, chunk_bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    float *burst = (float *)heap_caps_malloc(burst_len * sizeof(float), MALLOC_CAP_8BIT);
+    float *rec = (float *)heap_caps_malloc(win_len * sizeof(float), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    float *corr = (float *)heap_caps_malloc(win_len * sizeof(float), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    int64_t *t_ret = (int64_t *)malloc(win_frames * sizeof(int64_t));
+    int64_t *t_cap = (int64_t *)malloc(win_frames * sizeof(int64_t));
+    uint32_t *total_us = (uint32_t *)malloc(trials * sizeof(uint32_t));
+    if (!mic || !silence || !burst_pcm || !burst || !rec || !corr || !t_ret || !t_cap || !total_us) {
+        ret = ESP_ERR_NO_MEM;
+        goto exit;
+    }
+    ret = echo_gen_burst(burst, burst_len);
+    if (ret != ESP_OK) {
+        goto exit;
+    }
+    for (int i = 0; i < burst_len; i++) {
+        burst_pcm[i] = (int16_t)lrintf(burst[i]);
+    }
+
+    // 2.按档位初始化麦克风和扬声器
+    inmp441_i2s_config_t inmp441_config = {
+        .gpio_bclk = EXAMPLE_I2S_BCLK_IO1,
+        .gpio_ws = EXAMPLE_I2S_WS_IO1,
+        .gpio_din = EXAMPLE_I2S_DIN_IO1,
+        .sample_rate = ECHO_SAMPLE_RATE,
+        .bits_per_sample = BENCH_MIC_BITS,
+        .channel_mode = INMP441_CHANNEL_LEFT,
+        .gain_shift = BENCH_MIC_GAIN_SHIFT,
+        .capture_mode = INMP441_CAPTURE_CALLBACK,
+        .latency_profile = profile,
+        .dma_chunk_samples = chunk_samples,
+    };
+    max98357_i2s_config_t max98357_config = {
+        .gpio_bclk = EXAMPLE_I2S_BCLK_IO2,
+        .gpio_ws = EXAMPLE_I2S_WS_IO2,
+        .gpio_dout = EXAMPLE_I2S_DOUT_IO2,
+        .sample_rate = ECHO_SAMPLE_RATE,
+        .bits_per_sample = ECHO_BITS_PER_SAMPLE,
+        .channel_mode = MAX98357_CHANNEL_MONO,
+        .slot_mask = MAX98357_MASK_LEFT,
+        .latency_profile = profile,
+        .dma_chunk_samples = chunk_samples,
+    };
+    ret = inmp441_i2s_init(&inmp441_config);
+    if (ret != ESP_OK) {
+        goto exit;
+    }
+    ret = max98357_i2s_init(&max98357_config);
+    if (ret != ESP_OK) {
+        inmp441_i2s_close();
+        goto exit;
+    }
+
+    uint64_t sum_total = 0, sum_out = 0, sum_in = 0;
+    for (int t = 0; t < trials && ret == ESP_OK; t++) {
+        // 3.读一块写一块静音，让收发两侧的DMA缓冲回到稳态（上一次的相关计算会打断节奏）
+        for (int f = 0; f < settle_frames && ret == ESP_OK; f++) {
+            ret = inmp441_i2s_read(mic, chunk_bytes, NULL, pdMS_TO_TICKS(500));
+            if (ret == ESP_OK) {
+                ret = max98357_i2s_write(silence, chunk_bytes, NULL, pdMS_TO_TICKS(500));
+            }
+        }
+        if (ret != ESP_OK) {
+            break;
+        }
+
+        // 4.用测试音代替一块静音写入扬声器，之后继续读一块写一块并记录麦克风数据
+        int64_t t0 = esp_timer_get_time();
+        ret = max98357_i2s_write(burst_pcm, chunk_bytes, NULL, pdMS_TO_TICKS(500));
+        for (int f = 0; f < win_frames && ret == ESP_OK; f++) {
+            ret = inmp441_i2s_read(mic, chunk_bytes, NULL, pdMS_TO_TICKS(500));
+            t_ret[f] = esp_timer_get_time();
+            t_cap[f] = inmp441_i2s_get_read_timestamp();
+            for (int i = 0; i < chunk_samples; i++) {
+                rec[f * chunk_samples + i] = mic[i];
+            }
+            if (ret == ESP_OK) {
+                ret = max98357_i2s_write(silence, chunk_bytes, NULL, pdMS_TO_TICKS(500));
+            }
+        }
+        if (ret != ESP_OK) {
+            break;
+        }
+
+        // 5.找测试音起点：读取者在起点所在的那一块读取返回时才拿到它，起点的采集时间由该块最后一个采样的时间倒推
+        int pos = echo_find_burst(rec, win_len, burst, burst_len, corr);
+        if (pos < 0) {
+            ESP_LOGW(TAG, "[%s/%d] trial %d: burst not detected", i2s_latency_profile_name(profile), chunk_samples, t);
+            continue;
+        }
+        int f = pos / chunk_samples;
+        int64_t cap = t_cap[f] - (int64_t)(chunk_samples - 1 - pos % chunk_samples) * 1000000 / ECHO_SAMPLE_RATE;
+        uint32_t total = (uint32_t)(t_ret[f] - t0);
+        total_us[result->detected++] = total;
+        sum_total += total;
+        sum_out += (uint64_t)(cap > t0 ? cap - t0 : 0);
+        sum_in += (uint64_t)(t_ret[f] > cap ? t_ret[f] - cap : 0);
+    }
+
+    inmp441_i2s_close();
+    max98357_i2s_close();
+
+    // 6.统计分布
+    int n = result->detected;
+    if (n > 0) {
+        qsort(total_us, n, sizeof(uint32_t), echo_cmp_u32);
+        result->min_ms = total_us[0] / 1000.0f;
+        result->p50_ms = total_us[n / 2] / 1000.0f;
+        result->p90_ms = total_us[(n * 9) / 10 < n ? (n * 9) / 10 : n - 1] / 1000.0f;
+        result->max_ms = total_us[n - 1] / 1000.0f;
+        result->avg_ms = sum_total / n / 1000.0f;
+        result->out_avg_ms = sum_out / n / 1000.0f;
+        result->in_avg_ms = sum_in / n / 1000.0f;
+    }
+
+exit:
+    heap_caps_free(mic);
+    heap_caps_free(silence);
+    heap_caps_free(burst_pcm);
+    heap_caps_free(burst);
+    heap_caps_free(rec);
+    heap_caps_free(corr);
+    free(t_ret);
+    free(t_cap);
+    free(total_us);
+    return ret;
+}
+
+/**
+ * @brief 往返延迟基准测试
+ */
+esp_err_t audio_echo_benchmark(int trials)
+{
+    if (trials <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ESP_LOGI(TAG, "Round-trip latency benchmark: %d trials per config, %d ms burst", trials, BENCH_BURST_MS);
+    ESP_LOGI(TAG, "profile   chunk  dma(rx/tx ms)  hit    min    p50    p90    max    avg  (out + in)");
+
+    const int n_profiles = sizeof(s_bench_profiles) / sizeof(s_bench_profiles[0]);
+    const int n_chunks = sizeof(s_bench_chunks) / sizeof(s_bench_chunks[0]);
+    for (int p = 0; p < n_profiles; p++) {
+        for (int c = 0; c < n_chunks; c++) {
+            audio_echo_latency_t res;
+            esp_err_t ret = audio_echo_measure_latency(s_bench_profiles[p], s_bench_chunks[c], trials, &res);
+            if (ret != ESP_OK) {
+                ESP_LOGE(TAG, "[%s/%d] failed: %s", i2s_latency_profile_name(s_bench_profiles[p]), s_bench_chunks[c],
+                         esp_err_to_name(ret));
+                return ret;
+            }
+            // DMA缓冲时长按驱动相同的规则推算（麦克风32位单声道，扬声器16位单声道）
+            i2s_dma_layout_t rx, tx;
+            i2s_latency_get_dma_layout(s_bench_profiles[p], s_bench_chunks[c], BENCH_MIC_BITS / 8, &rx);
+            i2s_latency_get_dma_layout(s_bench_profiles[p], s_bench_chunks[c], sizeof(int16_t), &tx);
+            ESP_LOGI(TAG, "%-8s  %5d  %5.1f/%5.1f   %2d/%-2d %6.1f %6.1f %6.1f %6.1f %6.1f  (%.1f + %.1f)",
+                     i2s_latency_profile_name(s_bench_profiles[p]), s_bench_chunks[c],
+                     rx.desc_num * rx.frame_num * 1000.0f / ECHO_SAMPLE_RATE,
+                     tx.desc_num * tx.frame_num * 1000.0f / ECHO_SAMPLE_RATE,
+                     res.detected, res.trials, res.min_ms, res.p50_ms, res.p90_ms, res.max_ms, res.avg_ms,
+                     res.out_avg_ms, res.in_avg_ms);
+        }
+    }
+    return ESP_OK;
+}
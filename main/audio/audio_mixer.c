@@ -0,0 +1,444 @@
+#include "audio_mixer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/stream_buffer.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include <string.h>
+#include <limits.h>
+
+#include "dsps_add.h"
+#include "dsps_mul.h"
+
+#include "max98357_i2s.h"
+
+static const char *TAG = "AUDIO_MIXER";
+
+#define MIXER_TASK_STACK_SIZE   (3 * 1024)
+#define MIXER_GAIN_UNITY        32767   // Q15 增益 1.0
+#define MIXER_DUCK_HOLD_MS      300     // 高优先级的流结束后，低优先级的流保持压低的时间
+#define MIXER_WRITE_SLICE_MS    50      // 写入阻塞时检查混音器状态的间隔
+#define MIXER_STATS_LOG_MS      10000   // 统计日志间隔
+#define MIXER_STOP_TIMEOUT_MS   500
+
+struct audio_mixer_stream {
+    const char         *name;
+    int                 priority;
+    volatile int16_t    gain;           // 设置的增益（Q15）
+    int16_t             duck_gain;      // 被压低时的增益系数（Q15）
+    int16_t             cur_gain;       // 上一块实际使用的增益（Q15），用于平滑过渡
+    StreamBufferHandle_t buf;
+    bool                active;         // 正在播放
+    int64_t             pending_us;     // 未播放时第一次收到数据的时间
+    int64_t             last_active_us; // 最后一次播放的时间（用于压低保持）
+};
+
+static audio_mixer_config_t s_cfg;
+static size_t s_block_bytes = 0;
+
+static audio_mixer_stream_handle_t s_streams[AUDIO_MIXER_MAX_STREAMS];
+// 保护流表，混音任务每块持有一次，只创建一次
+static SemaphoreHandle_t s_lock = NULL;
+
+// aes3 向量指令要求16字节对齐
+static int16_t *s_mix = NULL;
+static int16_t *s_tmp = NULL;
+static int16_t *s_gain_vec = NULL;
+
+static volatile bool s_running = false;
+static TaskHandle_t s_task = NULL;
+static audio_mixer_stats_t s_stats;
+
+static inline int16_t mixer_gain_to_q15(float gain)
+{
+    if (gain <= 0.0f) {
+        return 0;
+    }
+    if (gain >= 1.0f) {
+        return MIXER_GAIN_UNITY;
+    }
+    return (int16_t)(gain * MIXER_GAIN_UNITY);
+}
+
+static esp_err_t mixer_lock_init(void)
+{
+    if (s_lock == NULL) {
+        s_lock = xSemaphoreCreateMutex();
+        if (s_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+static void mixer_free_buffers(void)
+{
+    heap_caps_free(s_mix);
+    heap_caps_free(s_tmp);
+    heap_caps_free(s_gain_vec);
+    s_mix = NULL;
+    s_tmp = NULL;
+    s_gain_vec = NULL;
+}
+
+/**
+ * @brief 给一块数据乘上增益：增益不变时为常数向量，变化时在块内从 from 线性过渡到 to
+ */
+static void mixer_apply_gain(int16_t *data, int samples, int16_t from, int16_t to)
+{
+    if (from == MIXER_GAIN_UNITY && to == MIXER_GAIN_UNITY) {
+        return;
+    }
+    if (from == to) {
+        for (int i = 0; i < samples; i++) {
+            s_gain_vec[i] = to;
+        }
+    } else {
+        int32_t diff = (int32_t)to - from;
+        for (int i = 0; i < samples; i++) {
+            s_gain_vec[i] = (int16_t)(from + diff * (i + 1) / samples);
+        }
+    }
+    dsps_mul_s16(data, s_gain_vec, data, samples, 1, 1, 1, 15);
+}
+
+/**
+ * @brief 混一块：返回参与混音的流数量，结果在 s_mix 中
+ */
+static int mixer_mix_block(void)
+{
+    const int samples = s_cfg.block_samples;
+    const int64_t now = esp_timer_get_time();
+    const int64_t block_us = (int64_t)samples * 1000000 / s_cfg.sample_rate;
+    int top_priority = INT_MIN;
+    int mixed = 0;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+
+    // 1.确定哪些流在播放：攒够一块才开始，数据不足一块但已经等了一个块长（短提示音的结尾）也开始
+    for (int i = 0; i < AUDIO_MIXER_MAX_STREAMS; i++) {
+        audio_mixer_stream_handle_t st = s_streams[i];
+        if (st == NULL) {
+            continue;
+        }
+        size_t avail = xStreamBufferBytesAvailable(st->buf);
+        if (!st->active && avail > 0) {
+            if (st->pending_us == 0) {
+                st->pending_us = now;
+            }
+            if (avail >= s_block_bytes || now - st->pending_us >= block_us) {
+                st->active = true;
+                st->pending_us = 0;
+            }
+        }
+        if (st->active) {
+            st->last_active_us = now;
+        }
+        // 刚结束的高优先级流在保持时间内仍然压低其他流
+        if (st->last_active_us && now - st->last_active_us < MIXER_DUCK_HOLD_MS * 1000LL &&
+            st->priority > top_priority) {
+            top_priority = st->priority;
+        }
+    }
+
+    // 2.逐流取一块数据，乘增益后饱和累加
+    for (int i = 0; i < AUDIO_MIXER_MAX_STREAMS; i++) {
+        audio_mixer_stream_handle_t st = s_streams[i];
+        if (st == NULL) {
+            continue;
+        }
+        int16_t target = st->gain;
+        if (st->priority < top_priority) {
+            target = (int16_t)(((int32_t)target * st->duck_gain) >> 15);
+        }
+        if (!st->active) {
+            // 从静音开始播放时不需要过渡
+            st->cur_gain = target;
+            continue;
+        }
+
+        size_t n = xStreamBufferReceive(st->buf, s_tmp, s_block_bytes, 0);
+        if (n == 0) {
+            // 流结束
+            st->active = false;
+            continue;
+        }
+        if (n < s_block_bytes) {
+            memset((uint8_t *)s_tmp + n, 0, s_block_bytes - n);
+            st->active = false;
+            s_stats.underruns++;
+        }
+
+        mixer_apply_gain(s_tmp, samples, st->cur_gain, target);
+        st->cur_gain = target;
+        if (mixed == 0) {
+            memcpy(s_mix, s_tmp, s_block_bytes);
+        } else {
+            dsps_add_s16(s_mix, s_tmp, s_mix, samples, 1, 1, 1, 0);
+        }
+        mixed++;
+    }
+
+    xSemaphoreGive(s_lock);
+    return mixed;
+}
+
+static void mixer_task(void *arg)
+{
+    const TickType_t block_ticks = pdMS_TO_TICKS(s_cfg.block_samples * 1000 / s_cfg.sample_rate) ?
+                                   pdMS_TO_TICKS(s_cfg.block_samples * 1000 / s_cfg.sample_rate) : 1;
+    int64_t last_log_us = esp_timer_get_time();
+
+    while (s_running) {
+        // 1.混一块（只有这一段计入混音开销）
+        uint32_t start = esp_cpu_get_cycle_count();
+        int mixed = mixer_mix_block();
+        uint32_t cycles = esp_cpu_get_cycle_count() - start;
+        s_stats.active_streams = mixed;
+
+        int64_t now = esp_timer_get_time();
+        if (now - last_log_us > MIXER_STATS_LOG_MS * 1000LL) {
+            last_log_us = now;
+            ESP_LOGI(TAG, "blocks=%lu idle=%lu underruns=%lu active=%lu mix=%lu cycles/block",
+                     (unsigned long)s_stats.blocks, (unsigned long)s_stats.idle_blocks,
+                     (unsigned long)s_stats.underruns, (unsigned long)s_stats.active_streams,
+                     (unsigned long)s_stats.mix_cycles_avg);
+        }
+
+        // 2.没有流在播放：等待有数据写入（I2S 的 auto_clear 会自动输出静音）
+        if (mixed == 0) {
+            s_stats.idle_blocks++;
+            ulTaskNotifyTake(pdTRUE, block_ticks);
+            continue;
+        }
+
+        // 3.写入I2S，DMA写满时在这里阻塞，混音节奏由I2S时钟决定
+        s_stats.mix_cycles_avg = s_stats.mix_cycles_avg ? (s_stats.mix_cycles_avg * 15 + cycles) / 16 : cycles;
+        max98357_i2s_write(s_mix, s_block_bytes, NULL, portMAX_DELAY);
+        s_stats.blocks++;
+    }
+
+    mixer_free_buffers();
+    s_task = NULL;
+    ESP_LOGI(TAG, "[mixer_task] finished");
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief 启动混音器
+ */
+esp_err_t audio_mixer_start(const audio_mixer_config_t *config)
+{
+    if (s_task != NULL) {
+        ESP_LOGW(TAG, "Audio mixer already started");
+        return ESP_OK;
+    }
+
+    audio_mixer_config_t def = AUDIO_MIXER_DEFAULT_CONFIG();
+    s_cfg = config ? *config : def;
+    if (s_cfg.sample_rate <= 0 || s_cfg.block_samples <= 0 || s_cfg.block_samples % 8) {
+        ESP_LOGE(TAG, "Invalid mixer configuration");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (mixer_lock_init() != ESP_OK) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // 1.分配混音缓冲区（内部RAM，16字节对齐）
+    s_block_bytes = s_cfg.block_samples * sizeof(int16_t);
+    s_mix = (int16_t *)heap_caps_aligned_alloc(16, s_block_bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    s_tmp = (int16_t *)heap_caps_aligned_alloc(16, s_block_bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    s_gain_vec = (int16_t *)heap_caps_aligned_alloc(16, s_block_bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!s_mix || !s_tmp || !s_gain_vec) {
+        ESP_LOGE(TAG, "Failed to allocate mix buffers");
+        mixer_free_buffers();
+        return ESP_ERR_NO_MEM;
+    }
+    memset(&s_stats, 0, sizeof(s_stats));
+
+    // 2.创建混音任务
+    s_running = true;
+    if (xTaskCreatePinnedToCore(mixer_task, "mixer_task", MIXER_TASK_STACK_SIZE, NULL,
+                                s_cfg.task_priority, &s_task, s_cfg.task_core) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create mixer task");
+        s_running = false;
+        s_task = NULL;
+        mixer_free_buffers();
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Audio mixer started: block=%d samples (%dms)",
+             s_cfg.block_samples, s_cfg.block_samples * 1000 / s_cfg.sample_rate);
+    return ESP_OK;
+}
+
+/**
+ * @brief 停止混音器
+ */
+esp_err_t audio_mixer_stop(void)
+{
+    if (s_task == NULL) {
+        return ESP_OK;
+    }
+    s_running = false;
+    xTaskNotifyGive(s_task);
+
+    // 等待混音任务退出（空闲等待或者一次I2S写入）
+    for (int i = 0; i < MIXER_STOP_TIMEOUT_MS / 10 && s_task != NULL; i++) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    if (s_task != NULL) {
+        ESP_LOGE(TAG, "Mixer task did not exit in time");
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+bool audio_mixer_is_running(void)
+{
+    return s_running;
+}
+
+/**
+ * @brief 创建输入流
+ */
+esp_err_t audio_mixer_stream_create(const audio_mixer_stream_config_t *config, audio_mixer_stream_handle_t *ret_stream)
+{
+    if (config == NULL || ret_stream == NULL || config->buffer_ms <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (mixer_lock_init() != ESP_OK) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // 1.流缓冲区至少能放下两个混音块，保证混音任务每次都能取到完整的一块
+    audio_mixer_config_t def = AUDIO_MIXER_DEFAULT_CONFIG();
+    int rate = s_cfg.sample_rate > 0 ? s_cfg.sample_rate : def.sample_rate;
+    int block = s_cfg.block_samples > 0 ? s_cfg.block_samples : def.block_samples;
+    size_t buf_bytes = (size_t)rate * config->buffer_ms / 1000 * sizeof(int16_t);
+    if (buf_bytes < 2 * block * sizeof(int16_t)) {
+        buf_bytes = 2 * block * sizeof(int16_t);
+    }
+
+    audio_mixer_stream_handle_t st = (audio_mixer_stream_handle_t)calloc(1, sizeof(struct audio_mixer_stream));
+    if (st == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    st->name = config->name ? config->name : "stream";
+    st->priority = config->priority;
+    st->gain = mixer_gain_to_q15(config->gain);
+    st->duck_gain = mixer_gain_to_q15(config->duck_gain);
+    st->cur_gain = st->gain;
+    st->buf = xStreamBufferCreate(buf_bytes, 1);
+    if (st->buf == NULL) {
+        free(st);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // 2.加入流表
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < AUDIO_MIXER_MAX_STREAMS; i++) {
+        if (s_streams[i] == NULL) {
+            s_streams[i] = st;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    xSemaphoreGive(s_lock);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Too many mixer streams");
+        vStreamBufferDelete(st->buf);
+        free(st);
+        return ret;
+    }
+    ESP_LOGI(TAG, "Stream '%s' created: priority=%d, gain=%.2f, duck=%.2f, buffer=%d bytes",
+             st->name, st->priority, config->gain, config->duck_gain, (int)buf_bytes);
+    *ret_stream = st;
+    return ESP_OK;
+}
+
+/**
+ * @brief 删除输入流
+ */
+void audio_mixer_stream_delete(audio_mixer_stream_handle_t stream)
+{
+    if (stream == NULL || s_lock == NULL) {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < AUDIO_MIXER_MAX_STREAMS; i++) {
+        if (s_streams[i] == stream) {
+            s_streams[i] = NULL;
+        }
+    }
+    xSemaphoreGive(s_lock);
+
+    vStreamBufferDelete(stream->buf);
+    free(stream);
+}
+
+/**
+ * @brief 向输入流写入PCM数据
+ */
+esp_err_t audio_mixer_write(audio_mixer_stream_handle_t stream, const void *data, size_t len,
+                            size_t *bytes_written, TickType_t ticks_to_wait)
+{
+    const uint8_t *src = (const uint8_t *)data;
+    size_t done = 0;
+    esp_err_t ret = ESP_OK;
+    TimeOut_t timeout;
+    vTaskSetTimeOutState(&timeout);
+
+    while (done < len) {
+        if (!s_running) {
+            ret = ESP_ERR_INVALID_STATE;
+            break;
+        }
+        // 分段等待，混音器停止时能及时返回
+        TickType_t wait = pdMS_TO_TICKS(MIXER_WRITE_SLICE_MS);
+        if (ticks_to_wait < wait) {
+            wait = ticks_to_wait;
+        }
+        size_t n = xStreamBufferSend(stream->buf, src + done, len - done, wait);
+        done += n;
+        if (n > 0 && s_task) {
+            xTaskNotifyGive(s_task);
+        }
+        if (done < len && xTaskCheckForTimeOut(&timeout, &ticks_to_wait) == pdTRUE) {
+            ret = ESP_ERR_TIMEOUT;
+            break;
+        }
+    }
+
+    if (bytes_written) {
+        *bytes_written = done;
+    }
+    return ret;
+}
+
+/**
+ * @brief 设置流的增益
+ */
+void audio_mixer_set_gain(audio_mixer_stream_handle_t stream, float gain)
+{
+    if (stream) {
+        stream->gain = mixer_gain_to_q15(gain);
+    }
+}
+
+/**
+ * @brief 获取统计信息
+ */
+esp_err_t audio_mixer_get_stats(audio_mixer_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *stats = s_stats;
+    return ESP_OK;
+}
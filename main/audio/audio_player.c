@@ -0,0 +1,516 @@
+#include "audio_player.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include <string.h>
+
+#include "audio_mixer.h"
+#include "resampler.h"
+
+static const char *TAG = "AUDIO_PLAYER";
+
+#define PLAYER_TASK_STACK_SIZE  (3 * 1024)
+#define PLAYER_CONCEAL_FRAMES   3       // 欠载时最多补偿的块数（每块衰减一半）
+#define PLAYER_SHRINK_AFTER_MS  10000   // 连续这么久没有欠载，目标深度减小一块
+#define PLAYER_TRIM_INTERVAL_MS 1000    // 缓冲超出目标时，最多每秒丢弃一块
+#define PLAYER_STATS_LOG_MS     10000   // 统计日志间隔
+#define PLAYER_STOP_TIMEOUT_MS  500
+#define PLAYER_DUCK_GAIN        0.3f    // 本地提示音播放时下行语音的增益
+#define PLAYER_RS_CHUNK         256     // 重采样每次处理的输入采样数
+#define PLAYER_MIN_INPUT_RATE   4000
+#define PLAYER_MAX_INPUT_RATE   96000
+
+typedef struct {
+    int16_t    *data;
+    size_t      len;            // 有效字节数
+    int64_t     enqueue_us;     // 块填满（入队）的时间
+} player_block_t;
+
+static audio_player_config_t s_cfg;
+static size_t s_block_bytes = 0;
+static int s_block_num = 0;
+
+// 块池：空闲队列 + 待播放队列（都存放 player_block_t*）
+static player_block_t *s_blocks = NULL;
+static uint8_t *s_block_mem = NULL;
+static QueueHandle_t s_free_que = NULL;
+static QueueHandle_t s_play_que = NULL;
+
+// 生产者（网络任务）正在填充的块
+static player_block_t *s_fill = NULL;
+static bool s_has_seq = false;
+static uint32_t s_next_seq = 0;
+
+// 保护生产者与播放任务退出时的资源释放，只创建一次
+static SemaphoreHandle_t s_lock = NULL;
+
+// 输入采样率与输出不同时，入队前先重采样（I2S 保持 s_cfg.sample_rate 不变）
+static int s_input_rate = 0;
+static int s_rs_out_rate = 0;
+static resampler_handle_t s_rs = NULL;
+static int16_t *s_rs_out = NULL;
+static int s_rs_out_max = 0;
+static int16_t s_rs_in[PLAYER_RS_CHUNK] __attribute__((aligned(16)));
+static size_t s_rs_pending = 0;     // s_rs_in 中上次剩下的奇数字节（0或1）
+
+static volatile bool s_running = false;
+static TaskHandle_t s_task = NULL;
+static audio_player_stats_t s_stats;
+
+// 混音器输入流，只创建一次
+static audio_mixer_stream_handle_t s_stream = NULL;
+
+static inline int player_ms_to_blocks(int ms)
+{
+    return (ms + s_cfg.frame_ms - 1) / s_cfg.frame_ms;
+}
+
+static void player_free_pool(void)
+{
+    if (s_play_que) {
+        vQueueDelete(s_play_que);
+        s_play_que = NULL;
+    }
+    if (s_free_que) {
+        vQueueDelete(s_free_que);
+        s_free_que = NULL;
+    }
+    if (s_block_mem) {
+        heap_caps_free(s_block_mem);
+        s_block_mem = NULL;
+    }
+    if (s_blocks) {
+        free(s_blocks);
+        s_blocks = NULL;
+    }
+    s_fill = NULL;
+}
+
+/**
+ * @brief 取一个空闲块；块池用完时回收待播放队列中最旧的块
+ */
+static player_block_t *player_get_free_block(void)
+{
+    player_block_t *blk = NULL;
+    if (xQueueReceive(s_free_que, &blk, 0) == pdTRUE) {
+        return blk;
+    }
+    if (xQueueReceive(s_play_que, &blk, 0) == pdTRUE) {
+        s_stats.overflow_dropped++;
+        return blk;
+    }
+    return NULL;
+}
+
+/**
+ * @brief 把填满的块放入待播放队列，超出缓冲容量时丢弃最旧的块
+ */
+static void player_commit_block(player_block_t *blk)
+{
+    blk->enqueue_us = esp_timer_get_time();
+    if (xQueueSend(s_play_que, &blk, 0) != pdTRUE) {
+        player_block_t *oldest = NULL;
+        if (xQueueReceive(s_play_que, &oldest, 0) == pdTRUE) {
+            xQueueSend(s_free_que, &oldest, 0);
+            s_stats.overflow_dropped++;
+        }
+        xQueueSend(s_play_que, &blk, 0);
+    }
+    xTaskNotifyGive(s_task);
+}
+
+static esp_err_t player_enqueue_locked(const uint8_t *src, size_t len)
+{
+    while (len > 0) {
+        if (s_fill == NULL) {
+            s_fill = player_get_free_block();
+            if (s_fill == NULL) {
+                // 播放任务持有所有块的极端情况，丢弃剩余数据
+                s_stats.overflow_dropped++;
+                return ESP_OK;
+            }
+            s_fill->len = 0;
+        }
+
+        size_t n = s_block_bytes - s_fill->len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy((uint8_t *)s_fill->data + s_fill->len, src, n);
+        s_fill->len += n;
+        src += n;
+        len -= n;
+
+        if (s_fill->len == s_block_bytes) {
+            player_commit_block(s_fill);
+            s_fill = NULL;
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief 按输入采样率入队：需要时先重采样，奇数字节留到下一次拼成完整的采样
+ */
+static esp_err_t player_enqueue_pcm_locked(const uint8_t *src, size_t len)
+{
+    if (s_rs == NULL) {
+        return player_enqueue_locked(src, len);
+    }
+
+    while (len > 0) {
+        size_t n = sizeof(s_rs_in) - s_rs_pending;
+        if (n > len) {
+            n = len;
+        }
+        memcpy((uint8_t *)s_rs_in + s_rs_pending, src, n);
+        size_t total = s_rs_pending + n;
+        src += n;
+        len -= n;
+
+        int out = resampler_process(s_rs, s_rs_in, total / sizeof(int16_t), s_rs_out, s_rs_out_max);
+        player_enqueue_locked((const uint8_t *)s_rs_out, out * sizeof(int16_t));
+
+        s_rs_pending = total % sizeof(int16_t);
+        if (s_rs_pending) {
+            ((uint8_t *)s_rs_in)[0] = ((uint8_t *)s_rs_in)[total - 1];
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t audio_player_enqueue(const void *data, size_t len)
+{
+    if (!s_running || s_lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t ret = s_running ? player_enqueue_pcm_locked((const uint8_t *)data, len) : ESP_ERR_INVALID_STATE;
+    xSemaphoreGive(s_lock);
+    return ret;
+}
+
+esp_err_t audio_player_enqueue_seq(uint32_t seq, const void *data, size_t len)
+{
+    if (!s_running || s_lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+    if (s_running) {
+        // 缓冲按顺序输出，比已接收的包更旧的包已经没有位置可以插入
+        if (s_has_seq && (int32_t)(seq - s_next_seq) < 0) {
+            s_stats.late_dropped++;
+            ret = ESP_ERR_INVALID_ARG;
+        } else {
+            s_has_seq = true;
+            s_next_seq = seq + 1;
+            ret = player_enqueue_pcm_locked((const uint8_t *)data, len);
+        }
+    }
+    xSemaphoreGive(s_lock);
+    return ret;
+}
+
+/**
+ * @brief 欠载补偿：重复上一块并逐块衰减，避免突然静音产生的爆音；新数据到达时立即停止
+ */
+static void player_conceal(int16_t *last, size_t last_len)
+{
+    for (int i = 0; i < PLAYER_CONCEAL_FRAMES; i++) {
+        if (uxQueueMessagesWaiting(s_play_que) > 0) {
+            return;
+        }
+        int samples = last_len / sizeof(int16_t);
+        for (int j = 0; j < samples; j++) {
+            last[j] >>= 1;
+        }
+        audio_mixer_write(s_stream, last, last_len, NULL, portMAX_DELAY);
+        s_stats.concealed++;
+    }
+}
+
+static void player_task(void *arg)
+{
+    // 上一块的副本，用于欠载补偿
+    int16_t *last = (int16_t *)calloc(1, s_block_bytes);
+    size_t last_len = 0;
+    bool prefill = true;
+    int64_t last_underrun_us = esp_timer_get_time();
+    int64_t last_trim_us = 0;
+    int64_t last_log_us = esp_timer_get_time();
+    const TickType_t frame_ticks = pdMS_TO_TICKS(s_cfg.frame_ms) ? pdMS_TO_TICKS(s_cfg.frame_ms) : 1;
+
+    while (s_running) {
+        int64_t now = esp_timer_get_time();
+        int depth = uxQueueMessagesWaiting(s_play_que);
+        int target = player_ms_to_blocks(s_stats.target_ms);
+        s_stats.depth_ms = depth * s_cfg.frame_ms;
+
+        if (now - last_log_us > PLAYER_STATS_LOG_MS * 1000LL) {
+            last_log_us = now;
+            ESP_LOGI(TAG, "played=%lu underruns=%lu concealed=%lu late=%lu overflow=%lu trimmed=%lu depth=%lums target=%lums latency avg=%lums max=%lums",
+                     (unsigned long)s_stats.played, (unsigned long)s_stats.underruns, (unsigned long)s_stats.concealed,
+                     (unsigned long)s_stats.late_dropped, (unsigned long)s_stats.overflow_dropped, (unsigned long)s_stats.trimmed,
+                     (unsigned long)s_stats.depth_ms, (unsigned long)s_stats.target_ms,
+                     (unsigned long)s_stats.latency_avg_ms, (unsigned long)s_stats.latency_max_ms);
+        }
+
+        // 1.预缓冲：等待缓冲达到目标深度
+        if (prefill) {
+            if (depth >= target) {
+                prefill = false;
+            } else {
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+            }
+            continue;
+        }
+
+        // 2.长时间稳定：减小目标深度，并丢弃多余的块来真正降低延迟
+        if (now - last_underrun_us > PLAYER_SHRINK_AFTER_MS * 1000LL &&
+            s_stats.target_ms > (uint32_t)s_cfg.min_target_ms) {
+            s_stats.target_ms -= s_cfg.frame_ms;
+            last_underrun_us = now;
+        }
+        if (depth > target + 1 && now - last_trim_us > PLAYER_TRIM_INTERVAL_MS * 1000LL) {
+            player_block_t *blk = NULL;
+            if (xQueueReceive(s_play_que, &blk, 0) == pdTRUE) {
+                xQueueSend(s_free_que, &blk, 0);
+                s_stats.trimmed++;
+            }
+            last_trim_us = now;
+        }
+
+        // 3.取一块播放，混音器的流缓冲区写满时在这里阻塞
+        player_block_t *blk = NULL;
+        if (xQueueReceive(s_play_que, &blk, frame_ticks) == pdTRUE) {
+            uint32_t latency_ms = (uint32_t)((esp_timer_get_time() - blk->enqueue_us) / 1000);
+            audio_mixer_write(s_stream, blk->data, blk->len, NULL, portMAX_DELAY);
+            if (last) {
+                memcpy(last, blk->data, blk->len);
+                last_len = blk->len;
+            }
+            xQueueSend(s_free_que, &blk, 0);
+
+            s_stats.played++;
+            s_stats.latency_avg_ms = (s_stats.latency_avg_ms * 15 + latency_ms) / 16;
+            if (latency_ms > s_stats.latency_max_ms) {
+                s_stats.latency_max_ms = latency_ms;
+            }
+            continue;
+        }
+
+        // 4.欠载：补偿播放，增大目标深度后重新预缓冲
+        s_stats.underruns++;
+        last_underrun_us = esp_timer_get_time();
+        if (s_stats.target_ms + s_cfg.frame_ms <= (uint32_t)s_cfg.max_target_ms) {
+            s_stats.target_ms += s_cfg.frame_ms;
+        }
+        if (last && last_len > 0) {
+            player_conceal(last, last_len);
+            last_len = 0;
+        }
+        if (uxQueueMessagesWaiting(s_play_que) == 0) {
+            prefill = true;
+        }
+    }
+
+    free(last);
+
+    // 退出前释放块池，持锁防止网络任务同时写入
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    player_free_pool();
+    xSemaphoreGive(s_lock);
+
+    s_task = NULL;
+    ESP_LOGI(TAG, "[player_task] finished");
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief 启动播放器
+ */
+esp_err_t audio_player_start(const audio_player_config_t *config)
+{
+    if (s_task != NULL) {
+        ESP_LOGW(TAG, "Audio player already started");
+        return ESP_OK;
+    }
+
+    audio_player_config_t def = AUDIO_PLAYER_DEFAULT_CONFIG();
+    s_cfg = config ? *config : def;
+    if (s_cfg.sample_rate <= 0 || s_cfg.frame_ms <= 0 ||
+        s_cfg.min_target_ms > s_cfg.max_target_ms || s_cfg.max_target_ms > s_cfg.max_depth_ms) {
+        ESP_LOGE(TAG, "Invalid player configuration");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_cfg.target_ms < s_cfg.min_target_ms) {
+        s_cfg.target_ms = s_cfg.min_target_ms;
+    } else if (s_cfg.target_ms > s_cfg.max_target_ms) {
+        s_cfg.target_ms = s_cfg.max_target_ms;
+    }
+
+    if (s_lock == NULL) {
+        s_lock = xSemaphoreCreateMutex();
+        if (s_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (s_stream == NULL) {
+        audio_mixer_stream_config_t stream_cfg = {
+            .name = "downlink",
+            .priority = AUDIO_MIXER_PRIO_DOWNLINK,
+            .gain = 1.0f,
+            .duck_gain = PLAYER_DUCK_GAIN,
+            .buffer_ms = 2 * s_cfg.frame_ms,
+        };
+        esp_err_t ret = audio_mixer_stream_create(&stream_cfg, &s_stream);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    // 1.分配块池：缓冲容量 + 1块正在填充 + 1块正在播放；播放不要求内部RAM，优先放在PSRAM
+    s_block_bytes = (size_t)s_cfg.sample_rate * s_cfg.frame_ms / 1000 * sizeof(int16_t);
+    int depth_blocks = player_ms_to_blocks(s_cfg.max_depth_ms);
+    s_block_num = depth_blocks + 2;
+    s_blocks = (player_block_t *)calloc(s_block_num, sizeof(player_block_t));
+    s_block_mem = (uint8_t *)heap_caps_malloc(s_block_bytes * s_block_num, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (s_block_mem == NULL) {
+        s_block_mem = (uint8_t *)heap_caps_malloc(s_block_bytes * s_block_num, MALLOC_CAP_8BIT);
+    }
+    s_free_que = xQueueCreate(s_block_num, sizeof(player_block_t *));
+    s_play_que = xQueueCreate(depth_blocks, sizeof(player_block_t *));
+    if (!s_blocks || !s_block_mem || !s_free_que || !s_play_que) {
+        ESP_LOGE(TAG, "Failed to allocate jitter buffer (%d x %d bytes)", s_block_num, (int)s_block_bytes);
+        player_free_pool();
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < s_block_num; i++) {
+        player_block_t *blk = &s_blocks[i];
+        blk->data = (int16_t *)(s_block_mem + i * s_block_bytes);
+        xQueueSend(s_free_que, &blk, 0);
+    }
+
+    // 2.重置统计、序号和重采样状态
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_stats.target_ms = s_cfg.target_ms;
+    s_has_seq = false;
+    s_fill = NULL;
+    s_rs_pending = 0;
+    if (s_rs) {
+        resampler_reset(s_rs);
+    }
+    if (s_input_rate > 0) {
+        // 输出采样率可能随配置改变，按之前设置的输入采样率重新创建重采样器
+        audio_player_set_input_rate(s_input_rate);
+    }
+
+    // 3.创建播放任务
+    s_running = true;
+    if (xTaskCreatePinnedToCore(player_task, "player_task", PLAYER_TASK_STACK_SIZE, NULL,
+                                s_cfg.task_priority, &s_task, s_cfg.task_core) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create player task");
+        s_running = false;
+        s_task = NULL;
+        player_free_pool();
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Audio player started: block=%dms, target=%dms (%d~%dms), capacity=%dms",
+             s_cfg.frame_ms, s_cfg.target_ms, s_cfg.min_target_ms, s_cfg.max_target_ms, s_cfg.max_depth_ms);
+    return ESP_OK;
+}
+
+/**
+ * @brief 停止播放器
+ */
+esp_err_t audio_player_stop(void)
+{
+    if (s_task == NULL) {
+        return ESP_OK;
+    }
+    s_running = false;
+
+    // 等待播放任务退出（预缓冲等待最长100ms，或者一次I2S写入）
+    for (int i = 0; i < PLAYER_STOP_TIMEOUT_MS / 10 && s_task != NULL; i++) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    if (s_task != NULL) {
+        ESP_LOGE(TAG, "Player task did not exit in time");
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief 设置下行数据的采样率
+ */
+esp_err_t audio_player_set_input_rate(int sample_rate)
+{
+    if (sample_rate < PLAYER_MIN_INPUT_RATE || sample_rate > PLAYER_MAX_INPUT_RATE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_lock == NULL) {
+        s_lock = xSemaphoreCreateMutex();
+        if (s_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    audio_player_config_t def = AUDIO_PLAYER_DEFAULT_CONFIG();
+    int out_rate = s_cfg.sample_rate > 0 ? s_cfg.sample_rate : def.sample_rate;
+    if (sample_rate == s_input_rate && out_rate == s_rs_out_rate) {
+        xSemaphoreGive(s_lock);
+        return ESP_OK;
+    }
+
+    // 1.释放旧的重采样器（滤波器组在 resampler 内部缓存，来回切换时不需要重新设计）
+    resampler_destroy(s_rs);
+    s_rs = NULL;
+    heap_caps_free(s_rs_out);
+    s_rs_out = NULL;
+    s_rs_pending = 0;
+
+    // 2.与输出采样率不同时创建新的重采样器
+    esp_err_t ret = ESP_OK;
+    if (sample_rate != out_rate) {
+        ret = resampler_create(sample_rate, out_rate, &s_rs);
+        if (ret == ESP_OK) {
+            s_rs_out_max = resampler_get_max_output(s_rs, PLAYER_RS_CHUNK);
+            s_rs_out = (int16_t *)heap_caps_malloc(s_rs_out_max * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+            if (s_rs_out == NULL) {
+                resampler_destroy(s_rs);
+                s_rs = NULL;
+                ret = ESP_ERR_NO_MEM;
+            }
+        }
+    }
+    s_input_rate = (ret == ESP_OK) ? sample_rate : out_rate;
+    s_rs_out_rate = out_rate;
+    xSemaphoreGive(s_lock);
+
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Downlink sample rate: %d Hz -> %d Hz", sample_rate, out_rate);
+    } else {
+        ESP_LOGE(TAG, "Failed to create resampler for %d Hz: %s", sample_rate, esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+/**
+ * @brief 获取播放器统计信息
+ */
+esp_err_t audio_player_get_stats(audio_player_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *stats = s_stats;
+    return ESP_OK;
+}
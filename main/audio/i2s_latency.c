@@ -0,0 +1,184 @@
+#include "i2s_latency.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+
+#include "inmp441_i2s.h"
+#include "max98357_i2s.h"
+#include "i2s_pins.h"
+
+static const char *TAG = "I2S_LATENCY";
+
+#define BENCH_SAMPLE_RATE   16000
+
+/**
+ * @brief 按档位和 chunk 推算DMA缓冲区布局
+ */
+esp_err_t i2s_latency_get_dma_layout(i2s_latency_profile_t profile, int chunk_samples, size_t frame_bytes,
+                                     i2s_dma_layout_t *layout)
+{
+    if (layout == NULL || frame_bytes == 0 || chunk_samples < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (chunk_samples == 0) {
+        chunk_samples = I2S_LATENCY_DEFAULT_CHUNK;
+    }
+
+    // 1.按档位取缓冲区个数和长度
+    int desc_num;
+    int frame_num;
+    switch (profile) {
+        case I2S_LATENCY_LOW:
+            desc_num = 3;
+            frame_num = chunk_samples / 2;
+            break;
+        case I2S_LATENCY_BALANCED:
+            desc_num = 4;
+            frame_num = chunk_samples / 2;
+            break;
+        case I2S_LATENCY_ROBUST:
+        default:
+            desc_num = 4;
+            frame_num = chunk_samples;
+            break;
+    }
+
+    // 2.缓冲区长度取8的倍数（aes3 向量转换和混音每次处理8个采样）
+    frame_num &= ~0x7;
+    if (frame_num < 8) {
+        frame_num = 8;
+    }
+
+    // 3.单个DMA缓冲区超过字节上限时减半，个数加倍
+    while (frame_num * frame_bytes > I2S_LATENCY_DMA_BUF_MAX && frame_num > 8) {
+        frame_num = (frame_num / 2) & ~0x7;
+        desc_num *= 2;
+    }
+    if (desc_num > I2S_LATENCY_MAX_DESC_NUM) {
+        desc_num = I2S_LATENCY_MAX_DESC_NUM;
+    }
+
+    layout->desc_num = desc_num;
+    layout->frame_num = frame_num;
+    return ESP_OK;
+}
+
+/**
+ * @brief 档位名称
+ */
+const char *i2s_latency_profile_name(i2s_latency_profile_t profile)
+{
+    switch (profile) {
+        case I2S_LATENCY_LOW:       return "low";
+        case I2S_LATENCY_BALANCED:  return "balanced";
+        case I2S_LATENCY_ROBUST:    return "robust";
+        default:                    return "unknown";
+    }
+}
+
+/**
+ * @brief 单个档位的回放测试
+ */
+static esp_err_t i2s_latency_run_profile(i2s_latency_profile_t profile, int chunk_samples, int duration_ms,
+                                         int16_t *buf, i2s_latency_stats_t *rx, i2s_latency_stats_t *tx)
+{
+    // 1.按档位初始化麦克风（与 sr.c 相同的32位回调采集）和扬声器
+    inmp441_i2s_config_t inmp441_config = {
+        .gpio_bclk = EXAMPLE_I2S_BCLK_IO1,
+        .gpio_ws = EXAMPLE_I2S_WS_IO1,
+        .gpio_din = EXAMPLE_I2S_DIN_IO1,
+        .sample_rate = BENCH_SAMPLE_RATE,
+        .bits_per_sample = I2S_DATA_BIT_WIDTH_32BIT,
+        .channel_mode = INMP441_CHANNEL_LEFT,
+        .capture_mode = INMP441_CAPTURE_CALLBACK,
+        .latency_profile = profile,
+        .dma_chunk_samples = chunk_samples,
+    };
+    max98357_i2s_config_t max98357_config = {
+        .gpio_bclk = EXAMPLE_I2S_BCLK_IO2,
+        .gpio_ws = EXAMPLE_I2S_WS_IO2,
+        .gpio_dout = EXAMPLE_I2S_DOUT_IO2,
+        .sample_rate = BENCH_SAMPLE_RATE,
+        .bits_per_sample = I2S_DATA_BIT_WIDTH_16BIT,
+        .channel_mode = MAX98357_CHANNEL_MONO,
+        .slot_mask = MAX98357_MASK_LEFT,
+        .latency_profile = profile,
+        .dma_chunk_samples = chunk_samples,
+    };
+    esp_err_t ret = inmp441_i2s_init(&inmp441_config);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = max98357_i2s_init(&max98357_config);
+    if (ret != ESP_OK) {
+        inmp441_i2s_close();
+        return ret;
+    }
+
+    // 2.读一个chunk写一个chunk，与 feed_Task/混音任务的节奏一致
+    size_t bytes = chunk_samples * sizeof(int16_t);
+    int64_t end = esp_timer_get_time() + (int64_t)duration_ms * 1000;
+    while (esp_timer_get_time() < end) {
+        size_t bytes_read = 0;
+        ret = inmp441_i2s_read(buf, bytes, &bytes_read, pdMS_TO_TICKS(1000));
+        if (ret != ESP_OK) {
+            break;
+        }
+        ret = max98357_i2s_write(buf, bytes_read, NULL, pdMS_TO_TICKS(1000));
+        if (ret != ESP_OK) {
+            break;
+        }
+    }
+
+    inmp441_i2s_get_latency_stats(rx);
+    max98357_i2s_get_latency_stats(tx);
+    inmp441_i2s_close();
+    max98357_i2s_close();
+    return ret;
+}
+
+/**
+ * @brief 延迟档位实测
+ */
+esp_err_t i2s_latency_benchmark(int chunk_samples, int duration_ms)
+{
+    if (chunk_samples <= 0) {
+        chunk_samples = I2S_LATENCY_DEFAULT_CHUNK;
+    }
+    chunk_samples &= ~0x7;
+    if (chunk_samples <= 0 || duration_ms <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // 16字节对齐，32位采集时走 aes3 向量转换
+    int16_t *buf = (int16_t *)heap_caps_aligned_alloc(16, chunk_samples * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (buf == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "I2S latency benchmark: chunk %d samples, %d ms per profile", chunk_samples, duration_ms);
+    const i2s_latency_profile_t profiles[] = {I2S_LATENCY_LOW, I2S_LATENCY_BALANCED, I2S_LATENCY_ROBUST};
+    esp_err_t ret = ESP_OK;
+    for (int i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++) {
+        i2s_latency_stats_t rx = {0};
+        i2s_latency_stats_t tx = {0};
+        ret = i2s_latency_run_profile(profiles[i], chunk_samples, duration_ms, buf, &rx, &tx);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "[%s] failed: %s", i2s_latency_profile_name(profiles[i]), esp_err_to_name(ret));
+            break;
+        }
+        ESP_LOGI(TAG, "[%-8s] mic: %2dx%-3d dma %5.1f ms, buffered avg %5.1f / max %5.1f ms, overruns %u",
+                 i2s_latency_profile_name(profiles[i]), (int)rx.desc_num, (int)rx.frame_num,
+                 rx.dma_buffer_us / 1000.0f, rx.buffered_avg_us / 1000.0f, rx.buffered_max_us / 1000.0f,
+                 (unsigned)rx.overruns);
+        ESP_LOGI(TAG, "[%-8s] spk: %2dx%-3d dma %5.1f ms, buffered avg %5.1f / max %5.1f ms, underruns %u",
+                 i2s_latency_profile_name(profiles[i]), (int)tx.desc_num, (int)tx.frame_num,
+                 tx.dma_buffer_us / 1000.0f, tx.buffered_avg_us / 1000.0f, tx.buffered_max_us / 1000.0f,
+                 (unsigned)tx.underruns);
+    }
+
+    heap_caps_free(buf);
+    return ret;
+}
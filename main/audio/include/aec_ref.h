@@ -0,0 +1,102 @@
+#ifndef AEC_REF_H
+#define AEC_REF_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/**
+ * @brief AEC 参考信号回采
+ *
+ * MAX98357 每发送完一个DMA缓冲区，就在中断中把这段实际输出的数据写入参考环形缓冲区，
+ * 因此环形缓冲区是按扬声器输出时间连续排列的（欠载时为静音）。
+ * 麦克风和扬声器使用同一个时钟源，两者的采样位置之间只差一个固定偏移：
+ * 首次读取时根据两边的DMA完成时间戳确定偏移，之后按采样数连续推进，
+ * 再减去校准得到的声学+DMA延迟，就得到与麦克风逐采样对齐的参考信号（AFE "MR" 输入中的 R）。
+ *
+ * 延迟校准：扬声器播放一段扫频信号，同时录下麦克风和参考信号，用互相关找到两者的延迟。
+ */
+
+/**
+ * @brief 参考信号统计信息
+ */
+typedef struct {
+    uint32_t resyncs;       /*!< 时间偏移重新同步的次数（麦克风丢帧等） */
+    uint32_t waits;         /*!< 参考数据尚未输出、需要等待的次数 */
+    uint32_t missing;       /*!< 参考数据缺失（超时或已被覆盖）用静音补齐的次数 */
+    int      delay_samples; /*!< 当前使用的延迟（采样数） */
+} aec_ref_stats_t;
+
+/**
+ * @brief 初始化参考信号环形缓冲区
+ *
+ * @param sample_rate 采样率（与麦克风、扬声器一致）
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_NO_MEM: 内存不足
+ */
+esp_err_t aec_ref_init(int sample_rate);
+
+/**
+ * @brief 释放参考信号环形缓冲区
+ *
+ * 调用前需要先关闭 MAX98357（停止回调）。
+ */
+void aec_ref_deinit(void);
+
+/**
+ * @brief MAX98357 发送完成回调，作为 max98357_i2s_config_t.on_sent 使用（中断上下文）
+ *
+ * 只支持单声道16位的发送数据。
+ */
+bool aec_ref_on_sent(const void *data, size_t size, void *ctx);
+
+/**
+ * @brief 取出与一段麦克风数据对齐的参考信号
+ *
+ * 必须由读取麦克风的任务在每次读取后连续调用。参考数据还没输出时会短暂等待（最多两个DMA缓冲区的时间），
+ * 超时或数据已被覆盖时用静音补齐。
+ *
+ * @param out            输出参考信号
+ * @param samples        采样数（与这次读取的麦克风采样数相同）
+ * @param capture_end_us 这段麦克风数据最后一个采样的采集时间（inmp441_i2s_get_read_timestamp）
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_STATE: 未初始化
+ * - ESP_ERR_TIMEOUT: 参考数据不完整，已用静音补齐
+ */
+esp_err_t aec_ref_fetch(int16_t *out, int samples, int64_t capture_end_us);
+
+/**
+ * @brief 设置扬声器到麦克风的延迟（采样数），下一次读取时重新同步
+ */
+void aec_ref_set_delay(int delay_samples);
+
+/**
+ * @brief 获取当前使用的延迟（采样数）
+ */
+int aec_ref_get_delay(void);
+
+/**
+ * @brief 播放扫频信号并用互相关测量扬声器到麦克风的延迟，成功后自动设置
+ *
+ * 调用期间不能有其他任务读取麦克风或写入扬声器（在启动AFE任务和播放器之前调用）。
+ * 麦克风和扬声器需要已经初始化，并且 MAX98357 的 on_sent 为 aec_ref_on_sent。
+ *
+ * @param mic_num 麦克风数量（与采集的声道数一致，多麦时数据交错，只用第一个麦克风测量）
+ * @param[out] delay_samples 测得的延迟（可以为NULL）
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_NOT_FOUND: 没有找到可靠的相关峰（音量太小或扬声器未连接），延迟保持不变
+ * - ESP_ERR_INVALID_ARG: 麦克风数量错误
+ * - ESP_ERR_NO_MEM: 内存不足
+ */
+esp_err_t aec_ref_calibrate(int mic_num, int *delay_samples);
+
+/**
+ * @brief 获取统计信息
+ */
+esp_err_t aec_ref_get_stats(aec_ref_stats_t *stats);
+
+#endif // AEC_REF_H
@@ -0,0 +1,143 @@
+#ifndef AUDIO_BUS_H
+#define AUDIO_BUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+/**
+ * @brief 音频帧总线
+ *
+ * 采集/识别任务从预分配的帧池中取出一帧，填充PCM数据后发布一次，
+ * 总线把同一帧（引用计数+1）分发给所有订阅者（扬声器、上行、录音、电平表等），
+ * 每个订阅者拥有自己的有界队列和溢出策略，互不阻塞。
+ * 最后一个持有者释放后，帧自动回到帧池。
+ */
+
+#define AUDIO_BUS_MAX_SUBSCRIBERS   8   /*!< 最大订阅者数量 */
+
+/**
+ * @brief 帧标志位（随帧一起传递的AFE状态）
+ */
+#define AUDIO_FRAME_FLAG_SPEECH     (1u << 0)   /*!< VAD判定为语音 */
+#define AUDIO_FRAME_FLAG_WAKEUP     (1u << 1)   /*!< 本帧检测到唤醒词 */
+#define AUDIO_FRAME_FLAG_PREROLL    (1u << 2)   /*!< VAD缓存的语音起始部分（之前已作为非语音帧发布过，补发给按VAD门控的订阅者） */
+
+/**
+ * @brief 订阅者队列满时的处理策略
+ */
+typedef enum {
+    AUDIO_BUS_DROP_OLDEST,  /*!< 丢弃队列中最旧的帧，保证实时性（适合播放、上行） */
+    AUDIO_BUS_DROP_NEWEST,  /*!< 丢弃当前新帧（适合电平表等可以跳帧的消费者） */
+    AUDIO_BUS_BLOCK,        /*!< 阻塞发布者直到有空间（仅用于不能丢帧的消费者） */
+} audio_bus_overflow_t;
+
+/**
+ * @brief PCM音频帧（引用计数，来自帧池）
+ */
+typedef struct {
+    int16_t          *data;         /*!< PCM数据（单声道16位） */
+    size_t            len;          /*!< 有效数据字节数 */
+    uint32_t          seq;          /*!< 发布序号（由总线填写） */
+    int64_t           timestamp_us; /*!< 采集时间戳（esp_timer_get_time） */
+    uint32_t          flags;        /*!< AUDIO_FRAME_FLAG_* */
+    volatile uint32_t refcount;     /*!< 引用计数，不要直接修改 */
+} audio_frame_t;
+
+/**
+ * @brief 订阅者句柄
+ */
+typedef struct audio_bus_sub *audio_bus_sub_handle_t;
+
+/**
+ * @brief 订阅者统计信息
+ */
+typedef struct {
+    uint32_t delivered;     /*!< 成功入队的帧数 */
+    uint32_t dropped;       /*!< 因队列满被丢弃的帧数 */
+    uint32_t queued;        /*!< 当前队列中的帧数 */
+} audio_bus_stats_t;
+
+/**
+ * @brief 初始化音频帧总线并预分配帧池
+ *
+ * @param frame_bytes 每帧最大字节数（通常为AFE fetch帧长 * 2）
+ * @param pool_size   帧池大小（帧数）
+ * @return
+ * - ESP_OK: 成功（已按相同参数初始化时也返回ESP_OK）
+ * - ESP_ERR_INVALID_ARG: 参数无效
+ * - ESP_ERR_INVALID_STATE: 已按不同的帧长或帧池大小初始化，需先调用audio_bus_deinit
+ * - ESP_ERR_NO_MEM: 内存不足
+ */
+esp_err_t audio_bus_init(size_t frame_bytes, int pool_size);
+
+/**
+ * @brief 释放帧池和所有订阅者队列
+ *
+ * 调用前需要保证所有发布者和订阅者任务已经退出。
+ */
+void audio_bus_deinit(void);
+
+/**
+ * @brief 从帧池中获取一帧（引用计数为1，归调用者所有）
+ *
+ * @param ticks_to_wait 帧池为空时的等待时间
+ * @return 帧指针，超时返回NULL
+ */
+audio_frame_t *audio_bus_frame_alloc(TickType_t ticks_to_wait);
+
+/**
+ * @brief 发布一帧给所有订阅者
+ *
+ * 该函数会消耗调用者持有的引用，调用后不能再访问该帧。
+ *
+ * @param frame 通过 audio_bus_frame_alloc 获取的帧
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_ARG: 参数错误
+ */
+esp_err_t audio_bus_publish(audio_frame_t *frame);
+
+/**
+ * @brief 增加帧的引用计数
+ */
+void audio_frame_retain(audio_frame_t *frame);
+
+/**
+ * @brief 释放帧的一个引用，最后一个引用释放时帧回到帧池
+ */
+void audio_frame_release(audio_frame_t *frame);
+
+/**
+ * @brief 注册一个订阅者
+ *
+ * @param name   订阅者名称（用于日志）
+ * @param depth  队列深度（帧数）
+ * @param policy 队列满时的处理策略
+ * @return 订阅者句柄，失败返回NULL
+ */
+audio_bus_sub_handle_t audio_bus_subscribe(const char *name, int depth, audio_bus_overflow_t policy);
+
+/**
+ * @brief 注销订阅者，并释放队列中尚未消费的帧
+ */
+esp_err_t audio_bus_unsubscribe(audio_bus_sub_handle_t sub);
+
+/**
+ * @brief 从订阅者队列中取出一帧
+ *
+ * 取到的帧使用完后必须调用 audio_frame_release 释放。
+ *
+ * @param sub           订阅者句柄
+ * @param ticks_to_wait 等待时间
+ * @return 帧指针，超时返回NULL
+ */
+audio_frame_t *audio_bus_receive(audio_bus_sub_handle_t sub, TickType_t ticks_to_wait);
+
+/**
+ * @brief 获取订阅者统计信息
+ */
+esp_err_t audio_bus_get_stats(audio_bus_sub_handle_t sub, audio_bus_stats_t *stats);
+
+#endif // AUDIO_BUS_H
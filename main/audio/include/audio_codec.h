@@ -0,0 +1,109 @@
+#ifndef AUDIO_CODEC_H
+#define AUDIO_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/**
+ * @brief 上行音频编码
+ *
+ * 上行任务把总线上的16位PCM帧交给当前编码器，编码后的帧按完整帧合并发送，一条 WebSocket 二进制消息
+ * 包含一帧或多帧（见 websocket_client_set_batch()）。
+ * 编码格式在连接建立后通过文本握手和服务器协商（见 websocket_client.h），未协商时为 PCM16。
+ *
+ * 帧格式：
+ * - "pcm16":     小端16位PCM，原样发送
+ * - "ima_adpcm": 4字节帧头 + 每个采样4位（低半字节在前），4:1 压缩
+ *                帧头为编码这一帧之前的解码器状态：int16 预测值（小端）、uint8 步长索引、uint8 保留(0)，
+ *                每帧都可以独立解码，上行丢帧不会让服务器的解码器失步
+ */
+
+typedef enum {
+    AUDIO_CODEC_PCM16 = 0,      /*!< 不压缩（默认） */
+    AUDIO_CODEC_IMA_ADPCM,      /*!< IMA-ADPCM 4位 */
+    AUDIO_CODEC_MAX,
+} audio_codec_type_t;
+
+#define AUDIO_CODEC_ADPCM_HEADER_BYTES  4
+
+/**
+ * @brief 编码器状态（PCM16 不使用）
+ */
+typedef struct {
+    int32_t predictor;      /*!< 预测值（上一个解码采样） */
+    int32_t step_index;     /*!< 步长索引（0 ~ 88） */
+} audio_codec_state_t;
+
+/**
+ * @brief 编码器接口
+ */
+typedef struct {
+    audio_codec_type_t  type;
+    const char         *name;       /*!< 握手中使用的格式名 */
+    /**
+     * @brief 编码 samples 个采样后的最大字节数
+     */
+    size_t (*max_encoded_size)(int samples);
+    /**
+     * @brief 编码一帧
+     *
+     * @param st      编码器状态，跨帧保持
+     * @param pcm     16位PCM
+     * @param samples 采样数
+     * @param out     输出缓冲区，至少 max_encoded_size(samples) 字节
+     * @return 输出字节数
+     */
+    size_t (*encode)(audio_codec_state_t *st, const int16_t *pcm, int samples, uint8_t *out);
+} audio_codec_iface_t;
+
+/**
+ * @brief 按类型获取编码器
+ *
+ * @return 编码器，类型无效时返回NULL
+ */
+const audio_codec_iface_t *audio_codec_get(audio_codec_type_t type);
+
+/**
+ * @brief 按格式名获取编码器（握手时使用）
+ *
+ * @return 编码器，不支持时返回NULL
+ */
+const audio_codec_iface_t *audio_codec_find(const char *name);
+
+/**
+ * @brief 重置编码器状态（连接建立或切换编码器时）
+ */
+void audio_codec_reset(audio_codec_state_t *st);
+
+/**
+ * @brief IMA-ADPCM 标量参考实现（不写帧头，只输出 (samples + 1) / 2 字节的半字节数据）
+ */
+void audio_codec_ima_encode_ansi(audio_codec_state_t *st, const int16_t *pcm, int samples, uint8_t *out);
+
+/**
+ * @brief IMA-ADPCM 解码参考实现（解码一帧完整的数据，包括帧头）
+ *
+ * @param in      编码后的一帧（含帧头）
+ * @param len     帧长（字节）
+ * @param samples 实际采样数（audio_proto 帧头中的 samples）；奇数时最后的填充半字节不解码，
+ *                小于等于0时按帧长计算 (len - 4) * 2
+ * @param pcm     输出，至少 samples 个采样
+ * @return 解码出的采样数
+ */
+int audio_codec_ima_decode(const uint8_t *in, size_t len, int samples, int16_t *pcm);
+
+/**
+ * @brief 编码基准测试：比较标量参考实现和优化实现的每帧CPU周期，
+ * 检查两者输出一致，并打印每帧在网络上的字节数、码率和解码信噪比
+ *
+ * @param samples 每帧采样数
+ * @param rounds  重复次数
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_FAIL: 优化实现与参考实现输出不一致
+ * - ESP_ERR_NO_MEM: 内存不足
+ */
+esp_err_t audio_codec_benchmark(int samples, int rounds);
+
+#endif // AUDIO_CODEC_H
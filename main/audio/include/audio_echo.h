@@ -2,6 +2,7 @@
 #define AUDIO_ECHO_H
 
 #include "esp_err.h"
+#include "i2s_latency.h"
 
 /**
  * @brief 启动实时音频回声任务
@@ -10,4 +11,49 @@
  */
 void audio_echo_task_start(void);
 
+/**
+ * @brief 一种配置下的声学往返延迟分布
+ *
+ * 往返延迟从调用 max98357_i2s_write 写入测试音开始，到 inmp441_i2s_read 返回包含测试音起点的数据为止，
+ * 包含扬声器DMA缓冲、功放/扬声器/空气传播、麦克风DMA缓冲三部分。
+ */
+typedef struct {
+    int   trials;       /*!< 测量次数 */
+    int   detected;     /*!< 在麦克风中检测到测试音的次数 */
+    float min_ms;       /*!< 最小往返延迟 */
+    float p50_ms;       /*!< 中位数 */
+    float p90_ms;       /*!< 90分位 */
+    float max_ms;       /*!< 最大往返延迟 */
+    float avg_ms;       /*!< 平均往返延迟 */
+    float out_avg_ms;   /*!< 平均：写入扬声器 -> 麦克风采集到测试音起点（扬声器DMA缓冲 + 声学路径） */
+    float in_avg_ms;    /*!< 平均：麦克风采集到 -> 读取者拿到（麦克风DMA缓冲） */
+} audio_echo_latency_t;
+
+/**
+ * @brief 测量一种DMA配置下的声学往返延迟
+ *
+ * 按给定的延迟档位和缓冲区长度初始化麦克风和扬声器，像回声任务一样每读一块写一块（平时写静音），
+ * 每隔一段时间写入一段多音短脉冲，再用互相关在麦克风数据中找到它的起点。
+ * 调用前麦克风和扬声器都不能被其他模块占用，结束后两者都处于关闭状态。
+ *
+ * @param profile       DMA缓冲延迟档位
+ * @param chunk_samples 每次读取/写入的采样数（同时用于推算DMA缓冲区长度），至少为测试音长度
+ * @param trials        测量次数
+ * @param[out] result   延迟分布
+ * @return
+ * - ESP_OK: 成功（detected 可能小于 trials）
+ * - ESP_ERR_INVALID_ARG: 参数错误
+ * - ESP_ERR_NO_MEM: 内存不足
+ * - 其他: 驱动初始化或读写失败
+ */
+esp_err_t audio_echo_measure_latency(i2s_latency_profile_t profile, int chunk_samples, int trials,
+                                     audio_echo_latency_t *result);
+
+/**
+ * @brief 往返延迟基准测试：依次测量各延迟档位和缓冲区长度的组合并打印延迟分布
+ *
+ * @param trials 每种配置的测量次数
+ */
+esp_err_t audio_echo_benchmark(int trials);
+
 #endif // AUDIO_ECHO_H
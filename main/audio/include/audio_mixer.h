@@ -0,0 +1,147 @@
+#ifndef AUDIO_MIXER_H
+#define AUDIO_MIXER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+/**
+ * @brief 播放混音器
+ *
+ * 混音任务是 MAX98357 唯一的写入者：每次从所有输入流各取一个DMA块长的数据，
+ * 乘以各自的增益后用饱和加法（ESP32-S3 上为 aes3 向量指令）叠加成一块，再写入I2S。
+ * 各模块（下行播放器、本地提示音、麦克风监听等）只往自己的输入流写数据，写满时阻塞在自己的流上。
+ *
+ * 优先级压低（ducking）：有更高优先级的流在播放时，低优先级的流按 duck_gain 衰减，
+ * 高优先级的流结束一段时间后再逐渐恢复；增益变化在一个块内线性过渡，避免爆音。
+ *
+ * 数据格式与 MAX98357 的配置一致：单声道16位PCM，写入长度必须是完整的采样。
+ */
+
+#define AUDIO_MIXER_MAX_STREAMS     4   /*!< 最大输入流数量 */
+
+// 常用的流优先级（数值越大越优先）
+#define AUDIO_MIXER_PRIO_MONITOR    0   /*!< 本地回放（麦克风监听） */
+#define AUDIO_MIXER_PRIO_DOWNLINK   1   /*!< 服务器下发的语音 */
+#define AUDIO_MIXER_PRIO_PROMPT     2   /*!< 本地提示音 */
+
+typedef struct audio_mixer_stream *audio_mixer_stream_handle_t;
+
+/**
+ * @brief 混音器配置
+ */
+typedef struct {
+    int sample_rate;        /*!< 采样率，与 MAX98357 一致 */
+    int block_samples;      /*!< 混音块长（采样数），取I2S DMA缓冲区长度，必须是8的倍数 */
+    int task_priority;      /*!< 混音任务优先级 */
+    int task_core;          /*!< 混音任务绑定的核 */
+} audio_mixer_config_t;
+
+#define AUDIO_MIXER_DEFAULT_CONFIG() { \
+    .sample_rate = 16000,              \
+    .block_samples = 512,              \
+    .task_priority = 7,                \
+    .task_core = 1,                    \
+}
+
+/**
+ * @brief 输入流配置
+ */
+typedef struct {
+    const char *name;       /*!< 名称（日志用） */
+    int         priority;   /*!< 优先级，AUDIO_MIXER_PRIO_xxx */
+    float       gain;       /*!< 增益（0.0 ~ 1.0） */
+    float       duck_gain;  /*!< 被更高优先级的流压低时的增益系数（0.0 ~ 1.0，相对 gain） */
+    int         buffer_ms;  /*!< 流缓冲区长度（ms），至少为一个混音块 */
+} audio_mixer_stream_config_t;
+
+/**
+ * @brief 混音器统计信息
+ */
+typedef struct {
+    uint32_t blocks;            /*!< 已写入I2S的混音块数 */
+    uint32_t idle_blocks;       /*!< 没有任何流播放的空闲周期数 */
+    uint32_t underruns;         /*!< 正在播放的流数据不足一块（用静音补齐）的次数 */
+    uint32_t active_streams;    /*!< 当前正在播放的流数量 */
+    uint32_t mix_cycles_avg;    /*!< 每块混音的平均CPU周期（不含I2S写入） */
+} audio_mixer_stats_t;
+
+/**
+ * @brief 启动混音器（创建混音任务）
+ *
+ * 需要先调用 max98357_i2s_init()，启动后其他模块不能再直接调用 max98357_i2s_write()。
+ *
+ * @param config 配置，传 NULL 使用 AUDIO_MIXER_DEFAULT_CONFIG
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_ARG: 配置错误
+ * - ESP_ERR_NO_MEM: 内存不足
+ */
+esp_err_t audio_mixer_start(const audio_mixer_config_t *config);
+
+/**
+ * @brief 停止混音器
+ *
+ * 等待混音任务退出，之后才可以关闭 MAX98357。已创建的流保持有效，可以在下次启动后继续使用。
+ *
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_TIMEOUT: 混音任务未能按时退出
+ */
+esp_err_t audio_mixer_stop(void);
+
+/**
+ * @brief 混音器是否在运行
+ */
+bool audio_mixer_is_running(void);
+
+/**
+ * @brief 创建输入流
+ *
+ * @param config     流配置
+ * @param[out] ret_stream 流句柄
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_ARG: 配置错误
+ * - ESP_ERR_NO_MEM: 内存不足或流数量已满
+ */
+esp_err_t audio_mixer_stream_create(const audio_mixer_stream_config_t *config, audio_mixer_stream_handle_t *ret_stream);
+
+/**
+ * @brief 删除输入流（流中未播放的数据被丢弃）
+ *
+ * 调用前写入该流的任务必须已经停止。
+ */
+void audio_mixer_stream_delete(audio_mixer_stream_handle_t stream);
+
+/**
+ * @brief 向输入流写入PCM数据
+ *
+ * 流缓冲区满时阻塞，直到混音任务取走数据或超时；混音器停止时立即返回。
+ *
+ * @param stream         输入流
+ * @param data           PCM数据
+ * @param len            字节数
+ * @param bytes_written  实际写入的字节数（可以为NULL）
+ * @param ticks_to_wait  最长等待时间
+ * @return
+ * - ESP_OK: 全部写入
+ * - ESP_ERR_TIMEOUT: 超时，只写入了一部分
+ * - ESP_ERR_INVALID_STATE: 混音器未运行
+ */
+esp_err_t audio_mixer_write(audio_mixer_stream_handle_t stream, const void *data, size_t len,
+                            size_t *bytes_written, TickType_t ticks_to_wait);
+
+/**
+ * @brief 设置流的增益（0.0 ~ 1.0），在下一块内平滑过渡
+ */
+void audio_mixer_set_gain(audio_mixer_stream_handle_t stream, float gain);
+
+/**
+ * @brief 获取统计信息
+ */
+esp_err_t audio_mixer_get_stats(audio_mixer_stats_t *stats);
+
+#endif // AUDIO_MIXER_H
@@ -0,0 +1,134 @@
+#ifndef AUDIO_PLAYER_H
+#define AUDIO_PLAYER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/**
+ * @brief 下行音频播放器
+ *
+ * 网络任务只负责把收到的PCM数据放入抖动缓冲（audio_player_enqueue），
+ * 独立的播放任务按固定块长从缓冲中取数据写入混音器的输入流，流缓冲区写满只会阻塞播放任务。
+ *
+ * 抖动缓冲：
+ * - 预缓冲到目标深度后才开始播放；
+ * - 缓冲被取空（欠载）时，用上一块数据逐渐衰减的副本补偿，然后重新预缓冲，并增大目标深度；
+ * - 长时间没有欠载时逐步减小目标深度，并丢弃多出来的块以降低延迟；
+ * - 带序号的包如果比已经接收的包更旧（迟到），直接丢弃。
+ *
+ * 数据格式为单声道16位PCM；采样率与 MAX98357 不同时（audio_player_set_input_rate），
+ * 入队前经过流式多相重采样，I2S 不需要重新配置。
+ */
+
+/**
+ * @brief 播放器配置
+ */
+typedef struct {
+    int sample_rate;        /*!< 采样率，例如 16000 */
+    int frame_ms;           /*!< 缓冲块长度（ms） */
+    int target_ms;          /*!< 初始目标缓冲深度（ms） */
+    int min_target_ms;      /*!< 目标深度下限（ms） */
+    int max_target_ms;      /*!< 目标深度上限（ms） */
+    int max_depth_ms;       /*!< 缓冲容量（ms），超出时丢弃最旧的块 */
+    int task_priority;      /*!< 播放任务优先级 */
+    int task_core;          /*!< 播放任务绑定的核 */
+} audio_player_config_t;
+
+#define AUDIO_PLAYER_DEFAULT_CONFIG() { \
+    .sample_rate = 16000,               \
+    .frame_ms = 20,                     \
+    .target_ms = 80,                    \
+    .min_target_ms = 40,                \
+    .max_target_ms = 300,               \
+    .max_depth_ms = 500,                \
+    .task_priority = 6,                 \
+    .task_core = 1,                     \
+}
+
+/**
+ * @brief 播放器统计信息
+ */
+typedef struct {
+    uint32_t played;            /*!< 已播放的块数 */
+    uint32_t underruns;         /*!< 欠载次数 */
+    uint32_t concealed;         /*!< 欠载时补偿播放的块数 */
+    uint32_t late_dropped;      /*!< 迟到被丢弃的包数 */
+    uint32_t overflow_dropped;  /*!< 缓冲满被丢弃的块数 */
+    uint32_t trimmed;           /*!< 为降低延迟主动丢弃的块数 */
+    uint32_t depth_ms;          /*!< 当前缓冲深度（ms） */
+    uint32_t target_ms;         /*!< 当前目标深度（ms） */
+    uint32_t latency_avg_ms;    /*!< 抖动缓冲引入的平均延迟（入队到写入I2S，ms） */
+    uint32_t latency_max_ms;    /*!< 抖动缓冲引入的最大延迟（ms） */
+} audio_player_stats_t;
+
+/**
+ * @brief 启动播放器（分配抖动缓冲并创建播放任务）
+ *
+ * 需要先调用 audio_mixer_start()，播放器作为 AUDIO_MIXER_PRIO_DOWNLINK 输入流写入混音器。
+ *
+ * @param config 配置，传 NULL 使用 AUDIO_PLAYER_DEFAULT_CONFIG
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_ARG: 配置错误
+ * - ESP_ERR_NO_MEM: 内存不足
+ */
+esp_err_t audio_player_start(const audio_player_config_t *config);
+
+/**
+ * @brief 停止播放器
+ *
+ * 等待播放任务退出并释放抖动缓冲，之后才可以停止混音器。
+ *
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_TIMEOUT: 播放任务未能按时退出
+ */
+esp_err_t audio_player_stop(void);
+
+/**
+ * @brief 把一段PCM数据放入抖动缓冲（不阻塞）
+ *
+ * 数据按字节拼接，长度不需要是块长的整数倍。只允许一个任务调用（网络接收任务）。
+ *
+ * @param data PCM数据
+ * @param len  字节数
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_STATE: 播放器未启动
+ */
+esp_err_t audio_player_enqueue(const void *data, size_t len);
+
+/**
+ * @brief 放入一个带序号的PCM包，比已接收的包更旧的包会被丢弃
+ *
+ * @param seq  包序号（允许回绕）
+ * @param data PCM数据
+ * @param len  字节数
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_STATE: 播放器未启动
+ * - ESP_ERR_INVALID_ARG: 迟到的包，已丢弃
+ */
+esp_err_t audio_player_enqueue_seq(uint32_t seq, const void *data, size_t len);
+
+/**
+ * @brief 设置下行PCM数据的采样率
+ *
+ * 与 config.sample_rate 不同时，之后入队的数据先重采样到 config.sample_rate；相同时直接入队。
+ * 可以在播放过程中调用（例如服务器切换音频格式），已经入队的数据不受影响。
+ *
+ * @param sample_rate 输入采样率（4000 ~ 96000）
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_ARG: 采样率超出范围
+ * - ESP_ERR_NO_MEM: 内存不足，输入按输出采样率处理
+ */
+esp_err_t audio_player_set_input_rate(int sample_rate);
+
+/**
+ * @brief 获取播放器统计信息
+ */
+esp_err_t audio_player_get_stats(audio_player_stats_t *stats);
+
+#endif // AUDIO_PLAYER_H
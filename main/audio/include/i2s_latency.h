@@ -0,0 +1,89 @@
+#ifndef I2S_LATENCY_H
+#define I2S_LATENCY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/**
+ * @brief I2S DMA 缓冲延迟档位
+ *
+ * DMA缓冲区长度按读取者/写入者每次处理的采样帧数（chunk，麦克风为AFE feed chunk，扬声器为混音块长）推算：
+ * - LOW:      3 个 chunk/2 的缓冲区，共 1.5 个chunk（512 @ 16kHz 时 48ms）
+ * - BALANCED: 4 个 chunk/2 的缓冲区，共 2 个chunk（64ms）
+ * - ROBUST:   4 个 chunk 的缓冲区，共 4 个chunk（128ms，即原来固定的 4 x 512）
+ *
+ * 单个DMA缓冲区超过 I2S 的 4092 字节上限时（例如32位立体声），缓冲区减半、个数加倍，总时长不变。
+ * 档位越低延迟越小，但读写任务被抢占时越容易溢出/欠载，可以用 i2s_latency_benchmark() 实测。
+ */
+typedef enum {
+    I2S_LATENCY_ROBUST = 0,     /*!< 默认（配置结构体零初始化时保持原来的缓冲长度） */
+    I2S_LATENCY_BALANCED,       /*!< 折中 */
+    I2S_LATENCY_LOW,            /*!< 低延迟 */
+} i2s_latency_profile_t;
+
+#define I2S_LATENCY_DEFAULT_CHUNK   512     /*!< 未指定 chunk 时使用的采样帧数 */
+#define I2S_LATENCY_MAX_DESC_NUM    16      /*!< DMA缓冲区个数上限 */
+#define I2S_LATENCY_DMA_BUF_MAX     4092    /*!< 单个DMA缓冲区的字节数上限 */
+
+/**
+ * @brief DMA缓冲区布局
+ */
+typedef struct {
+    int desc_num;       /*!< DMA缓冲区个数 */
+    int frame_num;      /*!< 每个DMA缓冲区的采样帧数 */
+} i2s_dma_layout_t;
+
+/**
+ * @brief I2S 通道延迟统计
+ *
+ * buffered 为读取/写入返回时DMA中排队的数据：
+ * 麦克风是已采集但还没有被读走的数据，扬声器是已写入但还没有播出的数据。
+ */
+typedef struct {
+    uint32_t desc_num;          /*!< DMA缓冲区个数 */
+    uint32_t frame_num;         /*!< 每个DMA缓冲区的采样帧数 */
+    uint32_t dma_buffer_us;     /*!< DMA缓冲区总时长（us） */
+    uint32_t buffered_us;       /*!< 最近一次读取/写入后排队的数据时长（us） */
+    uint32_t buffered_avg_us;   /*!< 排队时长的滑动平均（us） */
+    uint32_t buffered_max_us;   /*!< 排队时长的最大值（us） */
+    uint32_t overruns;          /*!< 麦克风：读取者来不及取、被DMA覆盖的缓冲区数 */
+    uint32_t underruns;         /*!< 扬声器：写入的数据播完、DMA开始输出静音的次数（正常播放结束也计一次） */
+} i2s_latency_stats_t;
+
+/**
+ * @brief 按档位和 chunk 推算DMA缓冲区布局
+ *
+ * @param profile       延迟档位
+ * @param chunk_samples 每次读取/写入的采样帧数，0 为 I2S_LATENCY_DEFAULT_CHUNK
+ * @param frame_bytes   一个采样帧（所有通道）的字节数
+ * @param[out] layout   DMA缓冲区布局
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_ARG: 参数错误
+ */
+esp_err_t i2s_latency_get_dma_layout(i2s_latency_profile_t profile, int chunk_samples, size_t frame_bytes,
+                                     i2s_dma_layout_t *layout);
+
+/**
+ * @brief 档位名称（日志用）
+ */
+const char *i2s_latency_profile_name(i2s_latency_profile_t profile);
+
+/**
+ * @brief 延迟档位实测
+ *
+ * 依次用每个档位初始化 INMP441（32位、回调采集）和 MAX98357，把麦克风数据原样回放 duration_ms，
+ * 打印各档位的DMA缓冲时长、实际排队时长和溢出/欠载次数。
+ * 调用前麦克风和扬声器都不能被其他模块占用，结束后两者都处于关闭状态。
+ *
+ * @param chunk_samples 每次读取/写入的采样帧数（取AFE feed chunk），0 为默认值
+ * @param duration_ms   每个档位的测试时长
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_NO_MEM: 内存不足
+ * - 其他: 驱动初始化失败
+ */
+esp_err_t i2s_latency_benchmark(int chunk_samples, int duration_ms);
+
+#endif // I2S_LATENCY_H
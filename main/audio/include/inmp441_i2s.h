@@ -3,6 +3,7 @@
 
 #include "driver/i2s_std.h"
 #include "freertos/FreeRTOS.h"
+#include "i2s_latency.h"
 
 /**
  * @brief INMP441 声道模式
@@ -15,6 +16,14 @@ typedef enum {
     INMP441_CHANNEL_STEREO, /*!< 采集双声道 */
 } inmp441_channel_mode_t;
 
+/**
+ * @brief INMP441 采集方式
+ */
+typedef enum {
+    INMP441_CAPTURE_READ,       /*!< 阻塞调用 i2s_channel_read，由驱动把DMA数据拷贝出来 */
+    INMP441_CAPTURE_CALLBACK,   /*!< DMA完成回调（on_recv）直接交出DMA缓冲区，通过任务通知唤醒读取者 */
+} inmp441_capture_mode_t;
+
 /**
  * @brief INMP441 I2S 配置结构体
  */
@@ -25,8 +34,34 @@ typedef struct {
     int                     sample_rate;    /*!< 采样率，例如 16000 */
     inmp441_channel_mode_t  channel_mode;   /*!< 声道模式 */
     i2s_data_bit_width_t    bits_per_sample;/*!< 采样位宽, 通常为 16 或 32 位 */
+    int                     gain_shift;     /*!< 32位模式下的数字增益（左移位数, 0 ~ PCM_CONVERT_MAX_GAIN_SHIFT） */
+    inmp441_capture_mode_t  capture_mode;   /*!< 采集方式，默认 INMP441_CAPTURE_READ */
+    i2s_latency_profile_t   latency_profile;/*!< DMA缓冲延迟档位，默认 I2S_LATENCY_ROBUST */
+    int                     dma_chunk_samples;/*!< 每次读取的采样帧数（AFE feed chunk），用于推算DMA缓冲区长度，0 为512 */
 } inmp441_i2s_config_t;
 
+/**
+ * @brief 回调采集模式下一个已完成的DMA缓冲区
+ */
+typedef struct {
+    const void *data;           /*!< DMA缓冲区（原始I2S数据，32位模式下为32位采样） */
+    size_t      size;           /*!< 字节数 */
+    uint32_t    seq;            /*!< DMA缓冲区完成序号 */
+    int64_t     timestamp_us;   /*!< DMA完成时间（esp_timer_get_time） */
+} inmp441_dma_buf_t;
+
+/**
+ * @brief 回调采集模式统计信息
+ */
+typedef struct {
+    uint32_t completed;         /*!< DMA完成的缓冲区总数 */
+    uint32_t delivered;         /*!< 交给读取者的缓冲区数 */
+    uint32_t dropped;           /*!< 读取者来不及取、被丢弃的缓冲区数 */
+    uint32_t late;              /*!< 处理完之前已被DMA覆盖的缓冲区数 */
+    uint32_t latency_avg_us;    /*!< DMA完成到读取者拿到缓冲区的平均延迟（us） */
+    uint32_t latency_max_us;    /*!< 最大延迟（us） */
+} inmp441_capture_stats_t;
+
 /**
  * @brief 初始化 INMP441 I2S 驱动
  *
@@ -54,6 +89,13 @@ esp_err_t inmp441_i2s_close(void);
  *
  * 这是一个阻塞函数，它会等待直到读取到指定大小的数据或超时。
  *
+ * 32位模式（bits_per_sample 为 I2S_DATA_BIT_WIDTH_32BIT）下，驱动读取原生32位slot，
+ * 去直流、饱和后输出16位PCM，size 和 bytes_read 均按输出的16位数据计算。
+ * dest 16字节对齐且采样数为8的倍数时使用 aes3 向量转换。
+ *
+ * 回调采集模式下，数据直接从已完成的DMA缓冲区转换/拷贝到 dest，不再经过驱动的中间拷贝；
+ * 读取者在等待期间阻塞在任务通知上。只允许一个任务读取。
+ *
  * @param[out] dest         指向存储读取数据的缓冲区的指针
  * @param[in]  size         期望读取的字节数
  * @param[out] bytes_read   实际读取到的字节数
@@ -64,4 +106,51 @@ esp_err_t inmp441_i2s_close(void);
  */
 esp_err_t inmp441_i2s_read(void *dest, size_t size, size_t *bytes_read, TickType_t ticks_to_wait);
 
+/**
+ * @brief 获取最近一次 inmp441_i2s_read 返回的最后一个采样的采集时间
+ *
+ * 回调采集模式下由DMA完成时间推算，精度为中断延迟；阻塞读取模式下为读取返回的时间。
+ * 用于把麦克风数据与扬声器参考信号按时间对齐。
+ *
+ * @return 时间戳（esp_timer_get_time，us）
+ */
+int64_t inmp441_i2s_get_read_timestamp(void);
+
+/**
+ * @brief 获取一个已完成的DMA缓冲区（仅回调采集模式，零拷贝）
+ *
+ * 缓冲区在DMA转一圈（dma_desc_num 个缓冲区）后会被覆盖，
+ * 处理完必须尽快调用 inmp441_i2s_release_dma_buf。只允许一个任务调用。
+ *
+ * @param[out] buf           DMA缓冲区信息
+ * @param[in]  ticks_to_wait 等待时间
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_TIMEOUT: 超时
+ * - ESP_ERR_INVALID_STATE: 未初始化或不是回调采集模式
+ */
+esp_err_t inmp441_i2s_acquire_dma_buf(inmp441_dma_buf_t *buf, TickType_t ticks_to_wait);
+
+/**
+ * @brief 归还DMA缓冲区，并检查处理期间是否已经被DMA覆盖（计入 late）
+ *
+ * @return
+ * - ESP_OK: 数据有效
+ * - ESP_ERR_INVALID_STATE: 处理期间缓冲区已被覆盖
+ */
+esp_err_t inmp441_i2s_release_dma_buf(const inmp441_dma_buf_t *buf);
+
+/**
+ * @brief 获取回调采集模式的统计信息
+ */
+esp_err_t inmp441_i2s_get_capture_stats(inmp441_capture_stats_t *stats);
+
+/**
+ * @brief 获取DMA缓冲延迟统计
+ *
+ * buffered 在每次 inmp441_i2s_read 返回时采样，是已经采集但还没有被读走的数据；
+ * overruns 在回调采集模式下为 dropped + late，阻塞读取模式下为驱动接收队列溢出的次数。
+ */
+esp_err_t inmp441_i2s_get_latency_stats(i2s_latency_stats_t *stats);
+
 #endif // INMP441_I2S_H
\ No newline at end of file
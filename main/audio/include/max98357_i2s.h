@@ -3,6 +3,7 @@
 
 #include "driver/i2s_std.h"
 #include "freertos/FreeRTOS.h"
+#include "i2s_latency.h"
 
 /**
  * @brief MAX98357 声道模式
@@ -28,6 +29,16 @@ typedef enum {
     MAX98357_MASK_BOTH  = I2S_STD_SLOT_BOTH, /*!< 双声道 */
 } max98357_slot_mask_t;
 
+/**
+ * @brief DMA缓冲区发送完成回调（中断上下文，需要放在IRAM中，不能阻塞）
+ *
+ * @param data 刚刚发送完成的DMA缓冲区（即实际输出到功放的数据）
+ * @param size 字节数
+ * @param ctx  用户参数
+ * @return 是否唤醒了更高优先级的任务（需要在中断退出时切换任务）
+ */
+typedef bool (*max98357_sent_cb_t)(const void *data, size_t size, void *ctx);
+
 /**
  * @brief MAX98357 I2S 配置结构体
  */
@@ -39,6 +50,10 @@ typedef struct {
     max98357_channel_mode_t   channel_mode;   /*!< 声道模式 */
     max98357_slot_mask_t      slot_mask;       /*!< 声道掩码，用于设置 I2S 标准模式的 slot_mask */
     i2s_data_bit_width_t      bits_per_sample;/*!< 采样位宽, 通常为 16 或 32 位 */
+    max98357_sent_cb_t        on_sent;        /*!< 可选：DMA发送完成回调（例如采集AEC参考信号），不需要时为NULL */
+    void                     *on_sent_ctx;    /*!< on_sent 的用户参数 */
+    i2s_latency_profile_t     latency_profile;/*!< DMA缓冲延迟档位，默认 I2S_LATENCY_ROBUST */
+    int                       dma_chunk_samples;/*!< 每次写入的采样帧数（混音块长），用于推算DMA缓冲区长度，0 为512 */
 } max98357_i2s_config_t;
 
 /**
@@ -78,4 +93,21 @@ esp_err_t max98357_i2s_close(void);
  */
 esp_err_t max98357_i2s_write(const void *src, size_t size, size_t *bytes_written, TickType_t ticks_to_wait);
 
+/**
+ * @brief 获取DMA缓冲区布局（例如混音器按 frame_num 取混音块长）
+ *
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_STATE: 未初始化
+ */
+esp_err_t max98357_i2s_get_dma_layout(i2s_dma_layout_t *layout);
+
+/**
+ * @brief 获取DMA缓冲延迟统计
+ *
+ * buffered 在每次 max98357_i2s_write 返回时采样，是已经写入但还没有播出的数据；
+ * underruns 为写入的数据播完、DMA开始输出静音的次数。
+ */
+esp_err_t max98357_i2s_get_latency_stats(i2s_latency_stats_t *stats);
+
 #endif // MAX98357_I2S_H
@@ -0,0 +1,120 @@
+#ifndef OPUS_DOWNLINK_H
+#define OPUS_DOWNLINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/**
+ * @brief 下行 Opus 流式解码
+ *
+ * 服务器协商为 Opus 时（见 websocket_client.h 的 audio_format 消息），每条 WebSocket 二进制消息是一个 Opus 包。
+ * 网络任务只把包拷贝进预分配的包池（opus_downlink_push），独立的解码任务解码后放入播放器的抖动缓冲，
+ * 解码器状态和PCM缓冲区都在启动时分配，运行中不再申请内存。
+ *
+ * 丢包补偿：
+ * - 带序号的包出现空洞时，缺失的帧用 PLC 生成，紧挨当前包的一帧优先用当前包里的带内 FEC 恢复；
+ * - 比已解码的包更旧的包（迟到）直接丢弃；
+ * - 播放中没有包到达且抖动缓冲快要取空时，每个帧长生成一帧 PLC，最多 OPUS_DOWNLINK_PLC_MAX_FRAMES 帧，
+ *   之后认为这段语音已经结束，不再补偿，避免静音期间一直输出合成的声音。
+ */
+
+#define OPUS_DOWNLINK_MAX_PACKET        1276    /*!< 单个 Opus 包的最大字节数 */
+#define OPUS_DOWNLINK_PLC_MAX_FRAMES    5       /*!< 连续补偿的最大帧数 */
+
+/**
+ * @brief 解码配置
+ */
+typedef struct {
+    int sample_rate;        /*!< 解码输出采样率（8000/12000/16000/24000/48000），与播放器一致 */
+    int frame_ms;           /*!< 服务器的帧长（ms），用于 PLC 和等待超时，收到包后按实际帧长更新 */
+    int queue_packets;      /*!< 包池大小 */
+    int task_priority;      /*!< 解码任务优先级 */
+    int task_core;          /*!< 解码任务绑定的核 */
+} opus_downlink_config_t;
+
+#define OPUS_DOWNLINK_DEFAULT_CONFIG() {    \
+    .sample_rate = 16000,                   \
+    .frame_ms = 20,                         \
+    .queue_packets = 16,                    \
+    .task_priority = 5,                     \
+    .task_core = 0,                         \
+}
+
+/**
+ * @brief 解码统计信息
+ */
+typedef struct {
+    uint32_t packets;           /*!< 收到的包数 */
+    uint32_t decoded;           /*!< 正常解码的帧数 */
+    uint32_t concealed;         /*!< PLC 生成的帧数 */
+    uint32_t fec_recovered;     /*!< 用带内 FEC 恢复的帧数 */
+    uint32_t late_dropped;      /*!< 迟到被丢弃的包数 */
+    uint32_t overflow_dropped;  /*!< 包池满被丢弃的包数 */
+    uint32_t decode_errors;     /*!< 解码失败的包数 */
+    uint32_t decode_cycles_avg; /*!< 每帧解码（含 PLC）的平均CPU周期 */
+    uint32_t cpu_load_permille; /*!< 最近一个统计周期内解码占用的CPU（‰，单核） */
+} opus_downlink_stats_t;
+
+/**
+ * @brief 启动解码任务
+ *
+ * 需要先调用 audio_player_start()，解码结果通过 audio_player_enqueue() 播放。
+ *
+ * @param config 配置，传 NULL 使用 OPUS_DOWNLINK_DEFAULT_CONFIG
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_ARG: 配置错误
+ * - ESP_ERR_NO_MEM: 内存不足
+ */
+esp_err_t opus_downlink_start(const opus_downlink_config_t *config);
+
+/**
+ * @brief 停止解码任务并释放解码器和包池
+ *
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_TIMEOUT: 解码任务未能按时退出
+ */
+esp_err_t opus_downlink_stop(void);
+
+/**
+ * @brief 解码任务是否在运行
+ */
+bool opus_downlink_is_running(void);
+
+/**
+ * @brief 重置解码器（新的一段语音或重新协商格式时调用），清空未解码的包和序号
+ */
+void opus_downlink_reset(void);
+
+/**
+ * @brief 放入一个 Opus 包（不阻塞），包池满时丢弃最旧的包
+ *
+ * 只允许一个任务调用（网络接收任务）。不带序号时只能发现播放中断，无法发现中间丢失的包。
+ *
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_STATE: 解码任务未启动
+ * - ESP_ERR_INVALID_SIZE: 包长度为0或超过 OPUS_DOWNLINK_MAX_PACKET
+ */
+esp_err_t opus_downlink_push(const void *packet, size_t len);
+
+/**
+ * @brief 放入一个带序号的 Opus 包
+ *
+ * @param seq 包序号（每个包加1，允许回绕）
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_STATE: 解码任务未启动
+ * - ESP_ERR_INVALID_SIZE: 包长度为0或超过 OPUS_DOWNLINK_MAX_PACKET
+ */
+esp_err_t opus_downlink_push_seq(uint32_t seq, const void *packet, size_t len);
+
+/**
+ * @brief 获取解码统计信息
+ */
+esp_err_t opus_downlink_get_stats(opus_downlink_stats_t *stats);
+
+#endif // OPUS_DOWNLINK_H
@@ -0,0 +1,84 @@
+#ifndef PCM_CONVERT_H
+#define PCM_CONVERT_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "pcm_convert_platform.h"
+
+/**
+ * @brief 32位I2S采样 -> 16位PCM 转换
+ *
+ * INMP441 输出的是左对齐在32位slot中的24位数据。转换时取每个32位字的高16位
+ * （INMP441 的SNR约61dB，高16位已经覆盖有效动态范围），减去直流分量并饱和，
+ * 可选再做 2^gain_shift 倍的饱和增益，一次遍历完成。
+ *
+ * ESP32-S3 上使用 PIE(aes3) 向量指令实现，每次处理8个采样；
+ * 其他芯片或者地址/长度不满足对齐要求时使用标量实现，两者结果逐位一致。
+ */
+
+#define PCM_CONVERT_MAX_GAIN_SHIFT  2   /*!< 最大增益：左移2位（x4, +12dB） */
+
+/**
+ * @brief 直流阻断状态（每个 I2S 通道一份）
+ */
+typedef struct {
+    int16_t dc[2] __attribute__((aligned(4)));  /*!< 当前直流估计（交错的 L/R，单声道时两者相同） */
+    int32_t dc_q8[2];                           /*!< 直流估计的Q8累加器 */
+    int     channels;                           /*!< 交错通道数：1 或 2 */
+    int     gain_shift;                         /*!< 增益左移位数：0 ~ PCM_CONVERT_MAX_GAIN_SHIFT */
+} pcm_dc_block_t;
+
+/**
+ * @brief 初始化直流阻断状态
+ *
+ * @param st         状态
+ * @param channels   交错通道数（1或2）
+ * @param gain_shift 增益左移位数
+ */
+void pcm_dc_block_init(pcm_dc_block_t *st, int channels, int gain_shift);
+
+/**
+ * @brief 32位采样转换为16位PCM（自动选择SIMD或标量实现）
+ *
+ * 允许原地转换（dst == (int16_t *)src）。
+ * src/dst 16字节对齐且 samples 为8的倍数时走 aes3 向量路径。
+ *
+ * @param st      直流阻断状态，会根据本帧输入更新直流估计
+ * @param src     32位输入采样
+ * @param dst     16位输出采样
+ * @param samples 采样个数（所有通道的总数）
+ */
+void pcm_s32_to_s16(pcm_dc_block_t *st, const int32_t *src, int16_t *dst, int samples);
+
+/**
+ * @brief 标量参考实现
+ *
+ * @param dc_pair    交错的直流值 {L, R}
+ * @param gain_shift 增益左移位数
+ */
+void pcm_s32_to_s16_ansi(const int32_t *src, int16_t *dst, int samples, const int16_t *dc_pair, int gain_shift);
+
+#if pcm_convert_aes3_enabled
+/**
+ * @brief ESP32-S3 PIE 向量实现
+ *
+ * 要求 src/dst 16字节对齐，samples 为8的倍数，dc_pair 4字节对齐。
+ */
+void pcm_s32_to_s16_aes3(const int32_t *src, int16_t *dst, int samples, const int16_t *dc_pair, int gain_shift);
+#endif
+
+/**
+ * @brief 转换内核基准测试
+ *
+ * 分别测量标量实现和向量实现处理一帧的CPU周期数，校验两者输出一致，并打印结果。
+ *
+ * @param samples 每帧采样数（例如AFE feed帧长512）
+ * @param rounds  测量轮数
+ * @return
+ * - ESP_OK: 成功且两种实现结果一致
+ * - ESP_FAIL: 结果不一致
+ * - ESP_ERR_NO_MEM: 内存不足
+ */
+esp_err_t pcm_convert_benchmark(int samples, int rounds);
+
+#endif // PCM_CONVERT_H
@@ -0,0 +1,13 @@
+#ifndef PCM_CONVERT_PLATFORM_H
+#define PCM_CONVERT_PLATFORM_H
+
+#include "sdkconfig.h"
+
+// 汇编文件也会包含此头文件，这里只能放宏定义
+#if CONFIG_IDF_TARGET_ESP32S3
+#define pcm_convert_aes3_enabled 1
+#else
+#define pcm_convert_aes3_enabled 0
+#endif
+
+#endif // PCM_CONVERT_PLATFORM_H
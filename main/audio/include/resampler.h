@@ -0,0 +1,73 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * @brief 流式多相重采样器（单声道16位PCM）
+ *
+ * 输入/输出采样率化简为 L/M（输出/输入）后按比例选择实现：
+ * - L == 1（整数倍抽取，例如 48k->16k、32k->16k）：dsps_fird_s16（ESP32-S3 上为 aes3 实现）；
+ * - L <= RESAMPLER_MAX_EXACT_PHASES（例如 24k->16k 为 2/3、8k->16k 为 2/1）：L 个多相分支，
+ *   每个分支是一个抽取因子为 M 的 dsps_fird_f32，输出交错后得到精确的有理数比例；
+ * - 其他比例（例如 22.05k/44.1k）：64相滤波器组 + 相位间线性插值，每个输出用 dsps_dotprod_f32 计算。
+ *
+ * 滤波器组（Kaiser窗sinc原型分解得到的多相系数）按比例缓存，切换采样率时不需要重新设计滤波器。
+ * 处理是流式的：每次输入任意长度，不足一个抽取周期的采样留到下一次。
+ */
+
+#define RESAMPLER_MAX_EXACT_PHASES  8   /*!< 精确多相实现允许的最大相数 L */
+
+typedef struct resampler *resampler_handle_t;
+
+/**
+ * @brief 创建重采样器
+ *
+ * @param in_rate  输入采样率
+ * @param out_rate 输出采样率
+ * @param[out] ret_handle 重采样器句柄
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_ARG: 采样率无效
+ * - ESP_ERR_NO_MEM: 内存不足
+ */
+esp_err_t resampler_create(int in_rate, int out_rate, resampler_handle_t *ret_handle);
+
+/**
+ * @brief 销毁重采样器（缓存的滤波器组保留，供下次使用）
+ */
+void resampler_destroy(resampler_handle_t rs);
+
+/**
+ * @brief 清空内部状态（延迟线、未处理的采样），用于流中断后重新开始
+ */
+void resampler_reset(resampler_handle_t rs);
+
+/**
+ * @brief 处理一段输入
+ *
+ * @param rs         重采样器
+ * @param in         输入采样
+ * @param in_samples 输入采样数
+ * @param out        输出缓冲区
+ * @param out_max    输出缓冲区容量（采样数），至少为 resampler_get_max_output(rs, in_samples)
+ * @return 输出的采样数
+ */
+int resampler_process(resampler_handle_t rs, const int16_t *in, int in_samples, int16_t *out, int out_max);
+
+/**
+ * @brief 输入 in_samples 个采样时最多可能输出的采样数
+ */
+int resampler_get_max_output(resampler_handle_t rs, int in_samples);
+
+/**
+ * @brief 基准测试：24k->16k、48k->16k 等常见比例处理1秒音频的CPU周期和CPU占用
+ *
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_NO_MEM: 内存不足
+ */
+esp_err_t resampler_benchmark(void);
+
+#endif // RESAMPLER_H
@@ -1,17 +1,124 @@
 #include "inmp441_i2s.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
 #include "driver/i2s_std.h"
+#include "esp_heap_caps.h"
+#include "pcm_convert.h"
 #include <string.h>
 
-// I2S DMA 缓冲区配置
-#define DMA_DESC_NUM  4
-#define DMA_FRAME_NUM 512
-
 static const char *TAG = "INMP441_DRIVER";
 
 // 模块级静态变量，用于保存I2S通道句柄
 static i2s_chan_handle_t s_rx_chan = NULL;
+static i2s_dma_layout_t s_dma_layout;
+
+// 32位采集模式：原始32位数据先读到这里，再转换为16位PCM
+static bool s_is_32bit = false;
+static pcm_dc_block_t s_dc;
+static int32_t *s_raw_buf = NULL;
+static size_t s_raw_buf_size = 0;
+
+// 回调采集模式：on_recv 中断把已完成的DMA缓冲区放入环形队列，并用任务通知唤醒读取者
+// （环形队列按最大缓冲区个数分配，队列中最多保留 dma_desc_num 个）
+static bool s_use_callback = false;
+static portMUX_TYPE s_cap_lock = portMUX_INITIALIZER_UNLOCKED;
+static inmp441_dma_buf_t s_cap_ring[I2S_LATENCY_MAX_DESC_NUM];
+static uint32_t s_cap_head = 0;             // 中断写入位置
+static uint32_t s_cap_tail = 0;             // 读取者读取位置
+static volatile uint32_t s_cap_seq = 0;     // 最近完成的DMA缓冲区序号
+static volatile TaskHandle_t s_cap_task = NULL;
+static inmp441_capture_stats_t s_cap_stats;
+
+// 延迟统计：阻塞读取模式下DMA已完成和已被读走（或溢出丢弃）的字节数，两者之差为排队的数据
+static uint32_t s_rx_avail = 0;
+static uint32_t s_rx_taken = 0;
+static i2s_latency_stats_t s_lat_stats;
+
+// inmp441_i2s_read 在回调模式下正在消费的DMA缓冲区（读取长度与DMA缓冲区长度不必一致）
+static inmp441_dma_buf_t s_cur_buf;
+static size_t s_cur_off = 0;
+static bool s_has_cur = false;
+
+// 最近一次读取的最后一个采样的采集时间，以及推算时间所需的格式信息
+static int64_t s_read_ts = 0;
+static int s_sample_rate = 16000;
+static size_t s_raw_frame_bytes = 2;    // 一个采样帧（所有通道）的原始字节数
+
+/**
+ * @brief DMA缓冲区接收完成回调（中断上下文）
+ */
+static bool IRAM_ATTR inmp441_on_recv(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx)
+{
+    BaseType_t need_yield = pdFALSE;
+
+    portENTER_CRITICAL_ISR(&s_cap_lock);
+    uint32_t seq = ++s_cap_seq;
+    s_cap_stats.completed++;
+    // 读取者来不及取：丢弃最旧的一个（它马上就会被DMA覆盖）
+    if (s_cap_head - s_cap_tail >= (uint32_t)s_dma_layout.desc_num) {
+        s_cap_tail++;
+        s_cap_stats.dropped++;
+    }
+    inmp441_dma_buf_t *buf = &s_cap_ring[s_cap_head % I2S_LATENCY_MAX_DESC_NUM];
+    buf->data = event->dma_buf;
+    buf->size = event->size;
+    buf->seq = seq;
+    buf->timestamp_us = esp_timer_get_time();
+    s_cap_head++;
+    portEXIT_CRITICAL_ISR(&s_cap_lock);
+
+    if (s_cap_task) {
+        vTaskNotifyGiveFromISR(s_cap_task, &need_yield);
+    }
+    return need_yield == pdTRUE;
+}
+
+/**
+ * @brief 阻塞读取模式下的DMA接收完成回调（中断上下文），只用于统计排队的数据
+ */
+static bool IRAM_ATTR inmp441_on_recv_count(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx)
+{
+    portENTER_CRITICAL_ISR(&s_cap_lock);
+    s_rx_avail += event->size;
+    portEXIT_CRITICAL_ISR(&s_cap_lock);
+    return false;
+}
+
+/**
+ * @brief 阻塞读取模式下驱动接收队列溢出（中断上下文）：最旧的缓冲区被丢弃
+ */
+static bool IRAM_ATTR inmp441_on_recv_q_ovf(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx)
+{
+    portENTER_CRITICAL_ISR(&s_cap_lock);
+    s_rx_taken += event->size;
+    s_lat_stats.overruns++;
+    portEXIT_CRITICAL_ISR(&s_cap_lock);
+    return false;
+}
+
+/**
+ * @brief 缓冲区完成后DMA又写完了 (dma_desc_num - 1) 个缓冲区，说明DMA已经开始覆盖它
+ */
+static inline bool inmp441_dma_buf_is_late(const inmp441_dma_buf_t *buf)
+{
+    return (s_cap_seq - buf->seq) >= (uint32_t)s_dma_layout.desc_num - 1;
+}
+
+/**
+ * @brief 记录一次读取返回时DMA中排队的数据（调用者持有 s_cap_lock）
+ */
+static void inmp441_update_buffered(uint32_t pending_bytes)
+{
+    uint32_t buffered_us = (uint32_t)((int64_t)pending_bytes / s_raw_frame_bytes * 1000000 / s_sample_rate);
+    s_lat_stats.buffered_us = buffered_us;
+    s_lat_stats.buffered_avg_us = (s_lat_stats.buffered_avg_us * 15 + buffered_us) / 16;
+    if (buffered_us > s_lat_stats.buffered_max_us) {
+        s_lat_stats.buffered_max_us = buffered_us;
+    }
+}
 
 /**
  * @brief 初始化 INMP441 I2S 驱动
@@ -31,7 +138,15 @@ esp_err_t inmp441_i2s_init(const inmp441_i2s_config_t *config)
 
     ESP_LOGI(TAG, "Initializing INMP441 I2S driver...");
 
-    // 2. 配置I2S通道
+    // 2. 配置I2S通道，DMA缓冲区按延迟档位和每次读取的长度（AFE feed chunk）推算
+    i2s_slot_mode_t slot_mode = (config->channel_mode == INMP441_CHANNEL_STEREO) ? I2S_SLOT_MODE_STEREO : I2S_SLOT_MODE_MONO;
+    s_sample_rate = config->sample_rate;
+    s_raw_frame_bytes = (config->bits_per_sample / 8) * ((slot_mode == I2S_SLOT_MODE_STEREO) ? 2 : 1);
+    esp_err_t ret = i2s_latency_get_dma_layout(config->latency_profile, config->dma_chunk_samples, s_raw_frame_bytes, &s_dma_layout);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Invalid DMA configuration");
+        return ret;
+    }
     // i2s_chan_config_t chan_cfg = {
     //     .id = I2S_NUM_0, // 使用I2S0
     //     .role = I2S_ROLE_MASTER,
@@ -40,15 +155,14 @@ esp_err_t inmp441_i2s_init(const inmp441_i2s_config_t *config)
     //     .auto_clear = true, // 当缓冲区满时自动清除旧数据
     // };
     i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_0, I2S_ROLE_MASTER);
-    chan_cfg.dma_desc_num = DMA_DESC_NUM;
-    chan_cfg.dma_frame_num = DMA_FRAME_NUM;
+    chan_cfg.dma_desc_num = s_dma_layout.desc_num;
+    chan_cfg.dma_frame_num = s_dma_layout.frame_num;
     ESP_ERROR_CHECK(i2s_new_channel(&chan_cfg, NULL, &s_rx_chan));
 
     // 3. 配置I2S标准模式
     i2s_std_config_t std_cfg = {
         .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(config->sample_rate),
-        .slot_cfg = I2S_STD_MSB_SLOT_DEFAULT_CONFIG(config->bits_per_sample, 
-            (config->channel_mode == INMP441_CHANNEL_STEREO) ? I2S_SLOT_MODE_STEREO : I2S_SLOT_MODE_MONO),
+        .slot_cfg = I2S_STD_MSB_SLOT_DEFAULT_CONFIG(config->bits_per_sample, slot_mode),
         .gpio_cfg = {
             .mclk = I2S_GPIO_UNUSED,
             .bclk = config->gpio_bclk,
@@ -63,6 +177,13 @@ esp_err_t inmp441_i2s_init(const inmp441_i2s_config_t *config)
         },
     };
 
+    // 32位模式：INMP441 是标准I2S时序（数据比WS延后1个BCLK），24位数据左对齐在32位slot中
+    s_is_32bit = (config->bits_per_sample == I2S_DATA_BIT_WIDTH_32BIT);
+    if (s_is_32bit) {
+        std_cfg.slot_cfg = (i2s_std_slot_config_t)I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_32BIT, slot_mode);
+        pcm_dc_block_init(&s_dc, (slot_mode == I2S_SLOT_MODE_STEREO) ? 2 : 1, config->gain_shift);
+    }
+
     // 根据通道模式设置正确的slot_mask
     switch (config->channel_mode) {
         case INMP441_CHANNEL_LEFT:
@@ -78,7 +199,7 @@ esp_err_t inmp441_i2s_init(const inmp441_i2s_config_t *config)
     }
 
     // 4. 初始化通道
-    esp_err_t ret = i2s_channel_init_std_mode(s_rx_chan, &std_cfg);
+    ret = i2s_channel_init_std_mode(s_rx_chan, &std_cfg);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to init std mode: %s", esp_err_to_name(ret));
         // 初始化失败时，清理已创建的通道
@@ -87,7 +208,30 @@ esp_err_t inmp441_i2s_init(const inmp441_i2s_config_t *config)
         return ret;
     }
 
-    // 5. 启动接收
+    // 5. 注册DMA完成回调（必须在 enable 之前）：回调采集模式交出DMA缓冲区，阻塞读取模式只做延迟统计
+    s_use_callback = (config->capture_mode == INMP441_CAPTURE_CALLBACK);
+    s_cap_head = s_cap_tail = 0;
+    s_cap_seq = 0;
+    s_has_cur = false;
+    memset(&s_cap_stats, 0, sizeof(s_cap_stats));
+    s_rx_avail = s_rx_taken = 0;
+    memset(&s_lat_stats, 0, sizeof(s_lat_stats));
+    s_lat_stats.desc_num = s_dma_layout.desc_num;
+    s_lat_stats.frame_num = s_dma_layout.frame_num;
+    s_lat_stats.dma_buffer_us = (uint32_t)((int64_t)s_dma_layout.desc_num * s_dma_layout.frame_num * 1000000 / s_sample_rate);
+    i2s_event_callbacks_t cbs = {
+        .on_recv = s_use_callback ? inmp441_on_recv : inmp441_on_recv_count,
+        .on_recv_q_ovf = s_use_callback ? NULL : inmp441_on_recv_q_ovf,
+    };
+    ret = i2s_channel_register_event_callback(s_rx_chan, &cbs, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register DMA callback: %s", esp_err_to_name(ret));
+        i2s_del_channel(s_rx_chan);
+        s_rx_chan = NULL;
+        return ret;
+    }
+
+    // 6. 启动接收
     ret = i2s_channel_enable(s_rx_chan);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to enable channel: %s", esp_err_to_name(ret));
@@ -96,7 +240,9 @@ esp_err_t inmp441_i2s_init(const inmp441_i2s_config_t *config)
         return ret;
     }
 
-    ESP_LOGI(TAG, "I2S driver initialized successfully.");
+    ESP_LOGI(TAG, "I2S driver initialized successfully (%s capture, %s, DMA %d x %d frames, %d ms).",
+             s_use_callback ? "callback" : "read", i2s_latency_profile_name(config->latency_profile),
+             s_dma_layout.desc_num, s_dma_layout.frame_num, (int)(s_lat_stats.dma_buffer_us / 1000));
     return ESP_OK;
 }
 
@@ -114,9 +260,94 @@ esp_err_t inmp441_i2s_close(void)
     i2s_channel_disable(s_rx_chan);
     esp_err_t ret = i2s_del_channel(s_rx_chan);
     s_rx_chan = NULL; // 将句柄设为NULL，防止悬空指针
+
+    if (s_raw_buf) {
+        heap_caps_free(s_raw_buf);
+        s_raw_buf = NULL;
+        s_raw_buf_size = 0;
+    }
+    s_is_32bit = false;
+    s_use_callback = false;
+    s_has_cur = false;
+    s_cap_task = NULL;
+    return ret;
+}
+
+/**
+ * @brief 回调模式下的读取：直接从已完成的DMA缓冲区转换/拷贝到 dest
+ */
+static esp_err_t inmp441_i2s_read_from_dma(void *dest, size_t size, size_t *bytes_read, TickType_t ticks_to_wait)
+{
+    // 32位模式下一个输出采样（2字节）对应一个原始采样（4字节）
+    const size_t raw_per_out = s_is_32bit ? 2 : 1;
+    size_t out = 0;
+    size &= ~(size_t)(sizeof(int16_t) - 1);
+    esp_err_t ret = ESP_OK;
+
+    while (out < size) {
+        // 1.取下一个已完成的DMA缓冲区
+        if (!s_has_cur) {
+            ret = inmp441_i2s_acquire_dma_buf(&s_cur_buf, ticks_to_wait);
+            if (ret != ESP_OK) {
+                break;
+            }
+            s_cur_off = 0;
+            s_has_cur = true;
+        }
+
+        // 2.转换或拷贝，长度取 DMA 剩余数据和 dest 剩余空间的较小值
+        size_t raw_left = s_cur_buf.size - s_cur_off;
+        size_t n_out = (size - out) < raw_left / raw_per_out ? (size - out) : raw_left / raw_per_out;
+        const uint8_t *raw = (const uint8_t *)s_cur_buf.data + s_cur_off;
+        if (s_is_32bit) {
+            pcm_s32_to_s16(&s_dc, (const int32_t *)raw, (int16_t *)((uint8_t *)dest + out), n_out / sizeof(int16_t));
+        } else {
+            memcpy((uint8_t *)dest + out, raw, n_out);
+        }
+        out += n_out;
+        s_cur_off += n_out * raw_per_out;
+        // DMA完成时间对应缓冲区最后一个采样，往前推算已读到的位置
+        s_read_ts = s_cur_buf.timestamp_us -
+                    (int64_t)((s_cur_buf.size - s_cur_off) / s_raw_frame_bytes) * 1000000 / s_sample_rate;
+
+        // 3.当前DMA缓冲区用完后归还
+        if (s_cur_off + raw_per_out * sizeof(int16_t) > s_cur_buf.size) {
+            inmp441_i2s_release_dma_buf(&s_cur_buf);
+            s_has_cur = false;
+        }
+    }
+
+    // 4.读取返回时仍在排队的数据：队列中的DMA缓冲区 + 当前缓冲区未读的部分
+    portENTER_CRITICAL(&s_cap_lock);
+    uint32_t pending = (s_cap_head - s_cap_tail) * (uint32_t)(s_dma_layout.frame_num * s_raw_frame_bytes);
+    if (s_has_cur) {
+        pending += s_cur_buf.size - s_cur_off;
+    }
+    inmp441_update_buffered(pending);
+    portEXIT_CRITICAL(&s_cap_lock);
+
+    if (bytes_read) {
+        *bytes_read = out;
+    }
     return ret;
 }
 
+/**
+ * @brief 阻塞读取模式：记录读走的原始字节数和读取返回时排队的数据
+ */
+static void inmp441_i2s_account_read(size_t raw_bytes)
+{
+    portENTER_CRITICAL(&s_cap_lock);
+    s_rx_taken += raw_bytes;
+    uint32_t pending = s_rx_avail - s_rx_taken;
+    if ((int32_t)pending < 0) {
+        // i2s_channel_read 可能先于计数回调拿到刚完成的缓冲区
+        pending = 0;
+    }
+    inmp441_update_buffered(pending);
+    portEXIT_CRITICAL(&s_cap_lock);
+}
+
 /**
  * @brief 从 INMP441 读取I2S数据
  */
@@ -126,5 +357,136 @@ esp_err_t inmp441_i2s_read(void *dest, size_t size, size_t *bytes_read, TickType
         ESP_LOGE(TAG, "I2S driver is not initialized.");
         return ESP_ERR_INVALID_STATE;
     }
-    return i2s_channel_read(s_rx_chan, dest, size, bytes_read, ticks_to_wait);
+    if (s_use_callback) {
+        return inmp441_i2s_read_from_dma(dest, size, bytes_read, ticks_to_wait);
+    }
+    if (!s_is_32bit) {
+        size_t raw_read = 0;
+        esp_err_t ret = i2s_channel_read(s_rx_chan, dest, size, &raw_read, ticks_to_wait);
+        s_read_ts = esp_timer_get_time();
+        inmp441_i2s_account_read(raw_read);
+        if (bytes_read) {
+            *bytes_read = raw_read;
+        }
+        return ret;
+    }
+
+    // 32位模式：每个16位输出采样对应一个32位原始采样
+    size_t raw_size = size * 2;
+    if (raw_size > s_raw_buf_size) {
+        heap_caps_free(s_raw_buf);
+        s_raw_buf = (int32_t *)heap_caps_aligned_alloc(16, raw_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (s_raw_buf == NULL) {
+            s_raw_buf_size = 0;
+            ESP_LOGE(TAG, "Failed to allocate raw buffer (%d bytes)", (int)raw_size);
+            return ESP_ERR_NO_MEM;
+        }
+        s_raw_buf_size = raw_size;
+    }
+
+    size_t raw_read = 0;
+    esp_err_t ret = i2s_channel_read(s_rx_chan, s_raw_buf, raw_size, &raw_read, ticks_to_wait);
+    s_read_ts = esp_timer_get_time();
+    inmp441_i2s_account_read(raw_read);
+    int samples = raw_read / sizeof(int32_t);
+    pcm_s32_to_s16(&s_dc, s_raw_buf, (int16_t *)dest, samples);
+    if (bytes_read) {
+        *bytes_read = samples * sizeof(int16_t);
+    }
+    return ret;
+}
+
+int64_t inmp441_i2s_get_read_timestamp(void)
+{
+    return s_read_ts;
+}
+
+/**
+ * @brief 获取一个已完成的DMA缓冲区
+ */
+esp_err_t inmp441_i2s_acquire_dma_buf(inmp441_dma_buf_t *buf, TickType_t ticks_to_wait)
+{
+    if (s_rx_chan == NULL || !s_use_callback || buf == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_cap_task = xTaskGetCurrentTaskHandle();
+
+    while (1) {
+        // 1.先看环形队列中是否已有数据
+        bool got = false;
+        portENTER_CRITICAL(&s_cap_lock);
+        while (s_cap_tail != s_cap_head) {
+            *buf = s_cap_ring[s_cap_tail % I2S_LATENCY_MAX_DESC_NUM];
+            s_cap_tail++;
+            // 排队期间已经被覆盖的缓冲区直接丢弃
+            if (inmp441_dma_buf_is_late(buf)) {
+                s_cap_stats.late++;
+                continue;
+            }
+            got = true;
+            break;
+        }
+        portEXIT_CRITICAL(&s_cap_lock);
+
+        if (got) {
+            uint32_t latency_us = (uint32_t)(esp_timer_get_time() - buf->timestamp_us);
+            s_cap_stats.delivered++;
+            s_cap_stats.latency_avg_us = (s_cap_stats.latency_avg_us * 15 + latency_us) / 16;
+            if (latency_us > s_cap_stats.latency_max_us) {
+                s_cap_stats.latency_max_us = latency_us;
+            }
+            return ESP_OK;
+        }
+
+        // 2.等待中断通知（通知计数可能多于队列中的缓冲区，所以取到通知后回到第1步重新检查）
+        if (ulTaskNotifyTake(pdTRUE, ticks_to_wait) == 0) {
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+}
+
+/**
+ * @brief 归还DMA缓冲区
+ */
+esp_err_t inmp441_i2s_release_dma_buf(const inmp441_dma_buf_t *buf)
+{
+    if (buf == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (inmp441_dma_buf_is_late(buf)) {
+        s_cap_stats.late++;
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief 获取回调采集模式的统计信息
+ */
+esp_err_t inmp441_i2s_get_capture_stats(inmp441_capture_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&s_cap_lock);
+    *stats = s_cap_stats;
+    portEXIT_CRITICAL(&s_cap_lock);
+    return ESP_OK;
+}
+
+/**
+ * @brief 获取DMA缓冲延迟统计
+ */
+esp_err_t inmp441_i2s_get_latency_stats(i2s_latency_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&s_cap_lock);
+    *stats = s_lat_stats;
+    if (s_use_callback) {
+        stats->overruns = s_cap_stats.dropped + s_cap_stats.late;
+    }
+    portEXIT_CRITICAL(&s_cap_lock);
+    return ESP_OK;
 }
@@ -1,18 +1,58 @@
 #include "max98357_i2s.h"
 #include "freertos/FreeRTOS.h"
 #include "esp_log.h"
+#include "esp_attr.h"
 #include "driver/i2s_std.h"
 #include <string.h>
 
-// I2S DMA 缓冲区配置
-#define DMA_DESC_NUM  4
-#define DMA_FRAME_NUM 512
-
 static const char *TAG = "MAX98357_DRIVER";
 
 // 模块级静态变量，用于保存I2S发送通道句柄
 static i2s_chan_handle_t s_tx_chan = NULL;
 
+// DMA发送完成回调
+static max98357_sent_cb_t s_on_sent = NULL;
+static void *s_on_sent_ctx = NULL;
+
+// DMA缓冲区布局和推算时长所需的格式信息
+static i2s_dma_layout_t s_dma_layout;
+static int s_sample_rate = 16000;
+static size_t s_frame_bytes = 2;    // 一个采样帧（所有通道）的字节数
+
+// 延迟统计：已写入和已播出的有效数据字节数，两者之差为DMA中排队的数据
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_tx_written = 0;
+static uint32_t s_tx_played = 0;
+static i2s_latency_stats_t s_lat_stats;
+
+static bool IRAM_ATTR max98357_on_sent(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx)
+{
+    // 1.发送完的缓冲区里的有效数据计为已播出；排队的数据在这个缓冲区内耗尽说明下一个缓冲区是静音
+    portENTER_CRITICAL_ISR(&s_stats_lock);
+    uint32_t pending = s_tx_written - s_tx_played;
+    uint32_t ring_bytes = s_dma_layout.desc_num * s_dma_layout.frame_num * s_frame_bytes;
+    if (pending > ring_bytes) {
+        // 写入分片与DMA之间的竞争导致的计数偏差，排队数据不可能超过整个DMA环
+        s_tx_played = s_tx_written - ring_bytes;
+        pending = ring_bytes;
+    }
+    if (pending > 0) {
+        if (pending <= event->size) {
+            s_tx_played += pending;
+            s_lat_stats.underruns++;
+        } else {
+            s_tx_played += event->size;
+        }
+    }
+    portEXIT_CRITICAL_ISR(&s_stats_lock);
+
+    // 2.用户回调
+    if (s_on_sent) {
+        return s_on_sent(event->dma_buf, event->size, s_on_sent_ctx);
+    }
+    return false;
+}
+
 /**
  * @brief 初始化 MAX98357 I2S 驱动
  */
@@ -30,10 +70,18 @@ esp_err_t max98357_i2s_init(const max98357_i2s_config_t *config)
 
     ESP_LOGI(TAG, "Initializing MAX98357 I2S driver...");
 
-    // 2. 配置I2S通道（使用1号I2S）
+    // 2. 配置I2S通道（使用1号I2S），DMA缓冲区按延迟档位和每次写入的长度推算
+    s_sample_rate = config->sample_rate;
+    s_frame_bytes = (config->bits_per_sample / 8) * ((config->channel_mode == MAX98357_CHANNEL_STEREO) ? 2 : 1);
+    esp_err_t ret = i2s_latency_get_dma_layout(config->latency_profile, config->dma_chunk_samples, s_frame_bytes, &s_dma_layout);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Invalid DMA configuration");
+        return ret;
+    }
     i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_1, I2S_ROLE_MASTER);
-    chan_cfg.dma_desc_num = DMA_DESC_NUM;
-    chan_cfg.dma_frame_num = DMA_FRAME_NUM;
+    chan_cfg.dma_desc_num = s_dma_layout.desc_num;
+    chan_cfg.dma_frame_num = s_dma_layout.frame_num;
+    chan_cfg.auto_clear = true; // 没有新数据时输出静音，而不是重复播放DMA中的旧数据
     ESP_ERROR_CHECK(i2s_new_channel(&chan_cfg, &s_tx_chan, NULL)); // 创建 TX 通道
 
     // 3. 配置I2S标准模式
@@ -70,7 +118,7 @@ esp_err_t max98357_i2s_init(const max98357_i2s_config_t *config)
     }
 
     // 4. 初始化I2S标准模式
-    esp_err_t ret = i2s_channel_init_std_mode(s_tx_chan, &std_cfg);
+    ret = i2s_channel_init_std_mode(s_tx_chan, &std_cfg);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to init std mode: %s", esp_err_to_name(ret));
         i2s_del_channel(s_tx_chan);
@@ -78,7 +126,27 @@ esp_err_t max98357_i2s_init(const max98357_i2s_config_t *config)
         return ret;
     }
 
-    // 5. 启动发送
+    // 5. 注册DMA发送完成回调（必须在 enable 之前），延迟统计和用户回调共用
+    s_on_sent = config->on_sent;
+    s_on_sent_ctx = config->on_sent_ctx;
+    s_tx_written = s_tx_played = 0;
+    memset(&s_lat_stats, 0, sizeof(s_lat_stats));
+    s_lat_stats.desc_num = s_dma_layout.desc_num;
+    s_lat_stats.frame_num = s_dma_layout.frame_num;
+    s_lat_stats.dma_buffer_us = (uint32_t)((int64_t)s_dma_layout.desc_num * s_dma_layout.frame_num * 1000000 / s_sample_rate);
+    i2s_event_callbacks_t cbs = {
+        .on_sent = max98357_on_sent,
+    };
+    ret = i2s_channel_register_event_callback(s_tx_chan, &cbs, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register sent callback: %s", esp_err_to_name(ret));
+        i2s_del_channel(s_tx_chan);
+        s_tx_chan = NULL;
+        s_on_sent = NULL;
+        return ret;
+    }
+
+    // 6. 启动发送
     ret = i2s_channel_enable(s_tx_chan);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to enable channel: %s", esp_err_to_name(ret));
@@ -87,7 +155,9 @@ esp_err_t max98357_i2s_init(const max98357_i2s_config_t *config)
         return ret;
     }
 
-    ESP_LOGI(TAG, "I2S TX driver initialized successfully.");
+    ESP_LOGI(TAG, "I2S TX driver initialized successfully (%s, DMA %d x %d frames, %d ms).",
+             i2s_latency_profile_name(config->latency_profile), s_dma_layout.desc_num, s_dma_layout.frame_num,
+             (int)(s_lat_stats.dma_buffer_us / 1000));
     return ESP_OK;
 }
 
@@ -104,6 +174,8 @@ esp_err_t max98357_i2s_close(void)
     i2s_channel_disable(s_tx_chan);
     esp_err_t ret = i2s_del_channel(s_tx_chan);
     s_tx_chan = NULL;
+    s_on_sent = NULL;
+    s_on_sent_ctx = NULL;
     return ret;
 }
 
@@ -116,5 +188,66 @@ esp_err_t max98357_i2s_write(const void *src, size_t size, size_t *bytes_written
         ESP_LOGE(TAG, "I2S TX driver is not initialized.");
         return ESP_ERR_INVALID_STATE;
     }
-    return i2s_channel_write(s_tx_chan, src, size, bytes_written, ticks_to_wait);
+
+    // 1.按DMA缓冲区长度分片写入，每片写完立即计入已写入，避免大块写入期间已经播出的数据没有被统计
+    const size_t piece_max = s_dma_layout.frame_num * s_frame_bytes;
+    const uint8_t *p = (const uint8_t *)src;
+    size_t total = 0;
+    esp_err_t ret = ESP_OK;
+    while (total < size) {
+        size_t piece = (size - total) < piece_max ? (size - total) : piece_max;
+        size_t written = 0;
+        ret = i2s_channel_write(s_tx_chan, p + total, piece, &written, ticks_to_wait);
+        portENTER_CRITICAL(&s_stats_lock);
+        s_tx_written += written;
+        portEXIT_CRITICAL(&s_stats_lock);
+        total += written;
+        if (ret != ESP_OK || written < piece) {
+            break;
+        }
+    }
+    if (bytes_written) {
+        *bytes_written = total;
+    }
+
+    // 2.写入返回时DMA中排队的数据即扬声器一侧的缓冲延迟
+    portENTER_CRITICAL(&s_stats_lock);
+    uint32_t pending = s_tx_written - s_tx_played;
+    uint32_t buffered_us = (uint32_t)((int64_t)pending / s_frame_bytes * 1000000 / s_sample_rate);
+    s_lat_stats.buffered_us = buffered_us;
+    s_lat_stats.buffered_avg_us = (s_lat_stats.buffered_avg_us * 15 + buffered_us) / 16;
+    if (buffered_us > s_lat_stats.buffered_max_us) {
+        s_lat_stats.buffered_max_us = buffered_us;
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+    return ret;
+}
+
+/**
+ * @brief 获取DMA缓冲区布局
+ */
+esp_err_t max98357_i2s_get_dma_layout(i2s_dma_layout_t *layout)
+{
+    if (layout == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_tx_chan == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *layout = s_dma_layout;
+    return ESP_OK;
+}
+
+/**
+ * @brief 获取DMA缓冲延迟统计
+ */
+esp_err_t max98357_i2s_get_latency_stats(i2s_latency_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&s_stats_lock);
+    *stats = s_lat_stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+    return ESP_OK;
 }
@@ -0,0 +1,401 @@
+#include "opus_downlink.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include <string.h>
+
+#include "opus.h"
+#include "audio_player.h"
+
+static const char *TAG = "OPUS_DOWNLINK";
+
+#define OPUS_DL_TASK_STACK_SIZE (4 * 1024)     // libopus 解码（含 PLC）的栈占用在3KB左右
+#define OPUS_DL_MAX_FRAME_MS    120             // Opus 单个包的最大时长
+#define OPUS_DL_STATS_LOG_MS    10000           // 统计日志间隔
+#define OPUS_DL_STOP_TIMEOUT_MS 500
+
+typedef struct {
+    uint8_t    *data;
+    uint16_t    len;
+    bool        has_seq;
+    uint32_t    seq;
+} opus_dl_packet_t;
+
+static opus_downlink_config_t s_cfg;
+
+// 包池：空闲队列 + 待解码队列（都存放 opus_dl_packet_t*）
+static opus_dl_packet_t *s_packets = NULL;
+static uint8_t *s_packet_mem = NULL;
+static QueueHandle_t s_free_que = NULL;
+static QueueHandle_t s_ready_que = NULL;
+
+// 解码器状态和输出缓冲区，只由解码任务访问
+static OpusDecoder *s_dec = NULL;
+static int16_t *s_pcm = NULL;
+static int s_pcm_max = 0;               // s_pcm 能容纳的采样数
+static int s_frame_samples = 0;         // 最近一个包的帧长（采样数），PLC 按这个长度生成
+static bool s_has_seq = false;
+static uint32_t s_next_seq = 0;
+
+// 保护网络任务写入与解码任务退出时的资源释放，只创建一次
+static SemaphoreHandle_t s_lock = NULL;
+
+static volatile bool s_reset_req = false;
+static volatile bool s_running = false;
+static TaskHandle_t s_task = NULL;
+static opus_downlink_stats_t s_stats;
+static uint64_t s_busy_us = 0;          // 当前统计周期内的解码耗时
+
+static void opus_dl_free(void)
+{
+    if (s_ready_que) {
+        vQueueDelete(s_ready_que);
+        s_ready_que = NULL;
+    }
+    if (s_free_que) {
+        vQueueDelete(s_free_que);
+        s_free_que = NULL;
+    }
+    heap_caps_free(s_packet_mem);
+    s_packet_mem = NULL;
+    free(s_packets);
+    s_packets = NULL;
+    heap_caps_free(s_dec);
+    s_dec = NULL;
+    heap_caps_free(s_pcm);
+    s_pcm = NULL;
+}
+
+/**
+ * @brief 解码一帧并放入播放器
+ *
+ * @param data       Opus 包，NULL 表示 PLC
+ * @param len        包长度
+ * @param frame_size 输出采样数上限（PLC/FEC 时必须等于缺失帧的长度）
+ * @param fec        1 表示用 data 中的带内 FEC 恢复前一帧
+ * @return 解码出的采样数，失败时为负的 libopus 错误码
+ */
+static int opus_dl_decode(const uint8_t *data, int len, int frame_size, int fec)
+{
+    int64_t t0 = esp_timer_get_time();
+    uint32_t start = esp_cpu_get_cycle_count();
+    int samples = opus_decode(s_dec, data, len, s_pcm, frame_size, fec);
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    s_busy_us += esp_timer_get_time() - t0;
+
+    if (samples <= 0) {
+        return samples;
+    }
+    s_stats.decode_cycles_avg = (s_stats.decode_cycles_avg * 15 + cycles) / 16;
+    audio_player_enqueue(s_pcm, samples * sizeof(int16_t));
+    return samples;
+}
+
+/**
+ * @brief 补偿序号空洞：前面的帧用 PLC，最后一帧用当前包的带内 FEC
+ */
+static void opus_dl_fill_gap(const opus_dl_packet_t *pkt, int gap)
+{
+    int frame_size = opus_packet_get_nb_samples(pkt->data, pkt->len, s_cfg.sample_rate);
+    if (frame_size <= 0 || frame_size > s_pcm_max) {
+        frame_size = s_frame_samples;
+    }
+    for (int i = 0; i < gap - 1; i++) {
+        if (opus_dl_decode(NULL, 0, s_frame_samples, 0) > 0) {
+            s_stats.concealed++;
+        }
+    }
+    // 包内没有 FEC 数据时 libopus 退化为 PLC
+    if (opus_dl_decode(pkt->data, pkt->len, frame_size, 1) > 0) {
+        s_stats.fec_recovered++;
+    }
+}
+
+static void opus_dl_log_stats(int64_t elapsed_us)
+{
+    s_stats.cpu_load_permille = elapsed_us > 0 ? (uint32_t)(s_busy_us * 1000 / elapsed_us) : 0;
+    s_busy_us = 0;
+    ESP_LOGI(TAG, "packets=%lu decoded=%lu concealed=%lu fec=%lu late=%lu overflow=%lu errors=%lu decode avg=%lu cycles cpu=%lu.%lu%%",
+             (unsigned long)s_stats.packets, (unsigned long)s_stats.decoded, (unsigned long)s_stats.concealed,
+             (unsigned long)s_stats.fec_recovered, (unsigned long)s_stats.late_dropped,
+             (unsigned long)s_stats.overflow_dropped, (unsigned long)s_stats.decode_errors,
+             (unsigned long)s_stats.decode_cycles_avg,
+             (unsigned long)(s_stats.cpu_load_permille / 10), (unsigned long)(s_stats.cpu_load_permille % 10));
+}
+
+static void opus_dl_task(void *arg)
+{
+    bool in_stream = false;     // 正在播放一段语音（收到过包，且还没有因为长时间无包而结束）
+    int plc_run = 0;            // 连续补偿的帧数
+    int64_t window_us = esp_timer_get_time();
+    const TickType_t frame_ticks = pdMS_TO_TICKS(s_cfg.frame_ms) ? pdMS_TO_TICKS(s_cfg.frame_ms) : 1;
+
+    while (s_running) {
+        int64_t now = esp_timer_get_time();
+        if (now - window_us > OPUS_DL_STATS_LOG_MS * 1000LL) {
+            opus_dl_log_stats(now - window_us);
+            window_us = now;
+        }
+        if (s_reset_req) {
+            s_reset_req = false;
+            opus_decoder_ctl(s_dec, OPUS_RESET_STATE);
+            s_has_seq = false;
+            in_stream = false;
+            plc_run = 0;
+        }
+
+        opus_dl_packet_t *pkt = NULL;
+        if (xQueueReceive(s_ready_que, &pkt, frame_ticks) == pdTRUE) {
+            // 1.序号检查：迟到的包丢弃，空洞用 PLC/FEC 补上（空洞太大视为新的一段语音，直接重置解码器）
+            if (pkt->has_seq) {
+                if (s_has_seq) {
+                    int32_t gap = (int32_t)(pkt->seq - s_next_seq);
+                    if (gap < 0) {
+                        s_stats.late_dropped++;
+                        xQueueSend(s_free_que, &pkt, 0);
+                        continue;
+                    }
+                    if (gap > OPUS_DOWNLINK_PLC_MAX_FRAMES || (gap > 0 && !in_stream)) {
+                        opus_decoder_ctl(s_dec, OPUS_RESET_STATE);
+                    } else if (gap > 0) {
+                        opus_dl_fill_gap(pkt, gap);
+                    }
+                }
+                s_has_seq = true;
+                s_next_seq = pkt->seq + 1;
+            }
+
+            // 2.解码当前包
+            int samples = opus_dl_decode(pkt->data, pkt->len, s_pcm_max, 0);
+            xQueueSend(s_free_que, &pkt, 0);
+            if (samples > 0) {
+                s_stats.decoded++;
+                s_frame_samples = samples;
+                in_stream = true;
+                plc_run = 0;
+            } else {
+                s_stats.decode_errors++;
+                ESP_LOGD(TAG, "Decode failed: %s", opus_strerror(samples));
+            }
+            continue;
+        }
+
+        // 3.没有包到达：播放中且抖动缓冲不足一帧时补偿一帧，占用这一帧的序号（之后到达的这个包按迟到丢弃）
+        if (!in_stream) {
+            continue;
+        }
+        audio_player_stats_t player;
+        if (audio_player_get_stats(&player) != ESP_OK || player.depth_ms > (uint32_t)s_cfg.frame_ms) {
+            continue;
+        }
+        if (opus_dl_decode(NULL, 0, s_frame_samples, 0) > 0) {
+            s_stats.concealed++;
+        }
+        s_next_seq++;
+        if (++plc_run >= OPUS_DOWNLINK_PLC_MAX_FRAMES) {
+            // 一段语音结束：退回尾部补偿占用的序号，服务器的下一段语音从 last_seq + 1 继续，不能按迟到丢弃
+            s_next_seq -= plc_run;
+            in_stream = false;
+        }
+    }
+
+    // 退出前释放解码器和包池，持锁防止网络任务同时写入
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    opus_dl_free();
+    xSemaphoreGive(s_lock);
+
+    s_task = NULL;
+    ESP_LOGI(TAG, "[opus_dl_task] finished");
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief 启动解码任务
+ */
+esp_err_t opus_downlink_start(const opus_downlink_config_t *config)
+{
+    if (s_task != NULL) {
+        ESP_LOGW(TAG, "Opus downlink already started");
+        return ESP_OK;
+    }
+
+    opus_downlink_config_t def = OPUS_DOWNLINK_DEFAULT_CONFIG();
+    s_cfg = config ? *config : def;
+    if (s_cfg.frame_ms <= 0 || s_cfg.frame_ms > OPUS_DL_MAX_FRAME_MS || s_cfg.queue_packets <= 0) {
+        ESP_LOGE(TAG, "Invalid Opus downlink configuration");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (s_lock == NULL) {
+        s_lock = xSemaphoreCreateMutex();
+        if (s_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    // 1.解码器状态和输出缓冲区放在内部RAM（每帧都要访问）；包只拷贝一次、解码一次，放在PSRAM
+    int dec_size = opus_decoder_get_size(1);
+    s_dec = (OpusDecoder *)heap_caps_malloc(dec_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    s_pcm_max = s_cfg.sample_rate * OPUS_DL_MAX_FRAME_MS / 1000;
+    s_pcm = (int16_t *)heap_caps_malloc(s_pcm_max * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    s_packets = (opus_dl_packet_t *)calloc(s_cfg.queue_packets, sizeof(opus_dl_packet_t));
+    s_packet_mem = (uint8_t *)heap_caps_malloc(OPUS_DOWNLINK_MAX_PACKET * s_cfg.queue_packets, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (s_packet_mem == NULL) {
+        s_packet_mem = (uint8_t *)heap_caps_malloc(OPUS_DOWNLINK_MAX_PACKET * s_cfg.queue_packets, MALLOC_CAP_8BIT);
+    }
+    s_free_que = xQueueCreate(s_cfg.queue_packets, sizeof(opus_dl_packet_t *));
+    s_ready_que = xQueueCreate(s_cfg.queue_packets, sizeof(opus_dl_packet_t *));
+    if (!s_dec || !s_pcm || !s_packets || !s_packet_mem || !s_free_que || !s_ready_que) {
+        ESP_LOGE(TAG, "Failed to allocate Opus decoder (%d bytes) and packet pool", dec_size);
+        opus_dl_free();
+        return ESP_ERR_NO_MEM;
+    }
+    int err = opus_decoder_init(s_dec, s_cfg.sample_rate, 1);
+    if (err != OPUS_OK) {
+        ESP_LOGE(TAG, "opus_decoder_init(%d Hz) failed: %s", s_cfg.sample_rate, opus_strerror(err));
+        opus_dl_free();
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < s_cfg.queue_packets; i++) {
+        opus_dl_packet_t *pkt = &s_packets[i];
+        pkt->data = s_packet_mem + i * OPUS_DOWNLINK_MAX_PACKET;
+        xQueueSend(s_free_que, &pkt, 0);
+    }
+
+    // 2.重置统计和序号
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_busy_us = 0;
+    s_frame_samples = s_cfg.sample_rate * s_cfg.frame_ms / 1000;
+    s_has_seq = false;
+    s_reset_req = false;
+
+    // 3.创建解码任务
+    s_running = true;
+    if (xTaskCreatePinnedToCore(opus_dl_task, "opus_dl_task", OPUS_DL_TASK_STACK_SIZE, NULL,
+                                s_cfg.task_priority, &s_task, s_cfg.task_core) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create Opus decode task");
+        s_running = false;
+        s_task = NULL;
+        opus_dl_free();
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Opus downlink started: %d Hz, frame %d ms, pool %d packets, decoder %d bytes",
+             s_cfg.sample_rate, s_cfg.frame_ms, s_cfg.queue_packets, dec_size);
+    return ESP_OK;
+}
+
+/**
+ * @brief 停止解码任务
+ */
+esp_err_t opus_downlink_stop(void)
+{
+    if (s_task == NULL) {
+        return ESP_OK;
+    }
+    s_running = false;
+
+    // 等待解码任务退出（最多等一个帧长，或者一次解码）
+    for (int i = 0; i < OPUS_DL_STOP_TIMEOUT_MS / 10 && s_task != NULL; i++) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    if (s_task != NULL) {
+        ESP_LOGE(TAG, "Opus decode task did not exit in time");
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief 解码任务是否在运行
+ */
+bool opus_downlink_is_running(void)
+{
+    return s_running;
+}
+
+/**
+ * @brief 重置解码器
+ */
+void opus_downlink_reset(void)
+{
+    if (s_lock == NULL) {
+        return;
+    }
+    // 在调用者（网络任务）中清空待解码的包，解码器状态由解码任务自己重置
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_running && s_ready_que) {
+        opus_dl_packet_t *pkt = NULL;
+        while (xQueueReceive(s_ready_que, &pkt, 0) == pdTRUE) {
+            xQueueSend(s_free_que, &pkt, 0);
+        }
+        s_reset_req = true;
+    }
+    xSemaphoreGive(s_lock);
+}
+
+static esp_err_t opus_dl_push_locked(bool has_seq, uint32_t seq, const void *packet, size_t len)
+{
+    // 包池满：解码任务跟不上，丢弃最旧的包（PLC 会补上这一帧）
+    opus_dl_packet_t *pkt = NULL;
+    if (xQueueReceive(s_free_que, &pkt, 0) != pdTRUE) {
+        if (xQueueReceive(s_ready_que, &pkt, 0) != pdTRUE) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        s_stats.overflow_dropped++;
+    }
+    memcpy(pkt->data, packet, len);
+    pkt->len = (uint16_t)len;
+    pkt->has_seq = has_seq;
+    pkt->seq = seq;
+    xQueueSend(s_ready_que, &pkt, 0);
+    s_stats.packets++;
+    return ESP_OK;
+}
+
+static esp_err_t opus_dl_push(bool has_seq, uint32_t seq, const void *packet, size_t len)
+{
+    if (!s_running || s_lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (packet == NULL || len == 0 || len > OPUS_DOWNLINK_MAX_PACKET) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t ret = s_running ? opus_dl_push_locked(has_seq, seq, packet, len) : ESP_ERR_INVALID_STATE;
+    xSemaphoreGive(s_lock);
+    return ret;
+}
+
+/**
+ * @brief 放入一个 Opus 包
+ */
+esp_err_t opus_downlink_push(const void *packet, size_t len)
+{
+    return opus_dl_push(false, 0, packet, len);
+}
+
+/**
+ * @brief 放入一个带序号的 Opus 包
+ */
+esp_err_t opus_downlink_push_seq(uint32_t seq, const void *packet, size_t len)
+{
+    return opus_dl_push(true, seq, packet, len);
+}
+
+/**
+ * @brief 获取解码统计信息
+ */
+esp_err_t opus_downlink_get_stats(opus_downlink_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *stats = s_stats;
+    return ESP_OK;
+}
@@ -0,0 +1,152 @@
+#include "pcm_convert.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include <string.h>
+#include <math.h>
+
+static const char *TAG = "PCM_CONVERT";
+
+// 直流估计的更新速度：每帧向本帧均值靠近 1/2^DC_TRACK_SHIFT（32ms帧 -> 时间常数约0.5s）
+#define DC_TRACK_SHIFT      4
+// 直流估计抽样步长（偶数，保证单声道/双声道都取到同一通道）
+#define DC_SAMPLE_STRIDE    16
+
+static inline int16_t sat16(int32_t v)
+{
+    if (v > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (v < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return (int16_t)v;
+}
+
+void pcm_dc_block_init(pcm_dc_block_t *st, int channels, int gain_shift)
+{
+    memset(st, 0, sizeof(*st));
+    st->channels = (channels == 2) ? 2 : 1;
+    if (gain_shift < 0) {
+        gain_shift = 0;
+    } else if (gain_shift > PCM_CONVERT_MAX_GAIN_SHIFT) {
+        gain_shift = PCM_CONVERT_MAX_GAIN_SHIFT;
+    }
+    st->gain_shift = gain_shift;
+}
+
+void pcm_s32_to_s16_ansi(const int32_t *src, int16_t *dst, int samples, const int16_t *dc_pair, int gain_shift)
+{
+    for (int i = 0; i < samples; i++) {
+        int16_t s = sat16((src[i] >> 16) - dc_pair[i & 1]);
+        for (int g = 0; g < gain_shift; g++) {
+            s = sat16((int32_t)s + s);
+        }
+        dst[i] = s;
+    }
+}
+
+/**
+ * @brief 用抽样的输入更新直流估计（必须在转换之前调用，转换可能是原地的）
+ */
+static void pcm_dc_track(pcm_dc_block_t *st, const int32_t *src, int samples)
+{
+    for (int ch = 0; ch < st->channels; ch++) {
+        int32_t sum = 0;
+        int count = 0;
+        for (int i = ch; i < samples; i += DC_SAMPLE_STRIDE) {
+            sum += src[i] >> 16;
+            count++;
+        }
+        if (count == 0) {
+            continue;
+        }
+        int32_t mean_q8 = (sum << 8) / count;
+        st->dc_q8[ch] += (mean_q8 - st->dc_q8[ch]) >> DC_TRACK_SHIFT;
+        st->dc[ch] = (int16_t)(st->dc_q8[ch] >> 8);
+    }
+    if (st->channels == 1) {
+        st->dc[1] = st->dc[0];
+    }
+}
+
+void pcm_s32_to_s16(pcm_dc_block_t *st, const int32_t *src, int16_t *dst, int samples)
+{
+    pcm_dc_track(st, src, samples);
+
+#if pcm_convert_aes3_enabled
+    if ((((uintptr_t)src | (uintptr_t)dst) & 0xF) == 0 && (samples & 0x7) == 0) {
+        pcm_s32_to_s16_aes3(src, dst, samples, st->dc, st->gain_shift);
+        return;
+    }
+#endif
+    pcm_s32_to_s16_ansi(src, dst, samples, st->dc, st->gain_shift);
+}
+
+/**
+ * @brief 转换内核基准测试
+ */
+esp_err_t pcm_convert_benchmark(int samples, int rounds)
+{
+    samples &= ~0x7;
+    if (samples <= 0 || rounds <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int32_t *src = (int32_t *)heap_caps_aligned_alloc(16, samples * sizeof(int32_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    int16_t *out_ansi = (int16_t *)heap_caps_aligned_alloc(16, samples * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    int16_t *out_simd = (int16_t *)heap_caps_aligned_alloc(16, samples * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!src || !out_ansi || !out_simd) {
+        heap_caps_free(src);
+        heap_caps_free(out_ansi);
+        heap_caps_free(out_simd);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // 1.构造测试信号：1kHz正弦 + 直流偏置，幅度接近满量程以覆盖饱和路径
+    for (int i = 0; i < samples; i++) {
+        float v = 0.9f * sinf(2.0f * (float)M_PI * 1000.0f * i / 16000.0f) + 0.05f;
+        src[i] = (int32_t)(v * 2147483647.0f) & ~0xFF;  // 24位有效数据左对齐
+    }
+    const int16_t dc_pair[2] __attribute__((aligned(4))) = {1638, 1638};
+
+    esp_err_t ret = ESP_OK;
+    for (int gain = 0; gain <= PCM_CONVERT_MAX_GAIN_SHIFT; gain++) {
+        // 2.标量实现
+        uint32_t start = esp_cpu_get_cycle_count();
+        for (int r = 0; r < rounds; r++) {
+            pcm_s32_to_s16_ansi(src, out_ansi, samples, dc_pair, gain);
+        }
+        uint32_t ansi_cycles = (esp_cpu_get_cycle_count() - start) / rounds;
+
+        // 3.向量实现
+        uint32_t simd_cycles = 0;
+#if pcm_convert_aes3_enabled
+        start = esp_cpu_get_cycle_count();
+        for (int r = 0; r < rounds; r++) {
+            pcm_s32_to_s16_aes3(src, out_simd, samples, dc_pair, gain);
+        }
+        simd_cycles = (esp_cpu_get_cycle_count() - start) / rounds;
+
+        if (memcmp(out_ansi, out_simd, samples * sizeof(int16_t)) != 0) {
+            ESP_LOGE(TAG, "gain_shift=%d: aes3 output differs from ansi reference", gain);
+            ret = ESP_FAIL;
+        }
+#endif
+
+        // 4.每帧周期数，以及在16kHz实时流中占用的CPU比例
+        float frame_ms = samples * 1000.0f / 16000.0f;
+        float cycles_per_ms = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ * 1000.0f;
+        ESP_LOGI(TAG, "gain_shift=%d, %d samples/frame: ansi %lu cycles (%.3f%% CPU), aes3 %lu cycles (%.3f%% CPU), speedup x%.2f",
+                 gain, samples,
+                 (unsigned long)ansi_cycles, 100.0f * ansi_cycles / (cycles_per_ms * frame_ms),
+                 (unsigned long)simd_cycles, 100.0f * simd_cycles / (cycles_per_ms * frame_ms),
+                 simd_cycles ? (float)ansi_cycles / simd_cycles : 0.0f);
+    }
+
+    heap_caps_free(src);
+    heap_caps_free(out_ansi);
+    heap_caps_free(out_simd);
+    return ret;
+}
@@ -0,0 +1,568 @@
+#include "resampler.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include <string.h>
+#include <math.h>
+
+#include "dsps_fir.h"
+#include "dsps_dotprod.h"
+
+static const char *TAG = "RESAMPLER";
+
+#define RS_TAPS_PER_PHASE   16      // 每相抽头数
+#define RS_INTERP_PHASES    64      // 任意比例时的滤波器组相数
+#define RS_KAISER_BETA      7.0f    // Kaiser窗参数（阻带约 -70dB）
+#define RS_CUTOFF           0.9f    // 通带截止频率，相对于输入/输出中较低的奈奎斯特频率
+#define RS_S16_GAIN         0.95f   // 定点系数留出余量，防止吉布斯过冲导致 int16 回绕
+#define RS_CHUNK            256     // 每次内部处理的最大输入采样数
+#define RS_BANK_CACHE_SIZE  4       // 缓存的滤波器组数量
+
+typedef enum {
+    RS_MODE_BYPASS,         // 输入输出采样率相同
+    RS_MODE_DECIM_S16,      // 整数倍抽取：dsps_fird_s16
+    RS_MODE_POLY_F32,       // 精确有理数比例：L 个 dsps_fird_f32 分支
+    RS_MODE_INTERP_F32,     // 任意比例：滤波器组 + 相位插值
+} rs_mode_t;
+
+/**
+ * @brief 缓存的多相滤波器组
+ */
+typedef struct {
+    bool        used;
+    rs_mode_t   mode;
+    int         L;
+    int         M;
+    int         phases;     // 分支数
+    int         taps;       // 每个分支的系数个数（已补齐到对齐要求）
+    void       *coeffs;     // phases * taps 个系数（int16_t 或 float），按内核要求的顺序存放
+    int         refcount;
+} rs_bank_t;
+
+struct resampler {
+    rs_mode_t   mode;
+    int         L;
+    int         M;
+    rs_bank_t  *bank;
+    int         carry;              // 输入缓冲区开头尚未处理的采样数
+    int         in_cap;             // 输入缓冲区容量（采样数）
+
+    // RS_MODE_DECIM_S16
+    fir_s16_t   fir_s16;
+    int16_t    *delay_s16;
+    int16_t    *in_s16;
+
+    // RS_MODE_POLY_F32
+    fir_f32_t   fir_f32[RESAMPLER_MAX_EXACT_PHASES];
+    float      *delay_f32;
+    float      *in_f32;             // RS_MODE_INTERP_F32 下为历史+新输入
+    float      *out_f32;
+
+    // RS_MODE_INTERP_F32
+    uint64_t    pos;                // 下一个输出对应的输入位置（Q32，以 in_f32 下标为单位）
+    uint64_t    step;               // 每个输出前进的输入采样数（Q32）
+};
+
+static rs_bank_t s_banks[RS_BANK_CACHE_SIZE];
+static SemaphoreHandle_t s_bank_lock = NULL;
+static portMUX_TYPE s_bank_lock_init = portMUX_INITIALIZER_UNLOCKED;
+
+static int rs_gcd(int a, int b)
+{
+    while (b) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static inline int16_t rs_sat16(float v)
+{
+    if (v > 32767.0f) {
+        return 32767;
+    }
+    if (v < -32768.0f) {
+        return -32768;
+    }
+    return (int16_t)lrintf(v);
+}
+
+/**
+ * @brief 第一类零阶修正贝塞尔函数（Kaiser窗）
+ */
+static float rs_bessel_i0(float x)
+{
+    float sum = 1.0f, term = 1.0f;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0f * k)) * (x / (2.0f * k));
+        sum += term;
+        if (term < 1e-9f * sum) {
+            break;
+        }
+    }
+    return sum;
+}
+
+/**
+ * @brief 设计Kaiser窗sinc低通原型（采样率为 phases * 输入采样率），每相直流增益归一化为1
+ *
+ * @param h        输出系数，长度 len
+ * @param len      原型长度
+ * @param phases   原型对应的上采样倍数
+ * @param fc       截止频率（相对原型采样率，单位：周期/采样）
+ */
+static void rs_design_prototype(float *h, int len, int phases, float fc)
+{
+    float center = (len - 1) * 0.5f;
+    float i0_beta = rs_bessel_i0(RS_KAISER_BETA);
+    float sum = 0.0f;
+    for (int k = 0; k < len; k++) {
+        float x = k - center;
+        float sinc = (x == 0.0f) ? 2.0f * fc : sinf(2.0f * (float)M_PI * fc * x) / ((float)M_PI * x);
+        float r = 2.0f * k / (len - 1) - 1.0f;
+        float win = rs_bessel_i0(RS_KAISER_BETA * sqrtf(fmaxf(0.0f, 1.0f - r * r))) / i0_beta;
+        h[k] = sinc * win;
+        sum += h[k];
+    }
+    for (int k = 0; k < len; k++) {
+        h[k] *= phases / sum;
+    }
+}
+
+/**
+ * @brief 生成滤波器组系数（按各内核要求的存放顺序）
+ */
+static esp_err_t rs_bank_build(rs_bank_t *bank, int in_rate, int out_rate)
+{
+    int proto_phases = (bank->mode == RS_MODE_INTERP_F32) ? RS_INTERP_PHASES : bank->L;
+    int min_rate = in_rate < out_rate ? in_rate : out_rate;
+    float fc = 0.5f * RS_CUTOFF * min_rate / ((float)in_rate * proto_phases);
+
+    // 1.原型长度：每相 RS_TAPS_PER_PHASE 个抽头；抽取模式下按 M 倍加长以保证过渡带宽度
+    int proto_len;
+    if (bank->mode == RS_MODE_DECIM_S16) {
+        proto_len = (RS_TAPS_PER_PHASE * bank->M + 7) & ~7;    // aes3 要求长度为8的倍数
+        bank->phases = 1;
+        bank->taps = proto_len;
+    } else if (bank->mode == RS_MODE_POLY_F32) {
+        proto_len = RS_TAPS_PER_PHASE * bank->L;
+        bank->phases = bank->L;
+        bank->taps = (RS_TAPS_PER_PHASE + bank->M - 1 + 3) & ~3;  // 加上分支偏移，补齐到4的倍数
+    } else {
+        proto_len = RS_TAPS_PER_PHASE * RS_INTERP_PHASES;
+        bank->phases = RS_INTERP_PHASES + 1;                        // 多一相用于相位插值
+        bank->taps = RS_TAPS_PER_PHASE;
+    }
+
+    // 原型后面补零，方便按相取系数时不越界
+    int h_len = proto_len + RS_INTERP_PHASES + 1;
+    float *h = (float *)calloc(h_len, sizeof(float));
+    if (h == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    rs_design_prototype(h, proto_len, proto_phases, fc);
+
+    size_t elem = (bank->mode == RS_MODE_DECIM_S16) ? sizeof(int16_t) : sizeof(float);
+    bank->coeffs = heap_caps_aligned_calloc(16, bank->phases * bank->taps, elem, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (bank->coeffs == NULL) {
+        free(h);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // 2.按内核的系数顺序分解
+    if (bank->mode == RS_MODE_DECIM_S16) {
+        // dsps_fird_s16：coeffs[k] 乘以最新往前第k个采样（Q15）；aes3 实现要求系数反序存放
+        int16_t *c = (int16_t *)bank->coeffs;
+        for (int k = 0; k < bank->taps; k++) {
+            c[k] = rs_sat16(h[k] * RS_S16_GAIN * 32767.0f);
+        }
+#if CONFIG_DSP_OPTIMIZED && dsps_fird_s16_aes3_enabled
+        dsps_16_array_rev(c, bank->taps);
+#endif
+    } else if (bank->mode == RS_MODE_POLY_F32) {
+        // 分支 r 输出 y[qL+r] = sum_j h[ph + jL] * x[qM + off - j]，ph = rM mod L，off = floor(rM/L)。
+        // dsps_fird_f32 第q个输出的最新采样是 x[(q+1)M-1]，所以系数整体延后 D = M-1-off 个采样；
+        // dsps_fird_f32 的 coeffs[0] 乘以最旧的采样，因此按时间反序存放。
+        for (int r = 0; r < bank->L; r++) {
+            float *c = (float *)bank->coeffs + r * bank->taps;
+            int ph = (r * bank->M) % bank->L;
+            int d = bank->M - 1 - (r * bank->M) / bank->L;
+            for (int k = 0; k < bank->taps; k++) {
+                int j = k - d;
+                float g = (j >= 0 && j < RS_TAPS_PER_PHASE) ? h[ph + j * bank->L] : 0.0f;
+                c[bank->taps - 1 - k] = g;
+            }
+        }
+    } else {
+        // 相 p 的输出 y = sum_j h[p + jP] * x[i - j]，按时间反序存放，与 x[i-T+1..i] 做点积
+        for (int p = 0; p < bank->phases; p++) {
+            float *c = (float *)bank->coeffs + p * bank->taps;
+            for (int j = 0; j < bank->taps; j++) {
+                int idx = p + j * RS_INTERP_PHASES;
+                c[bank->taps - 1 - j] = (idx < h_len) ? h[idx] : 0.0f;
+            }
+        }
+    }
+
+    free(h);
+    return ESP_OK;
+}
+
+/**
+ * @brief 从缓存中取滤波器组，没有则生成（缓存满时淘汰一个未使用的）
+ */
+static rs_bank_t *rs_bank_acquire(rs_mode_t mode, int L, int M, int in_rate, int out_rate)
+{
+    if (s_bank_lock == NULL) {
+        portENTER_CRITICAL(&s_bank_lock_init);
+        static StaticSemaphore_t lock_buf;
+        if (s_bank_lock == NULL) {
+            s_bank_lock = xSemaphoreCreateMutexStatic(&lock_buf);
+        }
+        portEXIT_CRITICAL(&s_bank_lock_init);
+    }
+
+    rs_bank_t *bank = NULL;
+    rs_bank_t *spare = NULL;
+    xSemaphoreTake(s_bank_lock, portMAX_DELAY);
+    for (int i = 0; i < RS_BANK_CACHE_SIZE; i++) {
+        rs_bank_t *b = &s_banks[i];
+        if (b->used && b->mode == mode && b->L == L && b->M == M) {
+            bank = b;
+            break;
+        }
+        // 优先用空位，其次淘汰没有被引用的
+        if (!b->used && (spare == NULL || spare->used)) {
+            spare = b;
+        } else if (b->used && b->refcount == 0 && spare == NULL) {
+            spare = b;
+        }
+    }
+
+    if (bank == NULL && spare != NULL) {
+        if (spare->used) {
+            heap_caps_free(spare->coeffs);
+            memset(spare, 0, sizeof(*spare));
+        }
+        spare->mode = mode;
+        spare->L = L;
+        spare->M = M;
+        if (rs_bank_build(spare, in_rate, out_rate) == ESP_OK) {
+            spare->used = true;
+            bank = spare;
+            ESP_LOGI(TAG, "Filter bank built: L=%d M=%d, %d phases x %d taps", L, M, bank->phases, bank->taps);
+        } else {
+            memset(spare, 0, sizeof(*spare));
+        }
+    }
+    if (bank) {
+        bank->refcount++;
+    }
+    xSemaphoreGive(s_bank_lock);
+    return bank;
+}
+
+static void rs_bank_release(rs_bank_t *bank)
+{
+    if (bank == NULL) {
+        return;
+    }
+    xSemaphoreTake(s_bank_lock, portMAX_DELAY);
+    bank->refcount--;
+    xSemaphoreGive(s_bank_lock);
+}
+
+/**
+ * @brief 创建重采样器
+ */
+esp_err_t resampler_create(int in_rate, int out_rate, resampler_handle_t *ret_handle)
+{
+    if (in_rate <= 0 || out_rate <= 0 || ret_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    resampler_handle_t rs = (resampler_handle_t)calloc(1, sizeof(struct resampler));
+    if (rs == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // 1.化简比例并选择实现
+    int g = rs_gcd(in_rate, out_rate);
+    rs->L = out_rate / g;
+    rs->M = in_rate / g;
+    if (rs->L == rs->M) {
+        rs->mode = RS_MODE_BYPASS;
+    } else if (rs->L == 1) {
+        rs->mode = RS_MODE_DECIM_S16;
+    } else if (rs->L <= RESAMPLER_MAX_EXACT_PHASES) {
+        rs->mode = RS_MODE_POLY_F32;
+    } else {
+        rs->mode = RS_MODE_INTERP_F32;
+    }
+    if (rs->mode == RS_MODE_BYPASS) {
+        *ret_handle = rs;
+        return ESP_OK;
+    }
+
+    // 2.取缓存的滤波器组
+    rs->bank = rs_bank_acquire(rs->mode, rs->L, rs->M, in_rate, out_rate);
+    if (rs->bank == NULL) {
+        free(rs);
+        return ESP_ERR_NO_MEM;
+    }
+    int taps = rs->bank->taps;
+
+    // 3.分配延迟线和输入缓冲区（aes3 要求16字节对齐）
+    const uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    bool ok = true;
+    rs->in_cap = RS_CHUNK + (rs->mode == RS_MODE_INTERP_F32 ? taps : rs->M);
+    if (rs->mode == RS_MODE_DECIM_S16) {
+        rs->delay_s16 = (int16_t *)heap_caps_aligned_calloc(16, taps, sizeof(int16_t), caps);
+        rs->in_s16 = (int16_t *)heap_caps_aligned_calloc(16, rs->in_cap, sizeof(int16_t), caps);
+        ok = rs->delay_s16 && rs->in_s16 &&
+             dsps_fird_init_s16(&rs->fir_s16, (int16_t *)rs->bank->coeffs, rs->delay_s16, taps, rs->M, 0, 0) == ESP_OK;
+    } else if (rs->mode == RS_MODE_POLY_F32) {
+        rs->delay_f32 = (float *)heap_caps_aligned_calloc(16, rs->L * taps, sizeof(float), caps);
+        rs->in_f32 = (float *)heap_caps_aligned_calloc(16, rs->in_cap, sizeof(float), caps);
+        rs->out_f32 = (float *)heap_caps_aligned_calloc(16, RS_CHUNK / rs->M + 2, sizeof(float), caps);
+        ok = rs->delay_f32 && rs->in_f32 && rs->out_f32;
+        for (int r = 0; ok && r < rs->L; r++) {
+            ok = dsps_fird_init_f32(&rs->fir_f32[r], (float *)rs->bank->coeffs + r * taps,
+                                    rs->delay_f32 + r * taps, taps, rs->M) == ESP_OK;
+        }
+    } else {
+        rs->in_f32 = (float *)heap_caps_aligned_calloc(16, rs->in_cap, sizeof(float), caps);
+        ok = rs->in_f32 != NULL;
+        rs->step = ((uint64_t)in_rate << 32) / out_rate;
+    }
+    if (!ok) {
+        ESP_LOGE(TAG, "Failed to create resampler %d -> %d", in_rate, out_rate);
+        resampler_destroy(rs);
+        return ESP_ERR_NO_MEM;
+    }
+
+    resampler_reset(rs);
+    ESP_LOGI(TAG, "Resampler %d -> %d Hz (L=%d, M=%d, mode=%d)", in_rate, out_rate, rs->L, rs->M, rs->mode);
+    *ret_handle = rs;
+    return ESP_OK;
+}
+
+/**
+ * @brief 销毁重采样器
+ */
+void resampler_destroy(resampler_handle_t rs)
+{
+    if (rs == NULL) {
+        return;
+    }
+    if (rs->mode == RS_MODE_DECIM_S16 && rs->delay_s16 && rs->in_s16) {
+        dsps_fird_s16_aexx_free(&rs->fir_s16);
+    }
+    heap_caps_free(rs->delay_s16);
+    heap_caps_free(rs->in_s16);
+    heap_caps_free(rs->delay_f32);
+    heap_caps_free(rs->in_f32);
+    heap_caps_free(rs->out_f32);
+    rs_bank_release(rs->bank);
+    free(rs);
+}
+
+/**
+ * @brief 清空内部状态
+ */
+void resampler_reset(resampler_handle_t rs)
+{
+    if (rs == NULL || rs->bank == NULL) {
+        return;
+    }
+    int taps = rs->bank->taps;
+    rs->carry = 0;
+    if (rs->mode == RS_MODE_DECIM_S16) {
+        memset(rs->fir_s16.delay, 0, rs->fir_s16.coeffs_len * sizeof(int16_t));
+        rs->fir_s16.pos = 0;
+        rs->fir_s16.d_pos = 0;
+    } else if (rs->mode == RS_MODE_POLY_F32) {
+        memset(rs->delay_f32, 0, rs->L * taps * sizeof(float));
+        for (int r = 0; r < rs->L; r++) {
+            rs->fir_f32[r].pos = 0;
+        }
+    } else {
+        // 历史缓冲区开头保留 taps-1 个（初始为0的）旧采样
+        memset(rs->in_f32, 0, (taps - 1) * sizeof(float));
+        rs->carry = taps - 1;
+        rs->pos = (uint64_t)(taps - 1) << 32;
+    }
+}
+
+int resampler_get_max_output(resampler_handle_t rs, int in_samples)
+{
+    if (rs->mode == RS_MODE_BYPASS) {
+        return in_samples;
+    }
+    return (int)(((int64_t)in_samples + rs->M) * rs->L / rs->M) + rs->L;
+}
+
+/**
+ * @brief 任意比例：对历史缓冲区中的每个输出位置，在相邻两相之间插值
+ */
+static int rs_process_interp(resampler_handle_t rs, int avail, int16_t *out, int out_max)
+{
+    const int taps = rs->bank->taps;
+    const float *bank = (const float *)rs->bank->coeffs;
+    int n = 0;
+
+    while ((int)(rs->pos >> 32) < avail && n < out_max) {
+        int i = (int)(rs->pos >> 32);
+        uint64_t frac_p = (rs->pos & 0xFFFFFFFFull) * RS_INTERP_PHASES;    // Q32 相位
+        int p = (int)(frac_p >> 32);
+        float alpha = (float)(uint32_t)frac_p * (1.0f / 4294967296.0f);
+
+        const float *x = rs->in_f32 + i - taps + 1;
+        float y0, y1;
+        dsps_dotprod_f32(bank + p * taps, x, &y0, taps);
+        dsps_dotprod_f32(bank + (p + 1) * taps, x, &y1, taps);
+        out[n++] = rs_sat16(y0 + alpha * (y1 - y0));
+        rs->pos += rs->step;
+    }
+
+    // 丢弃不再需要的采样，保留 taps-1 个历史
+    int drop = avail - (taps - 1);
+    if ((int)(rs->pos >> 32) < drop) {
+        drop = (int)(rs->pos >> 32) - (taps - 1);
+    }
+    if (drop > 0) {
+        memmove(rs->in_f32, rs->in_f32 + drop, (avail - drop) * sizeof(float));
+        rs->pos -= (uint64_t)drop << 32;
+        rs->carry = avail - drop;
+    } else {
+        rs->carry = avail;
+    }
+    return n;
+}
+
+/**
+ * @brief 处理一段输入
+ */
+int resampler_process(resampler_handle_t rs, const int16_t *in, int in_samples, int16_t *out, int out_max)
+{
+    if (rs->mode == RS_MODE_BYPASS) {
+        int n = in_samples < out_max ? in_samples : out_max;
+        memcpy(out, in, n * sizeof(int16_t));
+        return n;
+    }
+
+    int out_n = 0;
+    while (in_samples > 0) {
+        // 1.新输入追加到上次剩余的采样后面（输入缓冲区对齐，满足 aes3 的要求）
+        int n = rs->in_cap - rs->carry;
+        if (n <= 0) {
+            // 输出缓冲区已满，剩余输入丢弃
+            break;
+        }
+        if (n > in_samples) {
+            n = in_samples;
+        }
+        int total = rs->carry + n;
+
+        if (rs->mode == RS_MODE_DECIM_S16) {
+            // 2a.整数倍抽取：每 M 个输入产生一个输出
+            memcpy(rs->in_s16 + rs->carry, in, n * sizeof(int16_t));
+            int blocks = total / rs->M;
+            if (blocks > out_max - out_n) {
+                blocks = out_max - out_n;
+            }
+            if (blocks > 0) {
+                out_n += dsps_fird_s16(&rs->fir_s16, rs->in_s16, out + out_n, blocks);
+            }
+            rs->carry = total - blocks * rs->M;
+            memmove(rs->in_s16, rs->in_s16 + blocks * rs->M, rs->carry * sizeof(int16_t));
+        } else if (rs->mode == RS_MODE_POLY_F32) {
+            // 2b.精确有理数比例：每 M 个输入，L 个分支各产生一个输出，交错存放
+            for (int i = 0; i < n; i++) {
+                rs->in_f32[rs->carry + i] = in[i];
+            }
+            int blocks = total / rs->M;
+            if (blocks * rs->L > out_max - out_n) {
+                blocks = (out_max - out_n) / rs->L;
+            }
+            if (blocks > 0) {
+                for (int r = 0; r < rs->L; r++) {
+                    dsps_fird_f32(&rs->fir_f32[r], rs->in_f32, rs->out_f32, blocks);
+                    for (int q = 0; q < blocks; q++) {
+                        out[out_n + q * rs->L + r] = rs_sat16(rs->out_f32[q]);
+                    }
+                }
+                out_n += blocks * rs->L;
+            }
+            rs->carry = total - blocks * rs->M;
+            memmove(rs->in_f32, rs->in_f32 + blocks * rs->M, rs->carry * sizeof(float));
+        } else {
+            // 2c.任意比例
+            for (int i = 0; i < n; i++) {
+                rs->in_f32[rs->carry + i] = in[i];
+            }
+            out_n += rs_process_interp(rs, total, out + out_n, out_max - out_n);
+        }
+
+        in += n;
+        in_samples -= n;
+    }
+    return out_n;
+}
+
+/**
+ * @brief 基准测试
+ */
+esp_err_t resampler_benchmark(void)
+{
+    static const int cases[][2] = {
+        {24000, 16000},
+        {48000, 16000},
+        {22050, 16000},
+        {44100, 16000},
+    };
+    const int max_in = 48000 / 50;    // 每次输入20ms
+    int16_t *in = (int16_t *)heap_caps_malloc(max_in * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    int16_t *out = (int16_t *)heap_caps_malloc((max_in + 16) * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!in || !out) {
+        heap_caps_free(in);
+        heap_caps_free(out);
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = ESP_OK;
+    for (int c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        int in_rate = cases[c][0];
+        int out_rate = cases[c][1];
+        int chunk = in_rate / 50;
+        for (int i = 0; i < chunk; i++) {
+            in[i] = (int16_t)(16000.0f * sinf(2.0f * (float)M_PI * 1000.0f * i / in_rate));
+        }
+
+        resampler_handle_t rs = NULL;
+        ret = resampler_create(in_rate, out_rate, &rs);
+        if (ret != ESP_OK) {
+            break;
+        }
+
+        // 处理1秒音频（50个20ms块）
+        int produced = 0;
+        uint32_t start = esp_cpu_get_cycle_count();
+        for (int k = 0; k < 50; k++) {
+            produced += resampler_process(rs, in, chunk, out, max_in + 16);
+        }
+        uint32_t cycles = esp_cpu_get_cycle_count() - start;
+        resampler_destroy(rs);
+
+        ESP_LOGI(TAG, "%5d -> %5d Hz: %lu cycles per second of audio (%.2f%% CPU @ %d MHz), %d samples out",
+                 in_rate, out_rate, (unsigned long)cycles,
+                 100.0f * cycles / (CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ * 1000000.0f), CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ, produced);
+    }
+
+    heap_caps_free(in);
+    heap_caps_free(out);
+    return ret;
+}
@@ -0,0 +1,193 @@
+#include "audio_proto.h"
+#include "esp_timer.h"
+#include <string.h>
+
+// 下行解析状态（只由 WebSocket 事件任务访问）
+static uint8_t s_hdr_buf[AUDIO_PROTO_HEADER_BYTES];  // 跨分片的帧头暂存
+static size_t s_hdr_have = 0;
+static audio_proto_header_t s_cur;                  // 正在接收数据的帧
+static size_t s_cur_offset = 0;
+static bool s_in_payload = false;
+static bool s_skip_msg = false;                     // 帧头错误，丢弃本条消息的剩余部分
+
+// 丢帧和抖动统计
+static bool s_has_seq = false;
+static uint32_t s_next_seq = 0;
+static bool s_has_transit = false;
+static int32_t s_last_transit = 0;
+static uint32_t s_jitter_x16 = 0;                   // 抖动 x16，保留小数部分
+static audio_proto_rx_stats_t s_stats;
+
+static void put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = v >> 24;
+}
+
+static uint16_t get_le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief 写入帧头
+ */
+size_t audio_proto_write_header(uint8_t *out, const audio_proto_header_t *hdr)
+{
+    out[0] = AUDIO_PROTO_VERSION;
+    out[1] = hdr->codec;
+    out[2] = hdr->flags;
+    out[3] = 0;
+    put_le32(out + 4, hdr->seq);
+    put_le32(out + 8, hdr->timestamp_us);
+    put_le16(out + 12, hdr->payload_len);
+    put_le16(out + 14, hdr->samples);
+    return AUDIO_PROTO_HEADER_BYTES;
+}
+
+/**
+ * @brief 解析一个完整的帧头
+ */
+esp_err_t audio_proto_parse_header(const uint8_t *in, size_t len, audio_proto_header_t *hdr)
+{
+    if (in == NULL || hdr == NULL || len < AUDIO_PROTO_HEADER_BYTES) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (in[0] != AUDIO_PROTO_VERSION) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    hdr->codec = in[1];
+    hdr->flags = in[2];
+    hdr->seq = get_le32(in + 4);
+    hdr->timestamp_us = get_le32(in + 8);
+    hdr->payload_len = get_le16(in + 12);
+    hdr->samples = get_le16(in + 14);
+    return ESP_OK;
+}
+
+/**
+ * @brief 按序号统计丢帧/乱序，按时间戳统计到达抖动
+ */
+static void audio_proto_rx_track(const audio_proto_header_t *hdr)
+{
+    s_stats.frames++;
+
+    // 1.序号：跳过的序号算丢失，比期望更旧的算乱序（不回退期望值），按差值比较以处理回绕
+    if (!s_has_seq) {
+        s_has_seq = true;
+        s_next_seq = hdr->seq + 1;
+    } else {
+        int32_t gap = (int32_t)(hdr->seq - s_next_seq);
+        if (gap < 0) {
+            s_stats.reordered++;
+        } else {
+            s_stats.lost += gap;
+            s_next_seq = hdr->seq + 1;
+        }
+    }
+
+    // 2.抖动（RFC 3550）：J += (|D| - J) / 16，D 为相邻两帧 (到达时间 - 发送时间戳) 之差
+    int32_t transit = (int32_t)((uint32_t)esp_timer_get_time() - hdr->timestamp_us);
+    if (s_has_transit) {
+        int32_t d = transit - s_last_transit;
+        uint32_t abs_d = d < 0 ? (uint32_t)-d : (uint32_t)d;
+        s_jitter_x16 += abs_d - ((s_jitter_x16 + 8) >> 4);
+    }
+    s_has_transit = true;
+    s_last_transit = transit;
+    s_stats.jitter_us = s_jitter_x16 >> 4;
+}
+
+/**
+ * @brief 重置下行解析状态和统计
+ */
+void audio_proto_rx_reset(void)
+{
+    s_hdr_have = 0;
+    s_in_payload = false;
+    s_skip_msg = false;
+    s_has_seq = false;
+    s_has_transit = false;
+    s_jitter_x16 = 0;
+    memset(&s_stats, 0, sizeof(s_stats));
+}
+
+/**
+ * @brief 送入下行消息的一个分片
+ */
+void audio_proto_rx_feed(const uint8_t *data, size_t len, bool msg_start, audio_proto_frame_cb_t cb, void *ctx)
+{
+    // 新消息开始：上一条消息没收完的帧头/数据直接丢弃
+    if (msg_start) {
+        s_hdr_have = 0;
+        s_in_payload = false;
+        s_skip_msg = false;
+    }
+    if (s_skip_msg) {
+        return;
+    }
+
+    size_t pos = 0;
+    while (pos < len) {
+        // 1.正在接收一帧的数据：把本分片中属于这一帧的部分交给回调
+        if (s_in_payload) {
+            size_t n = s_cur.payload_len - s_cur_offset;
+            if (n > len - pos) {
+                n = len - pos;
+            }
+            cb(&s_cur, data + pos, n, s_cur_offset, ctx);
+            s_cur_offset += n;
+            pos += n;
+            if (s_cur_offset == s_cur.payload_len) {
+                s_in_payload = false;
+            }
+            continue;
+        }
+
+        // 2.凑齐一个帧头（可能跨分片）
+        size_t n = AUDIO_PROTO_HEADER_BYTES - s_hdr_have;
+        if (n > len - pos) {
+            n = len - pos;
+        }
+        memcpy(s_hdr_buf + s_hdr_have, data + pos, n);
+        s_hdr_have += n;
+        pos += n;
+        if (s_hdr_have < AUDIO_PROTO_HEADER_BYTES) {
+            break;
+        }
+        s_hdr_have = 0;
+        if (audio_proto_parse_header(s_hdr_buf, AUDIO_PROTO_HEADER_BYTES, &s_cur) != ESP_OK) {
+            s_stats.bad_headers++;
+            s_skip_msg = true;
+            return;
+        }
+        audio_proto_rx_track(&s_cur);
+        s_cur_offset = 0;
+        s_in_payload = s_cur.payload_len > 0;
+    }
+}
+
+/**
+ * @brief 获取下行接收统计
+ */
+esp_err_t audio_proto_get_rx_stats(audio_proto_rx_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *stats = s_stats;
+    return ESP_OK;
+}
@@ -0,0 +1,995 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "audio_bus.h"
+#include "resampler.h"
+#include "websocket_client.h"
+#include "audio_proto.h"
+#include "udp_audio.h"
+
+#include "audio_uplink.h"
+
+static const char *TAG = "AUDIO_UPLINK";
+
+#define UPLINK_TASK_STACK_SIZE  (4 * 1024)
+#define UPLINK_TASK_PRIORITY    4
+#define UPLINK_QUEUE_DEPTH      8       // 8 * 32ms = 256ms 的网络抖动缓冲
+#define UPLINK_STATS_LOG_MS     10000   // 合并发送统计日志间隔
+#define UPLINK_SAMPLE_RATE      16000
+#define UPLINK_NB_SAMPLE_RATE   8000    // 自适应码率最低档的采样率
+#define UPLINK_STOP_TIMEOUT_MS  500     // 等待上行任务退出（一次接收超时加最后一次flush）
+
+static volatile bool s_running = false;
+static TaskHandle_t s_task = NULL;
+// 当前协商的编码格式（WebSocket 事件任务写，上行任务读）
+static volatile audio_codec_type_t s_codec_type = AUDIO_CODEC_PCM16;
+static volatile bool s_framing = false;     // 每帧前面加帧头（握手协商）
+static audio_uplink_gate_config_t s_gate = AUDIO_UPLINK_GATE_DEFAULT_CONFIG();
+static audio_uplink_stats_t s_stats;
+// 唤醒会话（sr 的检测任务写，上行任务读）
+static volatile uint32_t s_wake_samples = 0;
+static volatile audio_uplink_session_end_t s_session_end = AUDIO_UPLINK_SESSION_END_NONE;
+static volatile int s_session_command = -1;
+
+// 自适应码率
+static audio_uplink_rate_config_t s_rate_cfg = AUDIO_UPLINK_RATE_DEFAULT_CONFIG();
+static volatile bool s_adaptive = false;    // 服务器接受码率切换（握手协商）
+
+// 断线存储转发
+static audio_uplink_store_config_t s_store_cfg = AUDIO_UPLINK_STORE_DEFAULT_CONFIG();
+
+static const char *const s_rate_names[] = {"full", "compressed", "narrowband"};
+static const char *const s_mode_names[] = {"continuous", "vad_gate", "wake_session"};
+static const char *const s_end_reasons[] = {"", "timeout", "command", "max_duration", "mode_changed"};
+
+/**
+ * @brief 编码器上下文（只由上行任务访问）
+ */
+typedef struct {
+    const audio_codec_iface_t *codec;
+    audio_codec_state_t codec_st;
+    uint8_t *enc_buf;
+    size_t enc_size;
+    bool speech;                // 上一帧是语音（判断VAD边沿）
+    audio_uplink_rate_t level;  // 自适应码率档位
+    resampler_handle_t rs;      // 16k->8k 抽取（dsps_fird_s16），降到 NARROWBAND 时创建
+    int16_t *nb_buf;            // 抽取后的 8 kHz PCM
+    int nb_cap;                 // nb_buf 容量（采样数）
+    uint32_t send_us_max;       // 本检查周期内单次发送的最长耗时（同步发送时反映TCP阻塞）
+    bool udp;                   // 上一帧走的是UDP通道
+} uplink_enc_t;
+
+/**
+ * @brief 自适应码率控制状态（只由上行任务访问）
+ */
+typedef struct {
+    int64_t  window_start_us;   // 本检查周期的开始时间
+    int64_t  clear_us;          // 连续畅通的时长
+    uint32_t dropped;           // 上个周期结束时的 frames_dropped
+    uint32_t sq_lost;           // 上个周期结束时发送队列挤掉/拒绝/发送失败的消息数
+} uplink_rate_ctl_t;
+
+typedef struct {
+    uint32_t seq;
+    int64_t  timestamp_us;
+    uint32_t flags;
+    int      samples;
+} uplink_ring_meta_t;
+
+/**
+ * @brief 按帧保存的环形缓冲（唤醒会话的预滚动、断线期间的存储转发）
+ */
+typedef struct {
+    int16_t            *pcm;            // slots * slot_samples，PSRAM
+    uplink_ring_meta_t *meta;
+    int                 slots;
+    int                 slot_samples;
+    int                 ring_ms;
+    int                 head;           // 下一次写入的位置
+    int                 count;          // 有效帧数
+} uplink_ring_t;
+
+/**
+ * @brief 上行任务的状态（只由上行任务访问）
+ */
+typedef struct {
+    uplink_enc_t      enc;
+    uplink_rate_ctl_t rate;
+    uplink_ring_t     ring;             // 唤醒会话的预滚动
+    uplink_ring_t     store;            // 断线期间的存储转发（FIFO）
+    // 当前语音段（VAD门控）/ 唤醒会话
+    bool              seg_open;
+    uint32_t          seg_last_seq;
+    uint32_t          seg_frames;
+    int64_t           seg_samples;
+    int64_t           silence_us;       // 语音段中连续的静音时长
+    bool              session_open;
+    // 存储转发
+    int64_t           connected_us;     // 本次连上的时间，0 表示未连接
+    bool              backlog;          // 正在补发（已发送开始标记）
+    uint32_t          backlog_frames;   // 本次补发的帧数
+    uint32_t          backlog_expired;  // 本次断线期间过期/被覆盖的帧数
+} uplink_ctx_t;
+
+static void uplink_log_stats(void)
+{
+    uint32_t total = s_stats.frames_sent + s_stats.frames_gated;
+    if (s_gate.mode != AUDIO_UPLINK_MODE_CONTINUOUS && total > 0) {
+        ESP_LOGI(TAG, "%s: sent=%lu gated=%lu (%lu%%) segments=%lu sessions=%lu preroll=%lu",
+                 s_mode_names[s_gate.mode], (unsigned long)s_stats.frames_sent, (unsigned long)s_stats.frames_gated,
+                 (unsigned long)(s_stats.frames_gated * 100ULL / total), (unsigned long)s_stats.segments,
+                 (unsigned long)s_stats.sessions, (unsigned long)s_stats.preroll_frames);
+    }
+
+    if (s_adaptive) {
+        ESP_LOGI(TAG, "rate: level=%s downs=%lu ups=%lu", s_rate_names[s_stats.rate_level],
+                 (unsigned long)s_stats.rate_downs, (unsigned long)s_stats.rate_ups);
+    }
+
+    if (s_stats.frames_stored > 0) {
+        ESP_LOGI(TAG, "store: stored=%lu forwarded=%lu expired=%lu", (unsigned long)s_stats.frames_stored,
+                 (unsigned long)s_stats.frames_forwarded, (unsigned long)s_stats.frames_expired);
+    }
+
+    websocket_batch_stats_t bs;
+    if (websocket_client_get_batch_stats(&bs) != ESP_OK || bs.frames == 0) {
+        return;
+    }
+    ESP_LOGI(TAG, "batch: frames=%lu messages=%lu (%lu.%lu msg/s) flush bytes/timeout/edge=%lu/%lu/%lu send avg=%lu cycles cpu saved=%lu.%lu%%",
+             (unsigned long)bs.frames, (unsigned long)bs.messages,
+             (unsigned long)(bs.messages_per_sec_x10 / 10), (unsigned long)(bs.messages_per_sec_x10 % 10),
+             (unsigned long)bs.flush_bytes, (unsigned long)bs.flush_timeout, (unsigned long)bs.flush_edge,
+             (unsigned long)bs.send_cycles_avg,
+             (unsigned long)(bs.cpu_saved_permille / 10), (unsigned long)(bs.cpu_saved_permille % 10));
+
+    websocket_send_queue_stats_t sq;
+    if (websocket_send_queue_get_stats(&sq) == ESP_OK && sq.queued > 0) {
+        ESP_LOGI(TAG, "send queue: queued=%lu sent=%lu depth=%lu peak=%lu dropped=%lu would_block=%lu offline=%lu errors=%lu latency avg=%lu max=%lu us",
+                 (unsigned long)sq.queued, (unsigned long)sq.sent, (unsigned long)sq.depth, (unsigned long)sq.depth_peak,
+                 (unsigned long)sq.dropped_oldest, (unsigned long)sq.would_block, (unsigned long)sq.dropped_offline,
+                 (unsigned long)sq.send_errors, (unsigned long)sq.latency_avg_us, (unsigned long)sq.latency_max_us);
+    }
+
+    esp_websocket_buffer_stats_t buf;
+    if (websocket_client_get_buffer_stats(&buf) == ESP_OK) {
+        ESP_LOGI(TAG, "ws buffers: allocs=%lu frees=%lu reuses=%lu held=%lu peak=%lu bytes",
+                 (unsigned long)buf.allocs, (unsigned long)buf.frees, (unsigned long)buf.reuses,
+                 (unsigned long)buf.bytes_held, (unsigned long)buf.bytes_peak);
+    }
+}
+
+/**
+ * @brief 发送控制消息（语音段/会话标记），发送队列未启动时同步发送
+ */
+static void uplink_send_marker(const char *msg)
+{
+    esp_err_t ret = websocket_client_send_text_async(msg, WEBSOCKET_SEND_NEVER_DROP);
+    if (ret == ESP_ERR_INVALID_STATE) {
+        ret = websocket_client_send_text(msg);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Marker not sent (%s): %s", esp_err_to_name(ret), msg);
+    }
+}
+
+/**
+ * @brief 发送语音段开始/结束标记
+ */
+static void uplink_send_segment_marker(bool start, uint32_t seq, uint32_t frames, uint32_t duration_ms)
+{
+    char msg[112];
+    if (start) {
+        snprintf(msg, sizeof(msg), "{\"type\":\"segment\",\"event\":\"start\",\"seq\":%lu}", (unsigned long)seq);
+    } else {
+        snprintf(msg, sizeof(msg), "{\"type\":\"segment\",\"event\":\"end\",\"seq\":%lu,\"frames\":%lu,\"duration_ms\":%lu}",
+                 (unsigned long)seq, (unsigned long)frames, (unsigned long)duration_ms);
+    }
+    uplink_send_marker(msg);
+}
+
+/**
+ * @brief 发送唤醒会话结束标记
+ */
+static void uplink_send_session_end(audio_uplink_session_end_t reason, uint32_t seq, uint32_t frames, int64_t samples)
+{
+    uint32_t duration_ms = (uint32_t)(samples * 1000 / UPLINK_SAMPLE_RATE);
+    char msg[160];
+    snprintf(msg, sizeof(msg),
+             "{\"type\":\"session\",\"event\":\"end\",\"reason\":\"%s\",\"command_id\":%d,\"seq\":%lu,\"frames\":%lu,\"duration_ms\":%lu}",
+             s_end_reasons[reason], reason == AUDIO_UPLINK_SESSION_END_COMMAND ? s_session_command : -1,
+             (unsigned long)seq, (unsigned long)frames, (unsigned long)duration_ms);
+    uplink_send_marker(msg);
+    ESP_LOGI(TAG, "Session end (%s): %lu frames, %lu ms", s_end_reasons[reason],
+             (unsigned long)frames, (unsigned long)duration_ms);
+}
+
+/**
+ * @brief 编码一帧并发送（合并发送），更新统计
+ *
+ * @param enc     编码器上下文
+ * @param pcm     16位PCM
+ * @param samples 采样数
+ * @param seq     帧序号
+ * @param ts_us   采集时间戳
+ * @param flags   AUDIO_FRAME_FLAG_*
+ * @return 已发送或已进入合并缓冲区返回 ESP_OK
+ */
+static esp_err_t uplink_send_frame(uplink_enc_t *enc, const int16_t *pcm, int samples, uint32_t seq, int64_t ts_us, uint32_t flags)
+{
+    bool wake = (flags & AUDIO_FRAME_FLAG_WAKEUP) != 0;
+    bool now_speech = (flags & AUDIO_FRAME_FLAG_SPEECH) != 0;
+    bool preroll = (flags & AUDIO_FRAME_FLAG_PREROLL) != 0;
+
+    // 1.握手或自适应码率改变了编码格式：切换编码器并重置状态（降档后固定为 IMA-ADPCM）
+    audio_codec_type_t type = enc->level == AUDIO_UPLINK_RATE_FULL ? s_codec_type : AUDIO_CODEC_IMA_ADPCM;
+    if (enc->codec->type != type) {
+        // 合并缓冲区中旧格式的帧先发出去，一条消息里不混合两种格式
+        websocket_client_flush_binary(true);
+        enc->codec = audio_codec_get(type);
+        audio_codec_reset(&enc->codec_st);
+        ESP_LOGI(TAG, "Uplink codec: %s", enc->codec->name);
+    }
+
+    // 最低档先抽取到 8 kHz，后面按抽取后的采样编码
+    int in_samples = samples;
+    bool narrowband = enc->level == AUDIO_UPLINK_RATE_NARROWBAND && enc->rs != NULL;
+    if (narrowband) {
+        int cap = resampler_get_max_output(enc->rs, samples);
+        if (cap > enc->nb_cap) {
+            heap_caps_free(enc->nb_buf);
+            enc->nb_buf = (int16_t *)heap_caps_malloc(cap * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+            enc->nb_cap = enc->nb_buf ? cap : 0;
+        }
+        if (enc->nb_buf == NULL) {
+            s_stats.frames_dropped++;
+            return ESP_ERR_NO_MEM;
+        }
+        samples = resampler_process(enc->rs, pcm, samples, enc->nb_buf, enc->nb_cap);
+        pcm = enc->nb_buf;
+    }
+
+    // 2.编码（编码缓冲区按需扩大，总是预留帧头的位置）
+    size_t need = AUDIO_PROTO_HEADER_BYTES + enc->codec->max_encoded_size(samples);
+    if (need > enc->enc_size) {
+        heap_caps_free(enc->enc_buf);
+        enc->enc_buf = (uint8_t *)heap_caps_malloc(need, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        enc->enc_size = enc->enc_buf ? need : 0;
+    }
+    if (enc->enc_buf == NULL) {
+        s_stats.frames_dropped++;
+        return ESP_ERR_NO_MEM;
+    }
+    size_t hdr_len = s_framing ? AUDIO_PROTO_HEADER_BYTES : 0;
+    uint32_t start = esp_cpu_get_cycle_count();
+    size_t out_len = enc->codec->encode(&enc->codec_st, pcm, samples, enc->enc_buf + hdr_len);
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    if (hdr_len) {
+        // 帧头：总线序号（上行队列丢帧时出现空洞）、采集时间戳和AFE的VAD/唤醒状态
+        audio_proto_header_t hdr = {
+            .codec = (uint8_t)enc->codec->type,
+            .flags = (now_speech ? AUDIO_PROTO_FLAG_SPEECH : 0) |
+                     (wake ? AUDIO_PROTO_FLAG_WAKEUP : 0) | (preroll ? AUDIO_PROTO_FLAG_PREROLL : 0) |
+                     (narrowband ? AUDIO_PROTO_FLAG_NARROWBAND : 0),
+            .seq = seq,
+            .timestamp_us = (uint32_t)ts_us,
+            .payload_len = (uint16_t)out_len,
+            .samples = (uint16_t)samples,
+        };
+        audio_proto_write_header(enc->enc_buf, &hdr);
+        out_len += hdr_len;
+    }
+
+    // 3.合并发送：唤醒和开始说话时连同本帧立即发送，说话结束时先把语音的尾部发出去
+    //   预滚动帧后面紧跟着开始说话的帧，和它一起发送
+    bool onset = wake || (now_speech && !enc->speech && !preroll);
+    if (enc->speech && !now_speech) {
+        websocket_client_flush_binary(true);
+    }
+    enc->speech = now_speech && !preroll;
+
+    // 4.UDP通道打开时（需要帧头）每帧一个数据报，不合并；切换通道前先把合并缓冲区中的帧发出去
+    bool udp = hdr_len && udp_audio_is_open();
+    if (udp != enc->udp) {
+        websocket_client_flush_binary(true);
+        enc->udp = udp;
+        ESP_LOGI(TAG, "Uplink transport: %s", udp ? "udp" : "websocket");
+    }
+    int64_t send_start = esp_timer_get_time();
+    esp_err_t ret = udp ? udp_audio_send_frame(enc->enc_buf, out_len)
+                        : websocket_client_send_binary_batched(enc->enc_buf, out_len, onset);
+    uint32_t send_us = (uint32_t)(esp_timer_get_time() - send_start);
+    if (send_us > enc->send_us_max) {
+        enc->send_us_max = send_us;
+    }
+    if (ret != ESP_OK) {
+        s_stats.frames_dropped++;
+        return ESP_FAIL;
+    }
+    s_stats.frames_sent++;
+    s_stats.pcm_bytes += in_samples * sizeof(int16_t);
+    s_stats.wire_bytes += out_len;
+    s_stats.encode_cycles_avg = (s_stats.encode_cycles_avg * 15 + cycles) / 16;
+    if (preroll) {
+        s_stats.preroll_frames++;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief 切换码率档位：先发出旧档位的帧，再发送切换消息（seq 为新档位的第一帧）
+ */
+static void uplink_rate_switch(uplink_enc_t *enc, audio_uplink_rate_t level, uint32_t next_seq, const char *reason)
+{
+    if (level == AUDIO_UPLINK_RATE_NARROWBAND) {
+        if (enc->rs == NULL && resampler_create(UPLINK_SAMPLE_RATE, UPLINK_NB_SAMPLE_RATE, &enc->rs) != ESP_OK) {
+            ESP_LOGW(TAG, "Narrowband resampler unavailable, stay at %s", s_rate_names[enc->level]);
+            return;
+        }
+        // 抽取滤波器的延迟线里是上次降档时的旧数据
+        resampler_reset(enc->rs);
+    }
+    websocket_client_flush_binary(true);
+    bool nb = level == AUDIO_UPLINK_RATE_NARROWBAND;
+    const char *codec = level == AUDIO_UPLINK_RATE_FULL ? audio_codec_get(s_codec_type)->name
+                                                         : audio_codec_get(AUDIO_CODEC_IMA_ADPCM)->name;
+    char msg[160];
+    snprintf(msg, sizeof(msg),
+             "{\"type\":\"uplink_rate\",\"level\":\"%s\",\"codec\":\"%s\",\"sample_rate\":%d,\"seq\":%lu,\"reason\":\"%s\"}",
+             s_rate_names[level], codec, nb ? UPLINK_NB_SAMPLE_RATE : UPLINK_SAMPLE_RATE, (unsigned long)next_seq, reason);
+    uplink_send_marker(msg);
+    ESP_LOGI(TAG, "Uplink rate %s -> %s (%s)", s_rate_names[enc->level], s_rate_names[level], reason);
+    if (level > enc->level) {
+        s_stats.rate_downs++;
+    } else {
+        s_stats.rate_ups++;
+    }
+    enc->level = level;
+    s_stats.rate_level = level;
+}
+
+/**
+ * @brief 自适应码率：每个检查周期根据发送队列和发送耗时决定降档、升档
+ *
+ * @param enc      编码器上下文
+ * @param ctl      控制状态
+ * @param next_seq 下一帧的序号
+ */
+static void uplink_rate_update(uplink_enc_t *enc, uplink_rate_ctl_t *ctl, uint32_t next_seq)
+{
+    audio_uplink_rate_config_t cfg = s_rate_cfg;
+    int64_t now = esp_timer_get_time();
+
+    // 1.未开启、服务器不支持或没有帧头（服务器无法区分每帧的格式）：回到最高档
+    if (!cfg.enable || !s_adaptive || !s_framing) {
+        if (enc->level != AUDIO_UPLINK_RATE_FULL) {
+            if (s_adaptive && s_framing) {
+                uplink_rate_switch(enc, AUDIO_UPLINK_RATE_FULL, next_seq, "disabled");
+            } else {
+                enc->level = AUDIO_UPLINK_RATE_FULL;
+                s_stats.rate_level = AUDIO_UPLINK_RATE_FULL;
+            }
+        }
+        // 重新计数，开启后第一个周期不把之前的丢弃算作拥塞
+        websocket_send_queue_stats_t sq;
+        ctl->sq_lost = websocket_send_queue_get_stats(&sq) == ESP_OK ?
+                       sq.dropped_oldest + sq.would_block + sq.send_errors : 0;
+        ctl->dropped = s_stats.frames_dropped;
+        ctl->window_start_us = now;
+        ctl->clear_us = 0;
+        return;
+    }
+    int64_t elapsed = now - ctl->window_start_us;
+    if (elapsed < cfg.window_ms * 1000LL) {
+        return;
+    }
+
+    // 2.本周期的网络状况：排队深度和延迟（异步队列）、单次发送耗时（同步发送）、丢弃/失败的消息
+    uint32_t depth = 0;
+    uint32_t latency_us = enc->send_us_max;
+    uint32_t sq_lost = 0;
+    websocket_send_queue_stats_t sq;
+    if (websocket_send_queue_get_stats(&sq) == ESP_OK) {
+        depth = sq.depth;
+        latency_us = sq.latency_avg_us > latency_us ? sq.latency_avg_us : latency_us;
+        sq_lost = sq.dropped_oldest + sq.would_block + sq.send_errors;
+    }
+    uint32_t lost = (s_stats.frames_dropped - ctl->dropped) + (sq_lost - ctl->sq_lost);
+    ctl->dropped = s_stats.frames_dropped;
+    ctl->sq_lost = sq_lost;
+    ctl->window_start_us = now;
+    enc->send_us_max = 0;
+
+    bool congested = lost > 0 || depth >= (uint32_t)cfg.depth_high || latency_us >= cfg.latency_high_ms * 1000U;
+    bool clear = lost == 0 && depth <= (uint32_t)cfg.depth_low && latency_us <= cfg.latency_low_ms * 1000U;
+
+    // 3.拥塞立即降一档，连续畅通 recover_ms 后升一档（协商的格式已经是 IMA-ADPCM 时跳过 COMPRESSED）
+    bool adpcm = s_codec_type == AUDIO_CODEC_IMA_ADPCM;
+    if (congested) {
+        ctl->clear_us = 0;
+        if (enc->level != AUDIO_UPLINK_RATE_NARROWBAND) {
+            audio_uplink_rate_t down = (enc->level == AUDIO_UPLINK_RATE_FULL && !adpcm) ?
+                                       AUDIO_UPLINK_RATE_COMPRESSED : AUDIO_UPLINK_RATE_NARROWBAND;
+            uplink_rate_switch(enc, down, next_seq, "congested");
+        }
+    } else if (clear) {
+        ctl->clear_us += elapsed;
+        if (ctl->clear_us >= cfg.recover_ms * 1000LL && enc->level != AUDIO_UPLINK_RATE_FULL) {
+            audio_uplink_rate_t up = (enc->level == AUDIO_UPLINK_RATE_NARROWBAND && !adpcm) ?
+                                     AUDIO_UPLINK_RATE_COMPRESSED : AUDIO_UPLINK_RATE_FULL;
+            uplink_rate_switch(enc, up, next_seq, "recovered");
+            ctl->clear_us = 0;
+        }
+    } else {
+        ctl->clear_us = 0;
+    }
+}
+
+// 帧环形缓冲（PCM在PSRAM）：唤醒会话的预滚动、断线期间的存储转发-----------------------------
+static void uplink_ring_free(uplink_ring_t *ring)
+{
+    heap_caps_free(ring->pcm);
+    free(ring->meta);
+    memset(ring, 0, sizeof(*ring));
+}
+
+/**
+ * @brief 按第一帧的长度分配环形缓冲（帧长固定为AFE的fetch帧长）
+ */
+static esp_err_t uplink_ring_alloc(uplink_ring_t *ring, int ring_ms, int frame_samples, const char *name)
+{
+    int frame_ms = frame_samples * 1000 / UPLINK_SAMPLE_RATE;
+    int slots = frame_ms > 0 ? (ring_ms + frame_ms - 1) / frame_ms : 0;
+    if (slots <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ring->pcm = (int16_t *)heap_caps_malloc((size_t)slots * frame_samples * sizeof(int16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    ring->meta = (uplink_ring_meta_t *)calloc(slots, sizeof(uplink_ring_meta_t));
+    if (ring->pcm == NULL || ring->meta == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate %d ms %s ring (%d frames)", ring_ms, name, slots);
+        uplink_ring_free(ring);
+        return ESP_ERR_NO_MEM;
+    }
+    ring->slots = slots;
+    ring->slot_samples = frame_samples;
+    ring->ring_ms = ring_ms;
+    ESP_LOGI(TAG, "%s ring: %d ms (%d frames, %u bytes PSRAM)", name, ring_ms, slots,
+             (unsigned)(slots * frame_samples * sizeof(int16_t)));
+    return ESP_OK;
+}
+
+/**
+ * @brief 写入一帧，满了覆盖最旧的一帧
+ *
+ * @return 覆盖了最旧的帧返回 true
+ */
+static bool uplink_ring_push(uplink_ring_t *ring, const int16_t *pcm, int samples, uint32_t seq, int64_t ts_us, uint32_t flags)
+{
+    if (samples > ring->slot_samples) {
+        samples = ring->slot_samples;
+    }
+    memcpy(ring->pcm + (size_t)ring->head * ring->slot_samples, pcm, samples * sizeof(int16_t));
+    ring->meta[ring->head] = (uplink_ring_meta_t) {
+        .seq = seq,
+        .timestamp_us = ts_us,
+        .flags = flags,
+        .samples = samples,
+    };
+    ring->head = (ring->head + 1) % ring->slots;
+    if (ring->count < ring->slots) {
+        ring->count++;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 最旧一帧的位置
+ */
+static inline int uplink_ring_oldest(const uplink_ring_t *ring)
+{
+    return (ring->head - ring->count + ring->slots) % ring->slots;
+}
+
+/**
+ * @brief 取出最旧的一帧（数据在下一次写入前有效）
+ */
+static const int16_t *uplink_ring_pop(uplink_ring_t *ring, uplink_ring_meta_t *meta)
+{
+    int idx = uplink_ring_oldest(ring);
+    *meta = ring->meta[idx];
+    ring->count--;
+    return ring->pcm + (size_t)idx * ring->slot_samples;
+}
+
+/**
+ * @brief 发送环形缓冲中最近的 n 帧（从旧到新）
+ *
+ * @return 发送的采样数
+ */
+static int64_t uplink_ring_replay(uplink_ring_t *ring, uplink_enc_t *enc, int n)
+{
+    int64_t samples = 0;
+    if (n > ring->count) {
+        n = ring->count;
+    }
+    for (int i = n; i > 0; i--) {
+        int idx = (ring->head - i + ring->slots) % ring->slots;
+        const uplink_ring_meta_t *m = &ring->meta[idx];
+        uplink_send_frame(enc, ring->pcm + (size_t)idx * ring->slot_samples, m->samples, m->seq, m->timestamp_us, m->flags);
+        samples += m->samples;
+    }
+    ring->count = 0;
+    return samples;
+}
+
+/**
+ * @brief 处理一帧：按发送模式门控，编码并发送，维护语音段/会话标记
+ *
+ * 实时帧和存储转发补发的帧都走这里，所以补发的语音段/会话标记和音频的顺序与实时发送时一致。
+ */
+static void uplink_process(uplink_ctx_t *ctx, const audio_uplink_gate_config_t *gate,
+                           const int16_t *pcm, int samples, uint32_t seq, int64_t ts_us, uint32_t flags)
+{
+    // 网络拥塞时降低码率，恢复后升回来
+    uplink_rate_update(&ctx->enc, &ctx->rate, seq);
+
+    // 切换了模式：结束正在发送的语音段/会话
+    if (ctx->seg_open && gate->mode != AUDIO_UPLINK_MODE_VAD_GATE) {
+        websocket_client_flush_binary(true);
+        uplink_send_segment_marker(false, ctx->seg_last_seq, ctx->seg_frames,
+                                   (uint32_t)(ctx->seg_samples * 1000 / UPLINK_SAMPLE_RATE));
+        ctx->seg_open = false;
+    }
+    if (ctx->session_open && gate->mode != AUDIO_UPLINK_MODE_WAKE_SESSION) {
+        websocket_client_flush_binary(true);
+        uplink_send_session_end(AUDIO_UPLINK_SESSION_END_MODE_CHANGED, ctx->seg_last_seq, ctx->seg_frames, ctx->seg_samples);
+        ctx->session_open = false;
+    }
+
+    bool wake = (flags & AUDIO_FRAME_FLAG_WAKEUP) != 0;
+    bool now_speech = (flags & AUDIO_FRAME_FLAG_SPEECH) != 0;
+    bool preroll = (flags & AUDIO_FRAME_FLAG_PREROLL) != 0;
+
+    // 一、唤醒会话：平时只写环形缓冲，唤醒后补发唤醒词和之前的一小段，之后实时发送，
+    //     命令词超时/识别到命令词/超过最长时间时结束（预滚动帧是VAD补发的重复数据，不需要）
+    if (gate->mode == AUDIO_UPLINK_MODE_WAKE_SESSION) {
+        if (preroll) {
+            return;
+        }
+        if (!ctx->session_open) {
+            if (ctx->ring.pcm == NULL) {
+                uplink_ring_alloc(&ctx->ring, gate->ring_ms, samples, "Pre-roll");
+            }
+            if (ctx->ring.pcm) {
+                uplink_ring_push(&ctx->ring, pcm, samples, seq, ts_us, flags);
+            }
+            if (!wake) {
+                s_stats.frames_gated++;
+                return;
+            }
+            // 唤醒词长度由 sr 在发布唤醒帧之前设置，加上 wake_margin_ms 换算成帧数（包括唤醒帧本身）
+            int64_t back = (int64_t)s_wake_samples + (int64_t)gate->wake_margin_ms * UPLINK_SAMPLE_RATE / 1000;
+            int n = samples > 0 ? (int)((back + samples - 1) / samples) + 1 : 1;
+            ctx->session_open = true;
+            s_session_end = AUDIO_UPLINK_SESSION_END_NONE;
+            s_stats.sessions++;
+            char msg[128];
+            snprintf(msg, sizeof(msg), "{\"type\":\"session\",\"event\":\"start\",\"seq\":%lu,\"wake_samples\":%lu}",
+                     (unsigned long)seq, (unsigned long)s_wake_samples);
+            uplink_send_marker(msg);
+            if (ctx->ring.pcm) {
+                n = n < ctx->ring.count ? n : ctx->ring.count;
+                ctx->seg_samples = uplink_ring_replay(&ctx->ring, &ctx->enc, n);
+                ctx->seg_frames = n;
+            } else {
+                uplink_send_frame(&ctx->enc, pcm, samples, seq, ts_us, flags);
+                ctx->seg_frames = 1;
+                ctx->seg_samples = samples;
+            }
+            ctx->seg_last_seq = seq;
+            return;
+        }
+    } else if (gate->mode == AUDIO_UPLINK_MODE_CONTINUOUS) {
+        // 二、连续发送：预滚动帧已经作为普通帧发送过
+        if (preroll) {
+            return;
+        }
+    } else if (!ctx->seg_open) {
+        // 三、VAD门控：只发送语音段（含预滚动和 hangover）
+        if (!now_speech && !wake) {
+            s_stats.frames_gated++;
+            return;
+        }
+        ctx->seg_open = true;
+        ctx->seg_frames = 0;
+        ctx->seg_samples = 0;
+        ctx->silence_us = 0;
+        s_stats.segments++;
+        uplink_send_segment_marker(true, seq, 0, 0);
+    }
+    if (ctx->seg_open) {
+        ctx->silence_us = (now_speech || wake) ? 0 : ctx->silence_us + (int64_t)samples * 1000000 / UPLINK_SAMPLE_RATE;
+    }
+
+    uplink_send_frame(&ctx->enc, pcm, samples, seq, ts_us, flags);
+
+    // 四、语音段结束：连续静音超过 hangover，先把本段剩余的音频发出去再发结束标记
+    if (ctx->seg_open) {
+        ctx->seg_last_seq = seq;
+        ctx->seg_frames++;
+        ctx->seg_samples += samples;
+        if (ctx->silence_us >= gate->hangover_ms * 1000LL) {
+            websocket_client_flush_binary(true);
+            uplink_send_segment_marker(false, ctx->seg_last_seq, ctx->seg_frames,
+                                       (uint32_t)(ctx->seg_samples * 1000 / UPLINK_SAMPLE_RATE));
+            ctx->seg_open = false;
+        }
+    }
+
+    // 五、会话结束：sr 请求结束（命令词超时/识别到命令词）或超过最长时间
+    if (ctx->session_open) {
+        ctx->seg_last_seq = seq;
+        ctx->seg_frames++;
+        ctx->seg_samples += samples;
+        audio_uplink_session_end_t reason = s_session_end;
+        if (reason == AUDIO_UPLINK_SESSION_END_NONE &&
+                ctx->seg_samples * 1000 >= (int64_t)gate->session_max_ms * UPLINK_SAMPLE_RATE) {
+            reason = AUDIO_UPLINK_SESSION_END_MAX_DURATION;
+        }
+        if (reason != AUDIO_UPLINK_SESSION_END_NONE) {
+            websocket_client_flush_binary(true);
+            uplink_send_session_end(reason, ctx->seg_last_seq, ctx->seg_frames, ctx->seg_samples);
+            ctx->session_open = false;
+            s_session_end = AUDIO_UPLINK_SESSION_END_NONE;
+        }
+    }
+}
+
+/**
+ * @brief 存储转发：按顺序补发断线期间存下的帧
+ *
+ * 每次最多补发 drain_frames 帧（上行任务每32ms至少调用一次，补发速度约为实时的 drain_frames 倍），
+ * 发送队列排队较多时暂停，避免补发的音频把队列挤满后被 DROP_OLDEST 丢掉。
+ */
+static void uplink_store_drain(uplink_ctx_t *ctx, const audio_uplink_gate_config_t *gate,
+                               const audio_uplink_store_config_t *cfg)
+{
+    uplink_ring_t *store = &ctx->store;
+    int64_t now = esp_timer_get_time();
+    char msg[128];
+
+    // 1.丢掉超过 max_age_ms 的帧（服务器已经用不上）
+    while (store->count > 0 && now - store->meta[uplink_ring_oldest(store)].timestamp_us > cfg->max_age_ms * 1000LL) {
+        uplink_ring_meta_t meta;
+        uplink_ring_pop(store, &meta);
+        s_stats.frames_expired++;
+        ctx->backlog_expired++;
+    }
+
+    // 2.开始补发：告诉服务器接下来的帧是断线期间存下的（帧头中是原来的序号和采集时间）
+    if (store->count > 0 && !ctx->backlog) {
+        int64_t age_ms = (now - store->meta[uplink_ring_oldest(store)].timestamp_us) / 1000;
+        snprintf(msg, sizeof(msg), "{\"type\":\"backlog\",\"event\":\"start\",\"frames\":%d,\"age_ms\":%lu,\"expired\":%lu}",
+                 store->count, (unsigned long)age_ms, (unsigned long)ctx->backlog_expired);
+        uplink_send_marker(msg);
+        ESP_LOGI(TAG, "Forwarding %d stored frames (%lu ms old)", store->count, (unsigned long)age_ms);
+        ctx->backlog = true;
+        ctx->backlog_frames = 0;
+    }
+
+    // 3.补发
+    websocket_send_queue_stats_t sq;
+    bool queue_busy = websocket_send_queue_get_stats(&sq) == ESP_OK && sq.depth >= (uint32_t)cfg->drain_max_depth;
+    for (int i = 0; i < cfg->drain_frames && store->count > 0 && !queue_busy; i++) {
+        uplink_ring_meta_t meta;
+        const int16_t *pcm = uplink_ring_pop(store, &meta);
+        uplink_process(ctx, gate, pcm, meta.samples, meta.seq, meta.timestamp_us, meta.flags);
+        s_stats.frames_forwarded++;
+        ctx->backlog_frames++;
+    }
+
+    // 4.补发完：之后的实时帧直接发送
+    if (store->count == 0 && ctx->backlog) {
+        websocket_client_flush_binary(true);
+        snprintf(msg, sizeof(msg), "{\"type\":\"backlog\",\"event\":\"end\",\"frames\":%lu,\"expired\":%lu}",
+                 (unsigned long)ctx->backlog_frames, (unsigned long)ctx->backlog_expired);
+        uplink_send_marker(msg);
+        ESP_LOGI(TAG, "Backlog forwarded: %lu frames, %lu expired",
+                 (unsigned long)ctx->backlog_frames, (unsigned long)ctx->backlog_expired);
+        ctx->backlog = false;
+        ctx->backlog_expired = 0;
+    }
+}
+
+/**
+ * @brief 上行任务：从总线取帧并发送给服务器
+ *
+ * @param arg 订阅者句柄
+ */
+static void uplink_task(void *arg)
+{
+    audio_bus_sub_handle_t sub = (audio_bus_sub_handle_t)arg;
+    uplink_ctx_t ctx = {
+        .enc = {
+            .codec = audio_codec_get(AUDIO_CODEC_PCM16),
+        },
+        .rate = {
+            .window_start_us = esp_timer_get_time(),
+        },
+    };
+    audio_codec_reset(&ctx.enc.codec_st);
+    int64_t last_log_us = esp_timer_get_time();
+
+    while (s_running) {
+        if (esp_timer_get_time() - last_log_us > UPLINK_STATS_LOG_MS * 1000LL) {
+            last_log_us = esp_timer_get_time();
+            uplink_log_stats();
+        }
+        // 还有存下的帧时不等满100ms，尽快补发
+        audio_frame_t *frame = audio_bus_receive(sub, pdMS_TO_TICKS(ctx.store.count > 0 ? 10 : 100));
+        audio_uplink_gate_config_t gate = s_gate;
+        audio_uplink_store_config_t store_cfg = s_store_cfg;
+        // 环形缓冲只在唤醒会话模式下存在，长度改变时重新分配
+        if (ctx.ring.pcm && (gate.mode != AUDIO_UPLINK_MODE_WAKE_SESSION || gate.ring_ms != ctx.ring.ring_ms)) {
+            uplink_ring_free(&ctx.ring);
+        }
+        // 关闭存储转发或容量改变时释放（还没补发的帧丢弃）
+        if (ctx.store.pcm && (!store_cfg.enable || store_cfg.capacity_ms != ctx.store.ring_ms)) {
+            s_stats.frames_dropped += ctx.store.count;
+            uplink_ring_free(&ctx.store);
+            ctx.backlog = false;
+        }
+
+        // 连上之后等握手回复（协商编码格式和帧头）再补发，最多等 hello_wait_ms
+        int64_t now = esp_timer_get_time();
+        bool connected = websocket_is_connected();
+        if (!connected) {
+            // 断开后服务器看不到当前语音段/会话的结束，作废（合并缓冲区中的旧数据也一起丢弃），
+            // 存下的帧重新连上后按新的语音段/会话补发
+            websocket_client_flush_binary(true);
+            ctx.seg_open = false;
+            ctx.session_open = false;
+            ctx.connected_us = 0;
+            // 重新连接后从最高档开始（服务器重新握手）
+            ctx.enc.level = AUDIO_UPLINK_RATE_FULL;
+            s_stats.rate_level = AUDIO_UPLINK_RATE_FULL;
+        } else if (ctx.connected_us == 0) {
+            ctx.connected_us = now;
+        }
+        bool ready = connected && (s_framing || now - ctx.connected_us >= store_cfg.hello_wait_ms * 1000LL);
+
+        if (frame) {
+            int samples = frame->len / sizeof(int16_t);
+            if (store_cfg.enable && (!ready || ctx.store.count > 0)) {
+                // 一、断线、等待握手或还有没补发完的帧：先存起来，保证按采集顺序发送
+                if (ctx.store.pcm == NULL) {
+                    uplink_ring_alloc(&ctx.store, store_cfg.capacity_ms, samples, "Store-and-forward");
+                }
+                if (ctx.store.pcm == NULL) {
+                    s_stats.frames_dropped++;
+                } else {
+                    if (uplink_ring_push(&ctx.store, frame->data, samples, frame->seq, frame->timestamp_us, frame->flags)) {
+                        // 存满了，最旧的一帧被覆盖
+                        s_stats.frames_expired++;
+                        ctx.backlog_expired++;
+                    }
+                    s_stats.frames_stored++;
+                }
+            } else if (!connected) {
+                // 二、未开启存储转发：直接丢弃，避免每帧打印错误日志
+                s_stats.frames_dropped++;
+            } else {
+                // 三、实时发送
+                uplink_process(&ctx, &gate, frame->data, samples, frame->seq, frame->timestamp_us, frame->flags);
+            }
+            audio_frame_release(frame);
+        }
+
+        // 四、按顺序补发存下的帧
+        if (ready && ctx.store.count > 0) {
+            uplink_store_drain(&ctx, &gate, &store_cfg);
+        }
+        if (frame == NULL) {
+            // 没有新帧时检查合并缓冲区的时间预算
+            websocket_client_flush_binary(false);
+        }
+    }
+
+    websocket_client_flush_binary(true);
+    uplink_log_stats();
+    heap_caps_free(ctx.enc.enc_buf);
+    heap_caps_free(ctx.enc.nb_buf);
+    resampler_destroy(ctx.enc.rs);
+    uplink_ring_free(&ctx.ring);
+    uplink_ring_free(&ctx.store);
+    audio_bus_unsubscribe(sub);
+    ESP_LOGI(TAG, "[uplink_task] sent=%lu dropped=%lu pcm=%lu bytes wire=%lu bytes encode avg=%lu cycles",
+             (unsigned long)s_stats.frames_sent, (unsigned long)s_stats.frames_dropped,
+             (unsigned long)s_stats.pcm_bytes, (unsigned long)s_stats.wire_bytes,
+             (unsigned long)s_stats.encode_cycles_avg);
+    s_task = NULL;
+    ESP_LOGI(TAG, "[uplink_task] finished");
+    vTaskDelete(NULL);
+}
+
+esp_err_t audio_uplink_start(void)
+{
+    if (s_task != NULL) {
+        ESP_LOGW(TAG, "Uplink already started");
+        return ESP_OK;
+    }
+
+    audio_bus_sub_handle_t sub = audio_bus_subscribe("uplink", UPLINK_QUEUE_DEPTH, AUDIO_BUS_DROP_OLDEST);
+    if (sub == NULL) {
+        return ESP_FAIL;
+    }
+
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_running = true;
+    if (xTaskCreatePinnedToCore(uplink_task, "uplink_task", UPLINK_TASK_STACK_SIZE, sub,
+                                UPLINK_TASK_PRIORITY, &s_task, 0) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create uplink task");
+        s_running = false;
+        audio_bus_unsubscribe(sub);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t audio_uplink_stop(void)
+{
+    if (s_task == NULL) {
+        return ESP_OK;
+    }
+    s_running = false;
+
+    // 等待任务注销订阅者后退出，调用者随后才能释放音频总线
+    for (int i = 0; i < UPLINK_STOP_TIMEOUT_MS / 10 && s_task != NULL; i++) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    if (s_task != NULL) {
+        ESP_LOGE(TAG, "Uplink task did not exit in time");
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+esp_err_t audio_uplink_set_codec(audio_codec_type_t type)
+{
+    if (audio_codec_get(type) == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_codec_type = type;
+    return ESP_OK;
+}
+
+audio_codec_type_t audio_uplink_get_codec(void)
+{
+    return s_codec_type;
+}
+
+esp_err_t audio_uplink_set_gate(const audio_uplink_gate_config_t *config)
+{
+    audio_uplink_gate_config_t def = AUDIO_UPLINK_GATE_DEFAULT_CONFIG();
+    audio_uplink_gate_config_t cfg = config ? *config : def;
+    if (cfg.mode < AUDIO_UPLINK_MODE_CONTINUOUS || cfg.mode > AUDIO_UPLINK_MODE_WAKE_SESSION ||
+            cfg.hangover_ms < 0 || cfg.ring_ms <= 0 || cfg.wake_margin_ms < 0 || cfg.session_max_ms <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_gate = cfg;
+    ESP_LOGI(TAG, "Uplink mode %s (hangover %d ms, ring %d ms, wake margin %d ms, session max %d ms)",
+             s_mode_names[cfg.mode], cfg.hangover_ms, cfg.ring_ms, cfg.wake_margin_ms, cfg.session_max_ms);
+    return ESP_OK;
+}
+
+void audio_uplink_get_gate(audio_uplink_gate_config_t *config)
+{
+    if (config) {
+        *config = s_gate;
+    }
+}
+
+const char *audio_uplink_mode_name(audio_uplink_mode_t mode)
+{
+    if (mode < AUDIO_UPLINK_MODE_CONTINUOUS || mode > AUDIO_UPLINK_MODE_WAKE_SESSION) {
+        return "unknown";
+    }
+    return s_mode_names[mode];
+}
+
+void audio_uplink_notify_wake(int wake_word_samples)
+{
+    s_wake_samples = wake_word_samples > 0 ? (uint32_t)wake_word_samples : 0;
+}
+
+void audio_uplink_session_end(audio_uplink_session_end_t reason, int command_id)
+{
+    if (reason <= AUDIO_UPLINK_SESSION_END_NONE || reason > AUDIO_UPLINK_SESSION_END_MODE_CHANGED) {
+        return;
+    }
+    s_session_command = command_id;
+    s_session_end = reason;
+}
+
+esp_err_t audio_uplink_set_rate_control(const audio_uplink_rate_config_t *config)
+{
+    audio_uplink_rate_config_t def = AUDIO_UPLINK_RATE_DEFAULT_CONFIG();
+    audio_uplink_rate_config_t cfg = config ? *config : def;
+    if (cfg.window_ms <= 0 || cfg.recover_ms < 0 || cfg.depth_low < 0 || cfg.depth_high <= cfg.depth_low ||
+            cfg.latency_low_ms < 0 || cfg.latency_high_ms <= cfg.latency_low_ms) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_rate_cfg = cfg;
+    ESP_LOGI(TAG, "Adaptive rate %s (window %d ms, recover %d ms, depth %d/%d, latency %d/%d ms)",
+             cfg.enable ? "on" : "off", cfg.window_ms, cfg.recover_ms, cfg.depth_low, cfg.depth_high,
+             cfg.latency_low_ms, cfg.latency_high_ms);
+    return ESP_OK;
+}
+
+void audio_uplink_get_rate_control(audio_uplink_rate_config_t *config)
+{
+    if (config) {
+        *config = s_rate_cfg;
+    }
+}
+
+void audio_uplink_set_adaptive(bool accepted)
+{
+    s_adaptive = accepted;
+}
+
+const char *audio_uplink_rate_name(audio_uplink_rate_t rate)
+{
+    if (rate < AUDIO_UPLINK_RATE_FULL || rate > AUDIO_UPLINK_RATE_NARROWBAND) {
+        return "unknown";
+    }
+    return s_rate_names[rate];
+}
+
+esp_err_t audio_uplink_set_store(const audio_uplink_store_config_t *config)
+{
+    audio_uplink_store_config_t def = AUDIO_UPLINK_STORE_DEFAULT_CONFIG();
+    audio_uplink_store_config_t cfg = config ? *config : def;
+    if (cfg.capacity_ms <= 0 || cfg.max_age_ms <= 0 || cfg.drain_frames <= 0 ||
+            cfg.drain_max_depth <= 0 || cfg.hello_wait_ms < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_store_cfg = cfg;
+    ESP_LOGI(TAG, "Store-and-forward %s (capacity %d ms, max age %d ms, drain %d frames, max depth %d)",
+             cfg.enable ? "on" : "off", cfg.capacity_ms, cfg.max_age_ms, cfg.drain_frames, cfg.drain_max_depth);
+    return ESP_OK;
+}
+
+void audio_uplink_get_store(audio_uplink_store_config_t *config)
+{
+    if (config) {
+        *config = s_store_cfg;
+    }
+}
+
+void audio_uplink_set_framing(bool enable)
+{
+    s_framing = enable;
+}
+
+bool audio_uplink_get_framing(void)
+{
+    return s_framing;
+}
+
+esp_err_t audio_uplink_get_stats(audio_uplink_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *stats = s_stats;
+    return ESP_OK;
+}
@@ -0,0 +1,298 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_event.h"
+#include "esp_wifi.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include <string.h>
+
+#include "wifi.h"
+#include "websocket_client.h"
+
+#include "conn_supervisor.h"
+
+static const char *TAG = "CONN_SUPERVISOR";
+
+#define CONN_TASK_STACK_SIZE    (3 * 1024)
+
+// 任务通知位（事件回调 -> 管理任务）
+#define CONN_EV_WIFI_UP         BIT0
+#define CONN_EV_WIFI_DOWN       BIT1
+#define CONN_EV_WS_UP           BIT2
+#define CONN_EV_WS_DOWN         BIT3
+#define CONN_EV_STOP            BIT4
+
+// 事件组位（conn_supervisor_wait_connected 等待）
+#define CONN_CONNECTED_BIT      BIT0
+
+typedef enum {
+    CONN_STATE_WAIT_WIFI,       // 等待 Wi-Fi 拿到IP（Wi-Fi 重试用完后按退避重新连接 AP）
+    CONN_STATE_CONNECTING,      // WebSocket 正在连接
+    CONN_STATE_CONNECTED,       // WebSocket 已连接
+    CONN_STATE_BACKOFF,         // WebSocket 断开，等待退避时间到期后重连
+} conn_state_t;
+
+static conn_supervisor_config_t s_cfg;
+static TaskHandle_t s_task = NULL;
+static EventGroupHandle_t s_events = NULL;
+static esp_event_handler_instance_t s_wifi_handler = NULL;
+static esp_event_handler_instance_t s_ip_handler = NULL;
+static conn_supervisor_stats_t s_stats;
+
+static const char *const s_state_names[] = {"wait_wifi", "connecting", "connected", "backoff"};
+
+/**
+ * @brief Wi-Fi/IP 事件（默认事件循环任务中调用），只通知管理任务
+ */
+static void conn_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    if (s_task == NULL) {
+        return;
+    }
+    if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        xTaskNotify(s_task, CONN_EV_WIFI_UP, eSetBits);
+    } else {
+        xTaskNotify(s_task, CONN_EV_WIFI_DOWN, eSetBits);
+    }
+}
+
+/**
+ * @brief WebSocket 连上/断开（WebSocket 客户端任务中调用），只通知管理任务
+ */
+static void conn_ws_cb(bool connected, void *ctx)
+{
+    if (s_task != NULL) {
+        xTaskNotify(s_task, connected ? CONN_EV_WS_UP : CONN_EV_WS_DOWN, eSetBits);
+    }
+}
+
+/**
+ * @brief 第 fails 次失败后的等待时间：backoff_min_ms * 2^(fails-1)，不超过 backoff_max_ms，再减去随机抖动
+ */
+static uint32_t conn_backoff_ms(int fails)
+{
+    uint64_t ms = s_cfg.backoff_min_ms;
+    for (int i = 1; i < fails && ms < (uint64_t)s_cfg.backoff_max_ms; i++) {
+        ms *= 2;
+    }
+    if (ms > (uint64_t)s_cfg.backoff_max_ms) {
+        ms = s_cfg.backoff_max_ms;
+    }
+    // 抖动让同时掉线的设备错开重连时间，不会一起冲击服务器
+    uint32_t jitter = (uint32_t)(ms * s_cfg.jitter_pct / 100);
+    if (jitter > 0) {
+        ms -= esp_random() % (jitter + 1);
+    }
+    return (uint32_t)ms;
+}
+
+/**
+ * @brief 管理任务：阻塞等待事件或退避到期，按当前状态启动/停止 WebSocket 客户端
+ */
+static void conn_supervisor_task(void *arg)
+{
+    conn_state_t state = CONN_STATE_WAIT_WIFI;
+    int64_t deadline_us = 0;        // 退避到期时间，0 表示没有
+    int64_t attempt_us = 0;         // 本次连接开始的时间
+    int64_t connected_us = 0;       // 连上的时间
+    int64_t ip_us = 0;              // 拿到IP的时间（统计到 WebSocket 可用的时间）
+    int ws_fails = 0;               // 连续失败次数（WebSocket）
+    int wifi_fails = 0;             // 连续失败次数（Wi-Fi）
+
+    while (1) {
+        // 1.等待事件：有退避时等到期，否则一直阻塞
+        TickType_t wait = portMAX_DELAY;
+        if (deadline_us) {
+            int64_t left_us = deadline_us - esp_timer_get_time();
+            wait = left_us > 0 ? pdMS_TO_TICKS((left_us + 999) / 1000) : 0;
+        }
+        uint32_t ev = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &ev, wait);
+        if (ev & CONN_EV_STOP) {
+            break;
+        }
+        int64_t now = esp_timer_get_time();
+        conn_state_t prev = state;
+
+        // 2.WebSocket 连上：记录连接耗时
+        if ((ev & CONN_EV_WS_UP) && state == CONN_STATE_CONNECTING) {
+            uint32_t ms = (uint32_t)((now - attempt_us) / 1000);
+            s_stats.connects++;
+            s_stats.connect_ms_last = ms;
+            s_stats.connect_ms_avg = (s_stats.connect_ms_avg * (s_stats.connects - 1) + ms) / s_stats.connects;
+            if (ms > s_stats.connect_ms_max) {
+                s_stats.connect_ms_max = ms;
+            }
+            if (ip_us) {
+                s_stats.ready_ms_last = (uint32_t)((now - ip_us) / 1000);
+                ip_us = 0;
+            }
+            connected_us = now;
+            state = CONN_STATE_CONNECTED;
+            xEventGroupSetBits(s_events, CONN_CONNECTED_BIT);
+            ESP_LOGI(TAG, "WebSocket connected in %lu ms (attempt %lu, ready %lu ms after IP)",
+                     (unsigned long)ms, (unsigned long)s_stats.attempts, (unsigned long)s_stats.ready_ms_last);
+        }
+
+        // 3.WebSocket 断开或连接失败：连接保持了 stable_ms 以上时退避从头开始，否则继续翻倍
+        if ((ev & CONN_EV_WS_DOWN) && (state == CONN_STATE_CONNECTING || state == CONN_STATE_CONNECTED)) {
+            xEventGroupClearBits(s_events, CONN_CONNECTED_BIT);
+            if (state == CONN_STATE_CONNECTED) {
+                uint32_t up_ms = (uint32_t)((now - connected_us) / 1000);
+                s_stats.drops++;
+                if (up_ms > s_stats.uptime_ms_max) {
+                    s_stats.uptime_ms_max = up_ms;
+                }
+                if (up_ms >= (uint32_t)s_cfg.stable_ms) {
+                    ws_fails = 0;
+                }
+            } else {
+                s_stats.failures++;
+            }
+            s_stats.backoff_ms = conn_backoff_ms(++ws_fails);
+            deadline_us = now + s_stats.backoff_ms * 1000LL;
+            state = CONN_STATE_BACKOFF;
+            ESP_LOGW(TAG, "WebSocket %s, reconnect in %lu ms (failures %d)",
+                     prev == CONN_STATE_CONNECTED ? "disconnected" : "connect failed",
+                     (unsigned long)s_stats.backoff_ms, ws_fails);
+        }
+
+        // 4.Wi-Fi 断开：停止客户端任务（句柄保留），不再尝试连接服务器
+        bool wifi_up = wifi_is_connected();
+        if (!wifi_up && state != CONN_STATE_WAIT_WIFI) {
+            if (state == CONN_STATE_CONNECTING || state == CONN_STATE_CONNECTED) {
+                websocket_client_stop();
+                if (state == CONN_STATE_CONNECTED) {
+                    s_stats.drops++;
+                }
+            }
+            xEventGroupClearBits(s_events, CONN_CONNECTED_BIT);
+            s_stats.wifi_drops++;
+            wifi_fails = 0;
+            deadline_us = 0;
+            state = CONN_STATE_WAIT_WIFI;
+        }
+
+        // 5.退避到期：重新连接 AP（只在 Wi-Fi 自己的快速重试已用完时生效），然后等下一个退避
+        if (deadline_us && now >= deadline_us) {
+            deadline_us = 0;
+            if (state == CONN_STATE_WAIT_WIFI && !wifi_up && wifi_reconnect() == ESP_OK) {
+                s_stats.wifi_retries++;
+            }
+        }
+        if (state == CONN_STATE_WAIT_WIFI && !wifi_up && deadline_us == 0) {
+            s_stats.backoff_ms = conn_backoff_ms(++wifi_fails);
+            deadline_us = now + s_stats.backoff_ms * 1000LL;
+        }
+
+        // 6.有IP并且没有在连接/退避：在同一个客户端句柄上重新启动
+        bool backoff_done = state == CONN_STATE_BACKOFF && deadline_us == 0;
+        if (wifi_up && (state == CONN_STATE_WAIT_WIFI || backoff_done)) {
+            if (state == CONN_STATE_WAIT_WIFI) {
+                ip_us = now;
+                ws_fails = 0;
+            }
+            s_stats.attempts++;
+            attempt_us = now;
+            deadline_us = 0;
+            state = CONN_STATE_CONNECTING;
+            if (websocket_reconnect() != ESP_OK) {
+                // 客户端没能启动，按连接失败处理
+                s_stats.failures++;
+                s_stats.backoff_ms = conn_backoff_ms(++ws_fails);
+                deadline_us = now + s_stats.backoff_ms * 1000LL;
+                state = CONN_STATE_BACKOFF;
+            }
+        }
+
+        if (state != prev) {
+            ESP_LOGI(TAG, "%s -> %s", s_state_names[prev], s_state_names[state]);
+        }
+    }
+
+    ESP_LOGI(TAG, "attempts=%lu connects=%lu failures=%lu drops=%lu wifi drops=%lu retries=%lu connect avg=%lu max=%lu ms",
+             (unsigned long)s_stats.attempts, (unsigned long)s_stats.connects, (unsigned long)s_stats.failures,
+             (unsigned long)s_stats.drops, (unsigned long)s_stats.wifi_drops, (unsigned long)s_stats.wifi_retries,
+             (unsigned long)s_stats.connect_ms_avg, (unsigned long)s_stats.connect_ms_max);
+    s_task = NULL;
+    vTaskDelete(NULL);
+}
+
+esp_err_t conn_supervisor_start(const conn_supervisor_config_t *config)
+{
+    if (s_task != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    conn_supervisor_config_t def = CONN_SUPERVISOR_DEFAULT_CONFIG();
+    conn_supervisor_config_t cfg = config ? *config : def;
+    if (cfg.backoff_min_ms <= 0 || cfg.backoff_max_ms < cfg.backoff_min_ms ||
+            cfg.jitter_pct < 0 || cfg.jitter_pct > 100 || cfg.stable_ms < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_cfg = cfg;
+    memset(&s_stats, 0, sizeof(s_stats));
+
+    // 一、事件组只创建一次，停止后 wait_connected 仍然可以调用
+    if (s_events == NULL) {
+        s_events = xEventGroupCreate();
+        if (s_events == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    xEventGroupClearBits(s_events, CONN_CONNECTED_BIT);
+    if (cfg.uri) {
+        websocket_client_set_uri(cfg.uri);
+    }
+
+    // 二、创建管理任务
+    if (xTaskCreatePinnedToCore(conn_supervisor_task, "conn_supervisor", CONN_TASK_STACK_SIZE, NULL,
+                                cfg.task_priority, &s_task, 0) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create supervisor task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // 三、注册事件：Wi-Fi 断开/丢失IP/拿到IP，WebSocket 连上/断开
+    esp_event_handler_instance_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, conn_event_handler, NULL, &s_wifi_handler);
+    esp_event_handler_instance_register(IP_EVENT, ESP_EVENT_ANY_ID, conn_event_handler, NULL, &s_ip_handler);
+    websocket_client_set_conn_cb(conn_ws_cb, NULL);
+
+    // 启动前可能已经拿到IP，由任务按当前状态决定
+    xTaskNotify(s_task, CONN_EV_WIFI_UP, eSetBits);
+    ESP_LOGI(TAG, "Started (backoff %d..%d ms, jitter %d%%)", cfg.backoff_min_ms, cfg.backoff_max_ms, cfg.jitter_pct);
+    return ESP_OK;
+}
+
+esp_err_t conn_supervisor_stop(void)
+{
+    if (s_task == NULL) {
+        return ESP_OK;
+    }
+    websocket_client_set_conn_cb(NULL, NULL);
+    esp_event_handler_instance_unregister(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, s_wifi_handler);
+    esp_event_handler_instance_unregister(IP_EVENT, ESP_EVENT_ANY_ID, s_ip_handler);
+    s_wifi_handler = NULL;
+    s_ip_handler = NULL;
+    xTaskNotify(s_task, CONN_EV_STOP, eSetBits);
+    return ESP_OK;
+}
+
+esp_err_t conn_supervisor_wait_connected(int timeout_ms)
+{
+    if (s_events == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    TickType_t ticks = timeout_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    EventBits_t bits = xEventGroupWaitBits(s_events, CONN_CONNECTED_BIT, pdFALSE, pdTRUE, ticks);
+    return (bits & CONN_CONNECTED_BIT) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t conn_supervisor_get_stats(conn_supervisor_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *stats = s_stats;
+    return ESP_OK;
+}
@@ -0,0 +1,126 @@
+#ifndef AUDIO_PROTO_H
+#define AUDIO_PROTO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/**
+ * @brief 音频帧头协议（v1）
+ *
+ * 握手协商后（见 websocket_client.h 的 hello / audio_format 消息），每一帧音频前面加一个16字节的帧头，
+ * 服务器据此检测丢帧、乱序，测量抖动、时钟漂移和每帧的端到端延迟。
+ * 一条 WebSocket 二进制消息可以包含多个"帧头+数据"（上行合并发送），按 payload_len 依次拆分。
+ *
+ * 帧头（小端）：
+ *   偏移  大小  字段
+ *   0     1     version      协议版本（AUDIO_PROTO_VERSION）
+ *   1     1     codec        audio_proto_codec_t
+ *   2     1     flags        AUDIO_PROTO_FLAG_*（AFE 的 VAD/唤醒状态）
+ *   3     1     reserved     0
+ *   4     4     seq          帧序号，每帧+1，中间的空洞就是丢失的帧
+ *   8     4     timestamp_us 采集时间（esp_timer_get_time() 的低32位，约71分钟回绕一次）
+ *   12    2     payload_len  紧跟帧头的数据字节数
+ *   14    2     samples      本帧的采样数（Opus 等不便计算时为0）
+ */
+
+#define AUDIO_PROTO_VERSION         1
+#define AUDIO_PROTO_NAME            "v1"    /*!< 握手中使用的协议名 */
+#define AUDIO_PROTO_HEADER_BYTES    16
+
+#define AUDIO_PROTO_FLAG_SPEECH     (1u << 0)   /*!< VAD判定为语音 */
+#define AUDIO_PROTO_FLAG_WAKEUP     (1u << 1)   /*!< 本帧检测到唤醒词 */
+#define AUDIO_PROTO_FLAG_PREROLL    (1u << 2)   /*!< VAD缓存补发的语音起始部分（采集时间早于前一帧） */
+#define AUDIO_PROTO_FLAG_NARROWBAND (1u << 3)   /*!< 数据为 8 kHz（上行自适应码率降档），否则为 16 kHz */
+
+/**
+ * @brief 帧数据的编码格式（上行与 audio_codec_type_t 的取值一致）
+ */
+typedef enum {
+    AUDIO_PROTO_CODEC_PCM16 = 0,
+    AUDIO_PROTO_CODEC_IMA_ADPCM = 1,
+    AUDIO_PROTO_CODEC_OPUS = 2,
+} audio_proto_codec_t;
+
+/**
+ * @brief 解析后的帧头
+ */
+typedef struct {
+    uint8_t  codec;         /*!< audio_proto_codec_t */
+    uint8_t  flags;         /*!< AUDIO_PROTO_FLAG_* */
+    uint32_t seq;           /*!< 帧序号 */
+    uint32_t timestamp_us;  /*!< 采集/发送端时间戳（us，低32位） */
+    uint16_t payload_len;   /*!< 数据字节数 */
+    uint16_t samples;       /*!< 采样数，0 表示未知 */
+} audio_proto_header_t;
+
+/**
+ * @brief 下行帧回调（数据可能跨 WebSocket 分片，分多次回调）
+ *
+ * @param hdr    帧头
+ * @param data   本次回调的数据
+ * @param len    本次回调的字节数
+ * @param offset data 在本帧数据中的偏移，为0时是一帧的开始；offset + len == hdr->payload_len 时一帧结束
+ * @param ctx    audio_proto_rx_feed() 传入的参数
+ */
+typedef void (*audio_proto_frame_cb_t)(const audio_proto_header_t *hdr, const uint8_t *data, size_t len,
+                                       size_t offset, void *ctx);
+
+/**
+ * @brief 下行接收统计
+ */
+typedef struct {
+    uint32_t frames;        /*!< 收到的帧数 */
+    uint32_t bad_headers;   /*!< 版本不对或长度错误的帧头数（之后本条消息的剩余部分丢弃） */
+    uint32_t lost;          /*!< 按序号推算丢失的帧数 */
+    uint32_t reordered;     /*!< 序号比已收到的更旧的帧数 */
+    uint32_t jitter_us;     /*!< 到达间隔抖动（RFC 3550 的平滑估计，us） */
+} audio_proto_rx_stats_t;
+
+/**
+ * @brief 写入帧头
+ *
+ * @param out 输出缓冲区，至少 AUDIO_PROTO_HEADER_BYTES 字节
+ * @param hdr 帧头
+ * @return 写入的字节数（AUDIO_PROTO_HEADER_BYTES）
+ */
+size_t audio_proto_write_header(uint8_t *out, const audio_proto_header_t *hdr);
+
+/**
+ * @brief 解析一个完整的帧头
+ *
+ * @param in  至少 AUDIO_PROTO_HEADER_BYTES 字节
+ * @param len in 的字节数
+ * @param hdr 输出的帧头
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_SIZE: 数据不足一个帧头
+ * - ESP_ERR_INVALID_VERSION: 版本不支持
+ */
+esp_err_t audio_proto_parse_header(const uint8_t *in, size_t len, audio_proto_header_t *hdr);
+
+/**
+ * @brief 重置下行解析状态和统计（协商下行帧头或重新连接时调用）
+ */
+void audio_proto_rx_reset(void);
+
+/**
+ * @brief 送入下行 WebSocket 二进制消息的一个分片，拆出其中的帧并回调
+ *
+ * 帧头和数据都可以跨分片，解析状态在两次调用之间保持；只允许 WebSocket 事件任务调用。
+ *
+ * @param data      分片数据
+ * @param len       分片字节数
+ * @param msg_start 本分片是一条消息的开始（payload_offset == 0），丢弃上一条消息未完成的部分
+ * @param cb        帧回调
+ * @param ctx       回调参数
+ */
+void audio_proto_rx_feed(const uint8_t *data, size_t len, bool msg_start, audio_proto_frame_cb_t cb, void *ctx);
+
+/**
+ * @brief 获取下行接收统计
+ */
+esp_err_t audio_proto_get_rx_stats(audio_proto_rx_stats_t *stats);
+
+#endif // AUDIO_PROTO_H
@@ -0,0 +1,279 @@
+#ifndef AUDIO_UPLINK_H
+#define AUDIO_UPLINK_H
+
+#include <stdbool.h>
+#include "esp_err.h"
+#include "audio_codec.h"
+
+/**
+ * @brief 上行发送模式
+ */
+typedef enum {
+    AUDIO_UPLINK_MODE_CONTINUOUS = 0,   /*!< 连续发送所有帧（包括静音） */
+    AUDIO_UPLINK_MODE_VAD_GATE,         /*!< 只发送VAD语音段 */
+    AUDIO_UPLINK_MODE_WAKE_SESSION,     /*!< 只在唤醒后发送：唤醒词及之后的语音，命令词超时或识别到命令词后结束 */
+} audio_uplink_mode_t;
+
+/**
+ * @brief 上行门控配置
+ *
+ * VAD_GATE：AFE判定为语音（或检测到唤醒词）时开始一段，先补发VAD缓存的语音起始部分（预滚动），
+ * 连续 hangover_ms 没有语音后结束。每段开始和结束时发送文本标记：
+ * {"type":"segment","event":"start","seq":首帧序号} / {"type":"segment","event":"end","seq":末帧序号,"frames":帧数,"duration_ms":时长}
+ *
+ * WAKE_SESSION：PSRAM环形缓冲一直保存最近 ring_ms 的AFE输出，检测到唤醒词时补发唤醒词（wake_word_length）
+ * 和之前 wake_margin_ms 的音频，之后实时发送，直到 audio_uplink_session_end() 或超过 session_max_ms：
+ * {"type":"session","event":"start","seq":唤醒帧序号,"wake_samples":唤醒词采样数} /
+ * {"type":"session","event":"end","reason":"timeout|command|max_duration|mode_changed","command_id":命令词ID,"seq":末帧序号,"frames":帧数,"duration_ms":时长}
+ *
+ * 结束标记走控制队列，可能先于最后几帧音频到达，服务器按 seq（带帧头时）或 frames 收齐后再结束。
+ */
+typedef struct {
+    audio_uplink_mode_t mode;   /*!< 发送模式 */
+    int hangover_ms;            /*!< VAD_GATE：语音结束后继续发送的时间（ms），避免句中停顿把一句话切成多段 */
+    int ring_ms;                /*!< WAKE_SESSION：环形缓冲保存的音频时长（ms），需要覆盖唤醒词 */
+    int wake_margin_ms;         /*!< WAKE_SESSION：唤醒词之前额外补发的时长（ms） */
+    int session_max_ms;         /*!< WAKE_SESSION：一次会话最多发送的时长（ms） */
+} audio_uplink_gate_config_t;
+
+#define AUDIO_UPLINK_GATE_DEFAULT_CONFIG() {    \
+    .mode = AUDIO_UPLINK_MODE_VAD_GATE,         \
+    .hangover_ms = 480,                         \
+    .ring_ms = 2000,                            \
+    .wake_margin_ms = 300,                      \
+    .session_max_ms = 10000,                    \
+}
+
+/**
+ * @brief 唤醒会话结束原因
+ */
+typedef enum {
+    AUDIO_UPLINK_SESSION_END_NONE = 0,
+    AUDIO_UPLINK_SESSION_END_TIMEOUT,       /*!< 命令词检测超时 */
+    AUDIO_UPLINK_SESSION_END_COMMAND,       /*!< 识别到命令词 */
+    AUDIO_UPLINK_SESSION_END_MAX_DURATION,  /*!< 超过 session_max_ms */
+    AUDIO_UPLINK_SESSION_END_MODE_CHANGED,  /*!< 切换了发送模式 */
+} audio_uplink_session_end_t;
+
+/**
+ * @brief 自适应码率的档位（从高到低）
+ */
+typedef enum {
+    AUDIO_UPLINK_RATE_FULL = 0,         /*!< 握手协商的编码格式，16 kHz */
+    AUDIO_UPLINK_RATE_COMPRESSED,       /*!< IMA-ADPCM，16 kHz（PCM16 的 1/4） */
+    AUDIO_UPLINK_RATE_NARROWBAND,       /*!< 抽取到 8 kHz 后 IMA-ADPCM（PCM16 的 1/8） */
+} audio_uplink_rate_t;
+
+/**
+ * @brief 自适应码率配置
+ *
+ * 上行任务每 window_ms 检查一次网络状况：异步发送队列的深度、入队到发送完成的延迟、
+ * 队列挤掉/发送失败的消息数，以及同步发送（队列未启动时）的最长耗时。
+ * 出现拥塞时立即降一档；连续 recover_ms 都畅通后升一档。
+ * 只在握手时服务器回复 "uplink_adaptive":true 且带帧头时生效（帧头中的编码格式和 AUDIO_PROTO_FLAG_NARROWBAND 描述每一帧），
+ * 每次切换发送文本消息：
+ * {"type":"uplink_rate","level":"full|compressed|narrowband","codec":"ima_adpcm","sample_rate":8000,"seq":新档位的第一帧序号,"reason":"congested|recovered|disabled"}
+ */
+typedef struct {
+    bool enable;            /*!< 开启自适应码率 */
+    int window_ms;          /*!< 检查周期（ms） */
+    int recover_ms;         /*!< 连续畅通多长时间后升一档（ms） */
+    int depth_high;         /*!< 发送队列排队消息数达到该值视为拥塞 */
+    int depth_low;          /*!< 排队消息数不超过该值才算畅通 */
+    int latency_high_ms;    /*!< 发送延迟达到该值视为拥塞（ms） */
+    int latency_low_ms;     /*!< 发送延迟不超过该值才算畅通（ms） */
+} audio_uplink_rate_config_t;
+
+#define AUDIO_UPLINK_RATE_DEFAULT_CONFIG() {    \
+    .enable = true,                             \
+    .window_ms = 1000,                          \
+    .recover_ms = 5000,                         \
+    .depth_high = 6,                            \
+    .depth_low = 1,                             \
+    .latency_high_ms = 300,                     \
+    .latency_low_ms = 100,                      \
+}
+
+/**
+ * @brief 断线存储转发配置
+ *
+ * WebSocket 断开（以及重新连上后等待握手回复）期间，上行任务把总线上的原始PCM帧按顺序存入PSRAM，
+ * 连上并完成握手后按原来的顺序补发：门控和编码在补发时进行，所以使用重新协商的编码格式/帧头/码率档位，
+ * 帧头中仍是原来的序号和采集时间戳。补发前后发送文本标记：
+ * {"type":"backlog","event":"start","frames":待补发帧数,"age_ms":最旧一帧的时长,"expired":已丢弃帧数} /
+ * {"type":"backlog","event":"end","frames":补发帧数,"expired":丢弃帧数}
+ * 补发期间的实时帧继续存入缓冲区，补发完之后才直接发送，保证服务器收到的音频按采集顺序排列。
+ * 存满时覆盖最旧的帧，超过 max_age_ms 的帧不再补发。
+ */
+typedef struct {
+    bool enable;            /*!< 开启存储转发 */
+    int capacity_ms;        /*!< 缓冲区能保存的音频时长（ms），16 kHz PCM16 每秒 32 KB PSRAM */
+    int max_age_ms;         /*!< 超过该时长的帧丢弃不补发（ms） */
+    int drain_frames;       /*!< 每次（每收到一帧或每10ms）最多补发的帧数，补发速度约为实时的 drain_frames 倍 */
+    int drain_max_depth;    /*!< 发送队列排队消息数达到该值时暂停补发，避免挤掉队列中的帧 */
+    int hello_wait_ms;      /*!< 连上后等待握手回复的最长时间（ms），超时后按未协商的格式补发 */
+} audio_uplink_store_config_t;
+
+#define AUDIO_UPLINK_STORE_DEFAULT_CONFIG() {   \
+    .enable = true,                             \
+    .capacity_ms = 10000,                       \
+    .max_age_ms = 8000,                         \
+    .drain_frames = 8,                          \
+    .drain_max_depth = 4,                       \
+    .hello_wait_ms = 500,                       \
+}
+
+/**
+ * @brief 上行统计信息
+ */
+typedef struct {
+    uint32_t frames_sent;       /*!< 已发送的帧数 */
+    uint32_t frames_dropped;    /*!< 未连接（未开启存储转发）或发送失败丢弃的帧数 */
+    uint32_t frames_gated;      /*!< VAD门控未发送的静音帧数 */
+    uint32_t preroll_frames;    /*!< 补发的预滚动帧数 */
+    uint32_t segments;          /*!< 发送的语音段数 */
+    uint32_t sessions;          /*!< 唤醒会话数 */
+    uint32_t pcm_bytes;         /*!< 编码前的PCM字节数 */
+    uint32_t wire_bytes;        /*!< 编码后实际发送的字节数 */
+    uint32_t encode_cycles_avg; /*!< 每帧编码的平均CPU周期 */
+    uint32_t rate_level;        /*!< 当前码率档位（audio_uplink_rate_t） */
+    uint32_t rate_downs;        /*!< 因拥塞降档的次数 */
+    uint32_t rate_ups;          /*!< 恢复后升档的次数 */
+    uint32_t frames_stored;     /*!< 断线期间存入缓冲区的帧数 */
+    uint32_t frames_forwarded;  /*!< 重新连上后补发的帧数 */
+    uint32_t frames_expired;    /*!< 存满被覆盖或超过 max_age_ms 丢弃的帧数 */
+} audio_uplink_stats_t;
+
+/**
+ * @brief 启动音频上行任务
+ *
+ * 向音频帧总线注册一个订阅者，并创建后台任务把帧编码后通过 WebSocket 发送给服务器。
+ * 网络阻塞只会让上行队列丢掉最旧的帧，不会影响唤醒词和命令词检测。
+ * 需要先调用 audio_bus_init()。
+ *
+ * @return
+ * - ESP_OK: 成功启动
+ * - 其他: 启动失败
+ */
+esp_err_t audio_uplink_start(void);
+
+/**
+ * @brief 停止音频上行任务
+ *
+ * 任务会在处理完当前帧后注销订阅者并退出，本函数等待任务退出后返回。
+ *
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_TIMEOUT: 任务未能按时退出
+ */
+esp_err_t audio_uplink_stop(void);
+
+/**
+ * @brief 设置上行编码格式（握手完成或连接断开时由 WebSocket 客户端调用）
+ *
+ * 上行任务在下一帧切换编码器并重置编码状态。
+ *
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_ARG: 编码格式无效
+ */
+esp_err_t audio_uplink_set_codec(audio_codec_type_t type);
+
+/**
+ * @brief 获取当前上行编码格式
+ */
+audio_codec_type_t audio_uplink_get_codec(void);
+
+/**
+ * @brief 设置上行门控（下一帧生效，切换模式时正在发送的语音段/会话立即结束）
+ *
+ * @param config 配置，传 NULL 使用 AUDIO_UPLINK_GATE_DEFAULT_CONFIG
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_ARG: 配置错误
+ */
+esp_err_t audio_uplink_set_gate(const audio_uplink_gate_config_t *config);
+
+/**
+ * @brief 获取上行门控配置
+ */
+void audio_uplink_get_gate(audio_uplink_gate_config_t *config);
+
+/**
+ * @brief 发送模式名（握手中使用）："continuous"、"vad_gate"、"wake_session"
+ */
+const char *audio_uplink_mode_name(audio_uplink_mode_t mode);
+
+/**
+ * @brief 记录唤醒词长度（sr 在发布带 AUDIO_FRAME_FLAG_WAKEUP 的帧之前调用）
+ *
+ * @param wake_word_samples afe_fetch_result_t 的 wake_word_length（采样数）
+ */
+void audio_uplink_notify_wake(int wake_word_samples);
+
+/**
+ * @brief 请求结束当前唤醒会话（sr 在命令词超时或识别到命令词时调用，上行任务在下一帧结束）
+ *
+ * @param reason     结束原因
+ * @param command_id 识别到的命令词ID，其他原因传 -1
+ */
+void audio_uplink_session_end(audio_uplink_session_end_t reason, int command_id);
+
+/**
+ * @brief 设置上行帧头（握手完成或连接断开时由 WebSocket 客户端调用）
+ *
+ * 开启后每帧前面加 audio_proto.h 定义的帧头（序号、采集时间戳、编码格式、VAD/唤醒标志），下一帧生效。
+ */
+void audio_uplink_set_framing(bool enable);
+
+/**
+ * @brief 上行是否带帧头
+ */
+bool audio_uplink_get_framing(void);
+
+/**
+ * @brief 设置自适应码率（下一个检查周期生效，关闭时回到 AUDIO_UPLINK_RATE_FULL）
+ *
+ * @param config 配置，传 NULL 使用 AUDIO_UPLINK_RATE_DEFAULT_CONFIG
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_ARG: 配置错误
+ */
+esp_err_t audio_uplink_set_rate_control(const audio_uplink_rate_config_t *config);
+
+/**
+ * @brief 获取自适应码率配置
+ */
+void audio_uplink_get_rate_control(audio_uplink_rate_config_t *config);
+
+/**
+ * @brief 服务器是否接受码率切换（握手完成或连接断开时由 WebSocket 客户端调用）
+ */
+void audio_uplink_set_adaptive(bool accepted);
+
+/**
+ * @brief 码率档位名（"full"、"compressed"、"narrowband"）
+ */
+const char *audio_uplink_rate_name(audio_uplink_rate_t rate);
+
+/**
+ * @brief 设置断线存储转发（关闭或改变容量时丢弃还没补发的帧）
+ *
+ * @param config 配置，传 NULL 使用 AUDIO_UPLINK_STORE_DEFAULT_CONFIG
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_ARG: 配置错误
+ */
+esp_err_t audio_uplink_set_store(const audio_uplink_store_config_t *config);
+
+/**
+ * @brief 获取断线存储转发配置
+ */
+void audio_uplink_get_store(audio_uplink_store_config_t *config);
+
+/**
+ * @brief 获取上行统计信息
+ */
+esp_err_t audio_uplink_get_stats(audio_uplink_stats_t *stats);
+
+#endif // AUDIO_UPLINK_H
@@ -0,0 +1,89 @@
+#ifndef CONN_SUPERVISOR_H
+#define CONN_SUPERVISOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/**
+ * @brief 连接管理（Wi-Fi -> WebSocket）
+ *
+ * 由 Wi-Fi/IP 事件（默认事件循环）和 WebSocket 连接/断开回调驱动，管理任务平时阻塞在任务通知上，不占CPU：
+ * - 拿到IP后启动 WebSocket 客户端；Wi-Fi 断开时停止客户端任务（句柄保留），恢复后在同一个句柄上重新启动；
+ * - WebSocket 断开或连接失败后按指数退避（加随机抖动）重新连接，连接保持 stable_ms 以上才把退避清零；
+ * - Wi-Fi 自己的快速重试用完后也按退避间隔重新连接 AP；
+ * - 统计每次连接耗时（开始连接 -> CONNECTED）、拿到IP到 WebSocket 可用的时间、断开和失败次数。
+ *
+ * WebSocket 客户端关闭了自动重连（websocket_client_start()），重连时机只由这里决定。
+ */
+
+typedef struct {
+    const char *uri;            /*!< 服务器地址，NULL 使用 websocket_client.c 中的默认地址 */
+    int backoff_min_ms;         /*!< 第一次重连的等待时间（ms） */
+    int backoff_max_ms;         /*!< 等待时间上限（ms），每失败一次翻倍 */
+    int jitter_pct;             /*!< 随机抖动（%）：实际等待 = 退避 * (1 - jitter_pct/100 * random[0,1)) */
+    int stable_ms;              /*!< 连接保持这么久后断开，从 backoff_min_ms 重新开始（ms） */
+    int task_priority;          /*!< 管理任务优先级 */
+} conn_supervisor_config_t;
+
+#define CONN_SUPERVISOR_DEFAULT_CONFIG() {  \
+    .uri = NULL,                            \
+    .backoff_min_ms = 500,                  \
+    .backoff_max_ms = 30000,                \
+    .jitter_pct = 50,                       \
+    .stable_ms = 10000,                     \
+    .task_priority = 3,                     \
+}
+
+/**
+ * @brief 连接统计
+ */
+typedef struct {
+    uint32_t attempts;          /*!< WebSocket 连接次数 */
+    uint32_t connects;          /*!< 连接成功次数 */
+    uint32_t failures;          /*!< 连接失败次数（未连上就断开） */
+    uint32_t drops;             /*!< 连上之后断开的次数 */
+    uint32_t wifi_drops;        /*!< Wi-Fi 断开次数 */
+    uint32_t wifi_retries;      /*!< 按退避重新连接 AP 的次数 */
+    uint32_t connect_ms_last;   /*!< 最近一次连接耗时（ms） */
+    uint32_t connect_ms_avg;    /*!< 平均连接耗时（ms） */
+    uint32_t connect_ms_max;    /*!< 最长连接耗时（ms） */
+    uint32_t ready_ms_last;     /*!< 最近一次拿到IP到 WebSocket 连上的时间（ms，包括失败重试和退避） */
+    uint32_t backoff_ms;        /*!< 当前（或最近一次）的退避等待时间（ms） */
+    uint32_t uptime_ms_max;     /*!< 最长的一次连接保持时间（ms） */
+} conn_supervisor_stats_t;
+
+/**
+ * @brief 启动连接管理（需要先调用 wifi_init_sta()）
+ *
+ * @param config 配置，传 NULL 使用 CONN_SUPERVISOR_DEFAULT_CONFIG
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_ARG: 配置错误
+ * - ESP_ERR_INVALID_STATE: 已经启动
+ * - ESP_ERR_NO_MEM: 内存不足
+ */
+esp_err_t conn_supervisor_start(const conn_supervisor_config_t *config);
+
+/**
+ * @brief 停止连接管理（不关闭当前连接）
+ */
+esp_err_t conn_supervisor_stop(void);
+
+/**
+ * @brief 等待 WebSocket 连上（阻塞在事件组上，不轮询）
+ *
+ * @param timeout_ms 超时时间（ms），小于0时一直等待
+ * @return
+ * - ESP_OK: 已连接
+ * - ESP_ERR_TIMEOUT: 超时
+ * - ESP_ERR_INVALID_STATE: 连接管理未启动
+ */
+esp_err_t conn_supervisor_wait_connected(int timeout_ms);
+
+/**
+ * @brief 获取连接统计
+ */
+esp_err_t conn_supervisor_get_stats(conn_supervisor_stats_t *stats);
+
+#endif // CONN_SUPERVISOR_H
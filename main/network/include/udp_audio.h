@@ -0,0 +1,148 @@
+#ifndef UDP_AUDIO_H
+#define UDP_AUDIO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "audio_proto.h"
+
+/**
+ * @brief UDP 音频通道（音频走数据报，控制消息仍走 WebSocket）
+ *
+ * WebSocket 基于TCP，丢一个报文段后面的数据都要等重传（队头阻塞），网络稍差时整条音频流停顿几百毫秒。
+ * 开启后在握手中声明 "udp"，服务器回复端口和会话标识后上行/下行音频改走UDP：
+ * 每个数据报是一个12字节的数据报头加若干个 audio_proto 帧（帧头中的序号和采集时间戳就是 RTP 式的排序信息），
+ * 丢失的帧不重传；redundancy > 0 时每个数据报附带前几帧的副本（类似 RFC 2198 冗余编码），
+ * 单个数据报丢失时接收端从下一个数据报中恢复。文本控制消息（语音段/会话/码率切换标记）仍走 WebSocket。
+ *
+ * 数据报头（小端）：
+ *   偏移  大小  字段
+ *   0     1     version  UDP_AUDIO_VERSION
+ *   1     1     type     udp_audio_type_t
+ *   2     1     frames   AUDIO：本数据报包含的帧数（从旧到新，最后一帧是新帧，前面是冗余副本）
+ *   3     1     reserved 0
+ *   4     4     seq      数据报序号（每个方向每个数据报+1；PROBE 为探测序号）
+ *   8     4     token    会话标识（服务器在握手回复中分配，据此把数据报对应到 WebSocket 连接）
+ * PROBE 数据报后面是4字节的发送时间（esp_timer 低32位，us），服务器原样回送，用来测量UDP的往返时间。
+ * 同时每个探测周期在 WebSocket 上发送 {"type":"ping","id":序号,"t":时间}，服务器回复 "pong"，得到TCP的往返时间作对比。
+ */
+
+#define UDP_AUDIO_VERSION       1
+#define UDP_AUDIO_HEADER_BYTES  12
+
+typedef enum {
+    UDP_AUDIO_TYPE_AUDIO = 0,   /*!< 音频帧 */
+    UDP_AUDIO_TYPE_PROBE = 1,   /*!< 往返时间探测（服务器原样回送），同时用作NAT保活 */
+} udp_audio_type_t;
+
+typedef struct {
+    bool enable;                /*!< 在握手中声明UDP通道 */
+    int redundancy;             /*!< 每个数据报附带的前几帧副本数（0~2），PCM16 帧较大时放不下的副本会被省略 */
+    int max_datagram;           /*!< 数据报的最大字节数，不超过以太网MTU避免IP分片 */
+    int probe_interval_ms;      /*!< 往返时间探测间隔（ms），0 为不探测 */
+    int task_priority;          /*!< 接收任务优先级 */
+} udp_audio_config_t;
+
+#define UDP_AUDIO_DEFAULT_CONFIG() {    \
+    .enable = false,                    \
+    .redundancy = 1,                    \
+    .max_datagram = 1400,               \
+    .probe_interval_ms = 1000,          \
+    .task_priority = 5,                 \
+}
+
+/**
+ * @brief UDP通道统计（ws_* 为同一时间 WebSocket 的对比探测）
+ */
+typedef struct {
+    uint32_t tx_datagrams;      /*!< 发送的音频数据报数 */
+    uint32_t tx_frames;         /*!< 发送的新帧数 */
+    uint32_t tx_redundant;      /*!< 附带的冗余副本数 */
+    uint32_t tx_errors;         /*!< 发送失败（协议栈缓冲区满等）的数据报数 */
+    uint32_t tx_bytes;          /*!< 发送的字节数（含数据报头和冗余） */
+    uint32_t rx_datagrams;      /*!< 收到的音频数据报数 */
+    uint32_t rx_frames;         /*!< 交给下行的帧数 */
+    uint32_t rx_recovered;      /*!< 从冗余副本中恢复的帧数（原来的数据报丢失） */
+    uint32_t rx_duplicates;     /*!< 重复或过期丢弃的帧数 */
+    uint32_t rx_lost;           /*!< 按序号推算最终丢失的帧数（冗余也没能恢复） */
+    uint32_t rx_bad;            /*!< 格式错误或会话标识不符的数据报数 */
+    uint32_t udp_probes_sent;   /*!< UDP 探测次数 */
+    uint32_t udp_probes_recv;   /*!< 收到回送的 UDP 探测数 */
+    uint32_t udp_rtt_avg_us;    /*!< UDP 往返时间（平滑平均，us） */
+    uint32_t udp_rtt_max_us;    /*!< UDP 最大往返时间（us） */
+    uint32_t ws_probes_sent;    /*!< WebSocket 探测次数 */
+    uint32_t ws_probes_recv;    /*!< 收到 pong 的 WebSocket 探测数 */
+    uint32_t ws_rtt_avg_us;     /*!< WebSocket 往返时间（平滑平均，us） */
+    uint32_t ws_rtt_max_us;     /*!< WebSocket 最大往返时间（us） */
+} udp_audio_stats_t;
+
+/**
+ * @brief 设置UDP通道（下次握手生效）
+ *
+ * @param config 配置，传 NULL 使用 UDP_AUDIO_DEFAULT_CONFIG
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_ARG: 配置错误
+ */
+esp_err_t udp_audio_set_config(const udp_audio_config_t *config);
+
+/**
+ * @brief 获取UDP通道配置
+ */
+void udp_audio_get_config(udp_audio_config_t *config);
+
+/**
+ * @brief 打开UDP通道（收到握手回复时由 WebSocket 客户端调用）
+ *
+ * 由接收任务解析地址并创建套接字，随后立即发送一个探测，让服务器（和中间的NAT）记下设备的地址。
+ *
+ * @param host  服务器地址（与 WebSocket 相同的主机）
+ * @param port  服务器UDP端口
+ * @param token 服务器分配的会话标识
+ * @param rx_cb 下行帧回调（在接收任务中调用，每帧一次，offset 为0）
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_ARG: 参数错误
+ * - ESP_ERR_INVALID_STATE: 未开启
+ * - ESP_ERR_NO_MEM: 内存不足
+ */
+esp_err_t udp_audio_open(const char *host, uint16_t port, uint32_t token, audio_proto_frame_cb_t rx_cb);
+
+/**
+ * @brief 关闭UDP通道（WebSocket 断开时调用，音频回到 WebSocket）
+ */
+void udp_audio_close(void);
+
+/**
+ * @brief UDP通道是否可用（套接字已创建）
+ */
+bool udp_audio_is_open(void);
+
+/**
+ * @brief 发送一帧（audio_proto 帧头+数据），连同前几帧的冗余副本放进一个数据报
+ *
+ * 不阻塞：协议栈缓冲区满时直接丢弃并返回 ESP_FAIL。只允许上行任务调用。
+ *
+ * @return
+ * - ESP_OK: 已发送
+ * - ESP_ERR_INVALID_STATE: 通道未打开
+ * - ESP_ERR_INVALID_SIZE: 帧超过 max_datagram
+ * - ESP_FAIL: 发送失败
+ */
+esp_err_t udp_audio_send_frame(const uint8_t *frame, size_t len);
+
+/**
+ * @brief 收到 WebSocket 的 pong（WebSocket 客户端调用）
+ *
+ * @param id   ping 中的序号
+ * @param t_us ping 中的发送时间
+ */
+void udp_audio_on_ws_pong(uint32_t id, uint32_t t_us);
+
+/**
+ * @brief 获取统计信息
+ */
+esp_err_t udp_audio_get_stats(udp_audio_stats_t *stats);
+
+#endif // UDP_AUDIO_H
@@ -3,6 +3,114 @@
 
 #include "esp_err.h"
 #include <stdbool.h>
+#include <stdint.h>
+#include "esp_websocket_client.h"
+
+/**
+ * @brief 上行二进制消息合并（批量发送）配置
+ *
+ * 每次 esp_websocket_client_send_bin() 都要加锁、分配发送缓冲区、加掩码并写一次TCP，
+ * 合并模式把连续的若干帧拼成一条二进制消息，达到字节数或时间预算时发送。
+ * 合并后一条消息包含若干完整的帧（PCM 直接拼接；IMA-ADPCM 每帧带自己的帧头，帧长固定）。
+ */
+typedef struct {
+    int max_bytes;      /*!< 一条消息的最大字节数，达到后立即发送 */
+    int max_ms;         /*!< 第一帧进入合并缓冲后最多等待的时间（ms），0 为关闭合并，每帧单独发送 */
+} websocket_batch_config_t;
+
+#define WEBSOCKET_BATCH_DEFAULT_CONFIG() {  \
+    .max_bytes = 4096,                      \
+    .max_ms = 96,                           \
+}
+
+/**
+ * @brief 上行合并统计
+ */
+typedef struct {
+    uint32_t frames;            /*!< 交给合并发送的帧数 */
+    uint32_t messages;          /*!< 实际发送的 WebSocket 消息数 */
+    uint32_t flush_bytes;       /*!< 因字节数达到上限发送的消息数 */
+    uint32_t flush_timeout;     /*!< 因时间预算到期发送的消息数 */
+    uint32_t flush_edge;        /*!< 因唤醒/VAD边沿立即发送的消息数 */
+    uint32_t send_cycles_avg;   /*!< 每条消息 esp_websocket_client_send_bin() 的平均CPU周期 */
+    uint32_t messages_per_sec_x10;  /*!< 实际每秒发送的消息数 x10 */
+    uint32_t cpu_saved_permille;    /*!< 相比每帧单独发送节省的CPU（‰，单核，已扣除拼接拷贝） */
+} websocket_batch_stats_t;
+
+/**
+ * @brief 异步发送队列满时的处理策略
+ */
+typedef enum {
+    WEBSOCKET_SEND_DROP_OLDEST,     /*!< 挤掉队列中最旧的可丢弃消息，只保留最新的数据（适合上行音频） */
+    WEBSOCKET_SEND_NEVER_DROP,      /*!< 自己不会被挤掉；没有空位且没有可丢弃的消息时返回 ESP_ERR_TIMEOUT（适合控制消息） */
+} websocket_send_policy_t;
+
+/**
+ * @brief 异步发送队列配置
+ *
+ * 调用者只把消息拷贝进预分配的消息槽，由独立的发送任务写入TCP，TCP阻塞时调用者不会被挂起。
+ * 控制消息（NEVER_DROP）优先于音频（DROP_OLDEST）发送。
+ */
+typedef struct {
+    int queue_depth;        /*!< 消息槽个数（队列中最多缓存的消息数） */
+    int max_msg_bytes;      /*!< 单条消息的最大字节数，不小于上行合并的 max_bytes */
+    int send_timeout_ms;    /*!< 发送任务每条消息的发送超时，超时的消息丢弃 */
+    int task_priority;      /*!< 发送任务优先级 */
+    int task_core;          /*!< 发送任务绑定的核 */
+} websocket_send_queue_config_t;
+
+#define WEBSOCKET_SEND_QUEUE_DEFAULT_CONFIG() { \
+    .queue_depth = 16,                          \
+    .max_msg_bytes = 4096,                      \
+    .send_timeout_ms = 1000,                    \
+    .task_priority = 4,                         \
+    .task_core = 0,                             \
+}
+
+/**
+ * @brief 异步发送队列统计
+ */
+typedef struct {
+    uint32_t queued;            /*!< 入队的消息数 */
+    uint32_t sent;              /*!< 发送成功的消息数 */
+    uint32_t dropped_oldest;    /*!< 队列满时被挤掉的消息数 */
+    uint32_t would_block;       /*!< 队列满返回 ESP_ERR_TIMEOUT 的次数 */
+    uint32_t dropped_offline;   /*!< 发送时连接已断开而丢弃的消息数 */
+    uint32_t send_errors;       /*!< 发送失败或超时的消息数 */
+    uint32_t depth;             /*!< 当前排队的消息数 */
+    uint32_t depth_peak;        /*!< 排队消息数的峰值 */
+    uint32_t latency_avg_us;    /*!< 从入队到发送完成的平均时间（us） */
+    uint32_t latency_max_us;    /*!< 从入队到发送完成的最大时间（us） */
+} websocket_send_queue_stats_t;
+
+/**
+ * @brief wss:// 连接配置（服务器地址以 wss:// 开头时使用）
+ *
+ * 完整的TLS握手（证书链校验 + ECDHE 密钥交换）在 S3 上要几百毫秒，session_reuse 开启时客户端保存上次协商的会话，
+ * 重连时提交会话票据/会话ID，服务器接受后走简化握手，省掉证书校验和密钥交换。
+ * 需要在 menuconfig 中开启 ESP_TLS_CLIENT_SESSION_TICKETS，未开启时每次都是完整握手。
+ */
+typedef struct {
+    const char *ca_cert_pem;        /*!< 服务器（或自签名CA）证书，PEM 格式，调用者保证一直有效；NULL 时使用证书包 */
+    bool use_crt_bundle;            /*!< ca_cert_pem 为 NULL 时用 ESP-IDF 内置的根证书包校验（需开启 MBEDTLS_CERTIFICATE_BUNDLE） */
+    bool skip_common_name_check;    /*!< 不校验证书中的主机名（局域网用IP地址连接自签名证书的服务器时开启） */
+    bool session_reuse;             /*!< 重连时复用TLS会话 */
+} websocket_tls_config_t;
+
+#define WEBSOCKET_TLS_DEFAULT_CONFIG() {    \
+    .ca_cert_pem = NULL,                    \
+    .use_crt_bundle = true,                 \
+    .skip_common_name_check = false,        \
+    .session_reuse = true,                  \
+}
+
+/**
+ * @brief 连接状态回调（在 WebSocket 客户端任务中调用，不能阻塞）
+ *
+ * @param connected true: 连上；false: 断开、连接失败或被关闭
+ * @param ctx       websocket_client_set_conn_cb() 传入的参数
+ */
+typedef void (*websocket_conn_cb_t)(bool connected, void *ctx);
 
 /**
  * @brief 初始化 WebSocket 客户端，启动 WebSocket 客户端并连接到服务器。
@@ -24,13 +132,55 @@ esp_err_t websocket_client_close_clean(void);
 
 /**
  * @brief 重新连接 WebSocket 客户端。
- * 
- * 关闭当前连接，释放资源，然后重新初始化并启动。
- * 
+ *
+ * 客户端关闭了自动重连，断开后客户端任务退出。重连时停止仍在运行的客户端任务，
+ * 在同一个句柄上重新启动（配置、收发缓冲区池保留），客户端未创建时等同于 websocket_client_start()。
+ *
  * @return 成功返回 ESP_OK，失败返回错误码。
  */
 esp_err_t websocket_reconnect(void);
 
+/**
+ * @brief 停止客户端任务（不发送CLOSE、不销毁句柄），之后可以用 websocket_reconnect() 重新启动
+ *
+ * 不能在 WebSocket 事件回调中调用。
+ *
+ * @return 成功返回 ESP_OK，失败返回错误码。
+ */
+esp_err_t websocket_client_stop(void);
+
+/**
+ * @brief 设置服务器地址（下一次启动/重连时生效）
+ *
+ * @return 成功返回 ESP_OK，地址无效或过长返回 ESP_ERR_INVALID_ARG。
+ */
+esp_err_t websocket_client_set_uri(const char *uri);
+
+/**
+ * @brief 设置 wss:// 连接配置（下一次 websocket_client_start() 时生效，已创建的客户端需要先 websocket_client_close_clean()）
+ *
+ * @param config 配置，传 NULL 使用 WEBSOCKET_TLS_DEFAULT_CONFIG
+ * @return 成功返回 ESP_OK。
+ */
+esp_err_t websocket_client_set_tls(const websocket_tls_config_t *config);
+
+/**
+ * @brief 获取TLS握手统计（完整/复用握手次数和耗时，耗时包含DNS、TCP连接和TLS握手）
+ *
+ * 统计保存在客户端句柄中，websocket_reconnect() 保留，websocket_client_close_clean() 清除（缓存的会话也一起释放）。
+ *
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_STATE: 客户端未初始化
+ * - ESP_ERR_NOT_SUPPORTED: 未开启 ESP_TLS_CLIENT_SESSION_TICKETS
+ */
+esp_err_t websocket_client_get_tls_stats(esp_websocket_tls_stats_t *stats);
+
+/**
+ * @brief 注册连接状态回调（连接管理使用），传 NULL 取消
+ */
+void websocket_client_set_conn_cb(websocket_conn_cb_t cb, void *ctx);
+
 /**
  * @brief 通过 WebSocket 发送文本消息。
  *
@@ -48,6 +198,91 @@ esp_err_t websocket_client_send_text(const char *text);
  */
 esp_err_t websocket_client_send_binary(const uint8_t *data, int len);
 
+/**
+ * @brief 启动异步发送队列和发送任务
+ *
+ * 启动后上行合并发送（websocket_client_send_binary_batched）也改为入队（DROP_OLDEST）。
+ *
+ * @param config 配置，传 NULL 使用 WEBSOCKET_SEND_QUEUE_DEFAULT_CONFIG
+ * @return
+ * - ESP_OK: 成功
+ * - ESP_ERR_INVALID_ARG: 配置错误
+ * - ESP_ERR_NO_MEM: 内存不足
+ */
+esp_err_t websocket_send_queue_start(const websocket_send_queue_config_t *config);
+
+/**
+ * @brief 停止发送任务并释放消息槽（队列中未发送的消息丢弃）
+ *
+ * @return 成功返回 ESP_OK，发送任务未能按时退出返回 ESP_ERR_TIMEOUT。
+ */
+esp_err_t websocket_send_queue_stop(void);
+
+/**
+ * @brief 异步发送文本消息（不阻塞）
+ *
+ * @param text   以 null 结尾的字符串
+ * @param policy 队列满时的处理策略
+ * @return
+ * - ESP_OK: 已入队
+ * - ESP_ERR_TIMEOUT: 队列已满（would-block），调用者稍后重试或放弃
+ * - ESP_ERR_INVALID_SIZE: 消息超过 max_msg_bytes
+ * - ESP_ERR_INVALID_STATE: 发送队列未启动
+ * - ESP_FAIL: 未连接
+ */
+esp_err_t websocket_client_send_text_async(const char *text, websocket_send_policy_t policy);
+
+/**
+ * @brief 异步发送二进制消息（不阻塞），返回值同 websocket_client_send_text_async()
+ */
+esp_err_t websocket_client_send_binary_async(const uint8_t *data, int len, websocket_send_policy_t policy);
+
+/**
+ * @brief 获取异步发送队列统计
+ */
+esp_err_t websocket_send_queue_get_stats(websocket_send_queue_stats_t *stats);
+
+/**
+ * @brief 设置上行合并模式（可以在任意时刻调用，下一帧生效）
+ *
+ * @param config 配置，传 NULL 使用 WEBSOCKET_BATCH_DEFAULT_CONFIG，max_ms 为0时关闭合并
+ * @return 成功返回 ESP_OK，参数错误返回 ESP_ERR_INVALID_ARG。
+ */
+esp_err_t websocket_client_set_batch(const websocket_batch_config_t *config);
+
+/**
+ * @brief 按合并模式发送一帧二进制数据（只允许上行任务调用）
+ *
+ * 数据先拷贝进合并缓冲区，字节数或时间预算达到时一起发送；flush 为 true 时本帧加入后立即发送。
+ * 合并模式关闭时等同于 websocket_client_send_binary()；异步发送队列运行时消息入队（DROP_OLDEST），不等待发送完成。
+ *
+ * @param data  帧数据
+ * @param len   字节数
+ * @param flush 本帧加入后立即发送（例如唤醒、开始说话）
+ * @return 成功返回 ESP_OK（数据已发送或已进入合并缓冲区），未连接或发送失败返回 ESP_FAIL（缓冲区中的数据被丢弃）。
+ */
+esp_err_t websocket_client_send_binary_batched(const uint8_t *data, int len, bool flush);
+
+/**
+ * @brief 立即发送合并缓冲区中的数据
+ *
+ * @param force false 时只在时间预算到期后才发送（上行任务空闲时轮询）
+ * @return 成功或缓冲区为空返回 ESP_OK，发送失败返回 ESP_FAIL。
+ */
+esp_err_t websocket_client_flush_binary(bool force);
+
+/**
+ * @brief 获取上行合并统计（每秒消息数和节省的CPU按上次设置合并模式以来的时间计算）
+ */
+esp_err_t websocket_client_get_batch_stats(websocket_batch_stats_t *stats);
+
+/**
+ * @brief 获取 WebSocket 收发缓冲区的堆分配统计（分配/释放/复用次数，当前和峰值占用）
+ *
+ * @return 成功返回 ESP_OK，客户端未初始化返回 ESP_ERR_INVALID_STATE。
+ */
+esp_err_t websocket_client_get_buffer_stats(esp_websocket_buffer_stats_t *stats);
+
 /**
  * @brief 检查 WebSocket 客户端当前是否已连接。
  *
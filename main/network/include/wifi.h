@@ -30,5 +30,16 @@ void wifi_scan(void);
  */
 bool wifi_is_connected(void);
 
+/**
+ * @brief 重新连接AP
+ *
+ * 断开后会先快速重试 LIGHT_ESP_MAXIMUM_RETRY 次，都失败后不再重试，由调用者（连接管理）按退避间隔调用本函数。
+ *
+ * @return
+ * - ESP_OK: 已开始连接
+ * - ESP_ERR_INVALID_STATE: 未初始化、已连接或还在快速重试
+ */
+esp_err_t wifi_reconnect(void);
+
 
 #endif // WIFI_H
\ No newline at end of file
@@ -0,0 +1,506 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#include <string.h>
+#include <stdio.h>
+
+#include "websocket_client.h"
+
+#include "udp_audio.h"
+
+static const char *TAG = "UDP_AUDIO";
+
+#define UDP_TASK_STACK_SIZE     (4 * 1024)
+#define UDP_RX_BUF_BYTES        1500    // 以太网MTU，下行数据报不会更大
+#define UDP_RX_TIMEOUT_MS       50      // 接收超时，兼顾探测和关闭请求的响应
+#define UDP_STATS_LOG_MS        10000
+#define UDP_MAX_REDUNDANCY      2
+#define UDP_PROBE_BYTES         (UDP_AUDIO_HEADER_BYTES + 4)
+
+// 任务通知位
+#define UDP_EV_OPEN             BIT0
+#define UDP_EV_CLOSE            BIT1
+
+static udp_audio_config_t s_cfg = UDP_AUDIO_DEFAULT_CONFIG();
+static TaskHandle_t s_task = NULL;
+static SemaphoreHandle_t s_lock = NULL;     // 保护套接字的使用与关闭、发送缓冲区，只创建一次
+static int s_sock = -1;                     // 只由接收任务创建和关闭
+static volatile bool s_active = false;      // 套接字可用（udp_audio_close() 立即清除，上行不再使用）
+static udp_audio_stats_t s_stats;
+
+// 打开请求（WebSocket 事件任务写，接收任务读）
+static char s_host[64];
+static uint16_t s_port = 0;
+static uint32_t s_token = 0;
+static audio_proto_frame_cb_t s_rx_cb = NULL;
+
+// 发送：数据报缓冲区和最近几帧的副本（只由上行任务访问，持锁）
+static uint8_t *s_tx_buf = NULL;
+static uint8_t *s_hist_buf = NULL;          // redundancy 个槽，每个 max_datagram 字节
+static size_t s_hist_len[UDP_MAX_REDUNDANCY];
+static int s_hist_next = 0;                 // 下一次写入的槽
+static int s_hist_count = 0;
+static int s_tx_size = 0;                   // 缓冲区按这个 max_datagram 分配
+static int s_tx_redundancy = 0;
+static uint32_t s_tx_seq = 0;
+
+// 接收：去重窗口（最近64个序号）和丢帧统计（只由接收任务访问）
+static uint8_t *s_rx_buf = NULL;
+static bool s_rx_has_seq = false;
+static uint32_t s_rx_first_seq = 0;
+static uint32_t s_rx_max_seq = 0;
+static uint64_t s_rx_mask = 0;              // bit i：序号 s_rx_max_seq - i 已收到
+
+// 探测（接收任务发送）
+static uint32_t s_probe_seq = 0;
+static uint32_t s_ws_probe_id = 0;
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = v >> 24;
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void write_header(uint8_t *out, udp_audio_type_t type, uint8_t frames, uint32_t seq)
+{
+    out[0] = UDP_AUDIO_VERSION;
+    out[1] = (uint8_t)type;
+    out[2] = frames;
+    out[3] = 0;
+    put_le32(out + 4, seq);
+    put_le32(out + 8, s_token);
+}
+
+/**
+ * @brief 更新往返时间统计（平滑平均和最大值）
+ */
+static void rtt_update(uint32_t rtt_us, uint32_t *avg, uint32_t *max)
+{
+    *avg = *avg == 0 ? rtt_us : (*avg * 7 + rtt_us) / 8;
+    if (rtt_us > *max) {
+        *max = rtt_us;
+    }
+}
+
+// 套接字（接收任务）-----------------------------------------------------------------------
+static void udp_close_socket(void)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_active = false;
+    if (s_sock >= 0) {
+        close(s_sock);
+        s_sock = -1;
+        ESP_LOGI(TAG, "UDP audio closed");
+    }
+    xSemaphoreGive(s_lock);
+}
+
+/**
+ * @brief 解析服务器地址并创建套接字（connect 之后只收服务器的数据报）
+ */
+static esp_err_t udp_open_socket(void)
+{
+    char port[8];
+    snprintf(port, sizeof(port), "%u", s_port);
+    struct addrinfo hints = {
+        .ai_family = AF_INET,
+        .ai_socktype = SOCK_DGRAM,
+    };
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(s_host, port, &hints, &res) != 0 || res == NULL) {
+        ESP_LOGE(TAG, "Failed to resolve %s", s_host);
+        return ESP_FAIL;
+    }
+    int sock = socket(res->ai_family, res->ai_socktype, IPPROTO_UDP);
+    if (sock < 0) {
+        freeaddrinfo(res);
+        ESP_LOGE(TAG, "Failed to create socket: errno %d", errno);
+        return ESP_FAIL;
+    }
+    struct timeval tv = {
+        .tv_sec = 0,
+        .tv_usec = UDP_RX_TIMEOUT_MS * 1000,
+    };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (connect(sock, res->ai_addr, res->ai_addrlen) != 0) {
+        ESP_LOGE(TAG, "Failed to connect socket: errno %d", errno);
+        close(sock);
+        freeaddrinfo(res);
+        return ESP_FAIL;
+    }
+    freeaddrinfo(res);
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_sock = sock;
+    s_hist_next = 0;
+    s_hist_count = 0;
+    s_tx_seq = 0;
+    s_active = true;
+    xSemaphoreGive(s_lock);
+    s_rx_has_seq = false;
+    ESP_LOGI(TAG, "UDP audio open: %s:%u token=%lu redundancy=%d", s_host, s_port, (unsigned long)s_token, s_cfg.redundancy);
+    return ESP_OK;
+}
+
+// 探测-------------------------------------------------------------------------------------
+static void udp_send_probes(void)
+{
+    uint32_t now = (uint32_t)esp_timer_get_time();
+
+    // 1.UDP：服务器原样回送
+    uint8_t probe[UDP_PROBE_BYTES];
+    write_header(probe, UDP_AUDIO_TYPE_PROBE, 0, s_probe_seq++);
+    put_le32(probe + UDP_AUDIO_HEADER_BYTES, now);
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_active && send(s_sock, probe, sizeof(probe), MSG_DONTWAIT) == sizeof(probe)) {
+        s_stats.udp_probes_sent++;
+    }
+    xSemaphoreGive(s_lock);
+
+    // 2.WebSocket：同一时刻走TCP的往返时间（控制队列优先发送，不包括音频排队的时间）
+    char msg[64];
+    snprintf(msg, sizeof(msg), "{\"type\":\"ping\",\"id\":%lu,\"t\":%lu}", (unsigned long)s_ws_probe_id++, (unsigned long)now);
+    esp_err_t ret = websocket_client_send_text_async(msg, WEBSOCKET_SEND_NEVER_DROP);
+    if (ret == ESP_ERR_INVALID_STATE) {
+        ret = websocket_client_send_text(msg);
+    }
+    if (ret == ESP_OK) {
+        s_stats.ws_probes_sent++;
+    }
+}
+
+static void udp_log_stats(void)
+{
+    udp_audio_stats_t st;
+    udp_audio_get_stats(&st);
+    uint32_t udp_loss = st.udp_probes_sent ? (st.udp_probes_sent - st.udp_probes_recv) * 100 / st.udp_probes_sent : 0;
+    uint32_t ws_loss = st.ws_probes_sent ? (st.ws_probes_sent - st.ws_probes_recv) * 100 / st.ws_probes_sent : 0;
+    ESP_LOGI(TAG, "rtt udp avg=%lu max=%lu us loss=%lu%% | ws avg=%lu max=%lu us loss=%lu%%",
+             (unsigned long)st.udp_rtt_avg_us, (unsigned long)st.udp_rtt_max_us, (unsigned long)udp_loss,
+             (unsigned long)st.ws_rtt_avg_us, (unsigned long)st.ws_rtt_max_us, (unsigned long)ws_loss);
+    ESP_LOGI(TAG, "tx datagrams=%lu frames=%lu redundant=%lu errors=%lu | rx frames=%lu recovered=%lu dup=%lu lost=%lu bad=%lu",
+             (unsigned long)st.tx_datagrams, (unsigned long)st.tx_frames, (unsigned long)st.tx_redundant,
+             (unsigned long)st.tx_errors, (unsigned long)st.rx_frames, (unsigned long)st.rx_recovered,
+             (unsigned long)st.rx_duplicates, (unsigned long)st.rx_lost, (unsigned long)st.rx_bad);
+}
+
+// 接收-------------------------------------------------------------------------------------
+/**
+ * @brief 去重：序号是新的（包括迟到但还在窗口内的）返回 true
+ */
+static bool rx_accept(uint32_t seq)
+{
+    if (!s_rx_has_seq) {
+        s_rx_has_seq = true;
+        s_rx_first_seq = seq;
+        s_rx_max_seq = seq;
+        s_rx_mask = 1;
+        return true;
+    }
+    int32_t d = (int32_t)(seq - s_rx_max_seq);
+    if (d > 0) {
+        s_rx_mask = d >= 64 ? 0 : s_rx_mask << d;
+        s_rx_mask |= 1;
+        s_rx_max_seq = seq;
+        return true;
+    }
+    if (-d >= 64 || (s_rx_mask & (1ULL << -d))) {
+        return false;
+    }
+    s_rx_mask |= 1ULL << -d;
+    return true;
+}
+
+/**
+ * @brief 处理一个数据报：音频帧去重后交给下行，探测回送计算往返时间
+ */
+static void udp_handle_datagram(const uint8_t *buf, int len)
+{
+    if (len < UDP_AUDIO_HEADER_BYTES || buf[0] != UDP_AUDIO_VERSION || get_le32(buf + 8) != s_token) {
+        s_stats.rx_bad++;
+        return;
+    }
+    if (buf[1] == UDP_AUDIO_TYPE_PROBE) {
+        if (len >= UDP_PROBE_BYTES) {
+            uint32_t rtt = (uint32_t)esp_timer_get_time() - get_le32(buf + UDP_AUDIO_HEADER_BYTES);
+            s_stats.udp_probes_recv++;
+            rtt_update(rtt, &s_stats.udp_rtt_avg_us, &s_stats.udp_rtt_max_us);
+        }
+        return;
+    }
+    if (buf[1] != UDP_AUDIO_TYPE_AUDIO) {
+        s_stats.rx_bad++;
+        return;
+    }
+
+    // 帧从旧到新排列，冗余副本在前：原来的数据报丢失时先补上旧帧
+    s_stats.rx_datagrams++;
+    int frames = buf[2];
+    size_t off = UDP_AUDIO_HEADER_BYTES;
+    for (int i = 0; i < frames; i++) {
+        audio_proto_header_t hdr;
+        if (audio_proto_parse_header(buf + off, len - off, &hdr) != ESP_OK ||
+                off + AUDIO_PROTO_HEADER_BYTES + hdr.payload_len > (size_t)len) {
+            s_stats.rx_bad++;
+            return;
+        }
+        off += AUDIO_PROTO_HEADER_BYTES;
+        if (!rx_accept(hdr.seq)) {
+            s_stats.rx_duplicates++;
+        } else {
+            s_stats.rx_frames++;
+            if (i < frames - 1) {
+                s_stats.rx_recovered++;
+            }
+            if (s_rx_cb) {
+                s_rx_cb(&hdr, buf + off, hdr.payload_len, 0, NULL);
+            }
+        }
+        off += hdr.payload_len;
+    }
+}
+
+/**
+ * @brief 接收任务：创建/关闭套接字，接收下行数据报，定时探测往返时间
+ *
+ * 通道关闭时阻塞在任务通知上。
+ */
+static void udp_task(void *arg)
+{
+    int64_t next_probe_us = 0;
+    int64_t last_log_us = esp_timer_get_time();
+
+    while (1) {
+        uint32_t ev = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &ev, s_sock < 0 ? portMAX_DELAY : 0);
+        if (ev & (UDP_EV_CLOSE | UDP_EV_OPEN)) {
+            udp_close_socket();
+        }
+        if ((ev & UDP_EV_OPEN) && udp_open_socket() == ESP_OK) {
+            // 立即探测一次，服务器（和NAT）据此记下设备的地址，下行才能发过来
+            next_probe_us = 0;
+        }
+        if (s_sock < 0) {
+            continue;
+        }
+
+        int64_t now = esp_timer_get_time();
+        if (s_cfg.probe_interval_ms > 0 && now >= next_probe_us) {
+            next_probe_us = now + s_cfg.probe_interval_ms * 1000LL;
+            udp_send_probes();
+        }
+        if (now - last_log_us > UDP_STATS_LOG_MS * 1000LL) {
+            last_log_us = now;
+            udp_log_stats();
+        }
+
+        int len = recv(s_sock, s_rx_buf, UDP_RX_BUF_BYTES, 0);
+        if (len > 0) {
+            udp_handle_datagram(s_rx_buf, len);
+        }
+    }
+}
+
+// 公共函数---------------------------------------------------------------------------------
+esp_err_t udp_audio_set_config(const udp_audio_config_t *config)
+{
+    udp_audio_config_t def = UDP_AUDIO_DEFAULT_CONFIG();
+    udp_audio_config_t cfg = config ? *config : def;
+    if (cfg.redundancy < 0 || cfg.redundancy > UDP_MAX_REDUNDANCY || cfg.probe_interval_ms < 0 ||
+            cfg.max_datagram <= UDP_AUDIO_HEADER_BYTES + AUDIO_PROTO_HEADER_BYTES || cfg.max_datagram > UDP_RX_BUF_BYTES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_cfg = cfg;
+    ESP_LOGI(TAG, "UDP audio %s (redundancy %d, max datagram %d bytes, probe %d ms)",
+             cfg.enable ? "on" : "off", cfg.redundancy, cfg.max_datagram, cfg.probe_interval_ms);
+    return ESP_OK;
+}
+
+void udp_audio_get_config(udp_audio_config_t *config)
+{
+    if (config) {
+        *config = s_cfg;
+    }
+}
+
+esp_err_t udp_audio_open(const char *host, uint16_t port, uint32_t token, audio_proto_frame_cb_t rx_cb)
+{
+    if (host == NULL || port == 0 || strlen(host) >= sizeof(s_host)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_cfg.enable) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // 1.第一次打开时创建锁、接收缓冲区和接收任务
+    if (s_lock == NULL) {
+        s_lock = xSemaphoreCreateMutex();
+        if (s_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (s_rx_buf == NULL) {
+        s_rx_buf = (uint8_t *)heap_caps_malloc(UDP_RX_BUF_BYTES, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (s_rx_buf == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    // 2.发送缓冲区按配置（重新）分配
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_active = false;
+    esp_err_t ret = ESP_OK;
+    if (s_tx_size != s_cfg.max_datagram || s_tx_redundancy != s_cfg.redundancy) {
+        heap_caps_free(s_tx_buf);
+        heap_caps_free(s_hist_buf);
+        // 副本槽数可能变化，旧的写入位置不能再用
+        s_hist_next = 0;
+        s_hist_count = 0;
+        s_tx_buf = (uint8_t *)heap_caps_malloc(s_cfg.max_datagram, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        s_hist_buf = s_cfg.redundancy > 0 ?
+                     (uint8_t *)heap_caps_malloc((size_t)s_cfg.redundancy * s_cfg.max_datagram, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT) : NULL;
+        if (s_tx_buf == NULL || (s_cfg.redundancy > 0 && s_hist_buf == NULL)) {
+            heap_caps_free(s_tx_buf);
+            heap_caps_free(s_hist_buf);
+            s_tx_buf = NULL;
+            s_hist_buf = NULL;
+            s_tx_size = 0;
+            s_tx_redundancy = 0;
+            ret = ESP_ERR_NO_MEM;
+        } else {
+            s_tx_size = s_cfg.max_datagram;
+            s_tx_redundancy = s_cfg.redundancy;
+        }
+    }
+    if (ret == ESP_OK) {
+        strcpy(s_host, host);
+        s_port = port;
+        s_token = token;
+        s_rx_cb = rx_cb;
+    }
+    xSemaphoreGive(s_lock);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    if (s_task == NULL && xTaskCreate(udp_task, "udp_audio", UDP_TASK_STACK_SIZE, NULL, s_cfg.task_priority, &s_task) != pdPASS) {
+        s_task = NULL;
+        ESP_LOGE(TAG, "Failed to create UDP task");
+        return ESP_ERR_NO_MEM;
+    }
+    memset(&s_stats, 0, sizeof(s_stats));
+    xTaskNotify(s_task, UDP_EV_OPEN, eSetBits);
+    return ESP_OK;
+}
+
+void udp_audio_close(void)
+{
+    if (s_task == NULL) {
+        return;
+    }
+    // 先停止上行使用，套接字由接收任务关闭
+    s_active = false;
+    xTaskNotify(s_task, UDP_EV_CLOSE, eSetBits);
+}
+
+bool udp_audio_is_open(void)
+{
+    return s_active;
+}
+
+esp_err_t udp_audio_send_frame(const uint8_t *frame, size_t len)
+{
+    if (!s_active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (!s_active) {
+        xSemaphoreGive(s_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (UDP_AUDIO_HEADER_BYTES + len > (size_t)s_tx_size) {
+        xSemaphoreGive(s_lock);
+        s_stats.tx_errors++;
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // 1.从最新的副本往前，数据报放得下几帧就附带几帧
+    size_t budget = s_tx_size - UDP_AUDIO_HEADER_BYTES - len;
+    size_t used = 0;
+    int k = 0;
+    while (k < s_hist_count) {
+        int slot = (s_hist_next - 1 - k + s_tx_redundancy) % s_tx_redundancy;
+        if (used + s_hist_len[slot] > budget) {
+            break;
+        }
+        used += s_hist_len[slot];
+        k++;
+    }
+
+    // 2.副本从旧到新，最后是新帧
+    size_t off = UDP_AUDIO_HEADER_BYTES;
+    write_header(s_tx_buf, UDP_AUDIO_TYPE_AUDIO, (uint8_t)(k + 1), s_tx_seq++);
+    for (int i = k - 1; i >= 0; i--) {
+        int slot = (s_hist_next - 1 - i + s_tx_redundancy) % s_tx_redundancy;
+        memcpy(s_tx_buf + off, s_hist_buf + (size_t)slot * s_tx_size, s_hist_len[slot]);
+        off += s_hist_len[slot];
+    }
+    memcpy(s_tx_buf + off, frame, len);
+    off += len;
+
+    // 3.新帧存为副本，供后面的数据报附带
+    if (s_tx_redundancy > 0) {
+        memcpy(s_hist_buf + (size_t)s_hist_next * s_tx_size, frame, len);
+        s_hist_len[s_hist_next] = len;
+        s_hist_next = (s_hist_next + 1) % s_tx_redundancy;
+        if (s_hist_count < s_tx_redundancy) {
+            s_hist_count++;
+        }
+    }
+
+    // 4.不阻塞发送，协议栈缓冲区满时丢弃（不重传）
+    int sent = send(s_sock, s_tx_buf, off, MSG_DONTWAIT);
+    xSemaphoreGive(s_lock);
+    if (sent != (int)off) {
+        s_stats.tx_errors++;
+        return ESP_FAIL;
+    }
+    s_stats.tx_datagrams++;
+    s_stats.tx_frames++;
+    s_stats.tx_redundant += k;
+    s_stats.tx_bytes += off;
+    return ESP_OK;
+}
+
+void udp_audio_on_ws_pong(uint32_t id, uint32_t t_us)
+{
+    uint32_t rtt = (uint32_t)esp_timer_get_time() - t_us;
+    s_stats.ws_probes_recv++;
+    rtt_update(rtt, &s_stats.ws_rtt_avg_us, &s_stats.ws_rtt_max_us);
+}
+
+esp_err_t udp_audio_get_stats(udp_audio_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *stats = s_stats;
+    // 窗口内的序号范围减去收到的帧数就是最终丢失的帧（迟到的帧在窗口内仍会补上）
+    if (s_rx_has_seq) {
+        uint32_t span = s_rx_max_seq - s_rx_first_seq + 1;
+        stats->rx_lost = span > stats->rx_frames ? span - stats->rx_frames : 0;
+    }
+    return ESP_OK;
+}
@@ -2,11 +2,25 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
 #include "esp_websocket_client.h"
+#include "sdkconfig.h"
+#ifdef CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+#include "esp_crt_bundle.h"
+#endif
 #include "cJSON.h"
 
-#include "max98357_i2s.h"
+#include "audio_player.h"
+#include "opus_downlink.h"
+#include "audio_uplink.h"
+#include "audio_codec.h"
+#include "audio_proto.h"
+#include "udp_audio.h"
 
 // 包含我们自己创建的头文件
 #include "websocket_client.h"
@@ -21,11 +35,54 @@ static const char *TAG = "WEBSOCKET_CLIENT";
 
 // --- 静态变量 (模块内部使用) ---
 static esp_websocket_client_handle_t client = NULL;
+static char s_uri[128] = WEBSOCKET_URI;
 
 static volatile bool is_connecting = false; // 用于标记是否正在连接
+static volatile bool s_task_running = false; // 客户端任务在运行（启动后到 WEBSOCKET_EVENT_FINISH）
+static websocket_conn_cb_t s_conn_cb = NULL;
+static void *s_conn_cb_ctx = NULL;
+static bool s_downlink_opus = false;        // 下行二进制消息是 Opus 包（audio_format 协商），否则为 PCM
+static bool s_downlink_framed = false;      // 下行二进制消息带 audio_proto 帧头（audio_format 协商）
+static bool s_downlink_frame_ok = false;    // 当前下行 PCM 帧已被播放器接受（后续分片继续写入）
+static websocket_tls_config_t s_tls_cfg = WEBSOCKET_TLS_DEFAULT_CONFIG();
+
+// 上行合并发送（缓冲区只由上行任务访问，配置可以由其他任务修改）
+static websocket_batch_config_t s_batch_cfg = {0};
+static uint8_t *s_batch_buf = NULL;
+static int s_batch_size = 0;                // s_batch_buf 的容量
+static int s_batch_len = 0;                 // 已拼接的字节数
+static int s_batch_frames = 0;              // 已拼接的帧数
+static int64_t s_batch_first_us = 0;        // 第一帧进入缓冲区的时间
+static websocket_batch_stats_t s_batch_stats;
+static int64_t s_batch_stats_start_us = 0;
+static uint64_t s_batch_copy_cycles = 0;    // 拼接拷贝的总周期（计算节省的CPU时扣除）
+
+// 异步发送队列：消息槽池 + 空闲队列 + 控制/音频两个待发送队列（都存放 ws_send_msg_t*）
+#define SEND_QUEUE_TASK_STACK_SIZE  (4 * 1024)
+
+typedef struct {
+    uint8_t    *data;
+    int         len;
+    bool        binary;
+    int64_t     enqueue_us;
+} ws_send_msg_t;
+
+static websocket_send_queue_config_t s_sq_cfg;
+static ws_send_msg_t *s_sq_msgs = NULL;
+static uint8_t *s_sq_mem = NULL;
+static QueueHandle_t s_sq_free = NULL;
+static QueueHandle_t s_sq_ctrl = NULL;      // NEVER_DROP 消息，优先发送
+static QueueHandle_t s_sq_data = NULL;      // DROP_OLDEST 消息
+static SemaphoreHandle_t s_sq_lock = NULL;  // 保护入队（取空闲槽/挤掉旧消息）与发送任务退出时的释放，只创建一次
+static volatile bool s_sq_running = false;
+static TaskHandle_t s_sq_task = NULL;
+static websocket_send_queue_stats_t s_sq_stats;
 
 // --- 静态函数声明 ---
 static void websocket_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
+static void downlink_data_cb(const char *data, int len, int payload_offset, int payload_len, bool fin, void *ctx);
+static void downlink_frame_cb(const audio_proto_header_t *hdr, const uint8_t *data, size_t len, size_t offset, void *ctx);
+static void tls_apply_config(esp_websocket_client_config_t *cfg);
 
 // --- 公共函数实现 ---
 // 连接&断开相关--------------------------------------------------------------------------------
@@ -37,9 +94,14 @@ esp_err_t websocket_client_start(void) {
     }
 
     // 1. 创建 WebSocket 客户端配置
+    // 关闭客户端自带的固定间隔重连：断开后客户端任务退出，由调用者（连接管理）决定何时在同一个句柄上重新启动
     esp_websocket_client_config_t websocket_cfg = {
-        .uri = WEBSOCKET_URI,
+        .uri = s_uri,
+        .disable_auto_reconnect = true,
     };
+    if (strncmp(s_uri, "wss://", 6) == 0) {
+        tls_apply_config(&websocket_cfg);
+    }
 
     ESP_LOGI(TAG, "Initializing WebSocket server at %s...", websocket_cfg.uri);
 
@@ -50,13 +112,17 @@ esp_err_t websocket_client_start(void) {
         return ESP_FAIL;
     }
 
-    // 3. 注册事件处理器
+    // 3. 注册事件处理器；下行二进制（音频）直接回调，省掉每个分片一次 esp_event 投递和分发
     esp_websocket_register_events(client, WEBSOCKET_EVENT_ANY, websocket_event_handler, (void *)client);
+    esp_websocket_client_set_data_callback(client, downlink_data_cb, NULL);
     
     // 4. 启动连接
     is_connecting = true;
+    s_task_running = true;
     if (esp_websocket_client_start(client) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start WebSocket client");
+        is_connecting = false;
+        s_task_running = false;
         return ESP_FAIL;
     }
 
@@ -80,33 +146,138 @@ esp_err_t websocket_client_close_clean(void)
         }
     }
     
-    // 2.清理资源
+    // 2.清理资源（销毁前打印收发缓冲区的堆分配次数）
+    esp_websocket_buffer_stats_t bs;
+    if (esp_websocket_client_get_buffer_stats(client, &bs) == ESP_OK) {
+        ESP_LOGI(TAG, "ws buffers: allocs=%lu frees=%lu reuses=%lu held=%lu peak=%lu bytes",
+                 (unsigned long)bs.allocs, (unsigned long)bs.frees, (unsigned long)bs.reuses,
+                 (unsigned long)bs.bytes_held, (unsigned long)bs.bytes_peak);
+    }
     esp_err_t err = esp_websocket_client_destroy(client);
     if (err != ESP_OK) {
          ESP_LOGE(TAG, "Failed to destroy client: %s", esp_err_to_name(err));
     }
     client = NULL;
     is_connecting = false; // 客户端被销毁，重置连接标志
+    s_task_running = false;
 
     ESP_LOGI(TAG, "WebSocket client closed and cleaned.");
 
     return ESP_OK;
 }
 
-// 三、重连WebSocket客户端
+// 三、重连WebSocket客户端：句柄、配置和收发缓冲区池都保留，只重新启动客户端任务
 esp_err_t websocket_reconnect(void)
 {
+    if (client == NULL) {
+        return websocket_client_start();
+    }
     ESP_LOGI(TAG, "Reconnecting WebSocket client...");
 
-    // 关闭连接 & 释放资源
-    websocket_client_close_clean();
+    // 1.客户端任务还在运行（连接中或已连接）时先停止
+    websocket_client_stop();
 
-    // 重新初始化 & 启动
-    websocket_client_start();
+    // 2.在同一个句柄上重新启动
+    is_connecting = true;
+    s_task_running = true;
+    if (esp_websocket_client_start(client) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to restart WebSocket client");
+        is_connecting = false;
+        s_task_running = false;
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
 
+// 四、停止客户端任务（不发送CLOSE，不销毁句柄），例如 Wi-Fi 断开时
+esp_err_t websocket_client_stop(void)
+{
+    if (client == NULL || !s_task_running) {
+        return ESP_OK;
+    }
+    esp_err_t err = esp_websocket_client_stop(client);
+    is_connecting = false;
+    s_task_running = false;
+    return err;
+}
+
+esp_err_t websocket_client_set_uri(const char *uri)
+{
+    if (uri == NULL || strlen(uri) >= sizeof(s_uri)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    strcpy(s_uri, uri);
+    // 已创建的客户端在下一次启动时使用新地址
+    return client ? esp_websocket_client_set_uri(client, s_uri) : ESP_OK;
+}
+
+// wss:// 配置（证书校验 + 会话复用），同时检查 mbedTLS 是否使用了硬件加速
+static void tls_apply_config(esp_websocket_client_config_t *cfg)
+{
+    // 1. 证书：指定的CA证书优先，否则使用内置证书包
+    if (s_tls_cfg.ca_cert_pem) {
+        cfg->cert_pem = s_tls_cfg.ca_cert_pem;
+    } else if (s_tls_cfg.use_crt_bundle) {
+#ifdef CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+        cfg->crt_bundle_attach = esp_crt_bundle_attach;
+#else
+        ESP_LOGE(TAG, "wss: no CA certificate and MBEDTLS_CERTIFICATE_BUNDLE is disabled, handshake will fail");
+#endif
+    }
+    cfg->skip_cert_common_name_check = s_tls_cfg.skip_common_name_check;
+
+    // 2. 会话复用：客户端缓存上次的会话，重连时走简化握手
+    cfg->tls_session_reuse = s_tls_cfg.session_reuse;
+#ifndef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    if (s_tls_cfg.session_reuse) {
+        ESP_LOGW(TAG, "wss: ESP_TLS_CLIENT_SESSION_TICKETS is disabled, every reconnect does a full handshake");
+    }
+#endif
+
+    // 3. 硬件加速：AES/SHA 用于记录层加解密和握手摘要，MPI（大数运算）用于 RSA 签名验证和 ECDHE
+    //    S3 没有 ECC 加速器，椭圆曲线运算由 MPI 加速器承担
+#if !defined(CONFIG_MBEDTLS_HARDWARE_AES) || !defined(CONFIG_MBEDTLS_HARDWARE_SHA) || !defined(CONFIG_MBEDTLS_HARDWARE_MPI)
+    ESP_LOGW(TAG, "wss: MBEDTLS_HARDWARE_AES/SHA/MPI not all enabled in menuconfig, software crypto slows down handshakes");
+#endif
+}
+
+esp_err_t websocket_client_set_tls(const websocket_tls_config_t *config)
+{
+    if (config) {
+        s_tls_cfg = *config;
+    } else {
+        s_tls_cfg = (websocket_tls_config_t)WEBSOCKET_TLS_DEFAULT_CONFIG();
+    }
     return ESP_OK;
 }
 
+// 打印本次连接的TLS握手耗时（完整握手/会话复用）
+static void log_tls_handshake(void)
+{
+    esp_websocket_tls_stats_t ts;
+    if (strncmp(s_uri, "wss://", 6) != 0 || esp_websocket_client_get_tls_stats(client, &ts) != ESP_OK || ts.handshakes == 0) {
+        return;
+    }
+    ESP_LOGI(TAG, "TLS handshake %lu ms (%s); full avg %lu ms, resumed avg %lu ms, resumed %lu/%lu offered (%lu handshakes), failures %lu",
+             (unsigned long)ts.last_ms, ts.last_resumed ? "resumed" : "full",
+             (unsigned long)ts.full_avg_ms, (unsigned long)ts.resumed_avg_ms,
+             (unsigned long)ts.resumed, (unsigned long)ts.offered, (unsigned long)ts.handshakes, (unsigned long)ts.failures);
+}
+
+void websocket_client_set_conn_cb(websocket_conn_cb_t cb, void *ctx)
+{
+    s_conn_cb_ctx = ctx;
+    s_conn_cb = cb;
+}
+
+static void notify_conn(bool connected)
+{
+    websocket_conn_cb_t cb = s_conn_cb;
+    if (cb) {
+        cb(connected, s_conn_cb_ctx);
+    }
+}
+
 
 // 下面的函数用于发送消息到WebSocket服务器------------------------------------------------
 esp_err_t websocket_client_send_text(const char *text) {
@@ -119,13 +290,375 @@ esp_err_t websocket_client_send_text(const char *text) {
     return esp_websocket_client_send_text(client, text, len, portMAX_DELAY);
 }
 
+static esp_err_t send_binary_timeout(const uint8_t *data, int len, TickType_t timeout) {
+    // 上行每秒几十条，逐条打印会占用可观的CPU和串口带宽
+    ESP_LOGD(TAG, "Sending binary data of length %d", len);
+    // 帧头和数据直接交给TCP（writev），不再拷贝进 tx_buffer，也不按 buffer_size 分片；返回发送的字节数，失败时为 -1
+    // 数据只读（加掩码写进客户端的小缓冲区），可以是 flash 中的常量
+    esp_websocket_iovec_t iov = { .data = data, .len = len };
+    uint32_t start = esp_cpu_get_cycle_count();
+    int sent = esp_websocket_client_send_bin_iov(client, &iov, 1, timeout);
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    if (sent < 0) {
+        return ESP_FAIL;
+    }
+    s_batch_stats.messages++;
+    s_batch_stats.send_cycles_avg = s_batch_stats.send_cycles_avg ?
+                                    (s_batch_stats.send_cycles_avg * 15 + cycles) / 16 : cycles;
+    return ESP_OK;
+}
+
 esp_err_t websocket_client_send_binary(const uint8_t *data, int len) {
     if (!websocket_is_connected()) {
         ESP_LOGE(TAG, "Cannot send binary data: WebSocket is not connected.");
         return ESP_FAIL;
     }
-    ESP_LOGI(TAG, "Sending binary data of length %d", len);
-    return esp_websocket_client_send_bin(client, (const char *)data, len, portMAX_DELAY);
+    return send_binary_timeout(data, len, portMAX_DELAY);
+}
+
+// 异步发送队列------------------------------------------------------------------------------
+static void send_queue_free(void) {
+    if (s_sq_data) {
+        vQueueDelete(s_sq_data);
+        s_sq_data = NULL;
+    }
+    if (s_sq_ctrl) {
+        vQueueDelete(s_sq_ctrl);
+        s_sq_ctrl = NULL;
+    }
+    if (s_sq_free) {
+        vQueueDelete(s_sq_free);
+        s_sq_free = NULL;
+    }
+    heap_caps_free(s_sq_mem);
+    s_sq_mem = NULL;
+    free(s_sq_msgs);
+    s_sq_msgs = NULL;
+}
+
+// 发送一条消息并统计入队到发送完成的时间
+static void send_queue_send(ws_send_msg_t *msg) {
+    // 连接断开后队列中的旧消息不再有意义（重连后会重新握手）
+    if (!websocket_is_connected()) {
+        s_sq_stats.dropped_offline++;
+        return;
+    }
+    TickType_t timeout = pdMS_TO_TICKS(s_sq_cfg.send_timeout_ms);
+    esp_err_t ret;
+    if (msg->binary) {
+        ret = send_binary_timeout(msg->data, msg->len, timeout);
+    } else {
+        ESP_LOGI(TAG, "Sending text: %.*s", msg->len, (const char *)msg->data);
+        ret = esp_websocket_client_send_text(client, (const char *)msg->data, msg->len, timeout) >= 0 ? ESP_OK : ESP_FAIL;
+    }
+    if (ret != ESP_OK) {
+        s_sq_stats.send_errors++;
+        return;
+    }
+    uint32_t latency = (uint32_t)(esp_timer_get_time() - msg->enqueue_us);
+    s_sq_stats.sent++;
+    s_sq_stats.latency_avg_us = s_sq_stats.latency_avg_us ? (s_sq_stats.latency_avg_us * 15 + latency) / 16 : latency;
+    if (latency > s_sq_stats.latency_max_us) {
+        s_sq_stats.latency_max_us = latency;
+    }
+}
+
+// 发送任务：控制消息优先，没有消息时等待入队通知
+static void send_queue_task(void *arg) {
+    while (s_sq_running) {
+        ws_send_msg_t *msg = NULL;
+        if (xQueueReceive(s_sq_ctrl, &msg, 0) != pdTRUE && xQueueReceive(s_sq_data, &msg, 0) != pdTRUE) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+            continue;
+        }
+        send_queue_send(msg);
+        xQueueSend(s_sq_free, &msg, 0);
+    }
+
+    // 退出前释放消息槽，持锁防止其他任务同时入队；句柄也在锁内清零，入队者持锁通知时句柄一定有效
+    xSemaphoreTake(s_sq_lock, portMAX_DELAY);
+    send_queue_free();
+    s_sq_task = NULL;
+    xSemaphoreGive(s_sq_lock);
+
+    ESP_LOGI(TAG, "[send_queue_task] finished");
+    vTaskDelete(NULL);
+}
+
+esp_err_t websocket_send_queue_start(const websocket_send_queue_config_t *config) {
+    if (s_sq_task != NULL) {
+        ESP_LOGW(TAG, "Send queue already started");
+        return ESP_OK;
+    }
+
+    websocket_send_queue_config_t def = WEBSOCKET_SEND_QUEUE_DEFAULT_CONFIG();
+    s_sq_cfg = config ? *config : def;
+    if (s_sq_cfg.queue_depth <= 0 || s_sq_cfg.max_msg_bytes <= 0 || s_sq_cfg.send_timeout_ms <= 0) {
+        ESP_LOGE(TAG, "Invalid send queue configuration");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (s_sq_lock == NULL) {
+        s_sq_lock = xSemaphoreCreateMutex();
+        if (s_sq_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    // 1.消息槽放在PSRAM（每条消息只拷贝一次、发送一次），PSRAM不够时退回内部RAM
+    size_t mem_size = (size_t)s_sq_cfg.max_msg_bytes * s_sq_cfg.queue_depth;
+    s_sq_msgs = (ws_send_msg_t *)calloc(s_sq_cfg.queue_depth, sizeof(ws_send_msg_t));
+    s_sq_mem = (uint8_t *)heap_caps_malloc(mem_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (s_sq_mem == NULL) {
+        s_sq_mem = (uint8_t *)heap_caps_malloc(mem_size, MALLOC_CAP_8BIT);
+    }
+    s_sq_free = xQueueCreate(s_sq_cfg.queue_depth, sizeof(ws_send_msg_t *));
+    s_sq_ctrl = xQueueCreate(s_sq_cfg.queue_depth, sizeof(ws_send_msg_t *));
+    s_sq_data = xQueueCreate(s_sq_cfg.queue_depth, sizeof(ws_send_msg_t *));
+    if (!s_sq_msgs || !s_sq_mem || !s_sq_free || !s_sq_ctrl || !s_sq_data) {
+        ESP_LOGE(TAG, "Failed to allocate send queue (%u bytes)", (unsigned)mem_size);
+        send_queue_free();
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < s_sq_cfg.queue_depth; i++) {
+        ws_send_msg_t *msg = &s_sq_msgs[i];
+        msg->data = s_sq_mem + i * s_sq_cfg.max_msg_bytes;
+        xQueueSend(s_sq_free, &msg, 0);
+    }
+    memset(&s_sq_stats, 0, sizeof(s_sq_stats));
+
+    // 2.创建发送任务
+    s_sq_running = true;
+    if (xTaskCreatePinnedToCore(send_queue_task, "ws_send_task", SEND_QUEUE_TASK_STACK_SIZE, NULL,
+                                s_sq_cfg.task_priority, &s_sq_task, s_sq_cfg.task_core) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create send task");
+        s_sq_running = false;
+        s_sq_task = NULL;
+        send_queue_free();
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Send queue started: %d x %d bytes, send timeout %d ms",
+             s_sq_cfg.queue_depth, s_sq_cfg.max_msg_bytes, s_sq_cfg.send_timeout_ms);
+    return ESP_OK;
+}
+
+esp_err_t websocket_send_queue_stop(void) {
+    if (s_sq_task == NULL) {
+        return ESP_OK;
+    }
+    s_sq_running = false;
+    xTaskNotifyGive(s_sq_task);
+
+    // 等待发送任务退出（最多等一条消息的发送超时）
+    int wait_ms = s_sq_cfg.send_timeout_ms + 100;
+    for (int i = 0; i < wait_ms / 10 && s_sq_task != NULL; i++) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    if (s_sq_task != NULL) {
+        ESP_LOGE(TAG, "Send task did not exit in time");
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t send_queue_push_locked(const void *data, int len, bool binary, websocket_send_policy_t policy) {
+    // 没有空闲槽：挤掉最旧的可丢弃消息（控制消息从不被挤掉），都是控制消息时返回 would-block
+    ws_send_msg_t *msg = NULL;
+    if (xQueueReceive(s_sq_free, &msg, 0) != pdTRUE) {
+        if (xQueueReceive(s_sq_data, &msg, 0) != pdTRUE) {
+            s_sq_stats.would_block++;
+            return ESP_ERR_TIMEOUT;
+        }
+        s_sq_stats.dropped_oldest++;
+    }
+    memcpy(msg->data, data, len);
+    msg->len = len;
+    msg->binary = binary;
+    msg->enqueue_us = esp_timer_get_time();
+    xQueueSend(policy == WEBSOCKET_SEND_NEVER_DROP ? s_sq_ctrl : s_sq_data, &msg, 0);
+    s_sq_stats.queued++;
+    uint32_t depth = uxQueueMessagesWaiting(s_sq_ctrl) + uxQueueMessagesWaiting(s_sq_data);
+    if (depth > s_sq_stats.depth_peak) {
+        s_sq_stats.depth_peak = depth;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t send_queue_push(const void *data, int len, bool binary, websocket_send_policy_t policy) {
+    if (!s_sq_running || s_sq_lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (data == NULL || len <= 0 || len > s_sq_cfg.max_msg_bytes) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (!websocket_is_connected()) {
+        return ESP_FAIL;
+    }
+    xSemaphoreTake(s_sq_lock, portMAX_DELAY);
+    esp_err_t ret = s_sq_running ? send_queue_push_locked(data, len, binary, policy) : ESP_ERR_INVALID_STATE;
+    // 在锁内通知：发送任务退出前要先拿到锁才会清零 s_sq_task
+    if (ret == ESP_OK) {
+        xTaskNotifyGive(s_sq_task);
+    }
+    xSemaphoreGive(s_sq_lock);
+    return ret;
+}
+
+esp_err_t websocket_client_send_text_async(const char *text, websocket_send_policy_t policy) {
+    return send_queue_push(text, text ? strlen(text) : 0, false, policy);
+}
+
+esp_err_t websocket_client_send_binary_async(const uint8_t *data, int len, websocket_send_policy_t policy) {
+    return send_queue_push(data, len, true, policy);
+}
+
+esp_err_t websocket_send_queue_get_stats(websocket_send_queue_stats_t *stats) {
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *stats = s_sq_stats;
+    stats->depth = 0;
+    if (s_sq_running && s_sq_lock) {
+        xSemaphoreTake(s_sq_lock, portMAX_DELAY);
+        if (s_sq_ctrl && s_sq_data) {
+            stats->depth = uxQueueMessagesWaiting(s_sq_ctrl) + uxQueueMessagesWaiting(s_sq_data);
+        }
+        xSemaphoreGive(s_sq_lock);
+    }
+    return ESP_OK;
+}
+
+// 上行合并发送------------------------------------------------------------------------------
+esp_err_t websocket_client_set_batch(const websocket_batch_config_t *config) {
+    websocket_batch_config_t def = WEBSOCKET_BATCH_DEFAULT_CONFIG();
+    websocket_batch_config_t cfg = config ? *config : def;
+    if (cfg.max_ms < 0 || (cfg.max_ms > 0 && cfg.max_bytes <= 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_batch_cfg = cfg;
+    memset(&s_batch_stats, 0, sizeof(s_batch_stats));
+    s_batch_copy_cycles = 0;
+    s_batch_stats_start_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "Uplink batching %s (max %d bytes / %d ms)", cfg.max_ms > 0 ? "on" : "off", cfg.max_bytes, cfg.max_ms);
+    return ESP_OK;
+}
+
+// 发送队列运行时上行消息交给发送任务（满时挤掉最旧的），上行任务不会因为TCP阻塞而停顿
+static esp_err_t uplink_send(const uint8_t *data, int len) {
+    if (s_sq_running) {
+        return websocket_client_send_binary_async(data, len, WEBSOCKET_SEND_DROP_OLDEST);
+    }
+    return websocket_client_send_binary(data, len);
+}
+
+// 发送合并缓冲区中的数据（失败时也清空，旧数据不再有意义）
+static esp_err_t batch_send_pending(uint32_t *reason_counter) {
+    if (s_batch_len == 0) {
+        return ESP_OK;
+    }
+    esp_err_t ret = uplink_send(s_batch_buf, s_batch_len);
+    if (ret == ESP_OK) {
+        (*reason_counter)++;
+    }
+    s_batch_len = 0;
+    s_batch_frames = 0;
+    return ret;
+}
+
+esp_err_t websocket_client_send_binary_batched(const uint8_t *data, int len, bool flush) {
+    s_batch_stats.frames++;
+    // 1.合并关闭，或者单帧就超过上限：先发送缓冲区中的数据，再单独发送本帧
+    if (s_batch_cfg.max_ms <= 0 || len >= s_batch_cfg.max_bytes) {
+        batch_send_pending(&s_batch_stats.flush_bytes);
+        return uplink_send(data, len);
+    }
+    if (!websocket_is_connected()) {
+        s_batch_len = 0;
+        s_batch_frames = 0;
+        return ESP_FAIL;
+    }
+
+    // 2.缓冲区按需分配（上限改变时重新分配）
+    if (s_batch_size != s_batch_cfg.max_bytes) {
+        batch_send_pending(&s_batch_stats.flush_bytes);
+        heap_caps_free(s_batch_buf);
+        s_batch_buf = (uint8_t *)heap_caps_malloc(s_batch_cfg.max_bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        s_batch_size = s_batch_buf ? s_batch_cfg.max_bytes : 0;
+        if (s_batch_buf == NULL) {
+            return uplink_send(data, len);
+        }
+    }
+
+    // 3.放不下本帧时先发送
+    esp_err_t ret = ESP_OK;
+    if (s_batch_len + len > s_batch_size) {
+        ret = batch_send_pending(&s_batch_stats.flush_bytes);
+    }
+    if (s_batch_len == 0) {
+        s_batch_first_us = esp_timer_get_time();
+    }
+    uint32_t start = esp_cpu_get_cycle_count();
+    memcpy(s_batch_buf + s_batch_len, data, len);
+    s_batch_copy_cycles += esp_cpu_get_cycle_count() - start;
+    s_batch_len += len;
+    s_batch_frames++;
+
+    // 4.边沿立即发送；缓冲区满或时间预算到期时发送
+    if (flush) {
+        ret = batch_send_pending(&s_batch_stats.flush_edge);
+    } else if (s_batch_len == s_batch_size) {
+        ret = batch_send_pending(&s_batch_stats.flush_bytes);
+    } else if (esp_timer_get_time() - s_batch_first_us >= s_batch_cfg.max_ms * 1000LL) {
+        ret = batch_send_pending(&s_batch_stats.flush_timeout);
+    }
+    return ret;
+}
+
+esp_err_t websocket_client_flush_binary(bool force) {
+    if (s_batch_len == 0) {
+        return ESP_OK;
+    }
+    if (force) {
+        return batch_send_pending(&s_batch_stats.flush_edge);
+    }
+    if (esp_timer_get_time() - s_batch_first_us >= s_batch_cfg.max_ms * 1000LL) {
+        return batch_send_pending(&s_batch_stats.flush_timeout);
+    }
+    return ESP_OK;
+}
+
+esp_err_t websocket_client_get_batch_stats(websocket_batch_stats_t *stats) {
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *stats = s_batch_stats;
+    int64_t elapsed_us = esp_timer_get_time() - s_batch_stats_start_us;
+    if (elapsed_us > 0) {
+        stats->messages_per_sec_x10 = (uint32_t)(stats->messages * 10000000LL / elapsed_us);
+        // 少发的消息数 x 每条消息的发送开销 - 拼接拷贝的开销
+        int64_t saved = 0;
+        if (stats->frames > stats->messages) {
+            saved = (int64_t)(stats->frames - stats->messages) * stats->send_cycles_avg - (int64_t)s_batch_copy_cycles;
+        }
+        int64_t total = elapsed_us * CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+        stats->cpu_saved_permille = saved > 0 ? (uint32_t)(saved * 1000 / total) : 0;
+    }
+    return ESP_OK;
+}
+
+esp_err_t websocket_client_get_buffer_stats(esp_websocket_buffer_stats_t *stats) {
+    if (client == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return esp_websocket_client_get_buffer_stats(client, stats);
+}
+
+esp_err_t websocket_client_get_tls_stats(esp_websocket_tls_stats_t *stats) {
+    if (client == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return esp_websocket_client_get_tls_stats(client, stats);
 }
 
 bool websocket_is_connected(void) {
@@ -148,13 +681,214 @@ static void log_error_if_nonzero(const char *message, int error_code) {
     }
 }
 
+// 连接建立后发送握手消息，告诉服务器上行音频的参数和支持的编码格式（按优先顺序）：
+// {"type":"hello","clock_us":123456789,"uplink":{"sample_rate":16000,"channels":1,"mode":"vad_gate","adaptive":true,"codecs":["ima_adpcm","pcm16"],"framing":["v1"]},
+//  "downlink":{"codecs":["opus","pcm16"],"framing":["v1"]}}
+// 服务器回复 {"type":"hello","uplink_codec":"ima_adpcm","uplink_framing":"v1"} 后上行切换为该格式并在每帧前加帧头；不回复则保持 pcm16、不带帧头
+// adaptive 表示网络拥塞时上行会降码率（见 audio_uplink.h），服务器回复 "uplink_adaptive":true（并且带帧头）后才会切换
+// clock_us 是发送握手时的 esp_timer 时间，服务器用它把帧头中的时间戳对应到自己的时钟
+// 开启了UDP通道时带 "udp":{"version":1,"redundancy":1}，服务器回复 "udp":{"port":5005,"token":1234}（并且协商了帧头）后
+// 音频改走UDP（见 udp_audio.h），控制消息仍走 WebSocket
+// 下行格式由服务器用 audio_format 消息指定，Opus 解码任务没有启动时不声明 opus
+static void send_hello(void) {
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "type", "hello");
+    cJSON_AddNumberToObject(root, "clock_us", (double)esp_timer_get_time());
+    cJSON *uplink = cJSON_AddObjectToObject(root, "uplink");
+    cJSON_AddNumberToObject(uplink, "sample_rate", 16000);
+    cJSON_AddNumberToObject(uplink, "channels", 1);
+    // 合并发送时一条消息包含多帧，最多延迟 batch_ms
+    cJSON_AddNumberToObject(uplink, "batch_ms", s_batch_cfg.max_ms);
+    // 发送模式：vad_gate 只发送语音段（segment 标记），wake_session 只发送唤醒后的会话（session 标记）
+    audio_uplink_gate_config_t gate;
+    audio_uplink_get_gate(&gate);
+    cJSON_AddStringToObject(uplink, "mode", audio_uplink_mode_name(gate.mode));
+    audio_uplink_rate_config_t rate;
+    audio_uplink_get_rate_control(&rate);
+    cJSON_AddBoolToObject(uplink, "adaptive", rate.enable);
+    cJSON *codecs = cJSON_AddArrayToObject(uplink, "codecs");
+    const audio_codec_type_t prefs[] = {AUDIO_CODEC_IMA_ADPCM, AUDIO_CODEC_PCM16};
+    for (int i = 0; i < sizeof(prefs) / sizeof(prefs[0]); i++) {
+        cJSON_AddItemToArray(codecs, cJSON_CreateString(audio_codec_get(prefs[i])->name));
+    }
+    cJSON_AddItemToArray(cJSON_AddArrayToObject(uplink, "framing"), cJSON_CreateString(AUDIO_PROTO_NAME));
+    cJSON *downlink = cJSON_AddObjectToObject(root, "downlink");
+    cJSON *dl_codecs = cJSON_AddArrayToObject(downlink, "codecs");
+    if (opus_downlink_is_running()) {
+        cJSON_AddItemToArray(dl_codecs, cJSON_CreateString("opus"));
+    }
+    cJSON_AddItemToArray(dl_codecs, cJSON_CreateString("pcm16"));
+    cJSON_AddItemToArray(cJSON_AddArrayToObject(downlink, "framing"), cJSON_CreateString(AUDIO_PROTO_NAME));
+    udp_audio_config_t udp_cfg;
+    udp_audio_get_config(&udp_cfg);
+    if (udp_cfg.enable) {
+        cJSON *udp = cJSON_AddObjectToObject(root, "udp");
+        cJSON_AddNumberToObject(udp, "version", UDP_AUDIO_VERSION);
+        cJSON_AddNumberToObject(udp, "redundancy", udp_cfg.redundancy);
+    }
+    char *text = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (text) {
+        websocket_client_send_text(text);
+        cJSON_free(text);
+    }
+}
+
+// 从 s_uri（ws://host:port/path）中取出主机名，UDP通道使用同一个主机
+static bool uri_get_host(char *host, size_t len) {
+    const char *p = strstr(s_uri, "://");
+    p = p ? p + 3 : s_uri;
+    size_t n = strcspn(p, ":/");
+    if (n == 0 || n >= len) {
+        return false;
+    }
+    memcpy(host, p, n);
+    host[n] = '\0';
+    return true;
+}
+
+// 处理服务器的文本控制消息，例如下行音频格式：{"type":"audio_format","sample_rate":24000}
+// 或 {"type":"audio_format","codec":"opus"}（之后每条二进制消息是一个 Opus 包，不带 codec 时为 pcm16）
+// 带 "framing":"v1" 时下行每帧前面有 audio_proto 帧头，帧头中的编码格式优先于 codec
+static void handle_text_message(const char *text, int len) {
+    cJSON *root = cJSON_ParseWithLength(text, len);
+    if (root == NULL) {
+        return;
+    }
+    const cJSON *type = cJSON_GetObjectItem(root, "type");
+    if (cJSON_IsString(type) && strcmp(type->valuestring, "audio_format") == 0) {
+        const cJSON *codec = cJSON_GetObjectItem(root, "codec");
+        const cJSON *rate = cJSON_GetObjectItem(root, "sample_rate");
+        bool opus = cJSON_IsString(codec) && strcmp(codec->valuestring, "opus") == 0;
+        if (opus && !opus_downlink_is_running()) {
+            ESP_LOGW(TAG, "Opus downlink requested but decoder is not running, audio will be dropped");
+        }
+        s_downlink_opus = opus;
+        const cJSON *framing = cJSON_GetObjectItem(root, "framing");
+        s_downlink_framed = cJSON_IsString(framing) && strcmp(framing->valuestring, AUDIO_PROTO_NAME) == 0;
+        audio_proto_rx_reset();
+        if (opus) {
+            // Opus 直接解码到播放器的采样率，sample_rate 只表示服务器编码时的采样率
+            opus_downlink_reset();
+            audio_player_set_input_rate(16000);
+            ESP_LOGI(TAG, "Downlink codec: opus");
+        } else if (cJSON_IsNumber(rate)) {
+            esp_err_t ret = audio_player_set_input_rate(rate->valueint);
+            if (ret != ESP_OK) {
+                ESP_LOGW(TAG, "Unsupported downlink sample rate %d: %s", rate->valueint, esp_err_to_name(ret));
+            }
+        }
+    } else if (cJSON_IsString(type) && strcmp(type->valuestring, "hello") == 0) {
+        // 握手回复：服务器选定的上行编码格式
+        const cJSON *codec_name = cJSON_GetObjectItem(root, "uplink_codec");
+        if (cJSON_IsString(codec_name)) {
+            const audio_codec_iface_t *codec = audio_codec_find(codec_name->valuestring);
+            if (codec) {
+                audio_uplink_set_codec(codec->type);
+                ESP_LOGI(TAG, "Uplink codec negotiated: %s", codec->name);
+            } else {
+                ESP_LOGW(TAG, "Server selected unsupported uplink codec '%s', keep pcm16", codec_name->valuestring);
+            }
+        }
+        const cJSON *framing = cJSON_GetObjectItem(root, "uplink_framing");
+        if (cJSON_IsString(framing) && strcmp(framing->valuestring, AUDIO_PROTO_NAME) == 0) {
+            audio_uplink_set_framing(true);
+            ESP_LOGI(TAG, "Uplink framing negotiated: %s", AUDIO_PROTO_NAME);
+        }
+        const cJSON *adaptive = cJSON_GetObjectItem(root, "uplink_adaptive");
+        if (cJSON_IsTrue(adaptive)) {
+            audio_uplink_set_adaptive(true);
+            ESP_LOGI(TAG, "Uplink adaptive rate accepted");
+        }
+        // UDP通道：数据报中的每帧都带帧头，没有协商帧头时不使用
+        const cJSON *udp = cJSON_GetObjectItem(root, "udp");
+        const cJSON *port = cJSON_GetObjectItem(udp, "port");
+        const cJSON *token = cJSON_GetObjectItem(udp, "token");
+        char host[64];
+        if (cJSON_IsNumber(port) && cJSON_IsNumber(token) && audio_uplink_get_framing() && uri_get_host(host, sizeof(host))) {
+            esp_err_t ret = udp_audio_open(host, (uint16_t)port->valueint, (uint32_t)token->valuedouble, downlink_frame_cb);
+            if (ret != ESP_OK) {
+                ESP_LOGW(TAG, "UDP audio not opened (%s), audio stays on WebSocket", esp_err_to_name(ret));
+            }
+        }
+    } else if (cJSON_IsString(type) && strcmp(type->valuestring, "pong") == 0) {
+        // UDP通道的对比探测：{"type":"pong","id":序号,"t":ping中的时间}
+        const cJSON *id = cJSON_GetObjectItem(root, "id");
+        const cJSON *t = cJSON_GetObjectItem(root, "t");
+        if (cJSON_IsNumber(id) && cJSON_IsNumber(t)) {
+            udp_audio_on_ws_pong((uint32_t)id->valuedouble, (uint32_t)t->valuedouble);
+        }
+    }
+    cJSON_Delete(root);
+}
+
+// 下行带帧头时每拆出一段帧数据回调一次：Opus 包按序号交给解码任务（丢失/乱序由解码任务补偿），
+// PCM 帧的第一段按序号放入抖动缓冲（迟到的帧被丢弃），同一帧的后续分片跟着写入
+static void downlink_frame_cb(const audio_proto_header_t *hdr, const uint8_t *data, size_t len, size_t offset, void *ctx) {
+    if (hdr->codec == AUDIO_PROTO_CODEC_OPUS) {
+        // Opus 包必须完整才能解码，跨分片的包直接丢弃
+        if (offset != 0 || len != hdr->payload_len) {
+            ESP_LOGW(TAG, "Fragmented Opus frame seq=%lu (%u bytes), dropped", (unsigned long)hdr->seq, hdr->payload_len);
+        } else if (opus_downlink_push_seq(hdr->seq, data, len) != ESP_OK) {
+            ESP_LOGD(TAG, "Opus decoder not running or invalid packet, dropped %d bytes", (int)len);
+        }
+    } else if (hdr->codec == AUDIO_PROTO_CODEC_PCM16) {
+        if (offset == 0) {
+            s_downlink_frame_ok = audio_player_enqueue_seq(hdr->seq, data, len) == ESP_OK;
+        } else if (s_downlink_frame_ok) {
+            audio_player_enqueue(data, len);
+        }
+    } else if (offset == 0) {
+        ESP_LOGW(TAG, "Unsupported downlink frame codec %u, dropped", hdr->codec);
+    }
+}
+
+// 下行二进制数据（音频流）：由 WebSocket 客户端任务对每个分片直接调用，不经过 esp_event 事件循环
+// 这里运行在WebSocket客户端任务中，只把数据放入播放器的抖动缓冲或解码队列，不能阻塞
+static void downlink_data_cb(const char *data, int len, int payload_offset, int payload_len, bool fin, void *ctx) {
+    ESP_LOGV(TAG, "Received binary data of length %d, offset %d, payload length: %d", len, payload_offset, payload_len);
+    if (s_downlink_framed) {
+        // 帧头和数据可能跨分片，由解析器拆帧后回调
+        audio_proto_rx_feed((const uint8_t *)data, len, payload_offset == 0, downlink_frame_cb, NULL);
+    } else if (s_downlink_opus) {
+        // 一条消息是一个完整的 Opus 包，交给解码任务；超过接收缓冲区被分片的包无法解码，直接丢弃
+        if (len != payload_len) {
+            if (payload_offset == 0) {
+                ESP_LOGW(TAG, "Fragmented Opus packet (%d bytes), dropped", payload_len);
+            }
+        } else if (opus_downlink_push(data, len) != ESP_OK) {
+            ESP_LOGD(TAG, "Opus decoder not running or invalid packet, dropped %d bytes", len);
+        }
+    } else if (audio_player_enqueue(data, len) != ESP_OK) {
+        ESP_LOGD(TAG, "Audio player not running, dropped %d bytes", len);
+    }
+}
+
+static void log_downlink_rx_stats(void) {
+    audio_proto_rx_stats_t rx;
+    if (s_downlink_framed && audio_proto_get_rx_stats(&rx) == ESP_OK && rx.frames > 0) {
+        ESP_LOGI(TAG, "downlink frames=%lu lost=%lu reordered=%lu bad=%lu jitter=%lu us",
+                 (unsigned long)rx.frames, (unsigned long)rx.lost, (unsigned long)rx.reordered,
+                 (unsigned long)rx.bad_headers, (unsigned long)rx.jitter_us);
+    }
+}
+
 static void websocket_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data) {
     esp_websocket_event_data_t *data = (esp_websocket_event_data_t *)event_data;
     switch (event_id) {
         case WEBSOCKET_EVENT_CONNECTED:
             ESP_LOGI(TAG, "WEBSOCKET_EVENT_CONNECTED: Connection established.");
             is_connecting = false; // 连接成功，重置标志
-            // TODO: 在这里可以发送一个初始的握手消息或设置一个准备就绪的标志
+            log_tls_handshake();
+            // 握手完成前按 pcm16 上行，兼容不支持握手的服务器
+            audio_uplink_set_codec(AUDIO_CODEC_PCM16);
+            audio_uplink_set_framing(false);
+            audio_uplink_set_adaptive(false);
+            udp_audio_close();
+            s_downlink_opus = false;
+            s_downlink_framed = false;
+            send_hello();
+            notify_conn(true);
             break;
         // 注意：不能在此处调用 websocket_client_cleanup()，因为这里是在client的事件处理上下文中，
         //      destroy的话会释放client资源，即释放掉当前资源，会出错
@@ -163,14 +897,22 @@ static void websocket_event_handler(void *handler_args, esp_event_base_t base, i
             // 异常断开连接
             ESP_LOGE(TAG, "WEBSOCKET_EVENT_DISCONNECTED");
             is_connecting = false; // 连接断开，重置连接标志
-            // 此事件可用于在需要时触发重连逻辑
-            // websocket_client_cleanup();
+            log_downlink_rx_stats();
+            udp_audio_close();
+            // 连接失败也会走到这里；重连由连接管理按退避时间决定
+            notify_conn(false);
             break;
         case WEBSOCKET_EVENT_CLOSED:
             // 正常关闭连接（可能是服务器断开，也可能是客户端主动断开）
             ESP_LOGI(TAG, "WEBSOCKET_EVENT_CLOSED: Connection closed.");
             is_connecting = false; // 连接关闭，重置连接标志
-            // websocket_client_cleanup();
+            log_downlink_rx_stats();
+            udp_audio_close();
+            notify_conn(false);
+            break;
+        case WEBSOCKET_EVENT_FINISH:
+            // 客户端任务即将退出（关闭了自动重连，断开后任务会结束）
+            s_task_running = false;
             break;
         case WEBSOCKET_EVENT_DATA:
             ESP_LOGV(TAG, "WEBSOCKET_EVENT_DATA received");
@@ -180,19 +922,11 @@ static void websocket_event_handler(void *handler_args, esp_event_base_t base, i
             if (data->op_code == WS_TRANSPORT_OPCODES_TEXT) {
                 // 处理文本数据 (例如: JSON格式的控制消息)
                 ESP_LOGI(TAG, "Received text data: %.*s", data->data_len, (char *)data->data_ptr);
-                // 示例: 解析 session_id 或 stream_end 信号
-                // cJSON *root = cJSON_ParseWithLength(data->data_ptr, data->data_len);
-                // if (root) {
-                //     // 处理JSON...
-                //     cJSON_Delete(root);
-                // }
+                handle_text_message(data->data_ptr, data->data_len);
 
             } else if (data->op_code == WS_TRANSPORT_OPCODES_BINARY) {
-                // 处理二进制数据 (例如: 音频流)
-                ESP_LOGI(TAG, "Received binary data of length %d, payload length: %d", data->data_len, data->payload_len);
-                // TODO: 将此音频数据送入音频播放任务的队列中
-                // audio_player_enqueue(data->data_ptr, data->data_len);
-                max98357_i2s_write(data->data_ptr, data->data_len, NULL, portMAX_DELAY);
+                // 注册了直接回调时二进制消息不会走到这里
+                downlink_data_cb(data->data_ptr, data->data_len, data->payload_offset, data->payload_len, data->fin, NULL);
             }
             break;
         case WEBSOCKET_EVENT_ERROR:
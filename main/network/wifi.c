@@ -139,6 +139,26 @@ bool wifi_is_connected(void)
 }
 
 
+/**
+ * @brief 快速重试用完后重新连接AP（连接管理按退避间隔调用）
+ */
+esp_err_t wifi_reconnect(void)
+{
+    if (s_wifi_event_group == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // 还在快速重试或已经连上：不打断
+    EventBits_t bits = xEventGroupGetBits(s_wifi_event_group);
+    if ((bits & WIFI_FAIL_BIT) == 0 || (bits & WIFI_CONNECTED_BIT) != 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xEventGroupClearBits(s_wifi_event_group, WIFI_FAIL_BIT);
+    s_retry_num = 0;
+    ESP_LOGI(TAG, "Reconnecting to AP: %s...", wifi_config_data.ssid);
+    return esp_wifi_connect();
+}
+
+
 // --- 内部静态函数实现 ---
 
 // 模拟用户输入WiFi凭据的函数
@@ -9,10 +9,19 @@
 #include "network/include/wifi.h"
 #include "network/include/http_request.h"
 #include "network/include/websocket_client.h"
+#include "network/include/conn_supervisor.h"
+#include "network/include/udp_audio.h"
 #include "audio/include/audio_echo.h"
 #include "audio/include/inmp441_i2s.h"
 #include "audio/include/max98357_i2s.h"
 #include "audio/include/i2s_pins.h"
+#include "audio/include/pcm_convert.h"
+#include "audio/include/audio_player.h"
+#include "audio/include/audio_mixer.h"
+#include "audio/include/opus_downlink.h"
+#include "audio/include/resampler.h"
+#include "audio/include/i2s_latency.h"
+#include "audio/include/audio_codec.h"
 #include "sr/include/sr.h"
 
 static const char *TAG = "app_main";
@@ -22,6 +31,11 @@ static const char *TAG = "app_main";
 void test_psram();
 void test_websocket();
 void test_echo();
+void test_echo_latency();
+void test_pcm_convert();
+void test_resampler();
+void test_i2s_latency();
+void test_audio_codec();
 
 void test_receive_audio();
 void test_send_audio();
@@ -43,6 +57,11 @@ void app_main(void)
     // test_websocket();
     // ESP_LOGI(TAG, "------------------------------------------------------");
     // test_echo();
+    // test_echo_latency();
+    // test_pcm_convert();
+    // test_resampler();
+    // test_i2s_latency();
+    // test_audio_codec();
     
     test_send_audio();
     // test_receive_audio();
@@ -86,41 +105,28 @@ void test_receive_audio() {
         ESP_LOGE(TAG, "Failed to initialize MAX98357 driver");
         vTaskDelete(NULL);
     }
+    // 4. 启动混音器和下行播放器，WebSocket收到的音频经抖动缓冲后播放
+    if (audio_mixer_start(NULL) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start audio mixer");
+        vTaskDelete(NULL);
+    }
+    if (audio_player_start(NULL) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start audio player");
+        vTaskDelete(NULL);
+    }
+    if (opus_downlink_start(NULL) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to start Opus decoder, downlink limited to PCM");
+    }
 
 
     wifi_init_sta();
-    ESP_LOGI(TAG, "Wi-Fi initialized, starting audio and speech recognition...");
-
-    while (1) {
-        // 等待直到Wi-Fi连接成功
-        if (wifi_is_connected()) {
-            if (!websocket_is_initialized()) {
-                // 1.客户端未初始化 -> 初始化WebSocket客户端，并连接到服务器
-                ESP_LOGI(TAG, "Wi-Fi is ready, initializing & starting WebSocket client...");
-                websocket_client_start();
-            } else if (!websocket_is_connected()) {
-                // 2.客户端已初始化，但未连接到服务器 -> 
-                //  i.正在连接中
-                if (websocket_is_connecting()) {
-                    ESP_LOGI(TAG, "WebSocket client is connecting, waiting...");
-                } else {
-                    // ii.未连接，尝试重连
-                    ESP_LOGI(TAG, "WebSocket client is not connected, attempting to reconnect...");
-                    websocket_reconnect();
-                }
-            } else {
-                break;
-            }
-        } else {
-            ESP_LOGW(TAG, "Wi-Fi is not connected. Waiting...");
-            // 如果Wi-Fi断开, 确保WebSocket客户端也停止
-            if (websocket_is_connected()) {
-                ESP_LOGI(TAG, "Wi-Fi connection lost, stopping WebSocket client.");
-                websocket_client_close_clean();
-            }
-            vTaskDelay(pdMS_TO_TICKS(1000));
-        }
+    // 连接管理：由 Wi-Fi/IP/WebSocket 事件驱动，断开后按指数退避（加随机抖动）重连，等待期间不占CPU
+    if (conn_supervisor_start(NULL) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start connection supervisor");
+        vTaskDelete(NULL);
     }
+    ESP_LOGI(TAG, "Wi-Fi initialized, waiting for WebSocket connection...");
+    conn_supervisor_wait_connected(-1);
     
     
     ESP_LOGI(TAG, "Audio drivers initialized.");
@@ -129,39 +135,18 @@ void test_receive_audio() {
 
 
 void test_send_audio() {
+    // 音频改走UDP（服务器支持时），控制消息仍走 WebSocket；测试服务器见 tools/udp_audio_server.py
+    // udp_audio_config_t udp_cfg = UDP_AUDIO_DEFAULT_CONFIG();
+    // udp_cfg.enable = true;
+    // udp_audio_set_config(&udp_cfg);
     wifi_init_sta();
-    ESP_LOGI(TAG, "Wi-Fi initialized, starting audio and speech recognition...");
-
-    while (1) {
-        // 等待直到Wi-Fi连接成功
-        if (wifi_is_connected()) {
-            if (!websocket_is_initialized()) {
-                // 1.客户端未初始化 -> 初始化WebSocket客户端，并连接到服务器
-                ESP_LOGI(TAG, "Wi-Fi is ready, initializing & starting WebSocket client...");
-                websocket_client_start();
-            } else if (!websocket_is_connected()) {
-                // 2.客户端已初始化，但未连接到服务器 -> 
-                //  i.正在连接中
-                if (websocket_is_connecting()) {
-                    ESP_LOGI(TAG, "WebSocket client is connecting, waiting...");
-                } else {
-                    // ii.未连接，尝试重连
-                    ESP_LOGI(TAG, "WebSocket client is not connected, attempting to reconnect...");
-                    websocket_reconnect();
-                }
-            } else {
-                break;
-            }
-        } else {
-            ESP_LOGW(TAG, "Wi-Fi is not connected. Waiting...");
-            // 如果Wi-Fi断开, 确保WebSocket客户端也停止
-            if (websocket_is_connected()) {
-                ESP_LOGI(TAG, "Wi-Fi connection lost, stopping WebSocket client.");
-                websocket_client_close_clean();
-            }
-            vTaskDelay(pdMS_TO_TICKS(1000));
-        }
+    // 连接管理：由 Wi-Fi/IP/WebSocket 事件驱动，断开后按指数退避（加随机抖动）重连，等待期间不占CPU
+    if (conn_supervisor_start(NULL) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start connection supervisor");
+        vTaskDelete(NULL);
     }
+    ESP_LOGI(TAG, "Wi-Fi initialized, waiting for WebSocket connection...");
+    conn_supervisor_wait_connected(-1);
     ESP_LOGI(TAG, "Audio drivers initialized.");
 
     sr_start();
@@ -187,6 +172,55 @@ void test_echo() {
     ESP_LOGI(TAG, "Audio echo test completed.");
 }
 
+void test_echo_latency() {
+    ESP_LOGI(TAG, "Testing acoustic round-trip latency...");
+
+    // 扬声器需要对着麦克风，每种DMA配置测量20次
+    esp_err_t ret = audio_echo_benchmark(20);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Round-trip latency benchmark failed: %s", esp_err_to_name(ret));
+    }
+}
+
+void test_pcm_convert() {
+    ESP_LOGI(TAG, "Testing 32-bit -> 16-bit PCM conversion...");
+
+    // AFE feed 帧长为512个采样（32ms @ 16kHz）
+    esp_err_t ret = pcm_convert_benchmark(512, 1000);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "PCM conversion benchmark failed: %s", esp_err_to_name(ret));
+    }
+}
+
+void test_resampler() {
+    ESP_LOGI(TAG, "Testing downlink resampler...");
+
+    esp_err_t ret = resampler_benchmark();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Resampler benchmark failed: %s", esp_err_to_name(ret));
+    }
+}
+
+void test_i2s_latency() {
+    ESP_LOGI(TAG, "Testing I2S DMA latency profiles...");
+
+    // chunk 取 AFE feed 帧长（512个采样），每个档位回放5秒
+    esp_err_t ret = i2s_latency_benchmark(512, 5000);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "I2S latency benchmark failed: %s", esp_err_to_name(ret));
+    }
+}
+
+void test_audio_codec() {
+    ESP_LOGI(TAG, "Testing uplink audio codec...");
+
+    // 上行帧长与AFE fetch帧长一致（512个采样，32ms @ 16kHz）
+    esp_err_t ret = audio_codec_benchmark(512, 1000);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Audio codec benchmark failed: %s", esp_err_to_name(ret));
+    }
+}
+
 void test_psram() {
     ESP_LOGI(TAG, "Testing PSRAM...");
 
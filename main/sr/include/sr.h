@@ -27,4 +27,13 @@ esp_err_t sr_start(void);
  */
 esp_err_t sr_stop(void);
 
+/**
+ * @brief 获取最近一次有效的说话人方向（双麦阵列时可用）
+ *
+ * 唤醒事件发生时的方向也会随唤醒消息 {"type":"wake","doa":N} 发送给服务器。
+ *
+ * @return 方向角（0 ~ 180 度，以两个麦克风的连线为基准），单麦或还没有检测到声音时为 -1
+ */
+float sr_get_doa(void);
+
 #endif
@@ -3,6 +3,8 @@
 #include "freertos/queue.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_timer.h"
+#include <string.h>
 
 #include "esp_mn_models.h"
 #include "model_path.h"
@@ -11,12 +13,19 @@
 #include "esp_wn_models.h"
 #include "esp_afe_sr_models.h"
 #include "esp_afe_sr_iface.h"
+#include "esp_afe_doa.h"
 #include "esp_mn_speech_commands.h"
 
 #include "inmp441_i2s.h"
 #include "max98357_i2s.h"
 #include "i2s_pins.h"
 #include "websocket_client.h"
+#include "audio_bus.h"
+#include "audio_uplink.h"
+#include "audio_player.h"
+#include "opus_downlink.h"
+#include "audio_mixer.h"
+#include "aec_ref.h"
 
 #include "sr.h"
 
@@ -24,11 +33,44 @@ static const char *TAG = "sr";
 
 #define AUDIO_SAMPLE_RATE     (16000)
 #define AUDIO_BITS_PER_SAMPLE (I2S_DATA_BIT_WIDTH_16BIT)
+// 麦克风按原生32位slot采集，驱动内转换为16位PCM后再送入AFE
+#define MIC_BITS_PER_SAMPLE   (I2S_DATA_BIT_WIDTH_32BIT)
+#define MIC_GAIN_SHIFT        (1)
+
+// 全双工：扬声器输出回采为参考通道，AFE输入格式 "MR" 并开启AEC（播放时也能唤醒/打断）
+#define SR_AEC_ENABLE         (1)
+// 延迟校准失败时使用的默认扬声器->麦克风延迟
+#define SR_AEC_DEFAULT_DELAY_MS (8)
+
+// 麦克风数量：1 = 单个INMP441（左声道）；2 = 双INMP441阵列（L/R引脚分别接地/接VDD，共用数据线）
+// 双麦时按立体声采集，AFE输入格式 "MM(R)"，开启麦克风阵列语音增强，并估计说话人方向（DOA）
+// 默认单麦（现有板子只接了一个INMP441，右声道没有数据），接好第二个麦克风后改为2开启阵列模式
+#define SR_MIC_NUM            (1)
+#define SR_MIC_SPACING_M      (0.06f)   // 两个麦克风的间距（米）
+#define SR_DOA_RESOLUTION_DEG (20.0f)   // DOA角度搜索分辨率
+#define SR_DOA_MIN_RMS        (300)     // 低于该能量的帧不更新方向（静音时的估计没有意义）
+
+// I2S DMA缓冲延迟档位：麦克风和扬声器的DMA缓冲区按AFE feed chunk推算（见 i2s_latency.h）
+#define SR_I2S_LATENCY        (I2S_LATENCY_BALANCED)
+
+// 音频帧总线：帧池大小和扬声器订阅队列深度
+#define SR_BUS_POOL_SIZE      (16)
+#define SR_SPEAKER_QUE_DEPTH  (4)
+#define SR_TASK_STOP_TIMEOUT_MS (3000)  // 等待总线任务退出；AFE fetch默认超时2000ms
+// 麦克风读取超时，超时后重新检查 task_flag，保证 sr_stop 能等到 feed_Task 退出
+#define SR_FEED_READ_TIMEOUT_MS (100)
+// VAD：确认为语音/静音的最短时间（vad_cache 覆盖确认语音之前的部分）
+#define SR_VAD_MIN_SPEECH_MS  (128)
+#define SR_VAD_MIN_NOISE_MS   (320)
+// 麦克风监听在混音器中的增益，以及下行语音/提示音播放时被压低后的增益
+#define SR_MONITOR_GAIN       (1.0f)
+#define SR_MONITOR_DUCK_GAIN  (0.2f)
 
 typedef struct {
     wakenet_state_t     wakenet_mode;
     esp_mn_state_t      state;
     int                 command_id;
+    float               doa_deg;        // 唤醒时说话人的方向（度），单麦时为 -1
 } sr_result_t;
 
 // AFE 句柄与实例
@@ -41,6 +83,13 @@ static model_iface_data_t *model_data = NULL;
 static QueueHandle_t g_result_que = NULL;
 
 static volatile bool task_flag = false;
+static TaskHandle_t s_feed_task = NULL;     // 读取麦克风和AEC参考信号，喂给AFE
+static TaskHandle_t s_detect_task = NULL;   // 音频总线发布者
+static TaskHandle_t s_speaker_task = NULL;  // 音频总线订阅者
+// 扬声器回放任务在混音器中的输入流
+static audio_mixer_stream_handle_t s_monitor_stream = NULL;
+// 最近一次有效的说话人方向（度），-1 表示未知
+static volatile float s_doa_deg = -1.0f;
 static bool detect_flag = false;
 
 static const char *cmd_phoneme[] = {
@@ -57,6 +106,7 @@ static const char *cmd_phoneme[] = {
 static void feed_Task(void*);
 static void detect_Task(void*);
 static void sr_handler_task(void*);
+static void speaker_Task(void*);
 
 /**
  * @brief 启动语音识别
@@ -71,10 +121,19 @@ esp_err_t sr_start(void)
     // 1.获取所有模型 - 首先尝试使用嵌入式模型
     srmodel_list_t *models = esp_srmodel_init("model");
     // 2.afe配置（包含了各种afe模型的配置）
-    afe_config_t *afe_config = afe_config_init("M", models, AFE_TYPE_SR, AFE_MODE_LOW_COST);
-
-    // 默认就是关闭AEC回声消除（如果使用喇叭就需要用）
-    // afe_config->aec_init = false;
+    const char *input_format = (SR_MIC_NUM == 2) ? (SR_AEC_ENABLE ? "MMR" : "MM") : (SR_AEC_ENABLE ? "MR" : "M");
+    afe_config_t *afe_config = afe_config_init(input_format, models, AFE_TYPE_SR, AFE_MODE_LOW_COST);
+
+    // AEC回声消除：参考通道为扬声器实际输出的数据（见 aec_ref.c）
+    afe_config->aec_init = SR_AEC_ENABLE;
+    // 双麦：麦克风阵列语音增强（波束形成/盲源分离），唤醒词在各输出通道上检测
+    afe_config->se_init = (SR_MIC_NUM == 2);
+    // VAD：上行按语音段发送（见 audio_uplink.h），VAD确认语音之前被判为静音的起始部分由 vad_cache 补回
+    afe_config->vad_init = true;
+    afe_config->vad_mode = VAD_MODE_1;
+    afe_config->vad_min_speech_ms = SR_VAD_MIN_SPEECH_MS;
+    afe_config->vad_min_noise_ms = SR_VAD_MIN_NOISE_MS;
+    afe_config->vad_delay_ms = SR_VAD_MIN_SPEECH_MS;
     // 过滤得到第一个包含 "wn" 前缀的唤醒词模型名称（第一个wakenet）
     afe_config->wakenet_model_name = esp_srmodel_filter(models, ESP_WN_PREFIX, NULL);
     // afe_config->wakenet_model_name_2 = esp_srmodel_filter(models, ESP_WN_PREFIX, "walle");
@@ -116,14 +175,19 @@ esp_err_t sr_start(void)
     multinet->print_active_speech_commands(model_data);//输出目前激活的命令词
 
     // 三、麦克风和扬声器配置
-    // 1.初始化inmp441和max98357
+    // 1.初始化inmp441和max98357（DMA缓冲区长度跟随AFE feed chunk）
+    int dma_chunk = afe_handle->get_feed_chunksize(afe_data);
     inmp441_i2s_config_t inmp441_config = {
         .gpio_bclk = EXAMPLE_I2S_BCLK_IO1,
         .gpio_ws = EXAMPLE_I2S_WS_IO1,
         .gpio_din = EXAMPLE_I2S_DIN_IO1,
         .sample_rate = AUDIO_SAMPLE_RATE,
-        .bits_per_sample = AUDIO_BITS_PER_SAMPLE,
-        .channel_mode = INMP441_CHANNEL_LEFT, // 假设使用左声道
+        .bits_per_sample = MIC_BITS_PER_SAMPLE,
+        .channel_mode = (SR_MIC_NUM == 2) ? INMP441_CHANNEL_STEREO : INMP441_CHANNEL_LEFT, // 双麦为立体声，单麦使用左声道
+        .gain_shift = MIC_GAIN_SHIFT,
+        .capture_mode = INMP441_CAPTURE_CALLBACK, // DMA完成后直接从DMA缓冲区转换到feed_buff
+        .latency_profile = SR_I2S_LATENCY,
+        .dma_chunk_samples = dma_chunk,
     };
     max98357_i2s_config_t max98357_config = {
         .gpio_bclk = EXAMPLE_I2S_BCLK_IO2,
@@ -133,24 +197,108 @@ esp_err_t sr_start(void)
         .bits_per_sample = AUDIO_BITS_PER_SAMPLE,
         .channel_mode = MAX98357_CHANNEL_MONO, // 使用单声道
         .slot_mask = MAX98357_MASK_LEFT, // 使用左声道输出
+        .on_sent = SR_AEC_ENABLE ? aec_ref_on_sent : NULL, // 回采扬声器输出作为AEC参考
+        .latency_profile = SR_I2S_LATENCY,
+        .dma_chunk_samples = dma_chunk,
     };
+    if (SR_AEC_ENABLE && aec_ref_init(AUDIO_SAMPLE_RATE) != ESP_OK) {
+        return ESP_ERR_NO_MEM;
+    }
     inmp441_i2s_init(&inmp441_config);
     max98357_i2s_init(&max98357_config);
+    // 2.播放扫频测量扬声器到麦克风的延迟，使参考信号与回声逐采样对齐（必须在其他任务使用麦克风/扬声器之前）
+    if (SR_AEC_ENABLE && aec_ref_calibrate(SR_MIC_NUM, NULL) != ESP_OK) {
+        aec_ref_set_delay(AUDIO_SAMPLE_RATE * SR_AEC_DEFAULT_DELAY_MS / 1000);
+        ESP_LOGW(TAG, "AEC delay calibration failed, using default %d ms", SR_AEC_DEFAULT_DELAY_MS);
+    }
+    // 3.启动混音器（此后只有混音任务写I2S，混音块长取扬声器DMA缓冲区长度）和下行播放器（服务器下发的音频经抖动缓冲后播放）
+    audio_mixer_config_t mixer_cfg = AUDIO_MIXER_DEFAULT_CONFIG();
+    i2s_dma_layout_t tx_layout;
+    if (max98357_i2s_get_dma_layout(&tx_layout) == ESP_OK) {
+        mixer_cfg.block_samples = tx_layout.frame_num;
+    }
+    if (audio_mixer_start(&mixer_cfg) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start audio mixer");
+        return ESP_ERR_NO_MEM;
+    }
+    audio_player_start(NULL);
+    // 服务器协商为 Opus 时，下行包先经过解码任务（含丢包补偿）再进入播放器
+    opus_downlink_start(NULL);
+
+    // 四、音频帧总线：detect_Task发布AFE输出，扬声器和上行各自订阅，I/O阻塞不会拖慢检测
+    int fetch_bytes = afe_handle->get_fetch_chunksize(afe_data) * sizeof(int16_t);
+    esp_err_t bus_ret = audio_bus_init(fetch_bytes, SR_BUS_POOL_SIZE);
+    if (bus_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize audio bus: %s", esp_err_to_name(bus_ret));
+        return bus_ret;
+    }
+    audio_bus_sub_handle_t speaker_sub = audio_bus_subscribe("speaker", SR_SPEAKER_QUE_DEPTH, AUDIO_BUS_DROP_OLDEST);
+    audio_mixer_stream_config_t monitor_cfg = {
+        .name = "monitor",
+        .priority = AUDIO_MIXER_PRIO_MONITOR,
+        .gain = SR_MONITOR_GAIN,
+        .duck_gain = SR_MONITOR_DUCK_GAIN,
+        .buffer_ms = 64,
+    };
+    if (speaker_sub && audio_mixer_stream_create(&monitor_cfg, &s_monitor_stream) != ESP_OK) {
+        audio_bus_unsubscribe(speaker_sub);
+        speaker_sub = NULL;
+    }
 
-    // 四、创建afe任务（3个任务调用）
+    // 五、创建afe任务（3个任务调用）
     task_flag = true; // 设置任务标志位为true，表示任务可以执行
     g_result_que = xQueueCreate(1, sizeof(sr_result_t));
-    xTaskCreatePinnedToCore(feed_Task, "feed_Task", 4 * 1024, afe_data, 5, NULL, 0);
-    xTaskCreatePinnedToCore(detect_Task, "detect_Task", 6 * 1024, afe_data, 5, NULL, 1);
+    xTaskCreatePinnedToCore(feed_Task, "feed_Task", 4 * 1024, afe_data, 5, &s_feed_task, 0);
+    xTaskCreatePinnedToCore(detect_Task, "detect_Task", 6 * 1024, afe_data, 5, &s_detect_task, 1);
     xTaskCreatePinnedToCore(sr_handler_task, "sr_handler_task", 4 * 1024, g_result_que, 1, NULL, 0);
+    // 六、创建总线订阅者任务（扬声器回放、上行发送）
+    if (speaker_sub) {
+        xTaskCreatePinnedToCore(speaker_Task, "speaker_Task", 3 * 1024, speaker_sub, 4, &s_speaker_task, 0);
+    }
+    // 上行帧合并后再发送（唤醒/VAD边沿立即发送），减少每秒的 WebSocket 发送次数
+    // 合并后的消息交给独立的发送任务，TCP阻塞时不会卡住上行和识别任务
+    websocket_client_set_batch(NULL);
+    websocket_send_queue_start(NULL);
+    // 默认按VAD语音段发送；只在唤醒后发送时改为唤醒会话模式：
+    // audio_uplink_gate_config_t gate = AUDIO_UPLINK_GATE_DEFAULT_CONFIG();
+    // gate.mode = AUDIO_UPLINK_MODE_WAKE_SESSION;
+    // audio_uplink_set_gate(&gate);
+    audio_uplink_start();
 
     ESP_LOGI(TAG, "sr_start done");
     return ESP_OK;
 }
 
+/**
+ * @brief 获取最近一次有效的说话人方向
+ */
+float sr_get_doa(void)
+{
+    return s_doa_deg;
+}
+
+/**
+ * @brief 等待任务退出（任务退出前会把自己的句柄清零）
+ *
+ * @param task 任务句柄变量
+ * @param name 任务名，用于日志
+ * @return 按时退出返回true
+ */
+static bool sr_wait_task_exit(TaskHandle_t *task, const char *name)
+{
+    for (int i = 0; i < SR_TASK_STOP_TIMEOUT_MS / 10 && *task != NULL; i++) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    if (*task != NULL) {
+        ESP_LOGE(TAG, "%s did not exit in time", name);
+        return false;
+    }
+    return true;
+}
+
 /**
  * @brief 停止语音识别
- * 清除所有资源，包括：AFE、MN、麦克风和扬声器等
+ * 清除所有资源，包括：AFE、MN、麦克风、扬声器和音频帧总线等
  * 
  * @return esp_err_t 
  */
@@ -161,10 +309,31 @@ esp_err_t sr_stop(void)
     // 停止任务
     task_flag = false;
     detect_flag = false;
+    // 总线的发布者和订阅者都退出后才能释放帧池；扬声器任务可能阻塞在混音器写入，要在停止混音器之前等待
+    bool bus_idle = audio_uplink_stop() == ESP_OK;
+    bus_idle &= sr_wait_task_exit(&s_speaker_task, "speaker_Task");
+    bus_idle &= sr_wait_task_exit(&s_detect_task, "detect_Task");
+    if (bus_idle) {
+        audio_bus_deinit();
+    } else {
+        // 仍有任务在使用帧，宁可泄漏也不能释放；下次sr_start会复用同样大小的帧池
+        ESP_LOGE(TAG, "Audio bus still in use, not released");
+    }
+    // feed_Task 使用麦克风、AEC参考信号和AFE，退出后才能关闭和销毁它们
+    bool feed_done = sr_wait_task_exit(&s_feed_task, "feed_Task");
+    websocket_send_queue_stop();
+    opus_downlink_stop();
+    audio_player_stop();
+    audio_mixer_stop();
+    if (!feed_done || s_detect_task != NULL) {
+        ESP_LOGE(TAG, "AFE tasks still running, microphone/AEC reference/AFE not released");
+        return ESP_ERR_TIMEOUT;
+    }
 
     // 关闭麦克风和扬声器
     inmp441_i2s_close();
     max98357_i2s_close();
+    aec_ref_deinit();
 
     // 销毁AFE句柄
     if (afe_handle) {
@@ -206,35 +375,175 @@ static void feed_Task(void *arg)
     ESP_LOGI(TAG, "feed_Task started with chunksize: %d, channels: %d", feed_chunksize, feed_nch);
     // 2.分配内存存储采集的音频数据
     // int16_t *feed_buff = (int16_t *) heap_caps_malloc(feed_chunksize * feed_nch * sizeof(int16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    int16_t *feed_buff = (int16_t *) malloc(feed_chunksize * feed_nch * sizeof(int16_t));
+    // 16字节对齐，32位采集模式下可以走 aes3 向量转换
+    int16_t *feed_buff = (int16_t *) heap_caps_aligned_alloc(16, feed_chunksize * feed_nch * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
     assert(feed_buff);
+    // 立体声采集时驱动输出的已经是交错的 [L, R, L, R, ...]，即AFE的 "MM" 格式；
+    // 有参考通道时（"MR"/"MMR"），麦克风和参考信号分别取出后再按帧交错成 [mic..., ref, mic..., ref, ...]
+    const int mic_num = SR_MIC_NUM;
+    bool with_ref = (feed_nch == mic_num + 1);
+    int16_t *mic_buff = feed_buff;
+    int16_t *ref_buff = NULL;
+    if (with_ref) {
+        mic_buff = (int16_t *) heap_caps_aligned_alloc(16, feed_chunksize * mic_num * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        ref_buff = (int16_t *) heap_caps_malloc(feed_chunksize * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        assert(mic_buff && ref_buff);
+    }
+    // 双麦：DOA（SRP-PHAT）直接使用交错的 "MM" 数据估计说话人方向
+    afe_doa_handle_t *doa = NULL;
+    if (mic_num == 2) {
+        doa = afe_doa_create("MM", AUDIO_SAMPLE_RATE, SR_DOA_RESOLUTION_DEG, SR_MIC_SPACING_M, feed_chunksize);
+        if (doa == NULL) {
+            ESP_LOGW(TAG, "Failed to create DOA, direction estimation disabled");
+        }
+    }
 
     // 循环采集音频数据
     while (task_flag) {
         size_t bytesIn = 0;
         // 3.从I2S读取音频数据
         // esp_err_t result = i2s_read(I2S_NUM_0, feed_buff, feed_chunksize * feed_nch * sizeof(int16_t), &bytesIn, portMAX_DELAY);
-        esp_err_t result = inmp441_i2s_read(feed_buff, feed_chunksize * feed_nch * sizeof(int16_t), &bytesIn, portMAX_DELAY);
+        esp_err_t result = inmp441_i2s_read(mic_buff, feed_chunksize * mic_num * sizeof(int16_t), &bytesIn,
+                                            pdMS_TO_TICKS(SR_FEED_READ_TIMEOUT_MS));
+        if (result == ESP_ERR_TIMEOUT) {
+            continue; // 麦克风暂时没有数据，重新检查 task_flag
+        }
         if (result != ESP_OK) {
             ESP_LOGE(TAG, "Failed to read audio data from INMP441: %s", esp_err_to_name(result));
             continue; // 如果读取失败，继续下一次循环
         }
 
-        // 4.将采集到的音频数据传递给AFE处理
+        // 4.有声音时更新说话人方向（按帧能量门限，静音帧不更新）
+        if (doa) {
+            int64_t energy = 0;
+            for (int i = 0; i < feed_chunksize * mic_num; i += mic_num) {
+                energy += (int32_t)mic_buff[i] * mic_buff[i];
+            }
+            if (energy > (int64_t)SR_DOA_MIN_RMS * SR_DOA_MIN_RMS * feed_chunksize) {
+                float angle = afe_doa_process(doa, mic_buff);
+                s_doa_deg = (s_doa_deg < 0) ? angle : 0.7f * s_doa_deg + 0.3f * angle;
+            }
+        }
+
+        // 5.取出与这帧麦克风数据对齐的扬声器参考信号，交错成AFE的输入格式
+        if (with_ref) {
+            aec_ref_fetch(ref_buff, feed_chunksize, inmp441_i2s_get_read_timestamp());
+            if (mic_num == 2) {
+                // 一次拷贝一对 L/R（32位）
+                const uint32_t *mm = (const uint32_t *)mic_buff;
+                for (int i = 0; i < feed_chunksize; i++) {
+                    memcpy(&feed_buff[3 * i], &mm[i], sizeof(uint32_t));
+                    feed_buff[3 * i + 2] = ref_buff[i];
+                }
+            } else {
+                for (int i = 0; i < feed_chunksize; i++) {
+                    feed_buff[2 * i] = mic_buff[i];
+                    feed_buff[2 * i + 1] = ref_buff[i];
+                }
+            }
+        }
+
+        // 6.将采集到的音频数据传递给AFE处理
         afe_handle->feed(afe_data, feed_buff);
     }
 
-    // 5.释放采集的音频数据缓冲区
+    // 7.释放采集的音频数据缓冲区
+    if (doa) {
+        afe_doa_destroy(doa);
+    }
+    if (with_ref) {
+        heap_caps_free(mic_buff);
+        heap_caps_free(ref_buff);
+    }
     if (feed_buff) {
-        free(feed_buff);
+        heap_caps_free(feed_buff);
         feed_buff = NULL;
     }
 
+    inmp441_capture_stats_t cap_stats;
+    if (inmp441_i2s_get_capture_stats(&cap_stats) == ESP_OK) {
+        ESP_LOGI(TAG, "[feed_Task] capture: delivered=%lu dropped=%lu late=%lu latency avg=%luus max=%luus",
+                 (unsigned long)cap_stats.delivered, (unsigned long)cap_stats.dropped, (unsigned long)cap_stats.late,
+                 (unsigned long)cap_stats.latency_avg_us, (unsigned long)cap_stats.latency_max_us);
+    }
+    i2s_latency_stats_t lat_stats;
+    if (inmp441_i2s_get_latency_stats(&lat_stats) == ESP_OK) {
+        ESP_LOGI(TAG, "[feed_Task] mic dma: %lux%lu (%lums) buffered avg=%luus max=%luus overruns=%lu",
+                 (unsigned long)lat_stats.desc_num, (unsigned long)lat_stats.frame_num,
+                 (unsigned long)(lat_stats.dma_buffer_us / 1000), (unsigned long)lat_stats.buffered_avg_us,
+                 (unsigned long)lat_stats.buffered_max_us, (unsigned long)lat_stats.overruns);
+    }
+    aec_ref_stats_t ref_stats;
+    if (with_ref && aec_ref_get_stats(&ref_stats) == ESP_OK) {
+        ESP_LOGI(TAG, "[feed_Task] aec reference: delay=%d resyncs=%lu waits=%lu missing=%lu",
+                 ref_stats.delay_samples, (unsigned long)ref_stats.resyncs,
+                 (unsigned long)ref_stats.waits, (unsigned long)ref_stats.missing);
+    }
+
     ESP_LOGI(TAG, "[feed_Task] finished");
+    s_feed_task = NULL;
 
     vTaskDelete(NULL);
 }
 
+/**
+ * @brief 把VAD缓存的语音起始部分发布到音频帧总线（带 AUDIO_FRAME_FLAG_PREROLL）
+ *
+ * @param cache      vad_cache
+ * @param bytes      vad_cache_size
+ * @param frame_size 每帧最大字节数
+ */
+static void sr_publish_preroll(const int16_t *cache, int bytes, int frame_size)
+{
+    int64_t now = esp_timer_get_time();
+    for (int off = 0; off < bytes; off += frame_size) {
+        audio_frame_t *frame = audio_bus_frame_alloc(0);
+        if (frame == NULL) {
+            ESP_LOGD(TAG, "audio bus pool exhausted, pre-roll dropped");
+            return;
+        }
+        int len = (bytes - off < frame_size) ? bytes - off : frame_size;
+        memcpy(frame->data, (const uint8_t *)cache + off, len);
+        frame->len = len;
+        // 缓存的最后一个采样紧挨着当前帧
+        frame->timestamp_us = now - (int64_t)(bytes - off) / sizeof(int16_t) * 1000000 / AUDIO_SAMPLE_RATE;
+        frame->flags |= AUDIO_FRAME_FLAG_SPEECH | AUDIO_FRAME_FLAG_PREROLL;
+        audio_bus_publish(frame);
+    }
+}
+
+/**
+ * @brief 把一帧AFE输出发布到音频帧总线
+ * 帧池耗尽时直接丢弃该帧（说明所有订阅者都积压了），不阻塞检测
+ *
+ * @param res AFE fetch结果
+ */
+static void sr_publish_frame(const afe_fetch_result_t *res)
+{
+    // VAD刚判定为语音时，vad_cache 中是被截掉的语音起始部分，按帧长拆分后先于本帧发布（时间戳按采样数往前推）
+    if (res->vad_cache_size > 0) {
+        sr_publish_preroll(res->vad_cache, res->vad_cache_size, res->data_size);
+    }
+
+    audio_frame_t *frame = audio_bus_frame_alloc(0);
+    if (frame == NULL) {
+        ESP_LOGD(TAG, "audio bus pool exhausted, frame dropped");
+        return;
+    }
+    memcpy(frame->data, res->data, res->data_size);
+    frame->len = res->data_size;
+    frame->timestamp_us = esp_timer_get_time();
+    if (res->vad_state == VAD_SPEECH) {
+        frame->flags |= AUDIO_FRAME_FLAG_SPEECH;
+    }
+    if (res->wakeup_state == WAKENET_DETECTED) {
+        frame->flags |= AUDIO_FRAME_FLAG_WAKEUP;
+        // 唤醒会话从唤醒词开头补发，先告诉上行唤醒词的长度
+        audio_uplink_notify_wake(res->wake_word_length);
+    }
+    audio_bus_publish(frame);
+}
+
 /**
  * @brief 音频检测任务
  * 该任务负责从AFE获取音频数据，并进行唤醒词检测和指令识别
@@ -261,17 +570,14 @@ static void detect_Task(void *arg)
         // 3.从AFE获取音频数据（res->data_size = 1024（字节数=512*2））
         afe_fetch_result_t* res = afe_handle->fetch(afe_data);
 
-        // 在MAX98357中播放
-        max98357_i2s_write(res->data, res->data_size, NULL, portMAX_DELAY);
-        // 发送给服务器播放
-        websocket_client_send_binary((const uint8_t *)res->data, res->data_size);
-
-
         if (!res || res->ret_value == ESP_FAIL) {
             ESP_LOGE(TAG, "fetch error!");
             break;
         }
 
+        // 发布到音频帧总线（扬声器播放、发送给服务器都由各自的订阅者任务完成）
+        sr_publish_frame(res);
+
         // 4.1.检测到唤醒词（但是要等到verify之后才能获取afe数据）
         if (res->wakeup_state == WAKENET_DETECTED) {
             ESP_LOGI(TAG, "model index:%d, word index:%d", res->wakenet_model_index, res->wake_word_index);
@@ -280,6 +586,7 @@ static void detect_Task(void *arg)
                 .wakenet_mode = WAKENET_DETECTED,
                 .state = ESP_MN_STATE_DETECTING,
                 .command_id = 0,
+                .doa_deg = s_doa_deg,
             };
             // 开启命令词
             detect_flag = true;
@@ -312,9 +619,11 @@ static void detect_Task(void *arg)
                     .wakenet_mode = WAKENET_NO_DETECT,
                     .state = mn_state,
                     .command_id = 0,
+                    .doa_deg = -1.0f,
                 };
                 // 将超时结果发送到结果队列
                 xQueueSend(g_result_que, &result, 10);
+                audio_uplink_session_end(AUDIO_UPLINK_SESSION_END_TIMEOUT, -1);
                 // 清空afe缓冲区，因为存在延迟，所以丢弃旧的数据保证实时
                 afe_handle->reset_buffer(afe_data);
                 // 重新启用唤醒词检测
@@ -338,9 +647,11 @@ static void detect_Task(void *arg)
                     .wakenet_mode = WAKENET_NO_DETECT,
                     .state = mn_state,
                     .command_id = sr_command_id,
+                    .doa_deg = -1.0f,
                 };
                 // 将检测到的指令结果发送到结果队列
                 xQueueSend(g_result_que, &result, 10);
+                audio_uplink_session_end(AUDIO_UPLINK_SESSION_END_COMMAND, sr_command_id);
                 // // 检测到命令后，重新启用唤醒词检测（一次唤醒词 -> 一次命令词）
                 // afe_handle->enable_wakenet(afe_data);
                 // detect_flag = false;
@@ -354,6 +665,7 @@ static void detect_Task(void *arg)
     //     model_data = NULL;
     // }
 
+    s_detect_task = NULL;
     vTaskDelete(NULL);
 }
 
@@ -383,7 +695,15 @@ static void sr_handler_task(void *pvParam)
 
         // 2.如果是检测到唤醒词
         if (WAKENET_DETECTED == result.wakenet_mode) {
-            ESP_LOGI(TAG, "wakenet detected");
+            ESP_LOGI(TAG, "wakenet detected, direction: %.0f deg", result.doa_deg);
+            // 把唤醒事件和说话人方向发给服务器
+            if (websocket_is_connected()) {
+                char msg[64];
+                snprintf(msg, sizeof(msg), "{\"type\":\"wake\",\"doa\":%d}", (int)result.doa_deg);
+                if (websocket_client_send_text_async(msg, WEBSOCKET_SEND_NEVER_DROP) == ESP_ERR_TIMEOUT) {
+                    ESP_LOGW(TAG, "send queue full, wake event not sent");
+                }
+            }
             
             printf("%d",result.command_id);
             continue;
@@ -395,3 +715,36 @@ static void sr_handler_task(void *pvParam)
         }
     }
 }
+
+/**
+ * @brief 扬声器回放任务（音频帧总线订阅者）
+ * 写入混音器的监听流，流缓冲区写满时只会阻塞本任务，队列满后丢弃最旧的帧
+ *
+ * @param arg 订阅者句柄
+ */
+static void speaker_Task(void *arg)
+{
+    audio_bus_sub_handle_t sub = (audio_bus_sub_handle_t)arg;
+
+    while (task_flag) {
+        audio_frame_t *frame = audio_bus_receive(sub, pdMS_TO_TICKS(100));
+        if (frame == NULL) {
+            continue;
+        }
+        // 预滚动帧之前已经播放过
+        if (frame->flags & AUDIO_FRAME_FLAG_PREROLL) {
+            audio_frame_release(frame);
+            continue;
+        }
+        // 经混音器在MAX98357中播放
+        audio_mixer_write(s_monitor_stream, frame->data, frame->len, NULL, portMAX_DELAY);
+        audio_frame_release(frame);
+    }
+
+    audio_bus_unsubscribe(sub);
+    audio_mixer_stream_delete(s_monitor_stream);
+    s_monitor_stream = NULL;
+    ESP_LOGI(TAG, "[speaker_Task] finished");
+    s_speaker_task = NULL;
+    vTaskDelete(NULL);
+}
@@ -0,0 +1,243 @@
+#!/usr/bin/env python3
+"""本地替身服务器：在 Linux 上测试 UDP 音频通道（udp_audio.h），并和 WebSocket 通道对比丢帧和延迟。
+
+    pip install websockets
+    python3 tools/udp_audio_server.py --ws-port 8000 --udp-port 5005 [--loss 5] [--no-udp] [--echo]
+
+WebSocket（ws://<本机IP>:8000/ws）处理握手和控制消息：回复 hello 时协商帧头，并分配 UDP 端口和会话标识；
+回复设备的 ping（pong），设备据此得到 TCP 的往返时间。UDP 端口接收音频数据报并原样回送探测数据报。
+--loss 按百分比随机丢弃收到的 UDP 数据报，模拟弱网以验证冗余恢复；--no-udp 不分配 UDP，所有音频走 WebSocket，
+用于在同样的网络条件下对比两条通道；--echo 把收到的 PCM16 帧经 UDP 发回设备播放（下行通道）。
+
+每 --report 秒打印每条通道的统计：帧数、丢帧率（按帧头序号）、冗余恢复的帧数、到达抖动（RFC 3550）、
+单向延迟的变化（到达时间 - 采集时间，减去最小值，p50/p95）。设备端的 UDP_AUDIO 日志打印两条通道的往返时间。
+
+--certfile/--keyfile 改为 wss://，用来测试设备端的TLS会话复用（websocket_client_set_tls），例如用自签名证书：
+    openssl req -x509 -newkey ec -pkeyopt ec_paramgen_curve:P-256 -nodes -days 365 \
+        -keyout key.pem -out cert.pem -subj "/CN=<本机IP>" -addext "subjectAltName=IP:<本机IP>"
+服务器默认发放会话票据（TLS 1.2 和 1.3），每次连接打印该连接是否复用了会话。
+"""
+
+import argparse
+import asyncio
+import json
+import random
+import ssl
+import struct
+import time
+
+import websockets
+
+AUDIO_PROTO_HEADER = struct.Struct("<BBBBIIHH")     # version codec flags reserved seq timestamp_us payload_len samples
+UDP_HEADER = struct.Struct("<BBBBII")               # version type frames reserved seq token
+UDP_VERSION = 1
+UDP_TYPE_AUDIO = 0
+UDP_TYPE_PROBE = 1
+CODEC_PCM16 = 0
+
+
+class PathStats:
+    """一条通道（ws/udp）的接收统计。"""
+
+    def __init__(self, name):
+        self.name = name
+        self.reset()
+
+    def reset(self):
+        self.frames = 0
+        self.recovered = 0
+        self.duplicates = 0
+        self.first_seq = None
+        self.max_seq = None
+        self.seen = set()
+        self.jitter_us = 0.0
+        self.last_transit = None
+        self.transits = []
+
+    def add(self, seq, timestamp_us, recovered=False):
+        if seq in self.seen:
+            self.duplicates += 1
+            return False
+        self.seen.add(seq)
+        if self.first_seq is None:
+            self.first_seq = seq
+        self.max_seq = seq if self.max_seq is None else max(self.max_seq, seq)
+        self.frames += 1
+        if recovered:
+            self.recovered += 1
+        # 设备和本机时钟不同步，单向延迟只看变化量
+        transit = (time.monotonic_ns() // 1000 - timestamp_us) & 0xFFFFFFFF
+        if self.last_transit is not None:
+            d = abs(((transit - self.last_transit + 0x80000000) & 0xFFFFFFFF) - 0x80000000)
+            self.jitter_us += (d - self.jitter_us) / 16
+        self.last_transit = transit
+        self.transits.append(transit)
+        return True
+
+    def report(self):
+        if self.frames == 0:
+            return f"{self.name:>4}: no frames"
+        span = self.max_seq - self.first_seq + 1
+        lost = max(span - self.frames, 0)
+        base = min(self.transits)
+        delays = sorted(((t - base) & 0xFFFFFFFF) / 1000 for t in self.transits)
+        p50 = delays[len(delays) // 2]
+        p95 = delays[min(len(delays) - 1, len(delays) * 95 // 100)]
+        return (f"{self.name:>4}: frames={self.frames} lost={lost} ({lost * 100 / span:.1f}%) "
+                f"recovered={self.recovered} dup={self.duplicates} jitter={self.jitter_us / 1000:.1f} ms "
+                f"delay p50={p50:.1f} p95={p95:.1f} ms (relative)")
+
+
+def parse_frames(data, count=None):
+    """按 audio_proto 帧头拆分，返回 [(header, payload)]。"""
+    frames = []
+    off = 0
+    while off + AUDIO_PROTO_HEADER.size <= len(data) and (count is None or len(frames) < count):
+        hdr = AUDIO_PROTO_HEADER.unpack_from(data, off)
+        off += AUDIO_PROTO_HEADER.size
+        payload_len = hdr[6]
+        if hdr[0] != 1 or off + payload_len > len(data):
+            break
+        frames.append((hdr, data[off:off + payload_len]))
+        off += payload_len
+    return frames
+
+
+class Session:
+    def __init__(self, token, ws):
+        self.token = token
+        self.ws = ws
+        self.addr = None
+        self.framing = False
+        self.echo_seq = 0
+
+
+class UdpProtocol(asyncio.DatagramProtocol):
+    def __init__(self, server):
+        self.server = server
+        self.transport = None
+
+    def connection_made(self, transport):
+        self.transport = transport
+
+    def datagram_received(self, data, addr):
+        if len(data) < UDP_HEADER.size:
+            return
+        version, dtype, nframes, _, seq, token = UDP_HEADER.unpack_from(data)
+        session = self.server.sessions.get(token)
+        if version != UDP_VERSION or session is None:
+            return
+        # 模拟丢包（探测和音频都丢）
+        if random.random() * 100 < self.server.args.loss:
+            return
+        session.addr = addr
+        if dtype == UDP_TYPE_PROBE:
+            self.transport.sendto(data, addr)
+            return
+        if dtype != UDP_TYPE_AUDIO:
+            return
+        frames = parse_frames(data[UDP_HEADER.size:], nframes)
+        for i, (hdr, payload) in enumerate(frames):
+            # 冗余副本在前，新帧在最后
+            if self.server.udp.add(hdr[4], hdr[5], recovered=i < len(frames) - 1) and self.server.args.echo:
+                self.server.echo(session, hdr, payload)
+
+
+class Server:
+    def __init__(self, args):
+        self.args = args
+        self.sessions = {}
+        self.ws = PathStats("ws")
+        self.udp = PathStats("udp")
+        self.udp_proto = None
+
+    def echo(self, session, hdr, payload):
+        if hdr[1] != CODEC_PCM16 or session.addr is None:
+            return
+        out = UDP_HEADER.pack(UDP_VERSION, UDP_TYPE_AUDIO, 1, 0, session.echo_seq, session.token)
+        out += AUDIO_PROTO_HEADER.pack(1, CODEC_PCM16, 0, 0, session.echo_seq, hdr[5], len(payload), hdr[7]) + payload
+        session.echo_seq += 1
+        self.udp_proto.transport.sendto(out, session.addr)
+
+    async def handle_ws(self, ws, path=None):
+        token = random.getrandbits(31)
+        session = Session(token, ws)
+        self.sessions[token] = session
+        tls = ws.transport.get_extra_info("ssl_object")
+        resumed = f" tls={tls.version()} resumed={tls.session_reused}" if tls else ""
+        print(f"[ws] connected token={token}{resumed}")
+        try:
+            async for msg in ws:
+                if isinstance(msg, bytes):
+                    if session.framing:
+                        for hdr, _ in parse_frames(msg):
+                            self.ws.add(hdr[4], hdr[5])
+                    continue
+                try:
+                    obj = json.loads(msg)
+                except ValueError:
+                    continue
+                mtype = obj.get("type")
+                if mtype == "hello":
+                    await self.reply_hello(ws, session, obj)
+                elif mtype == "ping":
+                    await ws.send(json.dumps({"type": "pong", "id": obj.get("id"), "t": obj.get("t")}))
+                else:
+                    print(f"[ws] {msg}")
+        except websockets.ConnectionClosed:
+            pass
+        finally:
+            self.sessions.pop(token, None)
+            print(f"[ws] disconnected token={token}")
+
+    async def reply_hello(self, ws, session, hello):
+        uplink = hello.get("uplink", {})
+        codec = self.args.codec if self.args.codec in uplink.get("codecs", []) else "pcm16"
+        reply = {"type": "hello", "uplink_codec": codec}
+        if "v1" in uplink.get("framing", []):
+            reply["uplink_framing"] = "v1"
+            session.framing = True
+        if "udp" in hello and session.framing and not self.args.no_udp:
+            reply["udp"] = {"port": self.args.udp_port, "token": session.token}
+        await ws.send(json.dumps(reply))
+        print(f"[ws] hello: {json.dumps(hello)} -> {json.dumps(reply)}")
+        if self.args.echo:
+            await ws.send(json.dumps({"type": "audio_format", "sample_rate": 16000, "framing": "v1"}))
+
+    async def report(self):
+        while True:
+            await asyncio.sleep(self.args.report)
+            print(f"--- {time.strftime('%H:%M:%S')} (udp loss simulated {self.args.loss}%) ---")
+            print(self.ws.report())
+            print(self.udp.report())
+
+    async def run(self):
+        loop = asyncio.get_running_loop()
+        _, self.udp_proto = await loop.create_datagram_endpoint(lambda: UdpProtocol(self),
+                                                                 local_addr=("0.0.0.0", self.args.udp_port))
+        tls = None
+        if self.args.certfile:
+            tls = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+            tls.load_cert_chain(self.args.certfile, self.args.keyfile)
+        async with websockets.serve(self.handle_ws, "0.0.0.0", self.args.ws_port, max_size=None, ssl=tls):
+            scheme = "wss" if tls else "ws"
+            print(f"listening {scheme}://0.0.0.0:{self.args.ws_port}/ws udp:{self.args.udp_port}")
+            await self.report()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--ws-port", type=int, default=8000)
+    parser.add_argument("--udp-port", type=int, default=5005)
+    parser.add_argument("--codec", default="ima_adpcm", help="上行编码格式（设备支持时），pcm16 时 --echo 可以回放")
+    parser.add_argument("--loss", type=float, default=0.0, help="随机丢弃收到的UDP数据报的百分比")
+    parser.add_argument("--no-udp", action="store_true", help="不分配UDP，音频走 WebSocket（对比用）")
+    parser.add_argument("--echo", action="store_true", help="把收到的 PCM16 帧经UDP发回设备")
+    parser.add_argument("--report", type=float, default=5.0, help="统计打印间隔（秒）")
+    parser.add_argument("--certfile", help="服务器证书（PEM），指定后使用 wss://")
+    parser.add_argument("--keyfile", help="服务器私钥（PEM）")
+    asyncio.run(Server(parser.parse_args()).run())
+
+
+if __name__ == "__main__":
+    main()